@@ -0,0 +1,185 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 블록 캐시를 갖춘 아카이브 임의 접근 리더를 구현합니다.
+// EN: This file implements the random-access archive reader with its block cache.
+#include "ArchiveReader.h"
+#include "../BlockCodec/BlockCodec.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+ArchiveReader::ArchiveReader(size_t cache_bytes, const TrainedModel* model)
+    : cache_capacity(cache_bytes), model(model) {
+}
+
+bool ArchiveReader::open(const std::filesystem::path& path) {
+    archive_file.open(path, std::ios::binary);
+    if (!archive_file.is_open()) {
+        std::cerr << "Error: Cannot open archive '" << path.string() << "'." << std::endl;
+        return false;
+    }
+    if (!read_container_index(archive_file, archive_index)) {
+        std::cerr << "Error: '" << path.string() << "' is not a TriSplit archive with a readable block index." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ArchiveReader::Block ArchiveReader::block(size_t block_index) {
+    if (block_index >= archive_index.blocks.size()) return nullptr;
+
+    // KO: 캐시에 있으면 LRU 맨 앞으로 옮겨 반환하고, 다른 스레드가 복호화 중이면 그 결과를 기다립니다.
+    //     둘 다 아니면 이 스레드가 복호화를 맡았음을 in_flight에 알리고 잠금 밖에서 복호화합니다.
+    // EN: A cached block moves to the front of the LRU and is returned, and a block another thread is decoding is waited for.
+    //     Otherwise this thread claims the decoding in in_flight and decodes outside the lock.
+    std::promise<Block> promise;
+    {
+        std::unique_lock<std::mutex> lock(cache_mutex);
+        const auto cached = cache.find(block_index);
+        if (cached != cache.end()) {
+            lru.splice(lru.begin(), lru, cached->second.position);
+            return cached->second.data;
+        }
+        const auto pending = in_flight.find(block_index);
+        if (pending != in_flight.end()) {
+            std::shared_future<Block> result = pending->second;
+            lock.unlock();
+            return result.get();
+        }
+        in_flight.emplace(block_index, promise.get_future().share());
+    }
+
+    Block data = decode(block_index);
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (data != nullptr) insert_locked(block_index, data);
+        in_flight.erase(block_index);
+    }
+    promise.set_value(data);
+    return data;
+}
+
+ArchiveReader::Block ArchiveReader::cached(size_t block_index) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    const auto entry = cache.find(block_index);
+    if (entry == cache.end()) return nullptr;
+    lru.splice(lru.begin(), lru, entry->second.position);
+    return entry->second.data;
+}
+
+void ArchiveReader::insert_locked(size_t block_index, const Block& data) {
+    // KO: 캐시보다 큰 블록은 보관하지 않습니다. 나머지는 가장 오래 쓰지 않은 블록부터 내보내 자리를 만듭니다.
+    //     연결 사슬을 푸는 스레드가 이미 넣은 블록은 다시 넣지 않습니다.
+    // EN: A block larger than the cache is not kept. Otherwise the least recently used blocks are evicted to make room.
+    //     A block already inserted by a thread decoding a linked chain is not inserted again.
+    if (data->size() > cache_capacity || cache.count(block_index) != 0) return;
+    while (cached_bytes + data->size() > cache_capacity && !lru.empty()) {
+        const auto evicted = cache.find(lru.back());
+        cached_bytes -= evicted->second.data->size();
+        cache.erase(evicted);
+        lru.pop_back();
+    }
+    lru.push_front(block_index);
+    cache.emplace(block_index, CacheEntry{ data, lru.begin() });
+    cached_bytes += data->size();
+}
+
+bool ArchiveReader::read_block(size_t block_index, std::vector<uint8_t>& compressed) {
+    std::lock_guard<std::mutex> lock(file_mutex);
+    archive_file.clear();
+    return read_container_block(archive_file, archive_index.blocks[block_index], compressed);
+}
+
+ArchiveReader::Block ArchiveReader::decompress(size_t block_index, const std::vector<uint8_t>& compressed, const std::vector<uint8_t>* previous) {
+    // KO: 엔트로피 복호기는 손상된 페이로드에서 예외를 던지므로, 기다리는 스레드에 실패로 전합니다.
+    // EN: The entropy decoders throw on corrupted payloads, which is handed to the waiting threads as a failure.
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    try {
+        *data = decompress_block(compressed, model, previous);
+    }
+    catch (const std::exception& error) {
+        std::cerr << "Error: Block " << block_index << " is corrupted (" << error.what() << ")." << std::endl;
+        return nullptr;
+    }
+    if (data->size() != archive_index.blocks[block_index].original_size) return nullptr;
+    return data;
+}
+
+// KO: 참조를 푸는 중첩의 최대 깊이입니다. 참조는 앞선 블록만 가리키지만, 그 블록이나 그 연결 사슬의 시작이 다시 참조일 수 있으므로
+//     손상된 아카이브가 스택을 다 쓰지 않도록 제한합니다. 압축기가 만드는 참조는 처음 나온 블록을 가리키므로 이 깊이에 이르지 않습니다.
+// EN: The most nested references resolved at once. A reference only points to earlier blocks, but that block or the start
+//     of its linked chain may be a reference again, so the depth is bounded to keep a corrupted archive from exhausting the
+//     stack. References written by the compressor point to first occurrences and never come near this depth.
+constexpr unsigned MAX_REFERENCE_DEPTH = 64;
+static thread_local unsigned reference_depth = 0;
+
+ArchiveReader::Block ArchiveReader::decode(size_t block_index) {
+    const ContainerBlock& entry = archive_index.blocks[block_index];
+    std::vector<uint8_t> compressed;
+    if (!read_block(block_index, compressed)) return nullptr;
+
+    uint64_t reference_offset, reference_size;
+    if (read_reference_block(compressed, reference_offset, reference_size)) {
+        // KO: 참조는 항상 앞선 데이터를 가리키므로, 다시 읽어도 순환하지 않습니다.
+        // EN: A reference always points to earlier data, so reading it again never cycles.
+        if (reference_size != entry.original_size || reference_size > entry.original_offset ||
+            reference_offset > entry.original_offset - reference_size || reference_depth >= MAX_REFERENCE_DEPTH) {
+            return nullptr;
+        }
+        auto data = std::make_shared<std::vector<uint8_t>>(reference_size);
+        reference_depth++;
+        const size_t copied = read(reference_offset, data->data(), data->size());
+        reference_depth--;
+        if (copied != data->size()) return nullptr;
+        return data;
+    }
+    if (!is_linked_block(compressed)) return decompress(block_index, compressed, nullptr);
+
+    // KO: 연결 블록: 캐시에 있거나 연결되지 않은 가장 가까운 앞 블록(재시작 지점)까지 헤더만 읽으며 거슬러 올라간 뒤,
+    //     거기서부터 앞으로 차례로 복호화합니다. 사슬의 길이와 관계없이 스택 깊이는 일정하며, 중간 블록은 캐시에 넣습니다.
+    // EN: Linked block: walks back reading only the blocks until the nearest earlier block that is cached or not linked
+    //     (a reset point), then decodes forward from there in turn. The stack depth stays constant whatever the length of
+    //     the chain, and the blocks in between go into the cache.
+    size_t first = block_index;
+    Block previous;
+    std::vector<uint8_t> earlier;
+    while (previous == nullptr) {
+        if (first == 0) return nullptr;
+        first--;
+        if ((previous = cached(first)) != nullptr) break;
+        if (!read_block(first, earlier)) return nullptr;
+        if (!is_linked_block(earlier) && (previous = block(first)) == nullptr) return nullptr;
+    }
+    for (size_t i = first + 1; i < block_index; ++i) {
+        if (!read_block(i, earlier) || (previous = decompress(i, earlier, previous.get())) == nullptr) return nullptr;
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        insert_locked(i, previous);
+    }
+    return decompress(block_index, compressed, previous.get());
+}
+
+size_t ArchiveReader::read(uint64_t offset, uint8_t* output, size_t size) {
+    const std::vector<ContainerBlock>& blocks = archive_index.blocks;
+    // KO: offset을 포함하는 첫 블록을 원본 오프셋으로 이분 탐색합니다.
+    // EN: Binary-searches the original offsets for the first block that contains offset.
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), offset,
+                               [](uint64_t value, const ContainerBlock& block) { return value < block.original_offset; });
+    if (it == blocks.begin()) return 0;
+    size_t block_index = static_cast<size_t>(it - blocks.begin()) - 1;
+
+    size_t copied = 0;
+    while (copied < size && block_index < blocks.size()) {
+        const ContainerBlock& entry = blocks[block_index];
+        const uint64_t within = offset + copied - entry.original_offset;
+        if (within >= entry.original_size) {
+            block_index++;
+            continue;
+        }
+        const Block data = block(block_index);
+        if (data == nullptr) break;
+        const size_t length = static_cast<size_t>(std::min<uint64_t>(size - copied, entry.original_size - within));
+        memcpy(output + copied, data->data() + within, length);
+        copied += length;
+        block_index++;
+    }
+    return copied;
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "../Container/Container.h"
+#include "../TrainedModel/TrainedModel.h"
+
+// KO: 압축 아카이브를 임의 위치에서 읽는 객체입니다. 블록 색인으로 읽을 블록을 찾고, 복호화된 블록을
+//     크기 제한이 있는 LRU 캐시에 블록 번호로 보관하므로, 같은 블록을 반복해서 읽으면 복사 한 번으로 끝납니다.
+//     여러 스레드가 동시에 읽을 수 있으며, 같은 블록을 동시에 요청하면 한 스레드만 복호화하고 나머지는 그 결과를 기다립니다.
+// EN: An object that reads a compressed archive at arbitrary positions. The block index locates the blocks to read,
+//     and decoded blocks are kept by block index in a size-bounded LRU cache, so repeated reads of a block are a single copy.
+//     Several threads may read at once, and when the same block is requested concurrently only one thread decodes it
+//     while the others wait for its result.
+class ArchiveReader {
+public:
+    using Block = std::shared_ptr<const std::vector<uint8_t>>;
+
+    // KO: @param cache_bytes - 캐시가 보관할 복호화된 블록의 최대 바이트 수
+    //     @param model - 학습된 모델 블록을 복호화할 모델 (없으면 nullptr). 리더보다 오래 살아 있어야 합니다.
+    // EN: @param cache_bytes - The most bytes of decoded blocks the cache keeps
+    //     @param model - The model to decode trained-model blocks with (nullptr if none). It must outlive the reader.
+    explicit ArchiveReader(size_t cache_bytes = 256 * 1024 * 1024, const TrainedModel* model = nullptr);
+
+    // KO: 아카이브를 열고 블록 색인을 읽습니다. 실패하면 오류를 출력하고 false를 반환합니다. 읽기를 시작하기 전에 한 번만 호출합니다.
+    // EN: Opens an archive and reads its block index. Prints an error and returns false on failure. Call it once, before reading.
+    bool open(const std::filesystem::path& path);
+
+    const ContainerIndex& index() const { return archive_index; }
+    uint64_t size() const { return archive_index.original_size(); }
+
+    // KO: 복호화된 블록 하나를 반환합니다. 블록이 손상되었거나 범위 밖이면 nullptr를 반환합니다.
+    // EN: Returns one decoded block. Returns nullptr if the block is corrupted or out of range.
+    Block block(size_t block_index);
+
+    // KO: 원본 데이터의 [offset, offset + size) 구간을 output에 복사하고 복사한 바이트 수를 반환합니다.
+    //     데이터의 끝이나 손상된 블록에서 멈추므로, 반환 값이 size보다 작을 수 있습니다.
+    // EN: Copies the range [offset, offset + size) of the original data to output and returns the number of bytes copied.
+    //     It stops at the end of the data or at a corrupted block, so the result may be less than size.
+    size_t read(uint64_t offset, uint8_t* output, size_t size);
+
+private:
+    // KO: 블록을 파일에서 읽어 복호화합니다. 참조 블록은 앞선 데이터를 read로 다시 읽어 풀고, 연결 블록은 가장 가까운 재시작 지점
+    //     (또는 캐시된 앞 블록)부터 재귀 없이 차례로 풉니다.
+    // EN: Reads a block from the file and decodes it. Reference blocks are resolved by reading the earlier data again through read,
+    //     and linked blocks are decoded in turn, without recursion, from the nearest reset point (or cached earlier block).
+    Block decode(size_t block_index);
+    Block decompress(size_t block_index, const std::vector<uint8_t>& compressed, const std::vector<uint8_t>* previous);
+    bool read_block(size_t block_index, std::vector<uint8_t>& compressed);
+    Block cached(size_t block_index);
+    void insert_locked(size_t block_index, const Block& data);
+
+    struct CacheEntry {
+        Block data;
+        std::list<size_t>::iterator position;
+    };
+
+    size_t cache_capacity;
+    const TrainedModel* model;
+    ContainerIndex archive_index;
+
+    std::mutex file_mutex;
+    std::ifstream archive_file;
+
+    std::mutex cache_mutex;
+    size_t cached_bytes = 0;
+    std::list<size_t> lru; // KO: 최근에 쓴 블록이 앞에 옵니다. / EN: The most recently used block comes first.
+    std::unordered_map<size_t, CacheEntry> cache;
+    std::unordered_map<size_t, std::shared_future<Block>> in_flight;
+};
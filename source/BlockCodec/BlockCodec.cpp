@@ -0,0 +1,1003 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 단일 블록의 압축과 복호화를 구현합니다.
+//     블록 하나를 SeparationEngine으로 세 스트림으로 나누고, 각 스트림을 rANS_Coder로 압축한 뒤
+//     블록 헤더와 함께 하나의 버퍼로 조립합니다. (복호화는 그 역순입니다.)
+// EN: This file implements the compression and decompression of a single block.
+//     A block is split into three streams by the SeparationEngine, each stream is compressed by the rANS_Coder,
+//     and the result is assembled into one buffer together with the block header. (Decompression is the reverse.)
+#include "BlockCodec.h"
+#include "../rANS_Coder/rANS_Coder.h"
+#include "../tANS_Coder/tANS_Coder.h"
+#include "../SeparationEngine/SeparationEngine.h"
+#include "../Varint/Varint.h"
+#include "../MatchFinder/MatchFinder.h"
+#include "../PerfCounters/PerfCounters.h"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <optional>
+
+// KO: 학습된 모델 블록에서 세 스트림의 모델 확률을 복호화 순서대로 반환합니다.
+//     reconstructed_stream을 먼저 복원해야 나머지 두 스트림의 길이를 알 수 있습니다.
+// EN: Returns the model probabilities of the three streams of a trained-model block, in decoding order.
+//     The reconstructed_stream comes first because it determines the lengths of the other two streams.
+static std::vector<uint32_t> model_stream_probs(const TrainedModel& model) {
+    return { model.prob0_reconstructed, model.prob0_bitmap, model.prob0_mask };
+}
+
+// KO: 학습된 모델을 사용하여 작은 블록을 압축합니다. 극성과 확률은 모델에서 가져오므로 블록에는 기록하지 않습니다.
+// EN: Compresses a small block with a trained model. The polarity and probabilities come from the model, so the block does not record them.
+static std::vector<uint8_t> compress_block_with_model(const std::vector<uint8_t>& block_data, const TrainedModel& model) {
+    // KO: 여러 스레드가 블록을 동시에 압축할 수 있으므로, 공유하는 std::cout의 서식 플래그를 바꾸지 않고 id를 따로 서식화합니다.
+    // EN: Several threads may compress blocks at once, so the id is formatted separately instead of changing the flags of the shared std::cout.
+    std::ostringstream model_id;
+    model_id << std::hex << model.model_id;
+    std::cout << "  [1/2] Separating streams with trained model " << model_id.str() << "..." << std::endl;
+    SeparationEngine separation_engine;
+    SeparatedStreams streams = separation_engine.separate(block_data, model.aux_mask_1_represents_11);
+
+    std::cout << "  [2/2] Compressing streams with trained model..." << std::endl;
+    // KO: 페이로드가 수 바이트에 불과한 작은 블록을 위해, 플러시가 4바이트인 바이트 단위 엔진을 사용합니다.
+    // EN: Small blocks have payloads of only a few bytes, so the byte-wise engine with its 4-byte flush is used.
+    rANS_Coder model_coder(StreamHeaderVersion::V2, RansEngine::RansByte);
+    std::vector<uint8_t> payload = model_coder.encode_bits_with_model(
+        { &streams.reconstructed_stream, &streams.value_bitmap, &streams.auxiliary_mask },
+        model_stream_probs(model));
+
+    std::vector<uint8_t> final_block;
+    final_block.reserve(1 + 4 + 2 * MAX_VARINT_SIZE + payload.size());
+    uint8_t metadata_flags = BLOCK_FLAG_TRAINED_MODEL;
+    if (streams.aux_mask_1_represents_11) metadata_flags |= (1 << 0);
+    metadata_flags |= (1 << 2); // rANS engine used
+    final_block.push_back(metadata_flags);
+    uint8_t id_bytes[4];
+    memcpy(id_bytes, &model.model_id, 4);
+    final_block.insert(final_block.end(), id_bytes, id_bytes + 4);
+    write_varint(final_block, block_data.size());
+    write_varint(final_block, streams.auxiliary_mask.size());
+    final_block.insert(final_block.end(), payload.begin(), payload.end());
+
+    std::cout << "    - Done. Final block size: " << final_block.size() << " bytes." << std::endl;
+    return final_block;
+}
+
+// KO: 학습된 모델 블록을 복호화합니다.
+// EN: Decompresses a trained-model block.
+static std::vector<uint8_t> decompress_block_with_model(const std::vector<uint8_t>& compressed_block_data, const TrainedModel* model) {
+    std::cout << "  [1/2] Parsing trained-model block header..." << std::endl;
+    const uint8_t* read_ptr = compressed_block_data.data();
+    const uint8_t* data_end = read_ptr + compressed_block_data.size();
+    if (compressed_block_data.size() < 5) {
+        std::cerr << "Error: Compressed data is smaller than header size." << std::endl;
+        return {};
+    }
+    const uint8_t metadata_flags = *read_ptr++;
+    uint32_t model_id;
+    memcpy(&model_id, read_ptr, 4);
+    read_ptr += 4;
+
+    if (model == nullptr || model->model_id != model_id) {
+        std::cerr << "Error: Block was compressed with trained model " << std::hex << model_id << std::dec
+                  << "; provide the matching model with -m." << std::endl;
+        return {};
+    }
+
+    uint64_t original_size, n_placeholders;
+    if (!read_varint(read_ptr, data_end, original_size) || !read_varint(read_ptr, data_end, n_placeholders) ||
+        original_size > (UINT64_MAX >> 2) || n_placeholders > original_size * 4) {
+        std::cerr << "Error: Corrupted block header, size mismatch." << std::endl;
+        return {};
+    }
+
+    std::cout << "  [2/2] Decompressing streams with trained model..." << std::endl;
+    const RansEngine rans_engine = (metadata_flags & (1 << 4)) ? RansEngine::Rans64 : RansEngine::RansByte;
+    rANS_Coder model_coder(StreamHeaderVersion::V2, rans_engine);
+    std::vector<uint8_t> payload(read_ptr, data_end);
+    std::vector<PackedBits> decoded = model_coder.decode_bits_with_model(
+        payload,
+        { original_size * 4, original_size * 4 - n_placeholders, n_placeholders },
+        model_stream_probs(*model));
+
+    SeparationEngine separation_engine;
+    std::vector<uint8_t> original_block = separation_engine.reconstruct(
+        decoded[1],
+        decoded[2],
+        decoded[0],
+        (metadata_flags & (1 << 0)) != 0,
+        original_size
+    );
+
+    std::cout << "    - Done. Decompressed block size: " << original_block.size() << " bytes." << std::endl;
+    return original_block;
+}
+
+// KO: layout 바이트의 심볼 폭 코드와 실제 심볼 폭을 서로 변환합니다.
+// EN: Converts between the symbol width code of the layout byte and the actual symbol width.
+static uint8_t symbol_width_code(unsigned symbol_width) {
+    return (symbol_width == 1) ? 1 : (symbol_width == 4) ? 2 : 0;
+}
+
+static unsigned symbol_width_from_code(uint8_t code) {
+    static const unsigned widths[4] = { 2, 1, 4, 0 };
+    return widths[code & 0x03];
+}
+
+// KO: layout 바이트 뒤의 사전 변환 정보를 기록하고 읽습니다.
+// EN: Writes and reads the pre-transform description that follows the layout byte.
+static void write_transform(std::vector<uint8_t>& out, const TransformSpec& spec, bool has_matches = false) {
+    out.push_back(static_cast<uint8_t>(static_cast<uint8_t>(spec.filter) | (static_cast<uint8_t>(spec.transposition) << 2) | (has_matches ? TRANSFORM_FLAG_MATCHES : 0)));
+    if (spec.filter != ByteFilter::None) write_varint(out, spec.filter_lag);
+    if (spec.transposition != Transposition::None) write_varint(out, spec.stride);
+}
+
+static bool read_transform(const uint8_t*& ptr, const uint8_t* end, TransformSpec& spec, bool& has_matches) {
+    if (ptr >= end || (*ptr & ~(0x0F | TRANSFORM_FLAG_MATCHES)) != 0) return false;
+    const uint8_t kinds = *ptr++;
+    has_matches = (kinds & TRANSFORM_FLAG_MATCHES) != 0;
+    spec.filter = static_cast<ByteFilter>(kinds & 0x03);
+    spec.transposition = static_cast<Transposition>((kinds >> 2) & 0x03);
+    uint64_t value;
+    if (spec.filter != ByteFilter::None) {
+        if (!read_varint(ptr, end, value) || value > MAX_TRANSFORM_DISTANCE) return false;
+        spec.filter_lag = static_cast<uint32_t>(value);
+    }
+    if (spec.transposition != Transposition::None) {
+        if (!read_varint(ptr, end, value) || value > MAX_TRANSFORM_DISTANCE) return false;
+        spec.stride = static_cast<uint32_t>(value);
+    }
+    return is_valid_transform(spec);
+}
+
+// KO: 이보다 작은 블록은 플러시가 4바이트이고 빈도가 2바이트 varint에 들어가는 바이트 단위 rANS 엔진을 사용합니다.
+// EN: Blocks smaller than this use the byte-wise rANS engine, whose flush is 4 bytes and whose frequencies fit in a 2-byte varint.
+constexpr size_t SMALL_BLOCK_SIZE = 64 * 1024;
+
+// KO: rANS 출력이 엔트로피보다 평균적으로 더 차지하는 비트 수입니다. 상태는 하한 L(바이트 단위 2^23, rans64 2^31)에서 시작하고
+//     끝에서 상태 전체(32/64비트)를 플러시하므로, 출력은 엔트로피보다 log2(L)비트에 마지막 출력 단위의 절반 정도를 더한 만큼 깁니다.
+// EN: The number of bits the rANS output takes beyond the entropy, on average. The state starts at its lower bound L
+//     (2^23 byte-wise, 2^31 for rans64) and the whole state (32/64 bits) is flushed at the end, so the output is longer than
+//     the entropy by log2(L) bits plus about half an output unit.
+static uint32_t rans_overhead_bits(bool small_block) {
+    return small_block ? (23 + 4) : (31 + 16);
+}
+
+// KO: 이보다 짧은 스트림은 빈도 표의 비용을 감당하기 어려우므로 항상 rANS로 부호화합니다.
+// EN: Streams shorter than this can hardly pay for a frequency table, so they are always coded with rANS.
+constexpr uint64_t TABLE_ANS_MIN_BITS = 64 * 1024;
+
+// KO: 레인 배치는 상태 32개(128바이트)를 플러시하므로, 이보다 짧은 스트림은 기존 rANS 엔진에 남깁니다.
+// EN: The lane layout flushes 32 states (128 bytes), so streams shorter than this stay with the regular rANS engine.
+constexpr uint64_t LANE_MIN_BITS = 1 << 20;
+
+// KO: 스트림을 tANS로 부호화할지 결정합니다. rANS 예측 크기는 부호화할 이진 스트림의 1의 개수로 계산합니다.
+//     tANS는 복호화 시 조회 한 번에 8비트를 내므로, 예측 크기가 rANS보다 1/256 넘게 크지 않으면 tANS를 고릅니다.
+//     퇴화 스트림은 rANS에서 페이로드가 없으므로 항상 rANS를 사용합니다.
+// EN: Decides whether a stream is coded with tANS. The predicted rANS size is computed from the ones of the binary stream it would code.
+//     tANS decodes 8 bits per lookup, so it is picked unless its predicted size exceeds the rANS one by more than 1/256.
+//     A degenerate stream has no payload under rANS, so it always stays with rANS.
+static bool prefer_table_ans(const PackedBits& bits, uint64_t rans_ones, uint64_t rans_total, bool small_block) {
+    if (bits.size() < TABLE_ANS_MIN_BITS || rans_ones == 0 || rans_ones == rans_total) return false;
+    const double p = static_cast<double>(rans_ones) / rans_total;
+    const double rans_bits = -static_cast<double>(rans_total) * (p * std::log2(p) + (1.0 - p) * std::log2(1.0 - p));
+    const uint64_t rans_bytes = static_cast<uint64_t>(std::ceil((rans_bits + rans_overhead_bits(small_block)) / 8.0));
+    return tANS_Coder::estimate_encoded_size(bits) <= rans_bytes + rans_bytes / 256;
+}
+
+// KO: 2단계(스트림 압축)의 결과 중 3단계(블록 조립)에 필요한 것들입니다. 스트림 순서는 reconstructed, value_bitmap, auxiliary_mask입니다.
+// EN: The results of step 2 (stream compression) that step 3 (block assembly) needs. The streams are ordered reconstructed, value_bitmap, auxiliary_mask.
+struct CompressedStreams {
+    unsigned symbol_width = 2;
+    SymbolPairing pairing = SymbolPairing::Canonical;
+    bool aux_mask_1_represents_11 = false;
+    bool is_placeholder_common = false;
+    uint64_t n_placeholders = 0;
+    RansEngine rans_engine = RansEngine::Rans64;
+    bool chunked = false;
+    bool use_table_ans[3] = { false, false, false };
+    bool nested[3] = { false, false, false };
+    bool lanes[3] = { false, false, false };
+    StreamDescriptor descriptors[3];
+    std::vector<uint8_t> payloads[3];
+};
+
+// KO: 파생 스트림의 비트열을 바이트열로 보고 다시 분리한 중첩 블록을 만들어, 지금의 페이로드보다 충분히 작으면 그것으로 바꿉니다.
+//     중첩 블록의 크기를 먼저 추정하여, 추정 이득이 stream_tree_min_gain에 못 미치면 압축해 보지 않고 멈춥니다.
+// EN: Builds a nested block that separates the bits of a derived stream again, read as bytes, and swaps it in if it is
+//     sufficiently smaller than the current payload. The size of the nested block is estimated first, and if the estimated
+//     gain falls short of stream_tree_min_gain the recursion stops without compressing it.
+static void nest_stream(const PackedBits& bits, int index, const char* name, const CompressionOptions& options, CompressedStreams& result) {
+    const double required_size = static_cast<double>(result.payloads[index].size()) * (1.0 - options.stream_tree_min_gain);
+    if (bits.empty() || required_size <= 0.0) return;
+
+    CompressionOptions nested_options = options;
+    nested_options.transform = TransformSpec();
+    nested_options.match_prepass = false;
+    nested_options.symbol_width = 2;
+    nested_options.search_symbol_width = false;
+    nested_options.store_incompressible = false;
+    nested_options.bypass_incompressible = false;
+    nested_options.stream_tree_depth = std::min(options.stream_tree_depth, MAX_STREAM_TREE_DEPTH) - 1;
+    const std::vector<uint8_t> stream_bytes = packed_bits_to_bytes(bits);
+    if (static_cast<double>(estimate_block(stream_bytes, nullptr, nested_options).predicted_size) >= required_size) return;
+
+    std::cout << "    - Separating the " << name << " stream again (" << stream_bytes.size() << " bytes)..." << std::endl;
+    std::vector<uint8_t> nested_block = compress_block(stream_bytes, nullptr, nested_options);
+    if (static_cast<double>(nested_block.size()) >= required_size) return;
+    std::cout << "    - Done. Nested " << name << " block: " << result.payloads[index].size() << " -> " << nested_block.size() << " bytes." << std::endl;
+    result.payloads[index] = std::move(nested_block);
+    result.descriptors[index] = StreamDescriptor();
+    result.use_table_ans[index] = false;
+    result.lanes[index] = false;
+    result.nested[index] = true;
+}
+
+// KO: 스트림을 모두 만든 뒤 압축합니다. tANS 선택과 청크 빈도는 스트림 전체를 먼저 살펴야 하므로 이 경로를 사용합니다.
+// EN: Compresses the streams after materializing all of them. Picking tANS and chunked frequencies both need to look at
+//     the whole stream first, so they take this path.
+static void compress_streams(const std::vector<uint8_t>& input, const CompressionOptions& options, CompressedStreams& result) {
+    // --- 1단계: 스트림 분리 ---
+    // --- Step 1: Separate Streams ---
+    std::cout << "  [1/3] Separating streams..." << std::endl;
+    SeparationEngine separation_engine;
+    const SymbolPairing pairing = options.optimize_pairing ? SymbolPairing::Auto : SymbolPairing::Canonical;
+    SeparatedStreams streams;
+    {
+        PerfStage stage("separate", input.size());
+        streams = separation_engine.separate(input, std::nullopt, options.symbol_width, pairing, options.threads);
+    }
+    result.symbol_width = streams.symbol_width;
+    result.pairing = streams.pairing;
+    result.aux_mask_1_represents_11 = streams.aux_mask_1_represents_11;
+
+    // --- 2단계: 각 스트림 압축 ---
+    // --- Step 2: Compress Each Stream ---
+    // KO: 스트림 헤더는 블록 헤더에 합쳐 기록하므로, 각 스트림은 헤더 없이(Detached) 압축하고 StreamDescriptor만 받습니다.
+    //     tANS로 부호화하는 스트림은 빈도 표를 페이로드에 담으므로 StreamDescriptor가 없습니다.
+    // EN: The stream headers are merged into the block header, so every stream is compressed without one (Detached)
+    //     and only its StreamDescriptor is kept. A stream coded with tANS carries its frequency table in the payload and has no StreamDescriptor.
+    std::cout << "  [2/3] Compressing Value Bitmap & Auxiliary Mask streams..." << std::endl;
+    std::optional<PerfStage> encode_stage(std::in_place, "encode streams", input.size());
+    const bool small_block = input.size() < SMALL_BLOCK_SIZE;
+    tANS_Coder table_coder;
+    result.n_placeholders = streams.reconstructed_stream.count_ones();
+    const uint64_t n_placeholders = result.n_placeholders;
+    const uint64_t n_recon = streams.reconstructed_stream.size();
+    bool* use_table_ans = result.use_table_ans;
+    if (options.allow_table_ans) {
+        use_table_ans[0] = prefer_table_ans(streams.reconstructed_stream, std::min(n_placeholders, n_recon - n_placeholders), 2 * n_recon, small_block);
+        use_table_ans[1] = prefer_table_ans(streams.value_bitmap, streams.value_bitmap.count_ones(), streams.value_bitmap.size(), small_block);
+        use_table_ans[2] = prefer_table_ans(streams.auxiliary_mask, streams.auxiliary_mask.count_ones(), streams.auxiliary_mask.size(), small_block);
+    }
+
+    // KO: 레인 배치를 사용하면 tANS를 고르지 않은 긴 reconstructed / value_bitmap 스트림이 레인 배치로 부호화됩니다.
+    //     (희소한 auxiliary_mask는 복호화 비용이 작으므로 제외합니다.)
+    // EN: With the lane layout, long reconstructed / value_bitmap streams that did not pick tANS are coded in the lane layout.
+    //     (The sparse auxiliary_mask is cheap to decode, so it is left out.)
+    const PackedBits* stream_bits[3] = { &streams.reconstructed_stream, &streams.value_bitmap, &streams.auxiliary_mask };
+    bool* lanes = result.lanes;
+    if (options.lane_interleaved) {
+        for (int i = 0; i < 2; ++i) lanes[i] = !use_table_ans[i] && stream_bits[i]->size() >= LANE_MIN_BITS;
+    }
+
+    // KO: 청크 크기보다 긴 rANS 스트림이 하나라도 있을 때만 청크 빈도를 사용하고 블록에 청크 크기를 기록합니다.
+    // EN: Chunked frequencies are used, and the chunk size recorded in the block, only if some rANS stream is longer than a chunk.
+    const uint64_t chunk_bits = options.freq_chunk_kib * 1024 * 8;
+    for (int i = 0; i < 3; ++i) {
+        if (chunk_bits > 0 && !use_table_ans[i] && !lanes[i] && stream_bits[i]->size() > chunk_bits) result.chunked = true;
+    }
+    rANS_Coder byte_coder(StreamHeaderVersion::Detached, result.rans_engine, result.chunked ? chunk_bits : 0);
+    rANS_Coder lane_coder(StreamHeaderVersion::Detached, RansEngine::RansLanes);
+    StreamDescriptor* descriptors = result.descriptors;
+    result.payloads[1] = use_table_ans[1] ? table_coder.encode_bits(streams.value_bitmap) : (lanes[1] ? lane_coder : byte_coder).encode_bits(streams.value_bitmap, &descriptors[1]);
+    result.payloads[2] = use_table_ans[2] ? table_coder.encode_bits(streams.auxiliary_mask) : byte_coder.encode_bits(streams.auxiliary_mask, &descriptors[2]);
+
+    std::cout << "  [2/3] Compressing Reconstructed stream with " << (use_table_ans[0] ? "tANS" : lanes[0] ? "rANS (lanes)" : "rANS") << " engine..." << std::endl;
+    result.is_placeholder_common = (n_placeholders >= n_recon / 2);
+    result.payloads[0] = use_table_ans[0]
+        ? table_coder.encode_bits(streams.reconstructed_stream)
+        : (lanes[0] ? lane_coder : byte_coder).encode_reconstructed_stream(streams.reconstructed_stream, result.is_placeholder_common, &descriptors[0]);
+    std::cout << "    - Done. Reconstructed stream compressed size: " << result.payloads[0].size() << " bytes." << std::endl;
+    encode_stage.reset();
+
+    // KO: 다단계 블록에서는 reconstructed_stream과 value_bitmap을 다시 분리해 봅니다. (auxiliary_mask는 희소하여 제외합니다.)
+    // EN: Multi-level blocks try separating the reconstructed_stream and the value_bitmap again. (The sparse auxiliary_mask is left out.)
+    if (options.stream_tree_depth > 0) {
+        nest_stream(streams.reconstructed_stream, 0, "reconstructed", options, result);
+        nest_stream(streams.value_bitmap, 1, "value bitmap", options, result);
+    }
+}
+
+// KO: 융합 압축 파이프라인입니다. 바이트 히스토그램만으로 세 스트림의 빈도를 정해 rANS 수신자를 만든 뒤, 분리가 데이터를 청크 단위로
+//     역순 분리하여 수신자에 바로 넘깁니다. 블록 크기의 중간 스트림을 만들지 않으므로 최대 메모리와 캐시 미스가 줄어들며,
+//     결과는 compress_streams와 바이트 단위로 같습니다.
+// EN: The fused compression pipeline. The frequencies of the three streams are settled from the byte histogram alone to create the rANS
+//     sinks, then the separation splits the data chunk by chunk in reverse and hands every chunk straight to the sinks. No block-sized
+//     intermediate stream is materialized, which cuts the peak memory and the cache misses, and the result is byte-identical to compress_streams.
+static void compress_streams_fused(const std::vector<uint8_t>& input, const CompressionOptions& options, CompressedStreams& result) {
+    std::cout << "  [1/3] Analyzing block..." << std::endl;
+    SeparationEngine separation_engine;
+    const SymbolPairing pairing = options.optimize_pairing ? SymbolPairing::Auto : SymbolPairing::Canonical;
+    SeparationEstimate plan;
+    {
+        PerfStage stage("analyze", input.size());
+        plan = separation_engine.estimate(input, std::nullopt, options.symbol_width, pairing);
+    }
+    result.symbol_width = plan.symbol_width;
+    result.pairing = plan.pairing;
+    result.aux_mask_1_represents_11 = plan.aux_mask_1_represents_11;
+    result.n_placeholders = plan.auxiliary_mask_bits;
+    result.is_placeholder_common = (result.n_placeholders >= plan.reconstructed_bits / 2);
+
+    std::cout << "  [2/3] Separating and compressing streams (fused)..." << std::endl;
+    PerfStage stage("separate+encode (fused)", input.size());
+    rANS_Coder byte_coder(StreamHeaderVersion::Detached, result.rans_engine);
+    const std::unique_ptr<RansStreamSink> recon_sink = byte_coder.create_reconstructed_stream_sink(plan.reconstructed_bits, result.n_placeholders, result.is_placeholder_common);
+    const std::unique_ptr<RansStreamSink> value_sink = byte_coder.create_bits_sink(plan.value_bitmap_bits, plan.value_bitmap_ones);
+    const std::unique_ptr<RansStreamSink> mask_sink = byte_coder.create_bits_sink(plan.auxiliary_mask_bits, plan.auxiliary_mask_ones);
+    separation_engine.separate_reverse(input, plan, *recon_sink, *value_sink, *mask_sink);
+    result.payloads[0] = recon_sink->finish(&result.descriptors[0]);
+    result.payloads[1] = value_sink->finish(&result.descriptors[1]);
+    result.payloads[2] = mask_sink->finish(&result.descriptors[2]);
+    std::cout << "    - Done. Reconstructed stream compressed size: " << result.payloads[0].size() << " bytes." << std::endl;
+}
+
+// KO: 심볼 폭(1, 2, 4)마다 세 스트림의 엔트로피를 추정하여 가장 작은 것을 고릅니다.
+// EN: Estimates the entropies of the three streams for every symbol width (1, 2, 4) and picks the smallest.
+static unsigned best_symbol_width(const std::vector<uint8_t>& input, SymbolPairing pairing) {
+    SeparationEngine separation_engine;
+    unsigned best_width = 2;
+    double best_bits = separation_engine.estimate(input, std::nullopt, 2, pairing).total_entropy_bits();
+    for (unsigned symbol_width : { 1u, 4u }) {
+        const double bits = separation_engine.estimate(input, std::nullopt, symbol_width, pairing).total_entropy_bits();
+        if (bits < best_bits) {
+            best_bits = bits;
+            best_width = symbol_width;
+        }
+    }
+    return best_width;
+}
+
+// KO: 블록을 저장 블록으로 담습니다.
+// EN: Wraps a block into a stored block.
+static std::vector<uint8_t> store_block(const std::vector<uint8_t>& block_data) {
+    std::vector<uint8_t> final_block;
+    final_block.reserve(1 + block_data.size());
+    final_block.push_back(BLOCK_STORED);
+    final_block.insert(final_block.end(), block_data.begin(), block_data.end());
+    std::cout << "    - Stored without compression. Final block size: " << final_block.size() << " bytes." << std::endl;
+    return final_block;
+}
+
+std::vector<uint8_t> make_reference_block(uint64_t offset, uint64_t size) {
+    std::vector<uint8_t> block;
+    block.reserve(1 + 2 * MAX_VARINT_SIZE);
+    block.push_back(BLOCK_REFERENCE);
+    write_varint(block, offset);
+    write_varint(block, size);
+    return block;
+}
+
+bool read_reference_block(const std::vector<uint8_t>& block, uint64_t& offset, uint64_t& size) {
+    if (block.empty() || block[0] != BLOCK_REFERENCE) return false;
+    const uint8_t* read_ptr = block.data() + 1;
+    const uint8_t* data_end = block.data() + block.size();
+    return read_varint(read_ptr, data_end, offset) && read_varint(read_ptr, data_end, size) && read_ptr == data_end;
+}
+
+bool is_linked_block(const std::vector<uint8_t>& block) {
+    return !block.empty() && block[0] == BLOCK_LINKED;
+}
+
+bool read_block_original_size(const std::vector<uint8_t>& block, uint64_t& original_size) {
+    if (block.empty()) return false;
+    const uint8_t* read_ptr = block.data();
+    const uint8_t* data_end = block.data() + block.size();
+    // KO: 연결 블록은 첫 바이트 뒤가 학습된 모델 블록입니다.
+    // EN: A linked block is a trained-model block after its first byte.
+    if (*read_ptr == BLOCK_LINKED) read_ptr++;
+    if (read_ptr >= data_end) return false;
+    const uint8_t metadata_flags = *read_ptr++;
+    uint64_t offset;
+    if (metadata_flags == BLOCK_REFERENCE) return read_reference_block(block, offset, original_size);
+    if (metadata_flags == BLOCK_STORED) {
+        original_size = block.size() - 1;
+        return true;
+    }
+    if (metadata_flags & BLOCK_FLAG_TRAINED_MODEL) {
+        // KO: [uint8 metadata_flags][uint32 model_id][varint 원본 크기]...
+        // EN: [uint8 metadata_flags][uint32 model_id][varint original size]...
+        if (data_end - read_ptr < 4) return false;
+        read_ptr += 4;
+        return read_varint(read_ptr, data_end, original_size);
+    }
+    if (!(metadata_flags & BLOCK_FLAG_COMPACT)) {
+        if (block.size() < sizeof(TriSplitBlockHeader)) return false;
+        TriSplitBlockHeader header;
+        memcpy(&header, block.data(), sizeof(header));
+        original_size = header.original_data_size;
+        return true;
+    }
+
+    // KO: 일치 사전 처리를 사용한 블록은 복원 크기가, 그 밖의 블록은 분리되는 입력의 크기가 원본 크기입니다.
+    // EN: For a block with the match prepass the restored size is the original size; for any other block it is the size of the separated input.
+    uint8_t layout = 0;
+    if (metadata_flags & BLOCK_FLAG_LAYOUT) {
+        if (read_ptr >= data_end) return false;
+        layout = *read_ptr++;
+    }
+    TransformSpec transform;
+    bool has_matches = false;
+    if ((layout & LAYOUT_FLAG_TRANSFORM) && !read_transform(read_ptr, data_end, transform, has_matches)) return false;
+    if (has_matches) return read_varint(read_ptr, data_end, original_size);
+    uint64_t chunk_kib;
+    if ((metadata_flags & BLOCK_FLAG_CHUNKED_FREQS) && !read_varint(read_ptr, data_end, chunk_kib)) return false;
+    if (!(metadata_flags & BLOCK_FLAG_SINGLE_LEVEL)) {
+        if (read_ptr >= data_end) return false;
+        read_ptr++;
+    }
+    return read_varint(read_ptr, data_end, original_size);
+}
+
+CompressionOptions compression_level_options(unsigned level) {
+    level = std::clamp(level, MIN_COMPRESSION_LEVEL, MAX_COMPRESSION_LEVEL);
+    CompressionOptions options;
+    options.bypass_incompressible = (level == 1);
+    options.store_incompressible = true;
+    options.allow_table_ans = (level >= 3);
+    options.optimize_pairing = (level >= 4);
+    options.search_symbol_width = (level >= 5);
+    options.freq_chunk_kib = (level >= 9) ? 16 : (level >= 6) ? 64 : 0;
+    options.match_prepass = (level >= 7);
+    options.stream_tree_depth = (level >= 9) ? 3 : (level >= 8) ? 1 : 0;
+    return options;
+}
+
+// KO: 압축 블록 형식으로 블록을 압축합니다.
+// EN: Compresses a block in the compact block format.
+static std::vector<uint8_t> compress_compact_block(const std::vector<uint8_t>& block_data, const CompressionOptions& options) {
+    // KO: 일치 사전 처리를 사용하면 일치로 덮이지 않은 리터럴만 분리합니다. 일치를 하나도 찾지 못하면 사용하지 않습니다.
+    // EN: With the match prepass only the literals not covered by a match are separated. It is dropped if no match was found.
+    MatchParse matches;
+    if (options.match_prepass) {
+        PerfStage stage("match prepass", block_data.size());
+        matches = find_matches(block_data);
+        std::cout << "  - Match prepass: " << block_data.size() << " bytes -> " << matches.literals.size() << " literal bytes." << std::endl;
+    }
+    const bool matched = !matches.sequences.empty();
+    const std::vector<uint8_t>& unmatched = matched ? matches.literals : block_data;
+
+    // KO: 사전 변환이 있으면 변환된 블록을 분리합니다. 변환은 크기를 바꾸지 않습니다.
+    // EN: With a pre-transform the transformed block is separated. The transform does not change the size.
+    const bool transformed = !options.transform.is_identity();
+    std::vector<uint8_t> transformed_data;
+    if (transformed) {
+        PerfStage stage("transform", unmatched.size());
+        transformed_data = forward_transform(unmatched, options.transform);
+    }
+    const std::vector<uint8_t>& input = transformed ? transformed_data : unmatched;
+    CompressionOptions stream_options = options;
+    if (options.search_symbol_width) {
+        stream_options.symbol_width = best_symbol_width(input, options.optimize_pairing ? SymbolPairing::Auto : SymbolPairing::Canonical);
+    }
+
+    // KO: 어떤 스트림도 블록의 비트 수(8N)보다 길 수 없으므로, 8N이 tANS 최소 길이와 청크 크기에 못 미치면
+    //     모든 스트림이 청크 빈도 없는 rANS로 부호화됨이 확실하고, 스트림을 만들지 않는 융합 경로를 사용할 수 있습니다.
+    //     다단계 블록은 스트림 자체를 다시 분리해야 하므로 융합 경로를 사용하지 않습니다.
+    // EN: No stream can be longer than the bits of the block (8N), so if 8N falls short of both the tANS minimum length and the chunk size,
+    //     every stream is sure to be coded with rANS without chunked frequencies, and the fused path, which materializes no stream, can be used.
+    //     Multi-level blocks need the streams themselves to separate them again, so they never take the fused path.
+    CompressedStreams streams;
+    streams.rans_engine = (input.size() < SMALL_BLOCK_SIZE) ? RansEngine::RansByte : RansEngine::Rans64;
+    const uint64_t block_bits = static_cast<uint64_t>(input.size()) * 8;
+    const bool may_use_table_ans = options.allow_table_ans && block_bits >= TABLE_ANS_MIN_BITS;
+    const bool may_chunk = options.freq_chunk_kib > 0 && block_bits > options.freq_chunk_kib * 1024 * 8;
+    const bool may_use_lanes = options.lane_interleaved && block_bits >= LANE_MIN_BITS;
+    if (may_use_table_ans || may_chunk || may_use_lanes || options.stream_tree_depth > 0) compress_streams(input, stream_options, streams);
+    else compress_streams_fused(input, stream_options, streams);
+
+    // --- 3단계: 최종 블록 조립 ---
+    // --- Step 3: Assemble Final Block ---
+    std::cout << "  [3/3] Assembling final block..." << std::endl;
+    size_t payload_total = 0;
+    int last_payload = -1;
+    for (int i = 0; i < 3; ++i) {
+        payload_total += streams.payloads[i].size();
+        if (!streams.payloads[i].empty()) last_payload = i;
+    }
+
+    std::vector<uint8_t> final_block;
+    final_block.reserve(1 + 8 * MAX_VARINT_SIZE + payload_total);
+
+    // KO: 복호화에 필요한 플래그들을 'metadata_flags' 비트 필드에 설정합니다.
+    // EN: Set the flags required for decompression in the 'metadata_flags' bitfield.
+    uint8_t stream_tree = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (streams.nested[i]) stream_tree |= static_cast<uint8_t>(1 << i);
+        if (streams.lanes[i])  stream_tree |= static_cast<uint8_t>(1 << (STREAM_TREE_LANES_SHIFT + i));
+    }
+    uint8_t metadata_flags = BLOCK_FLAG_COMPACT;
+    if (streams.aux_mask_1_represents_11)          metadata_flags |= (1 << 0);
+    if (streams.is_placeholder_common)             metadata_flags |= (1 << 1);
+    if (stream_tree == 0)                          metadata_flags |= BLOCK_FLAG_SINGLE_LEVEL;
+    if (streams.chunked)                           metadata_flags |= BLOCK_FLAG_CHUNKED_FREQS;
+    if (streams.rans_engine == RansEngine::Rans64) metadata_flags |= (1 << 4);
+    uint8_t layout = static_cast<uint8_t>(symbol_width_code(streams.symbol_width) | (static_cast<uint8_t>(streams.pairing) << 2));
+    if (transformed || matched) layout |= LAYOUT_FLAG_TRANSFORM;
+    for (int i = 0; i < 3; ++i) {
+        if (streams.use_table_ans[i]) layout |= static_cast<uint8_t>(LAYOUT_FLAG_TABLE_ANS << i);
+    }
+    if (layout != 0) metadata_flags |= BLOCK_FLAG_LAYOUT;
+    final_block.push_back(metadata_flags);
+    if (layout != 0) final_block.push_back(layout);
+    if (transformed || matched) write_transform(final_block, options.transform, matched);
+    if (matched) {
+        write_varint(final_block, block_data.size());
+        write_varint(final_block, matches.sequences.size());
+        final_block.insert(final_block.end(), matches.sequences.begin(), matches.sequences.end());
+    }
+    if (streams.chunked) write_varint(final_block, options.freq_chunk_kib);
+    if (stream_tree != 0) final_block.push_back(stream_tree);
+
+    // KO: 심볼 수는 원본 크기와 자리표시자 수로부터 유도되므로, 스트림마다 norm_freqs[0]만 기록합니다.
+    //     빈 스트림과 tANS 스트림(descriptor가 비어 있음)은 생략됩니다.
+    // EN: Symbol counts follow from the original size and the placeholder count, so only norm_freqs[0] is written per stream.
+    //     Empty streams and tANS streams (whose descriptor stays empty) are omitted.
+    write_varint(final_block, input.size());
+    write_varint(final_block, streams.n_placeholders);
+    for (const StreamDescriptor& descriptor : streams.descriptors) {
+        if (descriptor.symbol_count > 0) write_varint(final_block, descriptor.norm_freq0);
+    }
+    // KO: 마지막 페이로드의 크기는 블록의 나머지이므로 기록하지 않습니다.
+    // EN: The size of the last payload is the rest of the block, so it is not written.
+    for (int i = 0; i < last_payload; ++i) {
+        if (!streams.payloads[i].empty()) write_varint(final_block, streams.payloads[i].size());
+    }
+    for (const std::vector<uint8_t>& payload : streams.payloads) {
+        final_block.insert(final_block.end(), payload.begin(), payload.end());
+    }
+
+    std::cout << "    - Done. Final block size: " << final_block.size() << " bytes." << std::endl;
+    return final_block;
+}
+
+// KO: 단일 데이터 블록을 압축하는 전체 과정을 수행합니다.
+// EN: Performs the entire process of compressing a single data block.
+std::vector<uint8_t> compress_block(const std::vector<uint8_t>& block_data, const TrainedModel* model, const CompressionOptions& options) {
+    // KO: 바이트 히스토그램 한 번으로 압축되지 않을 블록을 미리 걸러, 분리와 부호화를 모두 건너뜁니다.
+    // EN: A single byte histogram screens out blocks that will not compress, skipping both separation and coding.
+    if (options.bypass_incompressible && estimate_block(block_data, model, options).predicted_size >= block_data.size()) {
+        return store_block(block_data);
+    }
+    std::vector<uint8_t> final_block = (model != nullptr) ? compress_block_with_model(block_data, *model) : compress_compact_block(block_data, options);
+    if (options.store_incompressible && final_block.size() > block_data.size() + 1) {
+        return store_block(block_data);
+    }
+    return final_block;
+}
+
+TrainedModel linked_block_model(const std::vector<uint8_t>& previous_block) {
+    ModelTrainer trainer;
+    trainer.add_sample(previous_block);
+    return trainer.build();
+}
+
+std::vector<uint8_t> compress_linked_block(const std::vector<uint8_t>& block_data, const std::vector<uint8_t>& previous_block,
+                                           const TrainedModel* model, const CompressionOptions& options) {
+    // KO: 앞 블록과 통계가 다른 블록(내용이 바뀐 지점 등)은 자기 빈도를 기록하는 편이 작으므로, 예측 크기로 고릅니다.
+    // EN: A block whose statistics differ from the previous block (where the content changes, etc.) is smaller with
+    //     its own frequencies, so the predicted sizes decide.
+    const TrainedModel linked_model = linked_block_model(previous_block);
+    const uint64_t linked_size = 1 + estimate_block(block_data, &linked_model, options).predicted_size;
+    if (linked_size >= estimate_block(block_data, model, options).predicted_size) {
+        return compress_block(block_data, model, options);
+    }
+    std::cout << "  - Linked to the previous block." << std::endl;
+    std::vector<uint8_t> final_block = compress_block_with_model(block_data, linked_model);
+    if (options.store_incompressible && final_block.size() > block_data.size()) {
+        return store_block(block_data);
+    }
+    final_block.insert(final_block.begin(), BLOCK_LINKED);
+    return final_block;
+}
+
+// KO: 학습된 모델의 고정 확률(0.24 고정소수점, 0의 확률)로 이진 스트림을 부호화할 때의 교차 엔트로피(비트)입니다.
+// EN: The cross entropy (in bits) of coding a binary stream with the fixed probability of a trained model (probability of a 0, in 0.24 fixed point).
+static double model_stream_bits(uint64_t ones, uint64_t total, uint32_t prob0_q24) {
+    const double p0 = static_cast<double>(prob0_q24) / (1u << TrainedModel::PROB_BITS);
+    return -(static_cast<double>(total - ones) * std::log2(p0) + static_cast<double>(ones) * std::log2(1.0 - p0));
+}
+
+// KO: 압축 블록 형식에서 스트림 하나가 차지하는 [varint norm_freqs[0]]와 페이로드의 예측 크기를 더합니다.
+//     빈 스트림은 아무것도 기록하지 않고, 퇴화 스트림은 빈도만 기록합니다.
+// EN: Adds the predicted size of the [varint norm_freqs[0]] and the payload one stream takes in the compact block format.
+//     An empty stream writes nothing, and a degenerate stream writes only its frequency.
+static void add_stream_estimate(uint64_t zeros, uint64_t total, double entropy_bits, uint32_t scale_bits, uint32_t overhead_bits, uint64_t& header_size, uint64_t& payload_size, int& n_payloads) {
+    if (total == 0) return;
+    const uint64_t prob_scale = uint64_t(1) << scale_bits;
+    uint64_t freq0 = static_cast<uint64_t>(static_cast<double>(zeros) / total * prob_scale);
+    if (zeros == 0 || zeros == total) {
+        header_size += varint_size(zeros == 0 ? 0 : prob_scale);
+        return;
+    }
+    freq0 = std::clamp<uint64_t>(freq0, 1, prob_scale - 1);
+    header_size += varint_size(freq0);
+    payload_size += static_cast<uint64_t>(std::ceil((entropy_bits + overhead_bits) / 8.0));
+    n_payloads++;
+}
+
+// KO: 블록을 압축하지 않고 세 스트림의 엔트로피로부터 compress_block이 만들 블록의 크기를 예측합니다.
+// EN: Predicts the size of the block compress_block would produce from the entropies of the three streams, without compressing it.
+BlockEstimate estimate_block(const std::vector<uint8_t>& block_data, const TrainedModel* model, const CompressionOptions& options) {
+    SeparationEngine separation_engine;
+    BlockEstimate result;
+    result.original_size = block_data.size();
+
+    if (model != nullptr) {
+        // KO: 학습된 모델 블록: 세 스트림이 모델의 고정 확률로 하나의 바이트 단위 rANS 상태에 부호화됩니다.
+        //     reconstructed_stream은 접두 비트 없이 그대로 부호화되므로, 엔트로피를 모델 기준 교차 엔트로피로 바꿉니다.
+        // EN: Trained-model block: the three streams are coded into a single byte-wise rANS state with the fixed model probabilities.
+        //     The reconstructed_stream is coded as is, without prefix bits, so the entropies are replaced by the cross entropies under the model.
+        SeparationEstimate& streams = result.streams = separation_engine.estimate(block_data, model->aux_mask_1_represents_11);
+        streams.reconstructed_entropy_bits = model_stream_bits(streams.auxiliary_mask_bits, streams.reconstructed_bits, model->prob0_reconstructed);
+        streams.value_bitmap_entropy_bits = model_stream_bits(streams.value_bitmap_ones, streams.value_bitmap_bits, model->prob0_bitmap);
+        streams.auxiliary_mask_entropy_bits = model_stream_bits(streams.auxiliary_mask_ones, streams.auxiliary_mask_bits, model->prob0_mask);
+        result.predicted_size = 1 + 4 + varint_size(block_data.size()) + varint_size(streams.auxiliary_mask_bits);
+        if (streams.reconstructed_bits > 0) {
+            result.predicted_size += static_cast<uint64_t>(std::ceil((streams.total_entropy_bits() + rans_overhead_bits(true)) / 8.0));
+        }
+        return result;
+    }
+
+    const bool transformed = !options.transform.is_identity();
+    const std::vector<uint8_t> transformed_data = transformed ? forward_transform(block_data, options.transform) : std::vector<uint8_t>();
+    const std::vector<uint8_t>& input = transformed ? transformed_data : block_data;
+    const SymbolPairing pairing = options.optimize_pairing ? SymbolPairing::Auto : SymbolPairing::Canonical;
+    // KO: 심볼 폭을 찾는 옵션이면 compress_block의 best_symbol_width와 같은 순서와 기준으로 폭마다 추정하여 가장 작은 것을 씁니다.
+    // EN: With the symbol width search every width is estimated in the same order and by the same measure as
+    //     best_symbol_width in compress_block, and the smallest is used.
+    SeparationEstimate& streams = result.streams = separation_engine.estimate(input, std::nullopt, options.search_symbol_width ? 2 : options.symbol_width, pairing);
+    if (options.search_symbol_width) {
+        for (unsigned symbol_width : { 1u, 4u }) {
+            SeparationEstimate candidate = separation_engine.estimate(input, std::nullopt, symbol_width, pairing);
+            if (candidate.total_entropy_bits() < streams.total_entropy_bits()) streams = std::move(candidate);
+        }
+    }
+
+    const bool small_block = block_data.size() < SMALL_BLOCK_SIZE;
+    const uint32_t scale_bits = small_block ? 14 : 24;
+    const uint32_t overhead_bits = rans_overhead_bits(small_block);
+    const uint8_t layout = static_cast<uint8_t>(symbol_width_code(streams.symbol_width) | (static_cast<uint8_t>(streams.pairing) << 2));
+
+    uint64_t header_size = 1 + ((layout != 0 || transformed) ? 1 : 0) + varint_size(block_data.size()) + varint_size(streams.auxiliary_mask_bits);
+    if (transformed) {
+        std::vector<uint8_t> transform_bytes;
+        write_transform(transform_bytes, options.transform);
+        header_size += transform_bytes.size();
+    }
+    uint64_t payload_size = 0;
+    int n_payloads = 0;
+    // KO: reconstructed_stream은 드문 심볼마다 접두 비트 쌍 '01'을 받으므로, 2N비트 중 1의 수는 드문 심볼의 수입니다.
+    // EN: The reconstructed_stream gives every rare symbol the prefix pair '01', so the ones among its 2N bits are the rare symbols.
+    const uint64_t n_mixed = streams.reconstructed_bits - streams.auxiliary_mask_bits;
+    const uint64_t n_rare = std::min(n_mixed, streams.auxiliary_mask_bits);
+    add_stream_estimate(2 * streams.reconstructed_bits - n_rare, 2 * streams.reconstructed_bits, streams.reconstructed_entropy_bits, scale_bits, overhead_bits, header_size, payload_size, n_payloads);
+    add_stream_estimate(streams.value_bitmap_bits - streams.value_bitmap_ones, streams.value_bitmap_bits, streams.value_bitmap_entropy_bits, scale_bits, overhead_bits, header_size, payload_size, n_payloads);
+    add_stream_estimate(streams.auxiliary_mask_bits - streams.auxiliary_mask_ones, streams.auxiliary_mask_bits, streams.auxiliary_mask_entropy_bits, scale_bits, overhead_bits, header_size, payload_size, n_payloads);
+
+    // KO: 마지막을 제외한 페이로드마다 크기 varint가 붙습니다. 페이로드 크기를 모르므로 평균 크기로 계산합니다.
+    // EN: Every payload but the last carries a size varint. The payload sizes are not known apart, so the average is used.
+    if (n_payloads > 1) header_size += (n_payloads - 1) * varint_size(payload_size / n_payloads);
+    result.predicted_size = header_size + payload_size;
+    return result;
+}
+
+// KO: 압축 블록 형식(BLOCK_FLAG_COMPACT)의 블록을 복호화합니다.
+// EN: Decompresses a block in the compact block format (BLOCK_FLAG_COMPACT).
+//     depth는 중첩 블록의 깊이이며, 손상된 데이터가 끝없이 재귀하지 않도록 MAX_STREAM_TREE_DEPTH로 제한합니다.
+// EN: `depth` is the nesting depth of the block, bounded by MAX_STREAM_TREE_DEPTH so that corrupted data cannot recurse forever.
+static std::vector<uint8_t> decompress_compact_block(const std::vector<uint8_t>& compressed_block_data, unsigned depth = 0) {
+    // --- 1단계: 블록 헤더 파싱 ---
+    // --- Step 1: Parse Block Header ---
+    std::cout << "  [1/3] Parsing compact block header..." << std::endl;
+    const uint8_t* read_ptr = compressed_block_data.data();
+    const uint8_t* data_end = read_ptr + compressed_block_data.size();
+    const uint8_t metadata_flags = *read_ptr++;
+    uint8_t layout = 0;
+    if ((metadata_flags & BLOCK_FLAG_LAYOUT) && read_ptr < data_end) layout = *read_ptr++;
+    const unsigned symbol_width = symbol_width_from_code(layout);
+    const SymbolPairing pairing = static_cast<SymbolPairing>((layout >> 2) & 0x03);
+    TransformSpec transform;
+    bool has_matches = false;
+    if (symbol_width == 0 ||
+        static_cast<uint8_t>(pairing) > 2 || (symbol_width != 2 && pairing != SymbolPairing::Canonical) ||
+        ((layout & LAYOUT_FLAG_TRANSFORM) && !read_transform(read_ptr, data_end, transform, has_matches))) {
+        std::cerr << "Error: Corrupted block header, unknown block layout." << std::endl;
+        return {};
+    }
+    uint64_t restored_size = 0, sequences_size = 0;
+    std::vector<uint8_t> match_sequences;
+    if (has_matches) {
+        if (!read_varint(read_ptr, data_end, restored_size) || !read_varint(read_ptr, data_end, sequences_size) ||
+            restored_size > (UINT64_MAX >> 5) || sequences_size > static_cast<uint64_t>(data_end - read_ptr)) {
+            std::cerr << "Error: Corrupted block header, invalid match sequences." << std::endl;
+            return {};
+        }
+        match_sequences.assign(read_ptr, read_ptr + sequences_size);
+        read_ptr += sequences_size;
+    }
+    uint64_t chunk_kib = 0;
+    if ((metadata_flags & BLOCK_FLAG_CHUNKED_FREQS) &&
+        (!read_varint(read_ptr, data_end, chunk_kib) || chunk_kib == 0 || chunk_kib > MAX_FREQ_CHUNK_KIB)) {
+        std::cerr << "Error: Corrupted block header, invalid frequency chunk size." << std::endl;
+        return {};
+    }
+    uint8_t stream_tree = 0;
+    if (!(metadata_flags & BLOCK_FLAG_SINGLE_LEVEL)) {
+        if (read_ptr >= data_end || (stream_tree = *read_ptr++) == 0 || (stream_tree & ~(STREAM_TREE_NESTED_MASK | STREAM_TREE_LANES_MASK)) != 0 ||
+            (((stream_tree & STREAM_TREE_NESTED_MASK) | (stream_tree >> STREAM_TREE_LANES_SHIFT)) & (layout >> 5)) != 0 ||
+            (stream_tree & (stream_tree >> STREAM_TREE_LANES_SHIFT)) != 0 ||
+            ((stream_tree & STREAM_TREE_NESTED_MASK) != 0 && depth >= MAX_STREAM_TREE_DEPTH)) {
+            std::cerr << "Error: Corrupted block header, invalid stream tree." << std::endl;
+            return {};
+        }
+    }
+    const uint64_t symbols_per_byte = SeparationEngine::symbols_per_byte(symbol_width);
+
+    uint64_t original_size, n_placeholders;
+    if (!read_varint(read_ptr, data_end, original_size) || !read_varint(read_ptr, data_end, n_placeholders) ||
+        original_size > (UINT64_MAX >> 5) || n_placeholders > original_size * symbols_per_byte) {
+        std::cerr << "Error: Corrupted block header, size mismatch." << std::endl;
+        return {};
+    }
+
+    const RansEngine rans_engine = (metadata_flags & (1 << 4)) ? RansEngine::Rans64 : RansEngine::RansByte;
+    bool lanes[3] = { false, false, false };
+    for (int i = 0; i < 2; ++i) lanes[i] = (stream_tree & (1 << (STREAM_TREE_LANES_SHIFT + i))) != 0;
+
+    // KO: 스트림 순서: reconstructed (심볼 쌍), value_bitmap, auxiliary_mask
+    //     tANS 스트림은 재구성 스트림도 접두 비트 쌍 없이 그대로 부호화하며, 빈도 없이 항상 페이로드를 갖습니다.
+    //     페이로드가 중첩 압축 블록인 중첩 스트림도 마찬가지입니다. 레인 배치 스트림도 접두 비트 쌍이 없습니다.
+    // EN: Stream order: reconstructed (symbol pairs), value_bitmap, auxiliary_mask
+    //     tANS streams code even the reconstructed stream as is, without prefix pairs, and always have a payload with no frequency.
+    //     So do nested streams, whose payload is a nested compact block. Lane-layout streams have no prefix pairs either.
+    StreamDescriptor descriptors[3];
+    descriptors[0].symbol_count = original_size * symbols_per_byte * (lanes[0] ? 1 : 2);
+    descriptors[1].symbol_count = (original_size * symbols_per_byte - n_placeholders) * SeparationEngine::value_bits_per_symbol(symbol_width);
+    descriptors[2].symbol_count = n_placeholders;
+    bool use_table_ans[3], nested[3], has_payload[3] = { false, false, false };
+    int last_payload = -1;
+    for (int i = 0; i < 3; ++i) {
+        use_table_ans[i] = (layout & (LAYOUT_FLAG_TABLE_ANS << i)) != 0;
+        nested[i] = (stream_tree & STREAM_TREE_NESTED_MASK & (1 << i)) != 0;
+        if (descriptors[i].symbol_count == 0) continue;
+        if (use_table_ans[i] || nested[i]) {
+            has_payload[i] = true;
+            last_payload = i;
+            continue;
+        }
+        const uint64_t prob_scale = uint64_t(1) << rANS_Coder::engine_scale_bits(lanes[i] ? RansEngine::RansLanes : rans_engine);
+        uint64_t freq0;
+        if (!read_varint(read_ptr, data_end, freq0) || freq0 > prob_scale) {
+            std::cerr << "Error: Corrupted block header, invalid stream frequency." << std::endl;
+            return {};
+        }
+        descriptors[i].norm_freq0 = static_cast<uint32_t>(freq0);
+        has_payload[i] = (freq0 != 0 && freq0 != prob_scale);
+        if (has_payload[i]) last_payload = i;
+    }
+
+    uint64_t payload_sizes[3] = { 0, 0, 0 };
+    for (int i = 0; i < last_payload; ++i) {
+        if (has_payload[i] && !read_varint(read_ptr, data_end, payload_sizes[i])) {
+            std::cerr << "Error: Corrupted block header, size mismatch." << std::endl;
+            return {};
+        }
+    }
+
+    // KO: 헤더에 기록된 크기 정보가 실제 데이터 크기와 맞는지 검증하여 데이터 손상을 확인합니다.
+    // EN: Validates if the size information in the header matches the actual data size to check for corruption.
+    uint64_t remaining = static_cast<uint64_t>(data_end - read_ptr);
+    for (int i = 0; i < last_payload; ++i) {
+        if (payload_sizes[i] > remaining) {
+            std::cerr << "Error: Corrupted block header, size mismatch." << std::endl;
+            return {};
+        }
+        remaining -= payload_sizes[i];
+    }
+    if (last_payload >= 0) payload_sizes[last_payload] = remaining;
+
+    std::vector<uint8_t> payloads[3];
+    for (int i = 0; i < 3; ++i) {
+        payloads[i].assign(read_ptr, read_ptr + payload_sizes[i]);
+        read_ptr += payload_sizes[i];
+    }
+
+    // --- 2단계: 각 스트림의 복호기 열기 ---
+    // --- Step 2: Open the Decoder of Every Stream ---
+    // KO: 스트림을 한꺼번에 복호화하지 않고 공급원으로 엽니다. 재조립 루프가 필요한 만큼씩 비트를 요청하므로,
+    //     원본 바이트가 압축 데이터에서 바로 만들어지고 작업 집합은 판독기의 작은 창으로 제한됩니다.
+    // EN: The streams are opened as sources instead of being decoded all at once. The reassembly loop requests bits as it needs them,
+    //     so the original bytes are produced straight from the compressed data and the working set is bounded by the small reader windows.
+    std::cout << "  [2/3] Opening stream decoders..." << std::endl;
+    rANS_Coder byte_coder(StreamHeaderVersion::Detached, rans_engine, chunk_kib * 1024 * 8);
+    rANS_Coder lane_coder(StreamHeaderVersion::Detached, RansEngine::RansLanes);
+    tANS_Coder table_coder;
+    bool is_placeholder_common = (metadata_flags & (1 << 1));
+    std::unique_ptr<PackedBitSource> nested_streams[2];
+    for (int i = 0; i < 2; ++i) {
+        if (!nested[i]) continue;
+        const uint64_t bit_count = (i == 0) ? descriptors[0].symbol_count / 2 : descriptors[1].symbol_count;
+        std::cout << "    - Decoding nested block of stream " << i << "..." << std::endl;
+        const std::vector<uint8_t> stream_bytes = (!payloads[i].empty() && (payloads[i][0] & (BLOCK_FLAG_COMPACT | BLOCK_FLAG_TRAINED_MODEL)) == BLOCK_FLAG_COMPACT)
+            ? decompress_compact_block(payloads[i], depth + 1) : std::vector<uint8_t>();
+        if (stream_bytes.size() != (bit_count + 7) / 8) {
+            std::cerr << "Error: Corrupted nested block, stream size mismatch." << std::endl;
+            return {};
+        }
+        nested_streams[i] = std::make_unique<StoredBitSource>(packed_bits_from_bytes(stream_bytes, bit_count));
+    }
+    std::unique_ptr<PackedBitSource> reconstructed_stream = nested[0] ? std::move(nested_streams[0])
+        : use_table_ans[0] ? table_coder.open_bits(payloads[0], descriptors[0].symbol_count / 2)
+        : (lanes[0] ? lane_coder : byte_coder).open_reconstructed_stream(payloads[0], is_placeholder_common, &descriptors[0]);
+    std::unique_ptr<PackedBitSource> value_bitmap = nested[1] ? std::move(nested_streams[1])
+        : use_table_ans[1] ? table_coder.open_bits(payloads[1], descriptors[1].symbol_count) : (lanes[1] ? lane_coder : byte_coder).open_bits(payloads[1], &descriptors[1]);
+    std::unique_ptr<PackedBitSource> auxiliary_mask = use_table_ans[2] ? table_coder.open_bits(payloads[2], descriptors[2].symbol_count) : byte_coder.open_bits(payloads[2], &descriptors[2]);
+
+    // --- 3단계: 복호화와 재조립 ---
+    // --- Step 3: Decode and Reconstruct ---
+    // KO: 측정 중에는 스트림을 먼저 모두 복호화하여, 엔트로피 복호화와 재조립을 따로 잽니다.
+    // EN: While profiling the streams are decoded in full first, so the entropy decoding and the reassembly are measured apart.
+    std::cout << "  [3/3] Decoding streams and reconstructing final data..." << std::endl;
+    if (perf_profiling_enabled()) {
+        PerfStage stage("decode streams", original_size);
+        reconstructed_stream = std::make_unique<StoredBitSource>(read_all_bits(*reconstructed_stream));
+        value_bitmap = std::make_unique<StoredBitSource>(read_all_bits(*value_bitmap));
+        auxiliary_mask = std::make_unique<StoredBitSource>(read_all_bits(*auxiliary_mask));
+    }
+    SeparationEngine separation_engine;
+    std::vector<uint8_t> original_block;
+    {
+        PerfStage stage("reconstruct", original_size);
+        original_block = separation_engine.reconstruct(
+            *value_bitmap,
+            *auxiliary_mask,
+            *reconstructed_stream,
+            (metadata_flags & (1 << 0)) != 0,
+            original_size,
+            symbol_width,
+            pairing
+        );
+    }
+    if (!transform.is_identity() && original_block.size() == original_size) {
+        PerfStage stage("inverse transform", original_size);
+        original_block = inverse_transform(original_block, transform);
+    }
+    if (has_matches && original_block.size() == original_size) {
+        PerfStage stage("expand matches", restored_size);
+        std::vector<uint8_t> restored_block;
+        if (!expand_matches(original_block, match_sequences, restored_size, restored_block)) {
+            std::cerr << "Error: Corrupted match sequences." << std::endl;
+            return {};
+        }
+        original_block = std::move(restored_block);
+    }
+
+    std::cout << "    - Done. Decompressed block size: " << original_block.size() << " bytes." << std::endl;
+    return original_block;
+}
+
+// KO: 단일 압축 블록을 복호화하는 전체 과정을 수행합니다.
+// EN: Performs the entire process of decompressing a single compressed block.
+std::vector<uint8_t> decompress_block(const std::vector<uint8_t>& compressed_block_data, const TrainedModel* model,
+                                      const std::vector<uint8_t>* previous_block) {
+    // KO: 학습된 모델 블록은 첫 바이트(metadata_flags)의 5번 비트로 구별합니다.
+    //     압축 블록 형식은 6번 비트로 구별하며, 둘 다 아니면 고정 크기 TriSplitBlockHeader를 갖는 기존 블록입니다.
+    //     두 비트가 함께 설정된 저장 블록을 먼저 확인합니다.
+    // EN: A trained-model block is recognized by bit 5 of its first byte (metadata_flags).
+    //     The compact block format is recognized by bit 6; anything else is a legacy block with a fixed-size TriSplitBlockHeader.
+    //     Stored blocks, which set both bits, are checked first.
+    if (!compressed_block_data.empty() && (compressed_block_data[0] & BLOCK_STORED) == BLOCK_STORED) {
+        if (compressed_block_data[0] == BLOCK_REFERENCE) {
+            std::cerr << "Error: A reference block must be resolved by the container." << std::endl;
+            return {};
+        }
+        if (compressed_block_data[0] == BLOCK_LINKED) {
+            if (previous_block == nullptr) {
+                std::cerr << "Error: A linked block needs the previous block." << std::endl;
+                return {};
+            }
+            const TrainedModel linked_model = linked_block_model(*previous_block);
+            const std::vector<uint8_t> inner_block(compressed_block_data.begin() + 1, compressed_block_data.end());
+            uint32_t model_id = 0;
+            if (inner_block.size() >= 5) memcpy(&model_id, inner_block.data() + 1, 4);
+            if (!(inner_block.size() >= 5 && (inner_block[0] & BLOCK_FLAG_TRAINED_MODEL)) || model_id != linked_model.model_id) {
+                std::cerr << "Error: Linked block does not match the previous block." << std::endl;
+                return {};
+            }
+            std::cout << "  - Linked block." << std::endl;
+            return decompress_block_with_model(inner_block, &linked_model);
+        }
+        if (compressed_block_data[0] != BLOCK_STORED) {
+            std::cerr << "Error: Invalid stored block flags." << std::endl;
+            return {};
+        }
+        std::cout << "  - Stored block: " << compressed_block_data.size() - 1 << " bytes." << std::endl;
+        return std::vector<uint8_t>(compressed_block_data.begin() + 1, compressed_block_data.end());
+    }
+    if (!compressed_block_data.empty() && (compressed_block_data[0] & BLOCK_FLAG_TRAINED_MODEL)) {
+        return decompress_block_with_model(compressed_block_data, model);
+    }
+    if (!compressed_block_data.empty() && (compressed_block_data[0] & BLOCK_FLAG_COMPACT)) {
+        return decompress_compact_block(compressed_block_data);
+    }
+
+    // --- 1단계: 블록 헤더 파싱 ---
+    // --- Step 1: Parse Block Header ---
+    std::cout << "  [1/4] Parsing block header..." << std::endl;
+    if (compressed_block_data.size() < sizeof(TriSplitBlockHeader)) {
+        std::cerr << "Error: Compressed data is smaller than header size." << std::endl;
+        return {};
+    }
+
+    TriSplitBlockHeader header;
+    memcpy(&header, compressed_block_data.data(), sizeof(header));
+
+    const uint8_t* read_ptr = compressed_block_data.data() + sizeof(header);
+    const uint8_t* data_end = compressed_block_data.data() + compressed_block_data.size();
+
+    // KO: 헤더에 기록된 크기 정보가 실제 데이터 크기와 맞는지 검증하여 데이터 손상을 확인합니다.
+    //     손상된 크기로 포인터를 먼저 더하면 넘침이 생기므로, 남은 바이트 수와 차례로 비교합니다.
+    // EN: Validates if the size information in the header matches the actual data size to check for corruption.
+    //     Adding a corrupted size to the pointer first could overflow, so each size is compared with the bytes that remain.
+    const uint64_t payload_size = static_cast<uint64_t>(data_end - read_ptr);
+    if (header.compressed_bitmap_size > payload_size ||
+        header.compressed_mask_size > payload_size - header.compressed_bitmap_size ||
+        header.compressed_reconstructed_size > payload_size - header.compressed_bitmap_size - header.compressed_mask_size) {
+        std::cerr << "Error: Corrupted block header, size mismatch." << std::endl;
+        return {};
+    }
+
+    // KO: 헤더 정보를 바탕으로 각 압축 스트림을 별도의 벡터로 분리합니다.
+    // EN: Separates each compressed stream into its own vector based on the header information.
+    std::vector<uint8_t> compressed_bitmap(read_ptr, read_ptr + header.compressed_bitmap_size);
+    read_ptr += header.compressed_bitmap_size;
+    std::vector<uint8_t> compressed_mask(read_ptr, read_ptr + header.compressed_mask_size);
+    read_ptr += header.compressed_mask_size;
+    std::vector<uint8_t> compressed_reconstructed_data(read_ptr, read_ptr + header.compressed_reconstructed_size);
+
+    // --- 2단계: 각 스트림 복호화 ---
+    // --- Step 2: Decompress Each Stream ---
+    std::cout << "  [2/4] Decompressing Value Bitmap & Auxiliary Mask streams..." << std::endl;
+    // KO: 기존 형식(V1)으로 기록된 블록도 복호화할 수 있도록 헤더 플래그에 따라 스트림 헤더 형식을 선택합니다.
+    // EN: Selects the stream header format from the header flags so that blocks written in the legacy (V1) format still decode.
+    const StreamHeaderVersion stream_header_version = (header.metadata_flags & (1 << 3)) ? StreamHeaderVersion::V2 : StreamHeaderVersion::V1;
+    const RansEngine rans_engine = (header.metadata_flags & (1 << 4)) ? RansEngine::Rans64 : RansEngine::RansByte;
+    rANS_Coder byte_coder(stream_header_version, rans_engine);
+    PackedBits value_bitmap = byte_coder.decode_bits(compressed_bitmap);
+    PackedBits auxiliary_mask = byte_coder.decode_bits(compressed_mask);
+
+    std::cout << "  [3/4] Decompressing Reconstructed stream with rANS engine..." << std::endl;
+    // KO: 헤더의 메타데이터 플래그를 읽어 복호화 함수에 전달합니다.
+    // EN: Reads the metadata flags from the header and passes them to the decompression function.
+    bool is_placeholder_common = (header.metadata_flags & (1 << 1));
+    PackedBits reconstructed_stream = byte_coder.decode_reconstructed_stream(compressed_reconstructed_data, is_placeholder_common);
+
+    // --- 3단계: 최종 데이터 재조립 ---
+    // --- Step 3: Reconstruct Final Data ---
+    std::cout << "  [4/4] Reconstructing final data..." << std::endl;
+    SeparationEngine separation_engine;
+    bool aux_mask_1_represents_11 = (header.metadata_flags & (1 << 0));
+
+    std::vector<uint8_t> original_block = separation_engine.reconstruct(
+        value_bitmap,
+        auxiliary_mask,
+        reconstructed_stream,
+        aux_mask_1_represents_11,
+        header.original_data_size
+    );
+
+    std::cout << "    - Done. Decompressed block size: " << original_block.size() << " bytes." << std::endl;
+    return original_block;
+}
\ No newline at end of file
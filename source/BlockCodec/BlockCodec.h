@@ -0,0 +1,258 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+#include "../TrainedModel/TrainedModel.h"
+#include "../SeparationEngine/SeparationEngine.h"
+#include "../Transform/Transform.h"
+
+// KO: 메모리 정렬(padding)을 비활성화하여 구조체를 파일에 쓰거나 읽을 때 크기가 그대로 유지되도록 합니다.
+// EN: Disables memory alignment (padding) to ensure the struct's size remains consistent when writing to or reading from a file.
+#pragma pack(push, 1)
+// KO: 압축된 각 블록의 시작 부분에 위치하는 헤더 정보입니다.
+//     복호화에 필요한 모든 메타데이터와 각 데이터 스트림의 크기를 담고 있습니다.
+// EN: The header information located at the beginning of each compressed block.
+//     It contains all the necessary metadata for decompression and the size of each data stream.
+struct TriSplitBlockHeader {
+    // KO: 비트 플래그 필드. 
+    //     - 0번 비트: aux_mask_1_represents_11 (1이면 true)
+    //     - 1번 비트: is_placeholder_common (1이면 true)
+    //     - 2번 비트: 사용된 엔진 (항상 1, rANS 의미)
+    //     - 3번 비트: 스트림 헤더 형식 (1이면 64비트 심볼 수를 갖는 V2, 0이면 기존 V1)
+    //     - 4번 비트: rANS 엔진 (1이면 64비트 상태 rans64, 0이면 기존 바이트 단위 rANS)
+    //     - 5번 비트: 학습된 모델 블록 (1이면 이 구조체 대신 학습된 모델 블록 형식을 사용)
+    //     - 6번 비트: 압축 블록 형식 (1이면 이 구조체 대신 varint 블록 헤더를 사용)
+    // EN: A bitfield for flags.
+    //     - Bit 0: aux_mask_1_represents_11 (1 if true)
+    //     - Bit 1: is_placeholder_common (1 if true)
+    //     - Bit 2: Engine used (always 1, means rANS)
+    //     - Bit 3: Stream header format (1 for V2 with 64-bit symbol counts, 0 for legacy V1)
+    //     - Bit 4: rANS engine (1 for the 64-bit state rans64, 0 for the legacy byte-wise rANS)
+    //     - Bit 5: Trained-model block (1 if the block uses the trained-model layout instead of this struct)
+    //     - Bit 6: Compact block format (1 if the block uses the varint block header instead of this struct)
+    uint8_t  metadata_flags;
+    uint8_t  reserved[7]; // KO: 예약된 공간. 향후 확장을 위함. / EN: Reserved space for future expansion.
+    uint64_t original_data_size; // KO: 원본 블록 데이터의 크기 / EN: The size of the original block data.
+    uint64_t compressed_bitmap_size; // KO: 압축된 value_bitmap 스트림의 크기 / EN: The size of the compressed value_bitmap stream.
+    uint64_t compressed_mask_size; // KO: 압축된 auxiliary_mask 스트림의 크기 / EN: The size of the compressed auxiliary_mask stream.
+    uint64_t compressed_reconstructed_size; // KO: 압축된 reconstructed_stream의 크기 / EN: The size of the compressed reconstructed_stream.
+};
+#pragma pack(pop)
+
+// KO: 블록 헤더의 5번 비트가 설정된 블록은 학습된 모델을 참조하는 작은 블록 형식을 사용합니다.
+//     [uint8 metadata_flags][uint32 model_id][varint 원본 크기][varint 자리표시자 수][rANS 페이로드]
+//     스트림 헤더와 스트림별 크기가 없으며, 세 스트림은 모델의 고정 확률로 하나의 rANS 상태에 이어서 부호화됩니다.
+// EN: A block with bit 5 of the block header set uses the small block layout that references a trained model.
+//     [uint8 metadata_flags][uint32 model_id][varint original size][varint placeholder count][rANS payload]
+//     There are no stream headers or per-stream sizes; the three streams are coded back to back into a single
+//     rANS state with the fixed probabilities of the model.
+constexpr uint8_t BLOCK_FLAG_TRAINED_MODEL = 1 << 5;
+
+// KO: 새로 압축되는 블록이 사용하는 압축 블록 형식입니다. (TriSplitBlockHeader는 기존 블록을 읽을 때만 사용합니다.)
+//     [uint8 metadata_flags][varint 원본 크기][varint 자리표시자 수]
+//     [비어 있지 않은 스트림마다 varint norm_freqs[0]][마지막을 제외한 페이로드마다 varint 크기][페이로드]
+//     스트림 순서는 reconstructed, value_bitmap, auxiliary_mask이며, 심볼 수는 원본 크기와 자리표시자 수로부터 유도됩니다.
+//     빈 스트림과 퇴화 스트림(모든 심볼이 같음)은 페이로드가 없으므로, 작은 블록의 헤더는 수 바이트에 불과합니다.
+// EN: The compact block format used by newly compressed blocks. (TriSplitBlockHeader is only used to read legacy blocks.)
+//     [uint8 metadata_flags][varint original size][varint placeholder count]
+//     [varint norm_freqs[0] per non-empty stream][varint size per payload except the last][payloads]
+//     The streams are ordered reconstructed, value_bitmap, auxiliary_mask, and their symbol counts follow from the
+//     original size and the placeholder count. Empty and degenerate streams (all symbols equal) have no payload,
+//     so the header of a small block is only a few bytes.
+constexpr uint8_t BLOCK_FLAG_COMPACT = 1 << 6;
+
+// KO: 압축 블록 형식에서 7번 비트가 설정되면 metadata_flags 바로 뒤에 분리 방식을 나타내는 uint8 layout 바이트가 옵니다.
+//     기본값(2비트 심볼)만 사용하는 블록은 이 바이트를 생략합니다.
+//     - 0~1번 비트: 심볼 폭 (0: 2비트, 1: 1비트, 2: 4비트)
+//     - 2~3번 비트: 심볼 짝짓기 (SymbolPairing, 2비트 심볼 전용)
+//     - 4번 비트: 사전 변환 사용. layout 바이트 뒤에 [uint8 변환 (0~1번 비트: ByteFilter, 2~3번 비트: Transposition)]
+//                 [필터가 있으면 varint lag][전치가 있으면 varint stride]가 옵니다. 변환 바이트의 4번 비트(TRANSFORM_FLAG_MATCHES)는
+//                 일치 사전 처리를 뜻하며, 그 뒤에 [varint 복원 크기][varint 일치 시퀀스 크기][일치 시퀀스]가 옵니다.
+//                 이때 블록의 원본 크기 자리에는 분리되는 리터럴의 수가 기록됩니다. 순방향은 일치, 필터, 전치 순입니다.
+//     - 5~7번 비트: 스트림별(reconstructed, value_bitmap, auxiliary_mask 순) tANS 사용. tANS 스트림은 norm_freqs[0]을 기록하지 않습니다.
+// EN: In the compact block format, bit 7 means a uint8 layout byte describing the separation follows right after metadata_flags.
+//     Blocks that only use the defaults (2-bit symbols) omit this byte.
+//     - Bits 0-1: Symbol width (0: 2-bit, 1: 1-bit, 2: 4-bit)
+//     - Bits 2-3: Symbol pairing (SymbolPairing, 2-bit symbols only)
+//     - Bit 4: Pre-transform used. The layout byte is followed by [uint8 transform (bits 0-1: ByteFilter, bits 2-3: Transposition)]
+//              [varint lag if there is a filter][varint stride if there is a transposition]. Bit 4 of the transform byte
+//              (TRANSFORM_FLAG_MATCHES) means the match prepass, followed by [varint restored size][varint match sequence size][match sequences];
+//              the original size field of the block then holds the number of separated literals. The forward order is matches, filter, transposition.
+//     - Bits 5-7: tANS used, per stream (reconstructed, value_bitmap, auxiliary_mask in order). tANS streams write no norm_freqs[0].
+constexpr uint8_t BLOCK_FLAG_LAYOUT = 1 << 7;
+constexpr uint8_t LAYOUT_FLAG_TRANSFORM = 1 << 4;
+constexpr uint8_t LAYOUT_FLAG_TABLE_ANS = 1 << 5;
+constexpr uint8_t TRANSFORM_FLAG_MATCHES = 1 << 4;
+
+// KO: 압축 블록 형식에서 3번 비트가 설정되면 layout 바이트(와 변환 정보) 뒤에 [varint 청크 크기(KiB)]가 옵니다.
+//     청크 크기보다 긴 rANS 스트림은 청크마다 다시 계산한 빈도를 사용하며, 청크 빈도 표는 각 페이로드의 앞에 있습니다.
+// EN: In the compact block format, bit 3 means a [varint chunk size (KiB)] follows the layout byte (and the transform).
+//     rANS streams longer than a chunk use frequencies recomputed for every chunk, with the chunk frequency table at the front of each payload.
+constexpr uint8_t BLOCK_FLAG_CHUNKED_FREQS = 1 << 3;
+constexpr uint64_t MAX_FREQ_CHUNK_KIB = 1 << 20;
+
+// KO: 압축 블록 형식의 2번 비트는 예전부터 모든 압축 블록에 설정되어 왔으며, 단일 단계 블록은 계속 이 비트를 설정합니다.
+//     이 비트가 꺼져 있으면 다단계 블록이며, 청크 크기 자리 뒤에 [uint8 스트림 트리]가 옵니다. 스트림 트리의 i번 비트가 설정된
+//     스트림(0: reconstructed, 1: value_bitmap)은 norm_freqs[0]을 기록하지 않고, 페이로드가 그 스트림의 비트열(MSB-first 바이트열)을
+//     다시 분리한 중첩 압축 블록입니다. 중첩 블록도 자신의 스트림 트리를 가지므로, 블록 헤더들이 모여 재귀 트리를 이룹니다.
+// EN: Bit 2 of the compact block format has always been set in every compact block, and single-level blocks keep setting it.
+//     If it is clear the block is a multi-level block, and a [uint8 stream tree] follows the place of the chunk size. A stream whose
+//     bit i is set in the stream tree (0: reconstructed, 1: value_bitmap) writes no norm_freqs[0], and its payload is a nested compact
+//     block that separates the bits of that stream (as MSB-first bytes) again. Nested blocks carry stream trees of their own,
+//     so the block headers together form the recursion tree.
+constexpr uint8_t BLOCK_FLAG_SINGLE_LEVEL = 1 << 2;
+constexpr uint8_t STREAM_TREE_NESTED_MASK = 0x03;
+constexpr unsigned MAX_STREAM_TREE_DEPTH = 4;
+
+// KO: 스트림 트리의 (2 + i)번 비트가 설정된 스트림(0: reconstructed, 1: value_bitmap)은 블록의 rANS 엔진 대신 레인 배치
+//     (RansEngine::RansLanes)로 부호화되어 SIMD로 복호화됩니다. 그 norm_freqs[0]은 레인 배치의 정밀도를 따르며, 청크 빈도를
+//     사용하지 않습니다. 중첩 스트림과 tANS 스트림에는 설정되지 않고, 레인 비트만 있는 블록도 스트림 트리를 기록하므로 2번 비트를 끕니다.
+// EN: A stream whose bit (2 + i) is set in the stream tree (0: reconstructed, 1: value_bitmap) is coded in the lane-interleaved layout
+//     (RansEngine::RansLanes) instead of the rANS engine of the block, and decodes with SIMD. Its norm_freqs[0] follows the precision of
+//     the lane layout, and it never uses chunked frequencies. It is never set for nested or tANS streams, and a block with only lane bits
+//     still writes the stream tree, so it clears bit 2.
+constexpr unsigned STREAM_TREE_LANES_SHIFT = 2;
+constexpr uint8_t STREAM_TREE_LANES_MASK = STREAM_TREE_NESTED_MASK << STREAM_TREE_LANES_SHIFT;
+
+// KO: 5번 비트와 6번 비트가 함께 설정된 블록은 저장 블록입니다. (두 형식은 서로의 비트를 설정하지 않습니다.)
+//     [uint8 BLOCK_STORED][원본 바이트]
+//     압축해도 줄어들지 않는 블록을 1바이트만 더해 그대로 담으며, 복호화는 복사 한 번입니다.
+// EN: A block with both bit 5 and bit 6 set is a stored block. (Neither of those two formats ever sets the other's bit.)
+//     [uint8 BLOCK_STORED][original bytes]
+//     It holds a block that does not shrink when compressed as is, for a single extra byte, and decodes with one copy.
+constexpr uint8_t BLOCK_STORED = BLOCK_FLAG_TRAINED_MODEL | BLOCK_FLAG_COMPACT;
+
+// KO: 저장 블록의 0번 비트가 설정되면 앞선 블록과 똑같은 블록을 가리키는 참조 블록입니다.
+//     [uint8 BLOCK_REFERENCE][varint 복호화된 출력에서 원본 블록의 오프셋][varint 크기]
+//     참조는 블록 하나만으로 풀 수 없으므로 컨테이너가 앞선 블록을 다시 풀어 복사하며, decompress_block은 이를 받지 않습니다.
+// EN: A stored block with bit 0 set is a reference block that points to an earlier, identical block.
+//     [uint8 BLOCK_REFERENCE][varint offset of the original block in the decompressed output][varint size]
+//     A reference cannot be resolved from the block alone, so the container decodes the earlier block again and copies it,
+//     and decompress_block does not accept it.
+constexpr uint8_t BLOCK_REFERENCE = BLOCK_STORED | (1 << 0);
+
+// KO: 저장 블록의 1번 비트가 설정되면 바로 앞 블록의 통계로 확률을 정하는 연결 블록입니다.
+//     [uint8 BLOCK_LINKED][학습된 모델 블록]
+//     모델은 앞 블록의 원본 바이트로 학습한 것(linked_block_model)이며, 안쪽 블록의 model_id로 앞 블록이 맞는지 확인합니다.
+//     작은 블록도 빈도 정보 없이 앞 블록이 쌓은 통계로 부호화되므로, 큰 블록에 가까운 압축률을 얻습니다.
+//     연결은 컨테이너가 정한 재시작 지점에서 끊기므로, 임의 접근은 가장 가까운 재시작 지점부터 복호화합니다.
+// EN: A stored block with bit 1 set is a linked block, whose probabilities come from the statistics of the block right before it.
+//     [uint8 BLOCK_LINKED][trained-model block]
+//     The model is trained on the original bytes of the previous block (linked_block_model), and the model_id of the inner
+//     block checks that the previous block is the right one. Small blocks are thus coded with the statistics built up by
+//     the previous block instead of their own frequencies, for a ratio close to that of large blocks.
+//     The chain is cut at the reset points chosen by the container, so random access decodes from the nearest reset point.
+constexpr uint8_t BLOCK_LINKED = BLOCK_STORED | (1 << 1);
+
+// KO: 블록 압축 방식을 조정하는 선택 사항입니다.
+// EN: Options that tune how blocks are compressed.
+struct CompressionOptions {
+    unsigned symbol_width = 2; // KO: SeparationEngine의 심볼 폭 (1, 2, 4) / EN: Symbol width of the SeparationEngine (1, 2, 4)
+    bool optimize_pairing = false; // KO: 블록마다 최적의 심볼 짝짓기를 고름 (2비트 심볼) / EN: Picks the best symbol pairing per block (2-bit symbols)
+    bool allow_table_ans = true;   // KO: 복호화가 빠른 tANS를 스트림별로 고를 수 있음 / EN: Lets every stream pick tANS, which decodes faster
+    TransformSpec transform;       // KO: 분리 전에 적용할 사전 변환 (학습된 모델 블록에는 적용되지 않음) / EN: Pre-transform applied before separation (not applied to trained-model blocks)
+    uint64_t freq_chunk_kib = 0;   // KO: 0이 아니면 rANS 스트림의 빈도를 이 크기(KiB)마다 다시 계산함 / EN: If non-zero, rANS streams recompute their frequencies every this many KiB
+    unsigned threads = 0;          // KO: 큰 블록의 분리에 사용할 최대 스레드 수 (0이면 모든 코어) / EN: Most threads used to separate a large block (0 for every core)
+    unsigned stream_tree_depth = 0;     // KO: 파생 스트림을 다시 분리할 최대 단계 수 (0이면 단일 단계) / EN: Most levels of re-separating derived streams (0 for single-level)
+    double stream_tree_min_gain = 0.01; // KO: 추정 크기가 이 비율 이상 줄어들 때만 다시 분리함 / EN: Separates again only if the estimated size shrinks by at least this fraction
+    bool match_prepass = false;         // KO: 분리 전에 긴 반복을 일치로 바꿈 (LZ 사전 처리) / EN: Turns long repeats into matches before separation (LZ prepass)
+    bool search_symbol_width = false;   // KO: 블록마다 추정 크기가 가장 작은 심볼 폭을 고름 / EN: Picks the symbol width with the smallest estimated size per block
+    bool store_incompressible = true;   // KO: 압축 결과가 원본보다 크면 저장 블록을 씀 / EN: Writes a stored block if the compressed block is larger than the original
+    bool bypass_incompressible = false; // KO: 추정 크기가 원본보다 작지 않으면 압축하지 않고 저장 블록을 씀 / EN: Writes a stored block without compressing if the estimated size is not below the original
+    bool lane_interleaved = false;      // KO: 긴 reconstructed / value_bitmap rANS 스트림을 SIMD로 복호화하는 레인 배치로 부호화함 / EN: Codes long reconstructed / value_bitmap rANS streams in the lane layout, which decodes with SIMD
+};
+
+// KO: 압축 수준은 속도와 압축률 사이의 일관된 전략 하나를 고르는 선택 사항의 묶음입니다.
+//     - 1: 추정으로 압축되지 않는 블록을 건너뛰고, 모든 스트림을 스트림을 만들지 않는 융합 rANS 경로로 부호화
+//     - 2: 압축한 뒤 커진 블록만 저장 블록으로 바꿈
+//     - 3: 스트림별 tANS 허용 (복호화가 빠름)
+//     - 4: 심볼 짝짓기 탐색
+//     - 5: 심볼 폭 탐색
+//     - 6: 64 KiB 청크 빈도
+//     - 7: 일치 사전 처리
+//     - 8: 파생 스트림을 한 단계 더 분리
+//     - 9: 파생 스트림을 세 단계까지 분리하고 16 KiB 청크 빈도 사용
+//     각 블록 헤더가 자신이 사용한 방식을 모두 기록하므로, 복호화에는 수준이 필요하지 않습니다.
+//     수준을 주지 않으면 DEFAULT_COMPRESSION_LEVEL을 사용하며, CompressionOptions의 기본값도 이 수준과 같습니다.
+// EN: A compression level is a bundle of options that picks one coherent strategy between speed and ratio.
+//     - 1: Skips blocks the estimate deems incompressible, and codes every stream on the fused rANS path, which materializes no stream
+//     - 2: Compresses first and turns only the blocks that grew into stored blocks
+//     - 3: Lets every stream pick tANS (decodes faster)
+//     - 4: Searches the symbol pairing
+//     - 5: Searches the symbol width
+//     - 6: 64 KiB chunked frequencies
+//     - 7: Match prepass
+//     - 8: Separates the derived streams one more level
+//     - 9: Separates the derived streams up to three levels, with 16 KiB chunked frequencies
+//     Every block header records all the tools the block used, so decompression does not need the level.
+//     Without a level DEFAULT_COMPRESSION_LEVEL is used, and the defaults of CompressionOptions are that level as well.
+constexpr unsigned MIN_COMPRESSION_LEVEL = 1;
+constexpr unsigned MAX_COMPRESSION_LEVEL = 9;
+constexpr unsigned DEFAULT_COMPRESSION_LEVEL = 3;
+
+// KO: 압축 수준(MIN_COMPRESSION_LEVEL~MAX_COMPRESSION_LEVEL)에 해당하는 선택 사항을 반환합니다.
+// EN: Returns the options of a compression level (MIN_COMPRESSION_LEVEL to MAX_COMPRESSION_LEVEL).
+CompressionOptions compression_level_options(unsigned level);
+
+// KO: compress_block을 실행하지 않고 예측한 블록의 압축 결과입니다.
+// EN: The outcome of compressing a block, predicted without running compress_block.
+struct BlockEstimate {
+    uint64_t original_size = 0;
+    uint64_t predicted_size = 0; // KO: 블록 헤더와 rANS 플러시를 포함한 예측 크기 / EN: Predicted size including the block header and rANS flushes
+    SeparationEstimate streams;  // KO: 스트림별 통계와 엔트로피 / EN: Per-stream statistics and entropies
+};
+
+// KO: 단일 데이터 블록을 압축합니다. model이 주어지면 학습된 모델 블록 형식을 사용합니다.
+// EN: Compresses a single data block. When a model is given, the trained-model block layout is used.
+std::vector<uint8_t> compress_block(const std::vector<uint8_t>& block_data, const TrainedModel* model = nullptr, const CompressionOptions& options = {});
+
+// KO: 앞 블록의 원본 바이트로 연결 블록의 모델을 만듭니다.
+// EN: Builds the model of a linked block from the original bytes of the previous block.
+TrainedModel linked_block_model(const std::vector<uint8_t>& previous_block);
+
+// KO: 앞 블록에 연결하여 블록을 압축합니다. 연결 블록과 독립 블록(compress_block) 중 예측 크기가 작은 쪽을 기록합니다.
+//     @param previous_block - 바로 앞 블록의 원본 바이트
+// EN: Compresses a block linked to the previous one. Whichever of a linked block and a standalone block (compress_block)
+//     is predicted to be smaller is written.
+//     @param previous_block - The original bytes of the block right before
+std::vector<uint8_t> compress_linked_block(const std::vector<uint8_t>& block_data, const std::vector<uint8_t>& previous_block,
+                                           const TrainedModel* model = nullptr, const CompressionOptions& options = {});
+
+// KO: 세 스트림의 0차 엔트로피를 심볼 수만으로 계산하여, rANS를 실행하지 않고 compress_block이 만들 블록의 크기를 예측합니다.
+//     바이트 히스토그램 한 번으로 끝나므로 압축보다 훨씬 빠르며, 데이터를 TriSplit으로 보낼지 미리 판단하는 데 사용합니다.
+//     예측 크기는 엔트로피에 블록 헤더와 rANS 플러시를 더한 값이며, 빈도 양자화 손실은 포함하지 않습니다.
+//     모든 스트림을 rANS로 부호화한다고 보므로, tANS 스트림이 비트 사이의 상관관계를 활용하는 블록에서는 실제보다 크게 예측합니다.
+//     청크 빈도(freq_chunk_kib), 다단계 블록(stream_tree_depth)과 일치 사전 처리(match_prepass)는 고려하지 않으므로 블록 전체의 정적 빈도를 기준으로 단일 단계 블록을 예측합니다.
+//     심볼 폭 찾기(search_symbol_width)는 압축과 같이 폭마다 추정하여 가장 작은 것을 고릅니다.
+// EN: Predicts the size of the block compress_block would produce, computing the order-0 entropies of the three streams
+//     from symbol counts alone, without running rANS. It costs a single byte histogram, far less than compressing, and is
+//     meant for deciding up front whether data should go to TriSplit at all.
+//     The predicted size is the entropy plus the block header and rANS flushes; frequency quantization losses are not included.
+//     Every stream is assumed to be coded with rANS, so blocks where tANS streams exploit correlations between bits are overestimated.
+//     Chunked frequencies (freq_chunk_kib), multi-level blocks (stream_tree_depth) and the match prepass (match_prepass) are not modelled; the prediction is
+//     for a single-level block using the static frequencies of the whole block.
+//     The symbol width search (search_symbol_width) estimates every width and picks the smallest, as compression does.
+BlockEstimate estimate_block(const std::vector<uint8_t>& block_data, const TrainedModel* model = nullptr, const CompressionOptions& options = {});
+
+// KO: 참조 블록을 만들고 읽습니다. read_reference_block은 참조 블록이 아니거나 손상되었으면 false를 반환합니다.
+// EN: Writes and reads reference blocks. read_reference_block returns false if the block is not a reference block or is corrupted.
+std::vector<uint8_t> make_reference_block(uint64_t offset, uint64_t size);
+bool read_reference_block(const std::vector<uint8_t>& block, uint64_t& offset, uint64_t& size);
+
+// KO: 블록이 연결 블록인지, 즉 복호화에 앞 블록이 필요한지 반환합니다.
+// EN: Returns whether a block is a linked block, i.e. whether decoding it needs the previous block.
+bool is_linked_block(const std::vector<uint8_t>& block);
+
+// KO: 블록을 복호화하지 않고 헤더만 읽어 원본 크기를 얻습니다. 참조 블록과 연결 블록도 받으며, 헤더가 손상되었으면 false를 반환합니다.
+// EN: Reads the original size of a block from its header alone, without decompressing it. Reference and linked blocks are accepted too,
+//     and false is returned if the header is corrupted.
+bool read_block_original_size(const std::vector<uint8_t>& block, uint64_t& original_size);
+
+// KO: 단일 압축 블록을 복호화합니다. 학습된 모델 블록은 같은 model_id의 모델이 있어야 복호화할 수 있습니다.
+//     연결 블록은 바로 앞 블록의 복호화된 바이트(previous_block)가 있어야 복호화할 수 있습니다.
+// EN: Decompresses a single compressed block. A trained-model block can only be decoded with the model of the same model_id.
+//     A linked block can only be decoded with the decoded bytes of the block right before it (previous_block).
+std::vector<uint8_t> decompress_block(const std::vector<uint8_t>& compressed_block_data, const TrainedModel* model = nullptr,
+                                      const std::vector<uint8_t>* previous_block = nullptr);
@@ -0,0 +1,62 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 블록 단위 중복 제거에 사용하는 128비트 해시(MurmurHash3 x64_128)를 구현합니다.
+// EN: This file implements the 128-bit hash (MurmurHash3 x64_128) used for block-level deduplication.
+#include "BlockHash.h"
+#include <cstring>
+#include <bit>
+
+static inline uint64_t load64(const uint8_t* ptr) {
+    uint64_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+BlockHash hash_block(const uint8_t* data, size_t size) {
+    constexpr uint64_t c1 = 0x87c37b91114253d5ULL;
+    constexpr uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = 0, h2 = 0;
+
+    // --- 본문: 16바이트 블록 ---
+    // --- Body: 16-byte blocks ---
+    const size_t n_blocks = size / 16;
+    for (size_t i = 0; i < n_blocks; ++i) {
+        uint64_t k1 = load64(data + i * 16);
+        uint64_t k2 = load64(data + i * 16 + 8);
+
+        k1 *= c1; k1 = std::rotl(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = std::rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = std::rotl(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = std::rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    // --- 꼬리: 남은 0~15바이트 ---
+    // --- Tail: the remaining 0-15 bytes ---
+    const uint8_t* tail = data + n_blocks * 16;
+    uint64_t k1 = 0, k2 = 0;
+    const size_t rest = size & 15;
+    for (size_t i = rest; i > 8; --i) k2 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 9) * 8);
+    if (rest > 8) {
+        k2 *= c2; k2 = std::rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    for (size_t i = (rest < 8 ? rest : 8); i > 0; --i) k1 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 1) * 8);
+    if (rest > 0) {
+        k1 *= c1; k1 = std::rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    // --- 마무리 ---
+    // --- Finalization ---
+    h1 ^= size; h2 ^= size;
+    h1 += h2; h2 += h1;
+    h1 = fmix64(h1); h2 = fmix64(h2);
+    h1 += h2; h2 += h1;
+    return { h1, h2 };
+}
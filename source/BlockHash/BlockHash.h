@@ -0,0 +1,25 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <cstddef>
+#include <cstdint>
+
+// KO: 블록 내용의 128비트 해시입니다. 같은 블록을 찾는 데 쓰며, 우연히 겹칠 확률은 무시할 수 있을 만큼 작습니다.
+// EN: A 128-bit hash of the content of a block. It is used to find identical blocks, and the odds of an accidental collision are negligible.
+struct BlockHash {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const BlockHash& other) const { return low == other.low && high == other.high; }
+};
+
+// KO: unordered_map의 키로 쓰기 위한 해시 함수 객체입니다. 이미 고르게 섞인 하위 64비트를 그대로 사용합니다.
+// EN: The hasher for using BlockHash as an unordered_map key. The low 64 bits are already well mixed and are used as is.
+struct BlockHashHasher {
+    size_t operator()(const BlockHash& hash) const { return static_cast<size_t>(hash.low); }
+};
+
+// KO: MurmurHash3 x64_128로 데이터의 해시를 계산합니다. 16바이트씩 처리하므로 블록 압축보다 훨씬 빠릅니다.
+// EN: Computes the hash of the data with MurmurHash3 x64_128. It works 16 bytes at a time, far faster than compressing the block.
+BlockHash hash_block(const uint8_t* data, size_t size);
@@ -0,0 +1,167 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 huge page와 NUMA 노드를 고려하는 버퍼 풀을 구현합니다.
+// EN: This file implements the buffer pool that is aware of huge pages and NUMA nodes.
+#include "BufferPool.h"
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cstdlib>
+#endif
+
+// KO: 풀이 내준 영역 하나입니다. 해제할 때 같은 노드와 크기의 목록으로 돌아갑니다.
+// EN: One region handed out by the pool. On release it goes back to the list of its node and size.
+struct PoolRegion {
+    size_t size = 0;
+    unsigned node = 0;
+};
+
+static std::mutex pool_mutex;
+static std::map<std::pair<unsigned, size_t>, std::vector<void*>> free_regions;
+static std::unordered_map<void*, PoolRegion> live_regions;
+static size_t cached_bytes = 0;
+
+// KO: 호출 스레드가 실행 중인 NUMA 노드입니다. 알 수 없으면 0입니다.
+// EN: The NUMA node the calling thread runs on. 0 if unknown.
+static unsigned current_numa_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return node;
+#elif defined(_WIN32)
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node = 0;
+    if (GetNumaProcessorNodeEx(&processor, &node)) return node;
+#endif
+    return 0;
+}
+
+// KO: 운영체제에서 2 MiB로 정렬된 새 영역을 받아 노드에 묶습니다. 실패하면 nullptr입니다.
+// EN: Gets a new 2 MiB aligned region from the OS and binds it to the node. nullptr on failure.
+static void* map_region(size_t size, unsigned node) {
+#if defined(__linux__)
+    // KO: 예약된 명시적 huge page가 있으면 먼저 사용하고, 없으면 정렬된 일반 매핑에 투명 huge page를 요청합니다.
+    // EN: Explicit huge pages are used first if any are reserved; otherwise transparent huge pages are requested on an aligned regular mapping.
+    void* region = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (region == MAP_FAILED) {
+        void* raw = mmap(nullptr, size + POOL_REGION_ALIGN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(raw);
+        const uintptr_t aligned = (begin + POOL_REGION_ALIGN - 1) & ~(uintptr_t(POOL_REGION_ALIGN) - 1);
+        if (aligned > begin) munmap(raw, aligned - begin);
+        if (aligned + size < begin + size + POOL_REGION_ALIGN) munmap(reinterpret_cast<void*>(aligned + size), begin + size + POOL_REGION_ALIGN - aligned - size);
+        region = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+        madvise(region, size, MADV_HUGEPAGE);
+#endif
+    }
+#if defined(SYS_mbind)
+    // KO: MPOL_PREFERRED(1): 가능하면 이 노드에서 페이지를 받습니다. 지원하지 않는 커널에서는 조용히 실패합니다.
+    // EN: MPOL_PREFERRED (1): take the pages from this node where possible. Fails silently on kernels without support.
+    if (node < 64) {
+        const unsigned long node_mask = 1ul << node;
+        syscall(SYS_mbind, region, size, 1, &node_mask, 64, 0);
+    }
+#endif
+    return region;
+#elif defined(_WIN32)
+    // KO: 여러 스레드가 동시에 영역을 받을 수 있으므로, 큰 페이지 실패 표시는 원자적으로 읽고 씁니다.
+    // EN: Several threads may map regions at once, so the large page failure flag is read and written atomically.
+    static std::atomic<bool> large_pages_failed{ false };
+    const SIZE_T large_page = GetLargePageMinimum();
+    if (!large_pages_failed && large_page != 0 && size % large_page == 0) {
+        void* region = VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+        if (region != nullptr) return region;
+        large_pages_failed = true;
+    }
+    return VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+#else
+    (void)node;
+    return std::aligned_alloc(POOL_REGION_ALIGN, size);
+#endif
+}
+
+static void unmap_region(void* region, size_t size) {
+#if defined(__linux__)
+    munmap(region, size);
+#elif defined(_WIN32)
+    (void)size;
+    VirtualFree(region, 0, MEM_RELEASE);
+#else
+    (void)size;
+    std::free(region);
+#endif
+}
+
+// KO: 보관된 영역 중 요청을 받을 수 있는 가장 작은 영역을 고릅니다(best fit). 크기 차이가 요청만큼을 넘는 영역은
+//     메모리를 너무 많이 묶어 두므로 고르지 않습니다. 고른 영역은 자신의 실제 크기로 내주고 돌려받습니다.
+// EN: Picks the smallest kept region that can serve the request (best fit). A region more than twice the request would
+//     tie up too much memory and is not picked. The picked region is handed out and taken back at its actual size.
+void* pool_allocate(size_t bytes) {
+    const size_t size = (bytes + POOL_REGION_ALIGN - 1) & ~(POOL_REGION_ALIGN - 1);
+    const unsigned node = current_numa_node();
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        const auto list = free_regions.lower_bound({ node, size });
+        if (list != free_regions.end() && list->first.first == node && list->first.second / 2 <= size) {
+            const size_t region_size = list->first.second;
+            void* region = list->second.back();
+            list->second.pop_back();
+            if (list->second.empty()) free_regions.erase(list);
+            cached_bytes -= region_size;
+            live_regions[region] = { region_size, node };
+            return region;
+        }
+    }
+    void* region = map_region(size, node);
+    if (region == nullptr) throw std::bad_alloc();
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    live_regions[region] = { size, node };
+    return region;
+}
+
+// KO: 돌려받은 영역은 보관합니다. 보관 한도를 넘으면 가장 작은 보관 영역부터 운영체제에 돌려주어 자리를 만드는데,
+//     best fit에서 작은 영역이 받을 수 있는 요청이 가장 적기 때문입니다. 한도보다 큰 영역은 바로 돌려줍니다.
+// EN: A released region is kept. If that would exceed the cache limit, the smallest kept regions are returned to the OS first
+//     to make room, since under best fit a small region can serve the fewest requests. A region larger than the limit is returned at once.
+void pool_release(void* ptr, size_t bytes) {
+    (void)bytes;
+    if (ptr == nullptr) return;
+    PoolRegion region;
+    std::vector<std::pair<void*, size_t>> evicted;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        const auto live = live_regions.find(ptr);
+        if (live == live_regions.end()) return;
+        region = live->second;
+        live_regions.erase(live);
+        if (region.size <= POOL_MAX_CACHED_BYTES) {
+            while (cached_bytes + region.size > POOL_MAX_CACHED_BYTES) {
+                const auto list = free_regions.begin();
+                evicted.emplace_back(list->second.back(), list->first.second);
+                cached_bytes -= list->first.second;
+                list->second.pop_back();
+                if (list->second.empty()) free_regions.erase(list);
+            }
+            free_regions[{ region.node, region.size }].push_back(ptr);
+            cached_bytes += region.size;
+            ptr = nullptr;
+        }
+    }
+    for (const auto& [evicted_region, evicted_size] : evicted) unmap_region(evicted_region, evicted_size);
+    if (ptr != nullptr) unmap_region(ptr, region.size);
+}
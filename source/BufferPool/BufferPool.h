@@ -0,0 +1,57 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// KO: 블록 파이프라인의 큰 버퍼(중간 스트림 등)를 위한 풀 할당기입니다.
+//     POOL_MIN_BYTES 이상의 요청은 2 MiB 단위로 올림하여, 2 MiB로 정렬된 영역을 명시적 huge page(가능하면) 또는
+//     투명 huge page로 받습니다. 해제된 영역은 운영체제에 돌려주지 않고 NUMA 노드와 크기별 목록에 보관했다가,
+//     같은 노드의 스레드가 요청하면 받을 수 있는 가장 작은 영역(요청의 두 배 이하)을 다시 내줍니다. 따라서 블록마다 페이지 폴트와
+//     TLB 채우기를 다시 치르지 않으며, 새 영역은 요청한 스레드의 노드를 선호하도록 묶입니다. 보관하는 바이트가
+//     POOL_MAX_CACHED_BYTES를 넘게 되면 가장 작은 보관 영역부터 돌려줍니다.
+//     huge page나 NUMA를 지원하지 않는 호스트에서는 일반 페이지로 같은 풀을 사용합니다.
+// EN: A pooled allocator for the large buffers of the block pipeline (the intermediate streams, etc.).
+//     Requests of at least POOL_MIN_BYTES are rounded up to 2 MiB and served with 2 MiB aligned regions backed by explicit
+//     huge pages (where available) or transparent huge pages. Released regions are not returned to the OS but kept in
+//     per-NUMA-node, per-size lists, and when a thread on the same node asks, the smallest region that fits (at most twice
+//     the request) is handed out again, so the page faults and TLB fills are not paid again for every block. New regions
+//     are bound to prefer the node of the requesting thread. Once the cached bytes would exceed POOL_MAX_CACHED_BYTES the
+//     smallest kept regions are returned first.
+//     Hosts without huge pages or NUMA use the same pool with regular pages.
+constexpr size_t POOL_MIN_BYTES = 1 << 20;
+constexpr size_t POOL_REGION_ALIGN = 2 << 20;
+constexpr size_t POOL_MAX_CACHED_BYTES = size_t(1) << 30;
+
+void* pool_allocate(size_t bytes);
+void pool_release(void* ptr, size_t bytes);
+
+// KO: std::vector 등에서 사용하는 상태 없는 할당기입니다. 작은 요청은 일반 operator new로 보냅니다.
+// EN: A stateless allocator for std::vector and friends. Small requests go to the regular operator new.
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        const size_t bytes = n * sizeof(T);
+        if (bytes >= POOL_MIN_BYTES) return static_cast<T*>(pool_allocate(bytes));
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        const size_t bytes = n * sizeof(T);
+        if (bytes >= POOL_MIN_BYTES) pool_release(ptr, bytes);
+        else ::operator delete(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+};
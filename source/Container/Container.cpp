@@ -0,0 +1,261 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 압축 컨테이너의 블록 프레이밍과 블록 색인을 구현합니다.
+//     색인은 파일 끝에 있으므로, 덧붙이기는 색인 자리에 새 블록을 쓰고 색인을 다시 쓰는 것으로 끝납니다.
+// EN: This file implements the block framing and the block index of the compact container.
+//     The index sits at the end of the file, so appending comes down to writing the new blocks over the index and rewriting it.
+#include "Container.h"
+#include "../BlockCodec/BlockCodec.h"
+#include "../Varint/Varint.h"
+#include <cstring>
+#include <algorithm>
+
+void BlockStats::merge(const BlockStats& other, bool first) {
+    for (int symbol = 0; symbol < 4; ++symbol) symbol_counts[symbol] += other.symbol_counts[symbol];
+    min_byte = first ? other.min_byte : std::min(min_byte, other.min_byte);
+    max_byte = first ? other.max_byte : std::max(max_byte, other.max_byte);
+}
+
+BlockStats compute_block_stats(const uint8_t* data, size_t size) {
+    // KO: 네 개의 히스토그램에 번갈아 세어 같은 칸을 연달아 고치는 의존성을 끊습니다.
+    // EN: Counting into four histograms in turn breaks the dependency of updating the same bin back to back.
+    uint64_t hist[4][256] = {};
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        hist[0][data[i]]++;
+        hist[1][data[i + 1]]++;
+        hist[2][data[i + 2]]++;
+        hist[3][data[i + 3]]++;
+    }
+    for (; i < size; ++i) hist[0][data[i]]++;
+
+    BlockStats stats;
+    bool seen = false;
+    for (int byte = 0; byte < 256; ++byte) {
+        const uint64_t count = hist[0][byte] + hist[1][byte] + hist[2][byte] + hist[3][byte];
+        if (count == 0) continue;
+        for (int shift = 0; shift < 8; shift += 2) stats.symbol_counts[(byte >> shift) & 0x03] += count;
+        if (!seen) stats.min_byte = static_cast<uint8_t>(byte);
+        stats.max_byte = static_cast<uint8_t>(byte);
+        seen = true;
+    }
+    return stats;
+}
+
+void write_container_block(std::ostream& out, const std::vector<uint8_t>& block, uint64_t original_size, const BlockStats& stats, ContainerIndex& index) {
+    ContainerBlock entry;
+    entry.offset = index.blocks_end + varint_size(block.size());
+    entry.compressed_size = block.size();
+    entry.original_offset = index.original_size();
+    entry.original_size = original_size;
+    entry.stats = stats;
+    write_varint(out, block.size());
+    out.write(reinterpret_cast<const char*>(block.data()), block.size());
+    index.blocks.push_back(entry);
+    index.blocks_end = entry.offset + entry.compressed_size;
+}
+
+void add_container_member(ContainerIndex& index, const std::string& name) {
+    ContainerMember member;
+    member.name = name;
+    member.first_block = index.members.empty() ? 0 : index.members.back().first_block + index.members.back().block_count;
+    member.block_count = index.blocks.size() - member.first_block;
+    member.original_offset = index.members.empty() ? 0 : index.members.back().original_offset + index.members.back().original_size;
+    member.original_size = index.original_size() - member.original_offset;
+    index.members.push_back(member);
+}
+
+void write_container_index(std::ostream& out, const ContainerIndex& index) {
+    std::vector<uint8_t> bytes;
+    write_varint(bytes, 0);
+    bytes.push_back((index.has_stats ? INDEX_FLAG_BLOCK_STATS : 0) | (index.members.empty() ? 0 : INDEX_FLAG_MEMBERS));
+    write_varint(bytes, index.blocks.size());
+    for (const ContainerBlock& block : index.blocks) {
+        write_varint(bytes, block.compressed_size);
+        write_varint(bytes, block.original_size);
+        if (!index.has_stats) continue;
+        for (int symbol = 0; symbol < 3; ++symbol) write_varint(bytes, block.stats.symbol_counts[symbol]);
+        bytes.push_back(block.stats.min_byte);
+        bytes.push_back(block.stats.max_byte);
+    }
+    if (!index.members.empty()) {
+        write_varint(bytes, index.members.size());
+        for (const ContainerMember& member : index.members) {
+            write_varint(bytes, member.name.size());
+            bytes.insert(bytes.end(), member.name.begin(), member.name.end());
+            write_varint(bytes, member.block_count);
+        }
+    }
+    uint8_t offset_bytes[8];
+    memcpy(offset_bytes, &index.blocks_end, sizeof(offset_bytes));
+    bytes.insert(bytes.end(), offset_bytes, offset_bytes + sizeof(offset_bytes));
+    bytes.insert(bytes.end(), INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC));
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+// KO: 스트림의 끝 위치를 구하고, 읽기 위치를 그대로 둡니다.
+// EN: Finds the end position of the stream, leaving the read position where it was.
+static uint64_t stream_size(std::istream& in) {
+    const std::streampos position = in.tellg();
+    in.seekg(0, std::ios::end);
+    const uint64_t size = static_cast<uint64_t>(in.tellg());
+    in.seekg(position);
+    return size;
+}
+
+bool find_container_index(std::istream& in, uint64_t& index_offset) {
+    const uint64_t size = stream_size(in);
+    if (size < sizeof(CONTAINER_MAGIC) + INDEX_TRAILER_SIZE) return false;
+    const std::streampos position = in.tellg();
+    uint8_t trailer[INDEX_TRAILER_SIZE];
+    in.seekg(static_cast<std::streamoff>(size - INDEX_TRAILER_SIZE));
+    const bool found = in.read(reinterpret_cast<char*>(trailer), sizeof(trailer)) && memcmp(trailer + 8, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0;
+    in.clear();
+    in.seekg(position);
+    uint64_t offset;
+    memcpy(&offset, trailer, 8);
+    if (!found || offset < sizeof(CONTAINER_MAGIC) || offset > size - INDEX_TRAILER_SIZE) return false;
+    index_offset = offset;
+    return true;
+}
+
+// KO: 멤버 표를 읽고, 블록 수의 누적 합으로 멤버의 첫 블록과 원본 구간을 복원합니다.
+// EN: Reads the member table and restores the first block and the original range of every member from prefix sums of the block counts.
+static bool read_member_table(const uint8_t*& read_ptr, const uint8_t* data_end, ContainerIndex& index) {
+    uint64_t n_members;
+    if (!read_varint(read_ptr, data_end, n_members) || n_members > static_cast<uint64_t>(data_end - read_ptr) / 2) return false;
+    index.members.resize(n_members);
+    size_t next_block = 0;
+    for (ContainerMember& member : index.members) {
+        uint64_t name_length, block_count;
+        if (!read_varint(read_ptr, data_end, name_length) || name_length > static_cast<uint64_t>(data_end - read_ptr)) return false;
+        member.name.assign(reinterpret_cast<const char*>(read_ptr), static_cast<size_t>(name_length));
+        read_ptr += name_length;
+        if (!read_varint(read_ptr, data_end, block_count) || block_count > index.blocks.size() - next_block) return false;
+        member.first_block = next_block;
+        member.block_count = static_cast<size_t>(block_count);
+        member.original_offset = (next_block < index.blocks.size()) ? index.blocks[next_block].original_offset : index.original_size();
+        next_block += member.block_count;
+        const uint64_t member_end = (next_block < index.blocks.size()) ? index.blocks[next_block].original_offset : index.original_size();
+        member.original_size = member_end - member.original_offset;
+    }
+    return true;
+}
+
+// KO: 꼬리가 가리키는 색인을 읽어, 크기의 누적 합으로 블록 오프셋을 복원합니다.
+// EN: Reads the index the trailer points to and restores the block offsets from prefix sums of the sizes.
+static bool read_index_section(std::istream& in, uint64_t index_offset, uint64_t file_size, ContainerIndex& index) {
+    std::vector<uint8_t> bytes(file_size - INDEX_TRAILER_SIZE - index_offset);
+    in.seekg(static_cast<std::streamoff>(index_offset));
+    if (!in.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) return false;
+    const uint8_t* read_ptr = bytes.data();
+    const uint8_t* data_end = bytes.data() + bytes.size();
+    uint64_t terminator, n_blocks;
+    if (!read_varint(read_ptr, data_end, terminator) || terminator != 0 || read_ptr >= data_end ||
+        (*read_ptr & ~(INDEX_FLAG_BLOCK_STATS | INDEX_FLAG_MEMBERS)) != 0) {
+        return false;
+    }
+    const uint8_t index_flags = *read_ptr++;
+    index.has_stats = (index_flags & INDEX_FLAG_BLOCK_STATS) != 0;
+    if (!read_varint(read_ptr, data_end, n_blocks) || n_blocks > static_cast<uint64_t>(data_end - read_ptr) / 2) return false;
+    index.blocks.resize(n_blocks);
+    uint64_t position = sizeof(CONTAINER_MAGIC), original_offset = 0;
+    for (ContainerBlock& block : index.blocks) {
+        if (!read_varint(read_ptr, data_end, block.compressed_size) || !read_varint(read_ptr, data_end, block.original_size) ||
+            block.compressed_size == 0 || block.compressed_size > index_offset) {
+            return false;
+        }
+        if (index.has_stats) {
+            // KO: 심볼 11의 수는 원본 크기의 4배에서 나머지 수를 빼서 얻으며, 합이 넘치면 손상된 색인입니다.
+            // EN: The count of symbol 11 is 4 times the original size minus the other counts; a sum that exceeds it means a corrupted index.
+            if (block.original_size > UINT64_MAX / 4) return false;
+            uint64_t remaining = block.original_size * 4;
+            for (int symbol = 0; symbol < 3; ++symbol) {
+                uint64_t& count = block.stats.symbol_counts[symbol];
+                if (!read_varint(read_ptr, data_end, count) || count > remaining) return false;
+                remaining -= count;
+            }
+            block.stats.symbol_counts[3] = remaining;
+            if (data_end - read_ptr < 2) return false;
+            block.stats.min_byte = *read_ptr++;
+            block.stats.max_byte = *read_ptr++;
+        }
+        block.offset = position + varint_size(block.compressed_size);
+        block.original_offset = original_offset;
+        position = block.offset + block.compressed_size;
+        original_offset += block.original_size;
+        if (position > index_offset) return false;
+    }
+    index.blocks_end = position;
+    if ((index_flags & INDEX_FLAG_MEMBERS) && !read_member_table(read_ptr, data_end, index)) return false;
+    return read_ptr == data_end && position == index_offset;
+}
+
+bool read_container_index(std::istream& in, ContainerIndex& index) {
+    index = ContainerIndex();
+    const uint64_t file_size = stream_size(in);
+    uint8_t magic[sizeof(CONTAINER_MAGIC)] = { 0 };
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(magic), sizeof(magic)) || memcmp(magic, CONTAINER_MAGIC, sizeof(magic)) != 0) return false;
+
+    uint64_t index_offset;
+    if (find_container_index(in, index_offset)) return read_index_section(in, index_offset, file_size, index);
+
+    // KO: 색인이 없는 컨테이너: 프레임을 차례로 읽으며 블록 헤더에서 원본 크기를 얻습니다. 빈 프레임은 색인에 담을 수 없습니다.
+    //     통계는 복호화해야만 얻을 수 있으므로 이 색인에는 통계가 없습니다.
+    // EN: A container without an index: the frames are read in turn and the original sizes taken from the block headers. Empty frames cannot be indexed.
+    //     The statistics are only available by decompressing, so this index has none.
+    index.has_stats = false;
+    in.seekg(sizeof(CONTAINER_MAGIC));
+    uint64_t compressed_size;
+    std::vector<uint8_t> data;
+    while (index.blocks_end < file_size) {
+        if (!read_varint(in, compressed_size) || compressed_size == 0 ||
+            compressed_size > file_size - index.blocks_end - varint_size(compressed_size)) {
+            return false;
+        }
+        data.resize(compressed_size);
+        uint64_t original_size;
+        if (!in.read(reinterpret_cast<char*>(data.data()), compressed_size) || !read_block_original_size(data, original_size)) return false;
+        ContainerBlock block;
+        block.offset = index.blocks_end + varint_size(compressed_size);
+        block.compressed_size = compressed_size;
+        block.original_offset = index.original_size();
+        block.original_size = original_size;
+        index.blocks.push_back(block);
+        index.blocks_end = block.offset + compressed_size;
+    }
+    return true;
+}
+
+bool read_container_block(std::istream& in, const ContainerBlock& block, std::vector<uint8_t>& data) {
+    data.resize(block.compressed_size);
+    in.seekg(static_cast<std::streamoff>(block.offset));
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(data.data()), block.compressed_size));
+}
+
+BlockStats aggregate_stats(const ContainerIndex& index, size_t first, size_t last) {
+    BlockStats total;
+    last = std::min(last, index.blocks.size());
+    for (size_t i = first; i < last; ++i) total.merge(index.blocks[i].stats, i == first);
+    return total;
+}
+
+std::vector<size_t> find_blocks(const ContainerIndex& index, const std::function<bool(const BlockStats&)>& predicate) {
+    std::vector<size_t> found;
+    if (!index.has_stats) return found;
+    for (size_t i = 0; i < index.blocks.size(); ++i) {
+        if (predicate(index.blocks[i].stats)) found.push_back(i);
+    }
+    return found;
+}
+
+std::vector<size_t> blocks_with_symbol(const ContainerIndex& index, unsigned symbol) {
+    return find_blocks(index, [symbol](const BlockStats& stats) { return symbol < 4 && stats.symbol_counts[symbol] > 0; });
+}
+
+std::vector<size_t> blocks_with_byte_range(const ContainerIndex& index, uint8_t low, uint8_t high) {
+    return find_blocks(index, [low, high](const BlockStats& stats) {
+        return stats.symbol_counts[0] + stats.symbol_counts[1] + stats.symbol_counts[2] + stats.symbol_counts[3] > 0 &&
+               stats.max_byte >= low && stats.min_byte <= high;
+    });
+}
@@ -0,0 +1,141 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <functional>
+#include <string>
+
+// KO: 압축 컨테이너를 나타내는 8바이트 파일 매직입니다. 이후 블록은 [varint 크기][블록]으로 프레이밍됩니다.
+//     기존 컨테이너는 [uint64 크기][블록]으로 시작하는데, 이 매직을 uint64로 읽으면 수백 PB가 되어 실제 블록 크기와 겹치지 않습니다.
+// EN: The 8-byte file magic that marks the compact container. Blocks after it are framed as [varint size][block].
+//     Legacy containers start with [uint64 size][block], and this magic read as a uint64 is hundreds of PB,
+//     so it never collides with a real block size.
+constexpr uint8_t CONTAINER_MAGIC[8] = { 0x89, 'T', 'S', 'P', '\r', '\n', 0x1A, '\n' };
+
+// KO: 블록 색인은 마지막 블록 뒤에 오며, 파일의 끝은 색인을 가리키는 고정 크기 꼬리입니다.
+//     [varint 0][uint8 색인 플래그][varint 블록 수][블록마다 varint 압축 크기, varint 원본 크기][uint64 색인 오프셋][uint8[8] INDEX_MAGIC]
+//     색인 오프셋은 맨 앞의 varint 0을 가리킵니다. 블록의 파일 오프셋과 원본 오프셋은 크기의 누적 합으로 유도됩니다.
+//     색인이 없는 컨테이너는 블록 프레임을 처음부터 훑어 같은 색인을 만들 수 있습니다.
+// EN: The block index follows the last block, and the file ends with a fixed-size trailer that points to the index.
+//     [varint 0][uint8 index flags][varint block count][per block: varint compressed size, varint original size][uint64 index offset][uint8[8] INDEX_MAGIC]
+//     The index offset points to the leading varint 0. The file and original offsets of the blocks follow from prefix sums of the sizes.
+//     For a container without an index the same index can be built by scanning the block frames from the start.
+constexpr uint8_t INDEX_MAGIC[8] = { 0x89, 'T', 'S', 'I', '\r', '\n', 0x1A, '\n' };
+constexpr uint64_t INDEX_TRAILER_SIZE = 8 + sizeof(INDEX_MAGIC);
+
+// KO: 색인 플래그의 0번 비트가 설정되면 블록마다 크기 뒤에 블록 통계가 옵니다.
+//     [varint 심볼 00 수][varint 01 수][varint 10 수][uint8 최소 바이트][uint8 최대 바이트]
+//     심볼은 원본 바이트(사전 변환 전)를 MSB부터 2비트씩 나눈 것입니다. 네 심볼 수의 합은 항상 원본 크기의 4배이므로
+//     심볼 11의 수는 기록하지 않고 나머지로 유도합니다. 통계가 없는 블록이 하나라도 있으면 이 비트를 끕니다.
+//     통계는 블록마다 약 8바이트가 들어 작은 블록에서는 색인을 크게 늘리므로, 압축할 때 요청한 경우에만 기록합니다. (-i)
+// EN: Bit 0 of the index flags means every block carries its statistics after its sizes.
+//     [varint count of symbol 00][varint count of 01][varint count of 10][uint8 min byte][uint8 max byte]
+//     The symbols are the original bytes (before any pre-transform) split into 2-bit pieces from the MSB. The four counts
+//     always add up to 4 times the original size, so the count of symbol 11 is not stored but derived from the rest.
+//     The bit is cleared if any block lacks statistics.
+//     The statistics take about 8 bytes per block, which grows the index a lot for small blocks, so they are only written
+//     when asked for at compression time. (-i)
+constexpr uint8_t INDEX_FLAG_BLOCK_STATS = 1 << 0;
+
+// KO: 색인 플래그의 1번 비트가 설정되면 블록 목록 뒤에 멤버 표가 오는 다중 멤버 아카이브입니다. (일괄 압축)
+//     [varint 멤버 수][멤버마다 varint 이름 길이, 이름 (UTF-8, '/'로 구분된 상대 경로), varint 블록 수]
+//     멤버는 블록 순서대로 이어지는 블록들이며, 각 멤버의 첫 블록은 블록 수의 누적 합으로 유도됩니다.
+//     멤버에 속하지 않는 블록(덧붙이기 등)이 뒤에 남을 수 있으며, -d는 모든 멤버를 이어 붙인 데이터를 복원합니다.
+// EN: Bit 1 of the index flags marks a multi-member archive, with a member table after the block list. (Batch compression)
+//     [varint member count][per member: varint name length, name (UTF-8, relative path separated by '/'), varint block count]
+//     A member is a run of consecutive blocks, and the first block of each member follows from prefix sums of the block counts.
+//     Blocks outside any member (appended ones, etc.) may trail behind, and -d restores all members concatenated.
+constexpr uint8_t INDEX_FLAG_MEMBERS = 1 << 1;
+
+// KO: 블록 하나의 원본 데이터 통계입니다. 복호화하지 않고 질의에 답하거나 블록을 건너뛰는 데 사용합니다.
+// EN: The statistics of the original data of one block. They answer queries and prune blocks without decompressing them.
+struct BlockStats {
+    uint64_t symbol_counts[4] = { 0, 0, 0, 0 }; // KO: 2비트 심볼 00, 01, 10, 11의 수 / EN: Counts of the 2-bit symbols 00, 01, 10, 11
+    uint8_t min_byte = 0; // KO: 가장 작은 바이트 값 (빈 블록이면 0) / EN: The smallest byte value (0 for an empty block)
+    uint8_t max_byte = 0; // KO: 가장 큰 바이트 값 (빈 블록이면 0) / EN: The largest byte value (0 for an empty block)
+
+    // KO: 다른 블록의 통계를 더합니다.
+    // EN: Adds the statistics of another block.
+    void merge(const BlockStats& other, bool first);
+};
+
+// KO: 바이트 히스토그램 한 번으로 블록의 통계를 계산합니다.
+// EN: Computes the statistics of a block with a single byte histogram.
+BlockStats compute_block_stats(const uint8_t* data, size_t size);
+
+// KO: 색인에 기록된 블록 하나입니다.
+// EN: One block recorded in the index.
+struct ContainerBlock {
+    uint64_t offset = 0;          // KO: 블록 바이트의 파일 오프셋 (프레임 크기 뒤) / EN: File offset of the block bytes (after the frame size)
+    uint64_t compressed_size = 0; // KO: 압축 블록의 크기 / EN: Size of the compressed block
+    uint64_t original_offset = 0; // KO: 복호화된 출력에서 블록의 오프셋 / EN: Offset of the block in the decompressed output
+    uint64_t original_size = 0;   // KO: 원본 블록의 크기 / EN: Size of the original block
+    BlockStats stats;             // KO: 원본 블록의 통계 (ContainerIndex::has_stats일 때만 유효) / EN: Statistics of the original block (valid only if ContainerIndex::has_stats)
+};
+
+// KO: 다중 멤버 아카이브의 멤버(압축한 파일 하나)입니다.
+// EN: A member (one compressed file) of a multi-member archive.
+struct ContainerMember {
+    std::string name;            // KO: 멤버 이름 (상대 경로) / EN: Member name (relative path)
+    size_t first_block = 0;      // KO: 첫 블록 번호 / EN: Index of the first block
+    size_t block_count = 0;      // KO: 블록 수 (빈 파일이면 0) / EN: Number of blocks (0 for an empty file)
+    uint64_t original_offset = 0; // KO: 복호화된 출력에서 멤버의 오프셋 / EN: Offset of the member in the decompressed output
+    uint64_t original_size = 0;   // KO: 멤버의 원본 크기 / EN: Original size of the member
+};
+
+// KO: 컨테이너의 블록 색인입니다. blocks_end는 마지막 블록 프레임이 끝나는 파일 오프셋이며, 새 블록과 색인은 여기부터 기록됩니다.
+// EN: The block index of a container. blocks_end is the file offset where the last block frame ends; new blocks and the index are written from there.
+struct ContainerIndex {
+    std::vector<ContainerBlock> blocks;
+    uint64_t blocks_end = sizeof(CONTAINER_MAGIC);
+    bool has_stats = false; // KO: 모든 블록에 통계가 있음 (쓸 때는 통계를 기록할지 정함) / EN: Every block has statistics (when writing, whether to store them)
+    std::vector<ContainerMember> members; // KO: 멤버 표 (다중 멤버 아카이브가 아니면 비어 있음) / EN: Member table (empty unless a multi-member archive)
+
+    uint64_t original_size() const { return blocks.empty() ? 0 : blocks.back().original_offset + blocks.back().original_size; }
+};
+
+// KO: 블록 하나를 out의 현재 위치(index.blocks_end여야 함)에 [varint 크기][블록]으로 기록하고 색인에 추가합니다.
+// EN: Writes one block as [varint size][block] at the current position of out (which must be index.blocks_end) and adds it to the index.
+void write_container_block(std::ostream& out, const std::vector<uint8_t>& block, uint64_t original_size, const BlockStats& stats, ContainerIndex& index);
+
+// KO: 마지막 멤버 뒤에 새로 기록된 블록들(index.blocks의 끝까지)을 멤버 하나로 추가합니다.
+// EN: Adds the blocks written after the last member (up to the end of index.blocks) as one member.
+void add_container_member(ContainerIndex& index, const std::string& name);
+
+// KO: out의 현재 위치(index.blocks_end여야 함)에 색인과 꼬리를 기록합니다.
+// EN: Writes the index and the trailer at the current position of out (which must be index.blocks_end).
+void write_container_index(std::ostream& out, const ContainerIndex& index);
+
+// KO: 파일 끝의 꼬리를 확인하여 색인 오프셋을 얻습니다. 색인이 없는 컨테이너이면 false를 반환합니다. 읽기 위치는 그대로 둡니다.
+// EN: Checks the trailer at the end of the file for the index offset. Returns false for a container without an index. The read position is left as it was.
+bool find_container_index(std::istream& in, uint64_t& index_offset);
+
+// KO: 컨테이너의 블록 색인을 읽습니다. 색인이 없으면 블록 프레임을 훑고 블록 헤더에서 원본 크기를 읽어 색인을 만듭니다.
+//     매직이 없는 기존 컨테이너이거나 색인과 프레임이 맞지 않으면 false를 반환합니다.
+// EN: Reads the block index of a container. Without an index the block frames are scanned and the original sizes read
+//     from the block headers to build one. Returns false for a legacy container without the magic, or if the index and
+//     the frames disagree.
+bool read_container_index(std::istream& in, ContainerIndex& index);
+
+// KO: 색인의 블록 하나를 읽습니다.
+// EN: Reads one block of the index.
+bool read_container_block(std::istream& in, const ContainerBlock& block, std::vector<uint8_t>& data);
+
+// KO: 블록 통계에 대한 질의입니다. 모두 색인만 읽으며, 통계가 없는 색인(has_stats가 false)에서는 아무 블록도 고르지 않습니다.
+//     - aggregate_stats: [first, last) 블록의 통계를 합칩니다.
+//     - find_blocks: 조건을 만족하는 블록의 번호를 반환합니다.
+//     - blocks_with_symbol: 2비트 심볼(0~3)을 하나라도 포함하는 블록만 남깁니다.
+//     - blocks_with_byte_range: [low, high] 안의 바이트를 포함할 수 있는 블록만 남깁니다. (최소/최대 바이트로 가지치기)
+// EN: Queries over the block statistics. They all read the index alone, and select no block from an index without statistics (has_stats false).
+//     - aggregate_stats: Merges the statistics of the blocks [first, last).
+//     - find_blocks: Returns the indices of the blocks that satisfy a predicate.
+//     - blocks_with_symbol: Keeps only the blocks that contain at least one of a 2-bit symbol (0-3).
+//     - blocks_with_byte_range: Keeps only the blocks that may contain a byte in [low, high]. (Pruned by the min/max byte)
+BlockStats aggregate_stats(const ContainerIndex& index, size_t first, size_t last);
+std::vector<size_t> find_blocks(const ContainerIndex& index, const std::function<bool(const BlockStats&)>& predicate);
+std::vector<size_t> blocks_with_symbol(const ContainerIndex& index, unsigned symbol);
+std::vector<size_t> blocks_with_byte_range(const ContainerIndex& index, uint8_t low, uint8_t high);
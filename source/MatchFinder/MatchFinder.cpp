@@ -0,0 +1,147 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 분리 전에 블록의 긴 반복을 일치로 바꾸는 가벼운 LZ 사전 처리를 구현합니다.
+//     일치로 덮인 구간은 심볼 단위 부호화를 건너뛰므로, 반복되는 레코드 헤더나 같은 프레임이 많은 데이터에서 압축률과 속도가 함께 좋아집니다.
+// EN: This file implements the lightweight LZ prepass that turns the long repeats of a block into matches before separation.
+//     Matched regions skip the per-symbol coding, so data with repeated record headers or identical frames gains both ratio and speed.
+#include "MatchFinder.h"
+#include "../Varint/Varint.h"
+#include <cstring>
+#include <bit>
+
+// KO: 해시 테이블 크기(2^HASH_BITS)와, 위치마다 살펴보는 최대 후보 수입니다.
+//     해시 체인에는 ANCHOR_STEP의 배수인 위치(기준점)만 넣고, 탐색은 모든 위치에서 합니다. 길이가 MIN_MATCH_LENGTH + ANCHOR_STEP - 1
+//     이상인 반복은 항상 어떤 기준점에서 시작하는 원본을 가지므로 반드시 찾아지며, 찾은 뒤에는 거꾸로 늘려 시작점을 되찾습니다.
+//     체인이 짧아지므로 반복이 없는 데이터에서도 위치마다 해시 테이블 조회 한 번 정도로 지나갑니다.
+// EN: The size of the hash table (2^HASH_BITS) and the most candidates examined per position.
+//     Only positions that are multiples of ANCHOR_STEP (anchors) go into the hash chain, while every position is searched.
+//     A repeat of at least MIN_MATCH_LENGTH + ANCHOR_STEP - 1 bytes always has a source starting at some anchor, so it is
+//     sure to be found, and the backward extension recovers its start. The chains stay short, so even data without
+//     repeats costs about one hash table lookup per position.
+static constexpr unsigned HASH_BITS = 20;
+static constexpr unsigned MAX_CHAIN_DEPTH = 8;
+static constexpr size_t ANCHOR_STEP = 8;
+static constexpr uint32_t NO_POSITION = UINT32_MAX;
+
+static inline uint64_t load64(const uint8_t* ptr) {
+    uint64_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hash8(uint64_t value) {
+    return static_cast<uint32_t>((value * 0x9E3779B97F4A7C15ull) >> (64 - HASH_BITS));
+}
+
+// KO: a와 b에서 시작하는 공통 접두사의 길이를 b_end까지 셉니다. 리틀 엔디언에서는 8바이트씩 비교하여 첫 차이를 countr_zero로 찾습니다.
+// EN: Counts the length of the common prefix starting at a and b, up to b_end. On little-endian targets 8 bytes are compared
+//     at a time and the first difference is located with countr_zero.
+static size_t common_length(const uint8_t* a, const uint8_t* b, const uint8_t* b_end) {
+    const uint8_t* start = b;
+    if constexpr (std::endian::native == std::endian::little) {
+        while (b + 8 <= b_end) {
+            const uint64_t diff = load64(a) ^ load64(b);
+            if (diff != 0) return static_cast<size_t>(b - start) + static_cast<size_t>(std::countr_zero(diff)) / 8;
+            a += 8;
+            b += 8;
+        }
+    }
+    while (b < b_end && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return static_cast<size_t>(b - start);
+}
+
+MatchParse find_matches(const std::vector<uint8_t>& data) {
+    MatchParse parse;
+    const size_t size = data.size();
+    // KO: 위치를 uint32_t로 저장하므로 4GiB 이상의 블록은 사전 처리하지 않습니다.
+    // EN: Positions are stored as uint32_t, so blocks of 4GiB or more are not preprocessed.
+    if (size < MIN_MATCH_LENGTH || size >= NO_POSITION) {
+        parse.literals = data;
+        return parse;
+    }
+
+    const uint8_t* src = data.data();
+    std::vector<uint32_t> head(size_t(1) << HASH_BITS, NO_POSITION);
+    std::vector<uint32_t> chain(size / ANCHOR_STEP + 1); // KO: 기준점 p의 이전 후보는 chain[p / ANCHOR_STEP] / EN: The previous candidate of anchor p is chain[p / ANCHOR_STEP]
+    parse.literals.reserve(size);
+    const size_t last_start = size - MIN_MATCH_LENGTH; // KO: 일치가 시작할 수 있는 마지막 위치 / EN: The last position a match may start at
+    size_t literal_start = 0;
+    size_t pos = 0;
+    while (pos <= last_start) {
+        const uint64_t key = load64(src + pos);
+        const uint32_t hash = hash8(key);
+        size_t best_length = 0, best_distance = 0;
+        uint32_t candidate = head[hash];
+        for (unsigned depth = 0; depth < MAX_CHAIN_DEPTH && candidate != NO_POSITION; ++depth, candidate = chain[candidate / ANCHOR_STEP]) {
+            if (load64(src + candidate) != key) continue;
+            const size_t length = 8 + common_length(src + candidate + 8, src + pos + 8, src + size);
+            if (length > best_length) {
+                best_length = length;
+                best_distance = pos - candidate;
+            }
+        }
+        if (pos % ANCHOR_STEP == 0) {
+            chain[pos / ANCHOR_STEP] = head[hash];
+            head[hash] = static_cast<uint32_t>(pos);
+        }
+        if (best_length < MIN_MATCH_LENGTH) {
+            ++pos;
+            continue;
+        }
+
+        // KO: 일치를 아직 기록하지 않은 리터럴 쪽으로 거꾸로 늘린 뒤 기록합니다.
+        // EN: Extends the match backwards into the pending literals, then writes it.
+        size_t start = pos;
+        while (start > literal_start && start - 1 >= best_distance && src[start - 1] == src[start - 1 - best_distance]) {
+            --start;
+            ++best_length;
+        }
+        parse.literals.insert(parse.literals.end(), src + literal_start, src + start);
+        write_varint(parse.sequences, start - literal_start);
+        write_varint(parse.sequences, best_length - MIN_MATCH_LENGTH);
+        write_varint(parse.sequences, best_distance - 1);
+
+        // KO: 일치 안의 기준점도 이후의 일치를 위해 해시 체인에 넣습니다.
+        // EN: The anchors inside the match are inserted into the hash chain too, for later matches.
+        const size_t end = start + best_length;
+        for (size_t p = (pos / ANCHOR_STEP + 1) * ANCHOR_STEP; p < end && p <= last_start; p += ANCHOR_STEP) {
+            const uint32_t h = hash8(load64(src + p));
+            chain[p / ANCHOR_STEP] = head[h];
+            head[h] = static_cast<uint32_t>(p);
+        }
+        pos = literal_start = end;
+    }
+    parse.literals.insert(parse.literals.end(), src + literal_start, src + size);
+    return parse;
+}
+
+bool expand_matches(const std::vector<uint8_t>& literals, const std::vector<uint8_t>& sequences, uint64_t original_size, std::vector<uint8_t>& output) {
+    output.clear();
+    output.reserve(static_cast<size_t>(original_size));
+    const uint8_t* ptr = sequences.data();
+    const uint8_t* end = ptr + sequences.size();
+    size_t next_literal = 0;
+    while (ptr < end) {
+        uint64_t run, length, distance;
+        if (!read_varint(ptr, end, run) || !read_varint(ptr, end, length) || !read_varint(ptr, end, distance)) return false;
+        if (run > literals.size() - next_literal || run > original_size - output.size()) return false;
+        output.insert(output.end(), literals.begin() + next_literal, literals.begin() + next_literal + run);
+        next_literal += run;
+
+        if (original_size - output.size() < MIN_MATCH_LENGTH || length > original_size - output.size() - MIN_MATCH_LENGTH ||
+            distance >= output.size()) return false;
+        length += MIN_MATCH_LENGTH;
+        distance += 1;
+        // KO: 거리가 길이보다 짧으면 원본과 겹치므로 바이트 단위로 복사합니다.
+        // EN: A distance shorter than the length overlaps the copy source, so it is copied byte by byte.
+        const size_t from = output.size() - static_cast<size_t>(distance);
+        output.resize(output.size() + static_cast<size_t>(length));
+        uint8_t* dst = output.data() + output.size() - static_cast<size_t>(length);
+        if (distance >= length) memcpy(dst, output.data() + from, static_cast<size_t>(length));
+        else for (size_t i = 0; i < length; ++i) dst[i] = output[from + i];
+    }
+    output.insert(output.end(), literals.begin() + next_literal, literals.end());
+    return output.size() == original_size;
+}
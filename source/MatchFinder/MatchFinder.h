@@ -0,0 +1,34 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+
+// KO: 일치 사전 처리가 찾는 가장 짧은 일치의 길이입니다. TriSplit은 리터럴 바이트를 엔트로피에 가깝게 부호화하므로,
+//     일치 하나의 비용(varint 세 개)을 확실히 넘는 긴 반복만 일치로 바꿉니다.
+// EN: The length of the shortest match the match prepass looks for. TriSplit codes literal bytes close to their entropy,
+//     so only long repeats that clearly outweigh the cost of one match (three varints) are turned into matches.
+constexpr uint32_t MIN_MATCH_LENGTH = 32;
+
+// KO: 일치 사전 처리의 결과입니다. 일치로 덮이지 않은 바이트는 순서대로 literals에 모이고, 일치는 sequences에
+//     [varint 앞선 리터럴 수][varint 길이 - MIN_MATCH_LENGTH][varint 거리 - 1]로 차례로 기록됩니다.
+//     마지막 일치 뒤의 리터럴은 기록하지 않으며, sequences가 비어 있으면 literals는 원본과 같습니다.
+// EN: The result of the match prepass. Bytes not covered by a match gather in order in `literals`, and every match is written
+//     to `sequences` as [varint preceding literal count][varint length - MIN_MATCH_LENGTH][varint distance - 1].
+//     The literals after the last match are implied, and if `sequences` is empty `literals` equals the original.
+struct MatchParse {
+    std::vector<uint8_t> literals;
+    std::vector<uint8_t> sequences;
+};
+
+// KO: 해시 체인으로 블록 안의 긴 반복을 찾아 리터럴과 일치로 나눕니다. (탐욕적 파싱, 체인 깊이 제한)
+//     8바이트 해시가 같은 후보만 비교하고 일치를 8바이트씩 늘리므로, 반복이 많은 데이터일수록 빠르게 지나갑니다.
+// EN: Finds the long repeats within a block with a hash chain and splits it into literals and matches. (Greedy parsing with a bounded chain depth)
+//     Only candidates with the same 8-byte hash are compared and matches are extended 8 bytes at a time, so repetitive data goes by quickly.
+MatchParse find_matches(const std::vector<uint8_t>& data);
+
+// KO: find_matches의 결과로부터 원본 블록을 복원합니다. 일치가 출력 밖을 가리키거나 크기가 original_size와 맞지 않으면 false를 반환합니다.
+// EN: Restores the original block from the result of find_matches. Returns false if a match points outside the output
+//     or the size does not match original_size.
+bool expand_matches(const std::vector<uint8_t>& literals, const std::vector<uint8_t>& sequences, uint64_t original_size, std::vector<uint8_t>& output);
@@ -0,0 +1,353 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <algorithm>
+#include <utility>
+#include "../BufferPool/BufferPool.h"
+
+// KO: uint64_t 워드에 비트를 촘촘하게 담는 비트 시퀀스입니다. std::vector<bool>의 프록시 참조 대신
+//     워드 단위로 읽고 쓰며, 1의 개수도 popcount로 워드 단위로 셉니다.
+//     비트 i는 words[i / 64]의 최상위 비트부터 순서대로 저장됩니다 (MSB-first).
+//     bit_count를 넘는 마지막 워드의 나머지 비트는 항상 0입니다.
+// EN: A bit sequence packed densely into uint64_t words. Instead of std::vector<bool>'s proxy references,
+//     it is read and written a word at a time, and its ones are counted a word at a time with popcount.
+//     Bit i is stored in words[i / 64], starting from the most significant bit (MSB-first).
+//     The bits of the last word beyond bit_count are always 0.
+struct PackedBits {
+    // KO: 블록 크기의 스트림은 버퍼 풀에서 받아, 블록마다 페이지를 새로 건드리지 않습니다.
+    // EN: Block-sized streams come from the buffer pool, so their pages are not touched afresh for every block.
+    std::vector<uint64_t, PoolAllocator<uint64_t>> words;
+    uint64_t bit_count = 0;
+
+    // KO: 주어진 비트 수를 담는 데 필요한 워드 수를 반환합니다.
+    // EN: Returns the number of words needed to hold the given number of bits.
+    static size_t words_for(uint64_t bits) { return static_cast<size_t>((bits + 63) / 64); }
+
+    uint64_t size() const { return bit_count; }
+    bool empty() const { return bit_count == 0; }
+
+    // KO: i번째 비트를 반환합니다. (임의 접근용. 순차 처리에는 PackedBitReader를 사용하십시오.)
+    // EN: Returns the i-th bit. (For random access. Use PackedBitReader for sequential processing.)
+    uint32_t get(uint64_t i) const {
+        return static_cast<uint32_t>(words[static_cast<size_t>(i >> 6)] >> (63 - (i & 63))) & 1;
+    }
+
+    // KO: 모든 비트가 같은 값(bit)인 길이 count의 시퀀스를 만듭니다.
+    // EN: Builds a sequence of length `count` whose bits all have the same value (bit).
+    static PackedBits filled(uint64_t count, uint32_t bit) {
+        PackedBits result;
+        result.bit_count = count;
+        result.words.assign(words_for(count), bit ? ~0ull : 0ull);
+        if (bit && (count & 63) != 0) result.words.back() = ~0ull << (64 - (count & 63));
+        return result;
+    }
+
+    // KO: 워드 단위 popcount로 1의 개수를 셉니다.
+    // EN: Counts the ones with a word-at-a-time popcount.
+    uint64_t count_ones() const {
+        uint64_t ones = 0;
+        for (uint64_t word : words) ones += static_cast<uint64_t>(std::popcount(word));
+        return ones;
+    }
+};
+
+// KO: PackedBits에 비트를 순서대로 덧붙이는 기록기입니다. 64비트 누산기에 모았다가 워드 단위로 내보냅니다.
+//     최종 비트 수를 알고 있으면 reserve_bits로 미리 할당해 재할당을 피할 수 있습니다.
+// EN: A writer that appends bits to a PackedBits in order. Bits are gathered in a 64-bit accumulator and emitted a word at a time.
+//     When the final bit count is known, reserve_bits preallocates the words so that no reallocation happens.
+class PackedBitWriter {
+public:
+    explicit PackedBitWriter(PackedBits& output, uint64_t reserve_bits = 0) : out(output) {
+        out.words.clear();
+        out.words.resize(PackedBits::words_for(reserve_bits));
+        out.bit_count = 0;
+        next = out.words.data();
+        limit = next + out.words.size();
+    }
+
+    // KO: 비트 하나를 덧붙입니다.
+    // EN: Appends a single bit.
+    inline void put(uint32_t bit) {
+        acc = (acc << 1) | bit;
+        if (++fill == 64) {
+            emit(acc);
+            fill = 0;
+        }
+    }
+
+    // KO: value의 하위 count비트를 상위 비트부터 덧붙입니다. (count <= 57)
+    // EN: Appends the low `count` bits of value, most significant first. (count <= 57)
+    inline void put_bits(uint64_t value, unsigned count) {
+        const unsigned free_bits = 64 - fill;
+        if (count < free_bits) {
+            acc = (acc << count) | value;
+            fill += count;
+            return;
+        }
+        const unsigned rest = count - free_bits;
+        emit((acc << free_bits) | (value >> rest));
+        acc = value & ((1ull << rest) - 1);
+        fill = rest;
+    }
+
+    // KO: 누산기에 남은 비트를 마지막 워드로 내보내고 bit_count를 확정합니다.
+    // EN: Emits the bits left in the accumulator as the last word and finalizes bit_count.
+    void finish() {
+        const size_t used = static_cast<size_t>(next - out.words.data());
+        out.bit_count = static_cast<uint64_t>(used) * 64 + fill;
+        if (fill > 0) {
+            emit(acc << (64 - fill));
+            fill = 0;
+            acc = 0;
+        }
+        out.words.resize(static_cast<size_t>(next - out.words.data()));
+    }
+
+private:
+    // KO: 워드 하나를 내보냅니다. 미리 확보한 워드를 포인터로 채우고, 다 쓰면 grow로 늘립니다.
+    // EN: Emits one word. The preallocated words are filled through a pointer, and grow extends them once they run out.
+    inline void emit(uint64_t word) {
+        if (next == limit) [[unlikely]] grow();
+        *next++ = word;
+    }
+
+    // KO: 워드 버퍼를 두 배로 늘립니다. (예약 크기가 모자랄 때에만 호출됩니다.)
+    // EN: Doubles the word buffer. (Called only when the reserved size runs short.)
+    void grow() {
+        const size_t used = static_cast<size_t>(next - out.words.data());
+        out.words.resize(std::max<size_t>(used * 2, 64));
+        next = out.words.data() + used;
+        limit = out.words.data() + out.words.size();
+    }
+
+    PackedBits& out;
+    uint64_t* next = nullptr;
+    uint64_t* limit = nullptr;
+    uint64_t acc = 0;
+    unsigned fill = 0;
+};
+
+// KO: 미리 0으로 채워 둔 PackedBits의 주어진 비트 위치부터 비트를 기록하는 기록기입니다. (병렬 분리용)
+//     여러 기록기가 한 출력의 서로 겹치지 않는 구간을 동시에 채울 수 있도록, 앞 구간과 공유할 수 있는 첫 워드는
+//     출력에 쓰지 않고 보관합니다. 모든 기록기가 끝난 뒤 merge_head로 합쳐야 합니다.
+// EN: A writer that writes bits into a zero-filled PackedBits starting at a given bit position. (For the parallel separation)
+//     So that several writers can fill disjoint spans of one output concurrently, the first word, which may be shared
+//     with the preceding span, is kept aside instead of being written. It must be merged with merge_head after every writer finished.
+class PackedBitSpanWriter {
+public:
+    PackedBitSpanWriter(PackedBits& output, uint64_t bit_offset)
+        : words(output.words.data()), index(static_cast<size_t>(bit_offset >> 6)), head_index(index), fill(static_cast<unsigned>(bit_offset & 63)) {}
+
+    // KO: value의 하위 count비트를 상위 비트부터 덧붙입니다. (count <= 57)
+    // EN: Appends the low `count` bits of value, most significant first. (count <= 57)
+    inline void put_bits(uint64_t value, unsigned count) {
+        const unsigned free_bits = 64 - fill;
+        if (count < free_bits) {
+            acc = (acc << count) | value;
+            fill += count;
+            return;
+        }
+        const unsigned rest = count - free_bits;
+        emit((acc << free_bits) | (value >> rest));
+        acc = value & ((1ull << rest) - 1);
+        fill = rest;
+    }
+
+    // KO: 누산기에 남은 비트를 마지막 워드로 내보냅니다.
+    // EN: Emits the bits left in the accumulator as the last word.
+    void finish() {
+        if (fill > 0) {
+            emit(acc << (64 - fill));
+            fill = 0;
+            acc = 0;
+        }
+    }
+
+    // KO: 보관한 첫 워드를 출력에 OR로 합칩니다. 같은 출력의 모든 기록기가 finish한 뒤에 호출해야 합니다.
+    // EN: ORs the first word that was kept aside into the output. Must be called after every writer of the same output finished.
+    void merge_head() {
+        if (head != 0) words[head_index] |= head;
+    }
+
+private:
+    inline void emit(uint64_t word) {
+        if (index == head_index) head = word;
+        else words[index] = word;
+        ++index;
+    }
+
+    uint64_t* words;
+    size_t index;
+    size_t head_index;
+    uint64_t head = 0;
+    uint64_t acc = 0;
+    unsigned fill;
+};
+
+// KO: PackedBits에서 비트를 순서대로 읽는 판독기입니다.
+//     호출자는 bit_count를 넘어서 읽지 않도록 미리 스트림 크기를 검증해야 합니다.
+// EN: A reader that reads bits from a PackedBits in order.
+//     Callers must validate the stream sizes beforehand so that reads never go past bit_count.
+class PackedBitReader {
+public:
+    explicit PackedBitReader(const PackedBits& input) : words(input.words.data()) {}
+
+    // KO: 다음 count비트를 읽어 하위 비트에 담아 반환합니다. (count <= 57)
+    // EN: Reads the next `count` bits and returns them in the low bits. (count <= 57)
+    inline uint64_t get_bits(unsigned count) {
+        if (count == 0) return 0;
+        const size_t word_index = static_cast<size_t>(pos >> 6);
+        const unsigned offset = static_cast<unsigned>(pos & 63);
+        uint64_t bits = words[word_index] << offset;
+        if (offset + count > 64) bits |= words[word_index + 1] >> (64 - offset);
+        pos += count;
+        return bits >> (64 - count);
+    }
+
+    inline uint32_t get() {
+        return static_cast<uint32_t>(get_bits(1));
+    }
+
+    uint64_t position() const { return pos; }
+
+private:
+    const uint64_t* words;
+    uint64_t pos = 0;
+};
+
+// KO: 비트 스트림을 한꺼번에 만들지 않고, 요청받을 때마다 다음 워드들을 만들어 내는 공급원입니다. (융합 복호화 파이프라인용)
+//     압축 데이터에서 바로 비트를 복호화하는 복호기가 이를 구현하므로, 복원 루프는 중간 스트림을 만들지 않고 원본 바이트를 만듭니다.
+// EN: A source that produces the next words of a bit stream on request instead of materializing it. (For the fused decoding pipeline)
+//     Decoders that decode bits straight from the compressed data implement it, so the reassembly loop produces
+//     the original bytes without materializing the intermediate streams.
+class PackedBitSource {
+public:
+    explicit PackedBitSource(uint64_t bit_count) : bit_count(bit_count) {}
+    virtual ~PackedBitSource() = default;
+
+    uint64_t size() const { return bit_count; }
+
+    // KO: 다음 워드를 최대 max_words개 out에 기록하고, 기록한 워드 수를 반환합니다. 스트림이 끝날 때에만 max_words보다 적게 기록하며,
+    //     마지막 워드에서 bit_count를 넘는 비트는 0입니다. 비트 순서는 PackedBits와 같습니다. (MSB-first)
+    // EN: Writes up to max_words next words into `out` and returns the number written. Fewer than max_words are written only
+    //     when the stream ends, and the bits of the last word beyond bit_count are 0. The bit order is that of PackedBits. (MSB-first)
+    virtual size_t read_words(uint64_t* out, size_t max_words) = 0;
+
+protected:
+    uint64_t bit_count;
+};
+
+// KO: 공급원의 남은 비트를 모두 읽어 PackedBits로 만듭니다.
+// EN: Reads all the remaining bits of a source into a PackedBits.
+inline PackedBits read_all_bits(PackedBitSource& source) {
+    PackedBits result;
+    result.bit_count = source.size();
+    result.words.resize(PackedBits::words_for(result.bit_count));
+    source.read_words(result.words.data(), result.words.size());
+    return result;
+}
+
+// KO: 이미 만들어진 PackedBits를 공급원으로 내놓습니다. (다단계 블록에서 중첩 블록으로 복원한 스트림용)
+// EN: Offers an already materialized PackedBits as a source. (For streams a multi-level block restores from a nested block)
+class StoredBitSource : public PackedBitSource {
+public:
+    explicit StoredBitSource(PackedBits stored) : PackedBitSource(stored.size()), bits(std::move(stored)) {}
+
+    size_t read_words(uint64_t* out, size_t max_words) override {
+        const size_t n = std::min(max_words, bits.words.size() - next_word);
+        std::copy(bits.words.begin() + next_word, bits.words.begin() + next_word + n, out);
+        next_word += n;
+        return n;
+    }
+
+private:
+    PackedBits bits;
+    size_t next_word = 0;
+};
+
+// KO: 비트 시퀀스를 MSB-first 바이트열로 바꿉니다. 마지막 바이트의 남는 비트는 0입니다. (비트 스트림을 다시 분리할 때 사용합니다.)
+// EN: Turns a bit sequence into MSB-first bytes. The spare bits of the last byte are 0. (Used to separate a bit stream again.)
+inline std::vector<uint8_t> packed_bits_to_bytes(const PackedBits& bits) {
+    std::vector<uint8_t> bytes(static_cast<size_t>((bits.size() + 7) / 8));
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(bits.words[i >> 3] >> (56 - 8 * (i & 7)));
+    }
+    return bytes;
+}
+
+// KO: packed_bits_to_bytes의 역변환입니다. bit_count를 넘는 비트는 버립니다.
+// EN: The inverse of packed_bits_to_bytes. Bits beyond bit_count are dropped.
+inline PackedBits packed_bits_from_bytes(const std::vector<uint8_t>& bytes, uint64_t bit_count) {
+    PackedBits bits;
+    bits.bit_count = bit_count;
+    bits.words.assign(PackedBits::words_for(bit_count), 0);
+    const size_t n_bytes = std::min(bytes.size(), static_cast<size_t>((bit_count + 7) / 8));
+    for (size_t i = 0; i < n_bytes; ++i) {
+        bits.words[i >> 3] |= static_cast<uint64_t>(bytes[i]) << (56 - 8 * (i & 7));
+    }
+    if ((bit_count & 63) != 0) bits.words.back() &= ~0ull << (64 - (bit_count & 63));
+    return bits;
+}
+
+// KO: 비트 스트림을 한꺼번에 받지 않고 청크 단위로 받는 수신자입니다. (융합 부호화 파이프라인용)
+//     rANS는 심볼을 역순으로 부호화하므로 청크는 마지막 청크부터 처음 청크 순으로 전달되며, 각 청크 안의 비트는 정순입니다.
+// EN: A sink that takes a bit stream chunk by chunk instead of all at once. (For the fused encoding pipeline)
+//     rANS codes the symbols in reverse, so the chunks are handed over from the last one to the first, each holding its bits in order.
+class PackedBitSink {
+public:
+    virtual ~PackedBitSink() = default;
+    virtual void put_reverse(const PackedBits& chunk) = 0;
+};
+
+// KO: PackedBitSource에서 작은 창(window) 단위로 워드를 가져오며 순서대로 읽는 판독기입니다. 작업 집합이 창 크기로 제한되므로
+//     L1/L2 캐시 안에 머뭅니다. 공급원이 끝난 뒤에는 0을 읽으므로, 호출자는 끝에서 position()을 size()와 비교해 손상을 확인해야 합니다.
+// EN: A reader that reads in order, fetching words from a PackedBitSource one small window at a time. The working set is bounded by
+//     the window, so it stays in the L1/L2 cache. Past the end of the source it reads zeros, so callers must compare position()
+//     with size() at the end to detect corruption.
+class BufferedBitReader {
+public:
+    static constexpr size_t DEFAULT_WINDOW_WORDS = 512;
+
+    explicit BufferedBitReader(PackedBitSource& input, size_t window_words = DEFAULT_WINDOW_WORDS)
+        : source(input), window(window_words + 1, 0) {}
+
+    // KO: 다음 count비트를 읽어 하위 비트에 담아 반환합니다. (count <= 57)
+    // EN: Reads the next `count` bits and returns them in the low bits. (count <= 57)
+    inline uint64_t get_bits(unsigned count) {
+        if (count == 0) return 0;
+        if (((pos + count - 1) >> 6) >= loaded) refill();
+        const size_t word_index = static_cast<size_t>(pos >> 6);
+        const unsigned offset = static_cast<unsigned>(pos & 63);
+        uint64_t bits = window[word_index] << offset;
+        if (offset + count > 64) bits |= window[word_index + 1] >> (64 - offset);
+        pos += count;
+        return bits >> (64 - count);
+    }
+
+    uint64_t position() const { return base + pos; }
+
+private:
+    // KO: 읽는 중인 워드를 창의 맨 앞으로 옮기고, 나머지를 공급원의 다음 워드로 채웁니다.
+    // EN: Moves the word being read to the front of the window and fills the rest with the next words of the source.
+    void refill() {
+        const size_t keep = static_cast<size_t>(pos >> 6);
+        const size_t n_keep = loaded - std::min(keep, loaded);
+        for (size_t i = 0; i < n_keep; ++i) window[i] = window[keep + i];
+        base += static_cast<uint64_t>(keep) * 64;
+        pos &= 63;
+        const size_t n_read = source.read_words(window.data() + n_keep, window.size() - n_keep);
+        for (size_t i = n_keep + n_read; i < window.size(); ++i) window[i] = 0;
+        loaded = window.size();
+    }
+
+    PackedBitSource& source;
+    std::vector<uint64_t> window;
+    size_t loaded = 0;
+    uint64_t base = 0;
+    uint64_t pos = 0;
+};
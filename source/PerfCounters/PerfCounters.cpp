@@ -0,0 +1,171 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 단계별 하드웨어 성능 카운터 측정을 구현합니다.
+// EN: This file implements the per-stage hardware performance counter measurement.
+#include "PerfCounters.h"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include <mutex>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// KO: 단계 이름별 누적 결과입니다. 단계 수가 적으므로 처음 나온 순서대로 선형 탐색합니다.
+// EN: The accumulated results per stage name. There are few stages, so they are searched linearly in order of first appearance.
+struct PerfStageTotals {
+    const char* name = nullptr;
+    uint64_t calls = 0;
+    uint64_t bytes = 0;
+    uint64_t nanoseconds = 0;
+    uint64_t counts[PERF_COUNTER_COUNT] = { 0 };
+};
+
+// KO: 측정 여부와 카운터 종류별 사용 가능 여부는 작업 스레드를 만들기 전에 켜는 스레드에서 한 번만 정해집니다.
+//     단계별 누적 결과는 여러 스레드의 단계가 함께 더하므로 totals_mutex로 보호합니다.
+// EN: Whether the measurement is on and which counters are available are settled once, on the enabling thread, before
+//     any worker thread is created. The per-stage totals are added to by stages on several threads, so totals_mutex guards them.
+static bool profiling_enabled = false;
+static bool counter_open[PERF_COUNTER_COUNT] = { false };
+static std::mutex totals_mutex;
+static std::vector<PerfStageTotals> stage_totals;
+
+#if defined(__linux__)
+// KO: 호출 스레드와 이후에 만들어질 자식 스레드를 세는 사용자 공간 카운터를 엽니다. 실패하면 -1입니다.
+// EN: Opens a user-space counter for the calling thread and the threads it creates later. Returns -1 on failure.
+static int open_counter(uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// KO: 스레드마다 따로 여는 카운터입니다. 카운터는 연 스레드만 세므로, 작업 스레드는 첫 단계에서 자신의 카운터를 열고
+//     스레드가 끝날 때 닫습니다. 다른 스레드의 카운터를 읽으면 그 스레드의 값이 섞이기 때문입니다.
+// EN: The counters opened separately by every thread. A counter only counts the thread that opened it, so a worker thread
+//     opens its own at its first stage and closes them when it exits; reading another thread's counters would mix in its values.
+struct ThreadCounters {
+    int fds[PERF_COUNTER_COUNT] = { -1, -1, -1, -1 };
+    bool opened = false;
+
+    void open() {
+        const uint64_t configs[PERF_COUNTER_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+        };
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) fds[i] = open_counter(configs[i]);
+        opened = true;
+    }
+
+    ~ThreadCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+    }
+};
+static thread_local ThreadCounters thread_counters;
+#endif
+
+bool enable_perf_profiling() {
+    profiling_enabled = true;
+    bool any_open = false;
+#if defined(__linux__)
+    thread_counters.open();
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        counter_open[i] = thread_counters.fds[i] >= 0;
+        any_open |= counter_open[i];
+    }
+#elif defined(_WIN32)
+    counter_open[PERF_CYCLES] = true;
+    any_open = true;
+#endif
+    return any_open;
+}
+
+bool perf_profiling_enabled() {
+    return profiling_enabled;
+}
+
+static void read_counters(uint64_t counts[PERF_COUNTER_COUNT]) {
+#if defined(__linux__)
+    if (!thread_counters.opened) thread_counters.open();
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        uint64_t value = 0;
+        if (counter_open[i] && thread_counters.fds[i] >= 0 && read(thread_counters.fds[i], &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value))) counts[i] = value;
+    }
+#elif defined(_WIN32)
+    ULONG64 cycles = 0;
+    QueryThreadCycleTime(GetCurrentThread(), &cycles);
+    counts[PERF_CYCLES] = cycles;
+#else
+    (void)counts;
+#endif
+}
+
+PerfStage::PerfStage(const char* name, uint64_t bytes) : name(name), bytes(bytes), active(profiling_enabled) {
+    if (!active) return;
+    read_counters(start_counts);
+    start_time = std::chrono::steady_clock::now();
+}
+
+PerfStage::~PerfStage() {
+    if (!active) return;
+    const auto end_time = std::chrono::steady_clock::now();
+    uint64_t end_counts[PERF_COUNTER_COUNT] = { 0 };
+    read_counters(end_counts);
+
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    PerfStageTotals* totals = nullptr;
+    for (PerfStageTotals& stage : stage_totals) {
+        if (strcmp(stage.name, name) == 0) totals = &stage;
+    }
+    if (totals == nullptr) {
+        stage_totals.emplace_back();
+        totals = &stage_totals.back();
+        totals->name = name;
+    }
+    totals->calls++;
+    totals->bytes += bytes;
+    totals->nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count());
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) totals->counts[i] += end_counts[i] - start_counts[i];
+}
+
+void report_perf_profile(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    const bool any_counter = counter_open[PERF_CYCLES] || counter_open[PERF_INSTRUCTIONS] || counter_open[PERF_BRANCH_MISSES] || counter_open[PERF_CACHE_MISSES];
+    out << "Performance profile" << (any_counter ? "" : " (hardware counters unavailable, wall-clock only)") << ":" << std::endl;
+    out << std::left << std::setw(28) << "  stage" << std::right << std::setw(8) << "calls" << std::setw(12) << "MB" << std::setw(10) << "ms"
+        << std::setw(10) << "MB/s" << std::setw(12) << "cycles/B" << std::setw(8) << "IPC" << std::setw(14) << "br-miss/KB" << std::setw(14) << "$-miss/KB" << std::endl;
+    out << std::fixed;
+    for (const PerfStageTotals& stage : stage_totals) {
+        const double megabytes = static_cast<double>(stage.bytes) / 1e6;
+        const double milliseconds = static_cast<double>(stage.nanoseconds) / 1e6;
+        const double kilobytes = static_cast<double>(stage.bytes) / 1e3;
+        out << "  " << std::left << std::setw(26) << stage.name << std::right << std::setw(8) << stage.calls
+            << std::setw(12) << std::setprecision(2) << megabytes << std::setw(10) << milliseconds
+            << std::setw(10) << std::setprecision(1) << (milliseconds > 0 ? megabytes / (milliseconds / 1e3) : 0.0);
+        auto column = [&](bool available, double value, int width, int precision) {
+            if (available && stage.bytes > 0) out << std::setw(width) << std::setprecision(precision) << value;
+            else out << std::setw(width) << "n/a";
+        };
+        column(counter_open[PERF_CYCLES], static_cast<double>(stage.counts[PERF_CYCLES]) / stage.bytes, 12, 2);
+        column(counter_open[PERF_CYCLES] && counter_open[PERF_INSTRUCTIONS] && stage.counts[PERF_CYCLES] > 0,
+               static_cast<double>(stage.counts[PERF_INSTRUCTIONS]) / std::max<uint64_t>(stage.counts[PERF_CYCLES], 1), 8, 2);
+        column(counter_open[PERF_BRANCH_MISSES], static_cast<double>(stage.counts[PERF_BRANCH_MISSES]) / kilobytes, 14, 2);
+        column(counter_open[PERF_CACHE_MISSES], static_cast<double>(stage.counts[PERF_CACHE_MISSES]) / kilobytes, 14, 2);
+        out << std::endl;
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <cstdint>
+#include <ostream>
+#include <chrono>
+
+// KO: 단계별 하드웨어 성능 카운터 측정입니다. 켜져 있으면 PerfStage가 감싼 구간마다 사이클, 명령어, 분기 예측 실패,
+//     캐시 미스와 경과 시간을 단계 이름별로 누적하고, 보고서는 단계마다 바이트당 사이클을 보여줍니다.
+//     Linux에서는 perf_event_open을, Windows에서는 스레드 사이클 시간(사이클만)을 사용합니다. 카운터를 열 수 없는 호스트에서는
+//     경과 시간만 기록하고 카운터 열은 n/a로 표시합니다. 카운터는 스레드마다 첫 단계에서 열리며(켠 스레드는 켤 때),
+//     단계 안에서 만든 자식 스레드는 종료될 때 값이 더해집니다(Linux). 한 스레드의 단계는 서로 겹치지 않게 두어야 하지만,
+//     여러 스레드의 단계는 동시에 측정할 수 있으며 결과는 잠금 아래에서 합쳐집니다. 이때 시간 열은 스레드들의 시간의 합입니다.
+// EN: Per-stage hardware performance counter measurement. When enabled, every span wrapped in a PerfStage accumulates
+//     cycles, instructions, branch misses, cache misses and the elapsed time under its stage name, and the report shows
+//     the cycles per byte of every stage. perf_event_open is used on Linux and the thread cycle time (cycles only) on Windows.
+//     On hosts where the counters cannot be opened only the elapsed time is recorded and the counter columns read n/a.
+//     The counters are opened per thread at its first stage (on the enabling thread when enabling), and child threads
+//     created inside a stage add their values when they exit (Linux). The stages of one thread must not overlap, but stages
+//     on several threads may be measured at once; their results are merged under a lock, and the time column is then
+//     the sum over the threads.
+enum PerfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_CACHE_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+// KO: 측정을 켭니다. 하드웨어 카운터를 하나라도 열었으면 true를 반환합니다. (false여도 경과 시간은 측정합니다.)
+// EN: Turns the measurement on. Returns true if at least one hardware counter was opened. (The elapsed time is measured even on false.)
+bool enable_perf_profiling();
+bool perf_profiling_enabled();
+
+// KO: 누적된 단계별 결과를 표로 출력합니다.
+// EN: Prints the accumulated per-stage results as a table.
+void report_perf_profile(std::ostream& out);
+
+// KO: 생성부터 소멸까지를 한 단계로 측정합니다. 측정이 꺼져 있으면 아무것도 하지 않습니다.
+//     @param name - 단계 이름 (정적 문자열)
+//     @param bytes - 바이트당 사이클의 기준이 되는 바이트 수
+// EN: Measures the span from construction to destruction as one stage. Does nothing when the measurement is off.
+//     @param name - The stage name (a static string)
+//     @param bytes - The byte count the cycles per byte are relative to
+class PerfStage {
+public:
+    PerfStage(const char* name, uint64_t bytes);
+    ~PerfStage();
+    PerfStage(const PerfStage&) = delete;
+    PerfStage& operator=(const PerfStage&) = delete;
+
+private:
+    const char* name;
+    uint64_t bytes;
+    bool active;
+    uint64_t start_counts[PERF_COUNTER_COUNT] = { 0 };
+    std::chrono::steady_clock::time_point start_time;
+};
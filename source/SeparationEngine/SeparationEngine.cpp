@@ -8,171 +8,678 @@
 #include "SeparationEngine.h"
 #include <iostream>
 #include <map>
+#include <bit>
+#include <stdexcept>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+// KO: 심볼 폭(Width)별 분리 형식의 상수들입니다.
+//     - 혼합 심볼(모든 비트가 같지는 않은 심볼)은 reconstructed_stream에 마커(0)를, value_bitmap에 값 비트를 남깁니다.
+//       2비트 심볼의 혼합 심볼은 '01'/'10' 두 가지뿐이므로 1비트로 충분하고, 4비트 심볼은 4비트를 그대로 기록합니다.
+//     - 균일 심볼(모두 0 또는 모두 1)은 reconstructed_stream에 자리표시자(1)를, auxiliary_mask에 희소 심볼 여부를 남깁니다.
+//       1비트 심볼은 모두 균일 심볼이므로 auxiliary_mask가 원본 비트열이 됩니다.
+// EN: The constants of the separation layout for each symbol width (Width).
+//     - A mixed symbol (one whose bits are not all equal) leaves a marker (0) in the reconstructed_stream and value bits in the value_bitmap.
+//       A 2-bit symbol has only two mixed symbols, '01'/'10', so 1 bit suffices; a 4-bit symbol records its 4 bits as is.
+//     - A uniform symbol (all zeros or all ones) leaves a placeholder (1) in the reconstructed_stream and whether it is the rare
+//       symbol in the auxiliary_mask. Every 1-bit symbol is uniform, so the auxiliary_mask becomes the original bit string.
+template <unsigned Width>
+struct SymbolLayout {
+    static_assert(Width == 1 || Width == 2 || Width == 4, "Unsupported symbol width");
+    static constexpr unsigned symbols_per_byte = 8 / Width;
+    static constexpr unsigned value_bits_per_symbol = (Width == 2) ? 1 : Width;
+    static constexpr unsigned max_payload_bits = symbols_per_byte * value_bits_per_symbol;
+    static constexpr unsigned all_ones = (1u << Width) - 1;
+};
+
+// KO: 한 바이트(Width비트 심볼 8/Width개)를 3개의 스트림으로 분해한 결과를 담는 조회 테이블 항목입니다.
+//     바이트마다 심볼을 하나씩 분기 처리하는 대신, 테이블에서 각 스트림에 덧붙일 비트 묶음을 한 번에 가져옵니다.
+// EN: A lookup table entry holding the result of splitting one byte (8/Width symbols of Width bits) into the three streams.
+//     Instead of branching on each symbol, the bit groups to append to each stream are fetched at once.
+struct ByteSplitEntry {
+    uint8_t recon_bits;     // KO: 재구성 스트림 비트 (심볼당 1비트) / EN: Reconstructed-stream bits (1 bit per symbol)
+    uint8_t value_bits;     // KO: value_bitmap에 덧붙일 비트 / EN: Bits to append to the value_bitmap
+    uint8_t value_count;
+    uint8_t mask_bits;      // KO: auxiliary_mask에 덧붙일 비트 / EN: Bits to append to the auxiliary_mask
+    uint8_t mask_count;
+};
+
+// KO: 심볼 폭과 극성별 분해 테이블입니다. Rep11이 참이면 마스크의 '1'은 모두 1인 심볼('11')을, 거짓이면 모두 0인 심볼('00')을 뜻합니다.
+// EN: The split table for each symbol width and polarity. If Rep11 is true a mask '1' means the all-ones symbol ('11'),
+//     otherwise the all-zeros symbol ('00').
+template <unsigned Width, bool Rep11>
+static const ByteSplitEntry* byte_split_table() {
+    using L = SymbolLayout<Width>;
+    static const auto table = [] {
+        std::vector<ByteSplitEntry> entries(256);
+        for (unsigned byte = 0; byte < 256; ++byte) {
+            ByteSplitEntry e = {};
+            for (unsigned j = 0; j < L::symbols_per_byte; ++j) {
+                const unsigned sym = (byte >> (8 - Width * (j + 1))) & L::all_ones;
+                if (sym != 0 && sym != L::all_ones) {
+                    // KO: 마커(0)와 값 정보 (2비트: '01'이면 1, '10'이면 0 / 4비트: 심볼 그대로)
+                    // EN: A marker (0) and the value information (2-bit: 1 for '01', 0 for '10' / 4-bit: the symbol itself)
+                    const unsigned value = (Width == 2) ? (sym & 1) : sym;
+                    e.recon_bits = static_cast<uint8_t>(e.recon_bits << 1);
+                    e.value_bits = static_cast<uint8_t>((e.value_bits << L::value_bits_per_symbol) | value);
+                    e.value_count = static_cast<uint8_t>(e.value_count + L::value_bits_per_symbol);
+                }
+                else {
+                    // KO: 자리표시자(1)와 희소 심볼 여부
+                    // EN: A placeholder (1) and whether it is the rare symbol
+                    const unsigned is_all_ones = (sym == L::all_ones) ? 1 : 0;
+                    e.recon_bits = static_cast<uint8_t>((e.recon_bits << 1) | 1);
+                    e.mask_bits = static_cast<uint8_t>((e.mask_bits << 1) | (Rep11 ? is_all_ones : (is_all_ones ^ 1)));
+                    e.mask_count++;
+                }
+            }
+            entries[byte] = e;
+        }
+        return entries;
+    }();
+    return table.data();
+}
+
+// KO: 재구성 스트림 비트(심볼 8/Width개)와, 그 뒤에 이어 붙인 value_bitmap/auxiliary_mask 비트로부터
+//     원본 바이트를 바로 찾는 조회 테이블입니다. 색인은 (recon << max_payload_bits) | (value_bits << n_mask) | mask_bits 입니다.
+// EN: A lookup table that maps the reconstructed-stream bits (8/Width symbols), followed by the concatenated
+//     value_bitmap/auxiliary_mask bits, straight to the original byte. The index is (recon << max_payload_bits) | (value_bits << n_mask) | mask_bits.
+template <unsigned Width, bool Rep11>
+static const uint8_t* byte_merge_table() {
+    using L = SymbolLayout<Width>;
+    static const auto table = [] {
+        std::vector<uint8_t> entries(size_t(1) << (L::symbols_per_byte + L::max_payload_bits));
+        for (unsigned recon = 0; recon < (1u << L::symbols_per_byte); ++recon) {
+            const unsigned n_mask = static_cast<unsigned>(std::popcount(recon));
+            const unsigned n_value_bits = (L::symbols_per_byte - n_mask) * L::value_bits_per_symbol;
+            for (unsigned payload = 0; payload < (1u << (n_value_bits + n_mask)); ++payload) {
+                const unsigned value_bits = payload >> n_mask;
+                const unsigned mask_bits = payload & ((1u << n_mask) - 1);
+                unsigned value_left = n_value_bits, mask_left = n_mask;
+                unsigned byte = 0;
+                for (unsigned j = 0; j < L::symbols_per_byte; ++j) {
+                    unsigned sym;
+                    if (((recon >> (L::symbols_per_byte - 1 - j)) & 1) == 0) {
+                        value_left -= L::value_bits_per_symbol;
+                        const unsigned value = (value_bits >> value_left) & ((1u << L::value_bits_per_symbol) - 1);
+                        sym = (Width == 2) ? (value ? 0b01u : 0b10u) : value;
+                    }
+                    else {
+                        const unsigned bit = (mask_bits >> --mask_left) & 1;
+                        sym = ((bit ^ (Rep11 ? 0u : 1u)) != 0) ? L::all_ones : 0u;
+                    }
+                    byte = (byte << Width) | sym;
+                }
+                entries[(static_cast<size_t>(recon) << L::max_payload_bits) | payload] = static_cast<uint8_t>(byte);
+            }
+        }
+        return entries;
+    }();
+    return table.data();
+}
+
+// KO: 각 짝짓기에서 원본 2비트 심볼을 표준 심볼로 바꾸는 순열입니다. 표준 짝짓기에서는 '01'/'10'이 혼합 쌍(value_bitmap),
+//     '00'/'11'이 균일 쌍(auxiliary_mask)입니다. 예를 들어 Pair00_01은 '00'/'01'을 '10'/'01'로, '10'/'11'을 '00'/'11'로 옮깁니다.
+// EN: The permutation that maps every original 2-bit symbol to a canonical symbol under each pairing. In the canonical pairing
+//     '01'/'10' form the mixed pair (value_bitmap) and '00'/'11' the uniform pair (auxiliary_mask). Pair00_01, for example,
+//     moves '00'/'01' to '10'/'01' and '10'/'11' to '00'/'11'.
+static const uint8_t PAIRING_SYMBOL_MAP[3][4] = {
+    { 0b00, 0b01, 0b10, 0b11 }, // Canonical: {01,10} / {00,11}
+    { 0b10, 0b01, 0b00, 0b11 }, // Pair00_01: {00,01} / {10,11}
+    { 0b01, 0b00, 0b10, 0b11 }, // Pair00_10: {00,10} / {01,11}
+};
+
+// KO: 짝짓기의 심볼 순열을 바이트 단위(심볼 4개)로 적용하는 256바이트 조회 테이블입니다. inverse가 참이면 역순열입니다.
+//     이 테이블은 분해/병합 테이블과 블록마다 한 번 합성되므로, 바이트당 추가 비용이 없습니다.
+// EN: A 256-byte lookup table applying the symbol permutation of a pairing to a whole byte (four symbols); the inverse if `inverse` is true.
+//     It is composed with the split/merge tables once per block, so it adds no per-byte cost.
+static const uint8_t* pairing_byte_map(SymbolPairing pairing, bool inverse) {
+    static const auto tables = [] {
+        std::vector<uint8_t> entries(3 * 2 * 256);
+        for (int p = 0; p < 3; ++p) {
+            uint8_t inverse_map[4];
+            for (uint8_t sym = 0; sym < 4; ++sym) inverse_map[PAIRING_SYMBOL_MAP[p][sym]] = sym;
+            for (int byte = 0; byte < 256; ++byte) {
+                uint8_t forward = 0, backward = 0;
+                for (int shift = 6; shift >= 0; shift -= 2) {
+                    const uint8_t sym = (byte >> shift) & 0x03;
+                    forward = static_cast<uint8_t>(forward | (PAIRING_SYMBOL_MAP[p][sym] << shift));
+                    backward = static_cast<uint8_t>(backward | (inverse_map[sym] << shift));
+                }
+                entries[(p * 2 + 0) * 256 + byte] = forward;
+                entries[(p * 2 + 1) * 256 + byte] = backward;
+            }
+        }
+        return entries;
+    }();
+    return tables.data() + (static_cast<size_t>(pairing) * 2 + (inverse ? 1 : 0)) * 256;
+}
+
+// KO: 이진 엔트로피(비트)입니다.
+// EN: Binary entropy in bits.
+static double binary_entropy_bits(uint64_t ones, uint64_t total) {
+    if (ones == 0 || ones == total) return 0.0;
+    const double p = static_cast<double>(ones) / total;
+    return -static_cast<double>(total) * (p * std::log2(p) + (1.0 - p) * std::log2(1.0 - p));
+}
+
+// KO: 스트림 크기와 1의 개수가 채워진 추정치에 세 스트림의 엔트로피를 계산해 넣습니다.
+//     reconstructed_stream은 rANS_Coder처럼 심볼마다 접두 비트를 붙인 2N비트 스트림으로 계산합니다.
+// EN: Fills in the entropies of the three streams of an estimate whose stream sizes and one counts are already set.
+//     The reconstructed_stream is costed like the rANS_Coder codes it: a 2N-bit stream with a prefix bit per symbol.
+static void estimate_stream_entropies(SeparationEstimate& estimate) {
+    const uint64_t n_uniform = estimate.auxiliary_mask_bits;
+    const uint64_t n_mixed = estimate.reconstructed_bits - n_uniform;
+    const uint64_t n_rare = (n_uniform < n_mixed) ? n_uniform : n_mixed;
+    estimate.reconstructed_entropy_bits = binary_entropy_bits(n_rare, 2 * estimate.reconstructed_bits);
+    estimate.value_bitmap_entropy_bits = binary_entropy_bits(estimate.value_bitmap_ones, estimate.value_bitmap_bits);
+    estimate.auxiliary_mask_entropy_bits = binary_entropy_bits(estimate.auxiliary_mask_ones, estimate.auxiliary_mask_bits);
+}
+
+SymbolPairing SeparationEngine::best_pairing(const uint64_t freqs[4]) {
+    SymbolPairing best = SymbolPairing::Canonical;
+    double best_bits = 0.0;
+    for (int p = 0; p < 3; ++p) {
+        uint64_t canonical_freqs[4];
+        for (int sym = 0; sym < 4; ++sym) canonical_freqs[PAIRING_SYMBOL_MAP[p][sym]] = freqs[sym];
+        SeparationEstimate estimate;
+        estimate.reconstructed_bits = freqs[0] + freqs[1] + freqs[2] + freqs[3];
+        estimate.value_bitmap_bits = canonical_freqs[0b01] + canonical_freqs[0b10];
+        estimate.value_bitmap_ones = canonical_freqs[0b01];
+        estimate.auxiliary_mask_bits = canonical_freqs[0b00] + canonical_freqs[0b11];
+        estimate.auxiliary_mask_ones = canonical_freqs[0b11];
+        estimate_stream_entropies(estimate);
+        const double bits = estimate.total_entropy_bits();
+        if (p == 0 || bits < best_bits) {
+            best = static_cast<SymbolPairing>(p);
+            best_bits = bits;
+        }
+    }
+    return best;
+}
+
+// KO: 바이트 히스토그램을 만듭니다. 이후의 모든 심볼 통계는 이 히스토그램에서 계산되므로 바이트당 카운터 증가는 한 번뿐입니다.
+//     같은 바이트가 연속될 때 한 카운터에 저장-적재 의존이 몰리지 않도록, 4개의 부분 히스토그램에 번갈아 센 뒤 합칩니다.
+// EN: Builds the byte histogram. Every later symbol statistic is computed from it, so each byte costs a single counter increment.
+//     Bytes are counted round-robin into four partial histograms that are summed at the end, so runs of the same byte
+//     do not serialize on the store-to-load dependency of a single counter.
+static void byte_histogram(const uint8_t* ptr, size_t size, uint64_t byte_hist[256]) {
+    uint64_t partial[4][256] = {};
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        partial[0][ptr[i + 0]]++;
+        partial[1][ptr[i + 1]]++;
+        partial[2][ptr[i + 2]]++;
+        partial[3][ptr[i + 3]]++;
+    }
+    for (; i < size; ++i) partial[0][ptr[i]]++;
+    for (int byte = 0; byte < 256; ++byte) {
+        byte_hist[byte] = partial[0][byte] + partial[1][byte] + partial[2][byte] + partial[3][byte];
+    }
+}
+
+// KO: 바이트 히스토그램으로부터 모두 0인 균일 심볼과 모두 1인 균일 심볼의 수, 그리고 value_bitmap에 기록될 1 비트의 수를 셉니다.
+// EN: Counts the all-zeros and all-ones uniform symbols, and the one bits the value_bitmap will receive, from the byte histogram.
+template <unsigned Width>
+static void count_uniform_symbols(const uint64_t byte_hist[256], uint64_t& n_all_zeros, uint64_t& n_all_ones, uint64_t& n_value_ones) {
+    using L = SymbolLayout<Width>;
+    n_all_zeros = n_all_ones = n_value_ones = 0;
+    for (unsigned byte = 0; byte < 256; ++byte) {
+        for (unsigned j = 0; j < L::symbols_per_byte; ++j) {
+            const unsigned sym = (byte >> (Width * j)) & L::all_ones;
+            if (sym == 0) n_all_zeros += byte_hist[byte];
+            else if (sym == L::all_ones) n_all_ones += byte_hist[byte];
+            else n_value_ones += byte_hist[byte] * static_cast<unsigned>((Width == 2) ? (sym & 1) : std::popcount(sym));
+        }
+    }
+}
+
+// KO: 원본 데이터를 2비트 심볼(00, 01, 10, 11) 단위로 보고 각 심볼의 등장 빈도를 계산합니다.
+//     바이트 히스토그램을 먼저 만든 뒤 심볼 빈도로 환산합니다.
+// EN: Treats the data as 2-bit symbols (00, 01, 10, 11) and counts the occurrence frequency of each symbol.
+//     A byte histogram is built first and then converted to symbol frequencies.
+static void symbol_freqs_from_histogram(const uint64_t byte_hist[256], uint64_t freqs[4]) {
+    freqs[0] = freqs[1] = freqs[2] = freqs[3] = 0;
+    for (int byte = 0; byte < 256; ++byte) {
+        freqs[(byte >> 6) & 0x03] += byte_hist[byte]; // 1st 2-bit symbol
+        freqs[(byte >> 4) & 0x03] += byte_hist[byte]; // 2nd 2-bit symbol
+        freqs[(byte >> 2) & 0x03] += byte_hist[byte]; // 3rd 2-bit symbol
+        freqs[(byte >> 0) & 0x03] += byte_hist[byte]; // 4th 2-bit symbol
+    }
+}
+
+void SeparationEngine::count_symbols(const std::vector<uint8_t>& data, uint64_t freqs[4]) {
+    uint64_t byte_hist[256];
+    byte_histogram(data.data(), data.size(), byte_hist);
+    symbol_freqs_from_histogram(byte_hist, freqs);
+}
+
+bool SeparationEngine::is_supported_width(unsigned symbol_width) {
+    return symbol_width == 1 || symbol_width == 2 || symbol_width == 4;
+}
+
+unsigned SeparationEngine::symbols_per_byte(unsigned symbol_width) {
+    return 8 / symbol_width;
+}
+
+unsigned SeparationEngine::value_bits_per_symbol(unsigned symbol_width) {
+    return (symbol_width == 2) ? 1 : symbol_width;
+}
+
+// KO: remap이 주어지면 분해 테이블과 미리 합성하여, 분리 루프가 항상 테이블 조회 한 번으로 끝나게 합니다.
+// EN: If `remap` is given it is composed into the split table beforehand, so the separation loop always costs a single table lookup.
+template <unsigned Width, bool Rep11>
+static const ByteSplitEntry* remapped_split_table(const uint8_t* remap, ByteSplitEntry remapped_table[256]) {
+    const ByteSplitEntry* table = byte_split_table<Width, Rep11>();
+    if (remap == nullptr) return table;
+    for (int byte = 0; byte < 256; ++byte) remapped_table[byte] = table[remap[byte]];
+    return remapped_table;
+}
+
+// KO: 바이트 구간을 분해 테이블로 분리하여 세 기록기(PackedBitWriter 또는 PackedBitSpanWriter)에 덧붙이고 마무리합니다.
+// EN: Splits a byte range through the split table, appends the results to the three writers (PackedBitWriter or PackedBitSpanWriter) and finishes them.
+template <unsigned Width, typename Writer>
+static void split_bytes(const uint8_t* data, size_t n_bytes, const ByteSplitEntry* table, Writer& recon_writer, Writer& value_writer, Writer& mask_writer) {
+    using L = SymbolLayout<Width>;
+    for (size_t i = 0; i < n_bytes; ++i) {
+        const ByteSplitEntry& e = table[data[i]];
+        recon_writer.put_bits(e.recon_bits, L::symbols_per_byte);
+        value_writer.put_bits(e.value_bits, e.value_count);
+        mask_writer.put_bits(e.mask_bits, e.mask_count);
+    }
+    value_writer.finish();
+    recon_writer.finish();
+    mask_writer.finish();
+}
+
+// KO: 분리 커널입니다. 심볼 폭과 극성이 컴파일 시간에 고정되므로, 조합마다 분기 없는 전용 루프가 만들어집니다.
+// EN: The separation kernel. The symbol width and polarity are fixed at compile time, so every combination gets its own branch-free loop.
+template <unsigned Width, bool Rep11>
+static void separate_kernel(const std::vector<uint8_t>& raw_data, const uint8_t* remap, uint64_t n_uniform, SeparatedStreams& result) {
+    using L = SymbolLayout<Width>;
+    const uint64_t n_symbols = static_cast<uint64_t>(raw_data.size()) * L::symbols_per_byte;
+
+    // KO: 빈도수로부터 각 스트림의 최종 비트 수를 알 수 있으므로, 메모리를 한 번에 예약하여 재할당을 없앱니다.
+    // EN: The final bit count of every stream is known from the frequencies, so memory is reserved once and never reallocated.
+    PackedBitWriter value_writer(result.value_bitmap, (n_symbols - n_uniform) * L::value_bits_per_symbol);
+    PackedBitWriter recon_writer(result.reconstructed_stream, n_symbols);
+    PackedBitWriter mask_writer(result.auxiliary_mask, n_uniform);
+
+    ByteSplitEntry remapped_table[256];
+    const ByteSplitEntry* table = remapped_split_table<Width, Rep11>(remap, remapped_table);
+    split_bytes<Width>(raw_data.data(), raw_data.size(), table, recon_writer, value_writer, mask_writer);
+}
+
+// KO: 병렬 분리에서 한 스레드가 맡는 원본 바이트 구간과, 그 구간의 바이트 히스토그램입니다.
+// EN: The range of original bytes one thread handles in the parallel separation, and the byte histogram of that range.
+struct SeparationRange {
+    size_t begin = 0;
+    size_t end = 0;
+    uint64_t byte_hist[256] = {};
+};
+
+// KO: 스레드 하나가 맡을 최소 바이트 수입니다. 이보다 작은 구간은 스레드를 만드는 비용이 분리 시간보다 커집니다.
+// EN: The fewest bytes one thread takes on. For smaller ranges, creating the thread costs more than the separation saves.
+static constexpr size_t MIN_PARALLEL_SEPARATION_BYTES = 1024 * 1024;
+
+// KO: 데이터 크기와 요청된 스레드 수(0이면 하드웨어 스레드 수)로부터 실제로 사용할 스레드 수를 정합니다.
+// EN: Settles the number of threads actually used from the data size and the requested thread count (0 for the hardware thread count).
+static unsigned separation_thread_count(size_t n_bytes, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t max_threads = std::max<size_t>(1, n_bytes / MIN_PARALLEL_SEPARATION_BYTES);
+    return static_cast<unsigned>(std::min<size_t>(threads, max_threads));
+}
+
+// KO: body(0) ... body(n_threads - 1)을 동시에 실행합니다. body(0)은 호출한 스레드에서 실행됩니다.
+// EN: Runs body(0) ... body(n_threads - 1) concurrently. body(0) runs on the calling thread.
+template <typename Body>
+static void run_parallel(unsigned n_threads, const Body& body) {
+    std::vector<std::thread> workers;
+    workers.reserve(n_threads - 1);
+    for (unsigned t = 1; t < n_threads; ++t) workers.emplace_back(body, t);
+    body(0u);
+    for (std::thread& worker : workers) worker.join();
+}
+
+// KO: 병렬 분리 커널입니다. 구간마다 히스토그램으로 세 스트림에 기록할 비트 수를 세고, 그 접두 합으로 각 구간이 출력 스트림의
+//     어느 비트 위치부터 기록할지 정한 뒤, 모든 구간을 동시에 분리합니다. 구간 경계에서 공유되는 워드는 끝에 OR로 합치므로,
+//     결과는 직렬 커널과 비트 단위로 같습니다.
+// EN: The parallel separation kernel. The histogram of every range tells how many bits it writes to each of the three streams;
+//     their prefix sums give the bit position in every output stream where each range starts writing, and then all ranges are
+//     separated concurrently. The words shared at range boundaries are ORed together at the end, so the result is bit-identical
+//     to the serial kernel.
+template <unsigned Width, bool Rep11>
+static void separate_kernel_parallel(const std::vector<uint8_t>& raw_data, const uint8_t* remap, const std::vector<SeparationRange>& ranges, SeparatedStreams& result) {
+    using L = SymbolLayout<Width>;
+    ByteSplitEntry remapped_table[256];
+    const ByteSplitEntry* table = remapped_split_table<Width, Rep11>(remap, remapped_table);
+
+    // --- 구간별 비트 수와 접두 합 ---
+    // --- Per-range Bit Counts and Prefix Sums ---
+    const size_t n_ranges = ranges.size();
+    std::vector<uint64_t> recon_offset(n_ranges + 1, 0), value_offset(n_ranges + 1, 0), mask_offset(n_ranges + 1, 0);
+    for (size_t t = 0; t < n_ranges; ++t) {
+        uint64_t value_bits = 0, mask_bits = 0;
+        for (int byte = 0; byte < 256; ++byte) {
+            value_bits += ranges[t].byte_hist[byte] * table[byte].value_count;
+            mask_bits += ranges[t].byte_hist[byte] * table[byte].mask_count;
+        }
+        recon_offset[t + 1] = recon_offset[t] + static_cast<uint64_t>(ranges[t].end - ranges[t].begin) * L::symbols_per_byte;
+        value_offset[t + 1] = value_offset[t] + value_bits;
+        mask_offset[t + 1] = mask_offset[t] + mask_bits;
+    }
+    PackedBits* streams[3] = { &result.reconstructed_stream, &result.value_bitmap, &result.auxiliary_mask };
+    const uint64_t totals[3] = { recon_offset[n_ranges], value_offset[n_ranges], mask_offset[n_ranges] };
+    for (int i = 0; i < 3; ++i) {
+        streams[i]->bit_count = totals[i];
+        streams[i]->words.assign(PackedBits::words_for(totals[i]), 0);
+    }
+
+    // --- 동시 기록 ---
+    // --- Concurrent Emission ---
+    std::vector<PackedBitSpanWriter> writers;
+    writers.reserve(3 * n_ranges);
+    for (size_t t = 0; t < n_ranges; ++t) {
+        writers.emplace_back(result.reconstructed_stream, recon_offset[t]);
+        writers.emplace_back(result.value_bitmap, value_offset[t]);
+        writers.emplace_back(result.auxiliary_mask, mask_offset[t]);
+    }
+    run_parallel(static_cast<unsigned>(n_ranges), [&](unsigned t) {
+        const SeparationRange& range = ranges[t];
+        split_bytes<Width>(raw_data.data() + range.begin, range.end - range.begin, table, writers[3 * t], writers[3 * t + 1], writers[3 * t + 2]);
+    });
+    for (PackedBitSpanWriter& writer : writers) writer.merge_head();
+}
+
+// KO: 역순 분리 커널입니다. 데이터를 chunk_bytes 크기의 청크로 나누어 마지막 청크부터 분리하고, 청크의 세 스트림을 바로 수신자에 넘깁니다.
+//     청크 스트림의 버퍼는 매번 재사용하므로, 작업 집합은 블록 크기와 관계없이 청크 크기로 제한됩니다.
+// EN: The reverse separation kernel. The data is cut into chunks of chunk_bytes, separated from the last chunk backwards, and the three
+//     streams of every chunk go straight to the sinks. The buffers of the chunk streams are reused, so the working set is bounded by
+//     the chunk size whatever the block size.
+template <unsigned Width, bool Rep11>
+static void separate_reverse_kernel(const std::vector<uint8_t>& raw_data, const uint8_t* remap, size_t chunk_bytes,
+                                    PackedBitSink& recon_sink, PackedBitSink& value_sink, PackedBitSink& mask_sink) {
+    using L = SymbolLayout<Width>;
+    ByteSplitEntry remapped_table[256];
+    const ByteSplitEntry* table = remapped_split_table<Width, Rep11>(remap, remapped_table);
+
+    PackedBits recon_chunk, value_chunk, mask_chunk;
+    const uint64_t n_symbols = static_cast<uint64_t>(chunk_bytes) * L::symbols_per_byte;
+    for (size_t end = raw_data.size(); end > 0;) {
+        const size_t begin = ((end - 1) / chunk_bytes) * chunk_bytes;
+        PackedBitWriter recon_writer(recon_chunk, n_symbols);
+        PackedBitWriter value_writer(value_chunk, n_symbols * L::value_bits_per_symbol);
+        PackedBitWriter mask_writer(mask_chunk, n_symbols);
+        split_bytes<Width>(raw_data.data() + begin, end - begin, table, recon_writer, value_writer, mask_writer);
+        recon_sink.put_reverse(recon_chunk);
+        value_sink.put_reverse(value_chunk);
+        mask_sink.put_reverse(mask_chunk);
+        end = begin;
+    }
+}
+
+// KO: 분리와 추정이 공유하는 사전 분석 단계입니다. 인자를 검증하고 바이트 히스토그램을 만든 뒤 짝짓기를 확정합니다.
+//     균일 심볼의 빈도는 'auxiliary_mask'의 극성을 정하고 각 스트림의 크기를 미리 정하는 데 사용됩니다.
+//     2비트 심볼에서는 네 심볼을 두 쌍으로 나누는 세 가지 짝짓기 중 하나를 사용할 수 있습니다.
+//     Auto이면 히스토그램에서 얻은 심볼 빈도로 각 짝짓기의 부호화 크기를 추정하여 가장 작은 것을 고릅니다.
+//     표준 짝짓기가 아니면 히스토그램을 표준 심볼 기준으로 옮기고, 분해 테이블에 합성할 바이트 순열을 반환합니다.
+// EN: The pre-analysis phase shared by separation and estimation. Validates the arguments, builds the byte histogram and settles the pairing.
+//     The frequencies of the uniform symbols decide the polarity of the 'auxiliary_mask' and size every stream in advance.
+//     With 2-bit symbols, any of the three pairings that split the four symbols into two pairs can be used.
+//     With Auto, the coded size of every pairing is estimated from the symbol frequencies of the histogram and the smallest wins.
+//     For a non-canonical pairing the histogram is moved onto the canonical symbols, and the byte permutation to compose
+//     into the split table is returned.
+//     ranges가 주어지면 구간마다 히스토그램을 동시에 만든 뒤 합칩니다. (구간 히스토그램은 짝짓기 순열을 적용하지 않은 원본 기준입니다.)
+// EN: With `ranges`, the histogram of every range is built concurrently and the results are summed.
+//     (The range histograms stay on the original bytes; the pairing permutation is not applied to them.)
+static const uint8_t* analyze_separation(const std::vector<uint8_t>& raw_data, unsigned symbol_width, SymbolPairing& pairing, uint64_t byte_hist[256],
+                                         std::vector<SeparationRange>* ranges = nullptr) {
+    if (!SeparationEngine::is_supported_width(symbol_width)) {
+        throw std::invalid_argument("Unsupported symbol width (must be 1, 2 or 4).");
+    }
+    if (symbol_width != 2 && pairing != SymbolPairing::Canonical && pairing != SymbolPairing::Auto) {
+        throw std::invalid_argument("Symbol pairings are only defined for 2-bit symbols.");
+    }
+
+    if (ranges == nullptr) {
+        byte_histogram(raw_data.data(), raw_data.size(), byte_hist);
+    }
+    else {
+        run_parallel(static_cast<unsigned>(ranges->size()), [&](unsigned t) {
+            SeparationRange& range = (*ranges)[t];
+            byte_histogram(raw_data.data() + range.begin, range.end - range.begin, range.byte_hist);
+        });
+        for (int byte = 0; byte < 256; ++byte) {
+            byte_hist[byte] = 0;
+            for (const SeparationRange& range : *ranges) byte_hist[byte] += range.byte_hist[byte];
+        }
+    }
+
+    if (symbol_width != 2) {
+        pairing = SymbolPairing::Canonical;
+    }
+    else if (pairing == SymbolPairing::Auto) {
+        uint64_t freqs[4];
+        symbol_freqs_from_histogram(byte_hist, freqs);
+        pairing = SeparationEngine::best_pairing(freqs);
+    }
+    const uint8_t* remap = nullptr;
+    if (pairing != SymbolPairing::Canonical) {
+        remap = pairing_byte_map(pairing, false);
+        uint64_t remapped_hist[256] = { 0 };
+        for (int byte = 0; byte < 256; ++byte) remapped_hist[remap[byte]] += byte_hist[byte];
+        for (int byte = 0; byte < 256; ++byte) byte_hist[byte] = remapped_hist[byte];
+    }
+    return remap;
+}
+
+template <unsigned Width>
+static void estimate_with_width(uint64_t n_bytes, const uint64_t byte_hist[256], std::optional<bool> forced_aux_mask_1_represents_11, SeparationEstimate& result) {
+    using L = SymbolLayout<Width>;
+    uint64_t n_all_zeros, n_all_ones, n_value_ones;
+    count_uniform_symbols<Width>(byte_hist, n_all_zeros, n_all_ones, n_value_ones);
+
+    result.aux_mask_1_represents_11 = forced_aux_mask_1_represents_11.value_or(n_all_ones <= n_all_zeros);
+    result.reconstructed_bits = n_bytes * L::symbols_per_byte;
+    result.auxiliary_mask_bits = n_all_zeros + n_all_ones;
+    result.auxiliary_mask_ones = result.aux_mask_1_represents_11 ? n_all_ones : n_all_zeros;
+    result.value_bitmap_bits = (result.reconstructed_bits - result.auxiliary_mask_bits) * L::value_bits_per_symbol;
+    result.value_bitmap_ones = n_value_ones;
+    estimate_stream_entropies(result);
+}
+
+SeparationEstimate SeparationEngine::estimate(const std::vector<uint8_t>& raw_data, std::optional<bool> forced_aux_mask_1_represents_11, unsigned symbol_width, SymbolPairing pairing) {
+    uint64_t byte_hist[256];
+    analyze_separation(raw_data, symbol_width, pairing, byte_hist);
+
+    SeparationEstimate result;
+    result.symbol_width = symbol_width;
+    result.pairing = pairing;
+    switch (symbol_width) {
+    case 1: estimate_with_width<1>(raw_data.size(), byte_hist, forced_aux_mask_1_represents_11, result); break;
+    case 2: estimate_with_width<2>(raw_data.size(), byte_hist, forced_aux_mask_1_represents_11, result); break;
+    default: estimate_with_width<4>(raw_data.size(), byte_hist, forced_aux_mask_1_represents_11, result); break;
+    }
+    return result;
+}
+
+template <unsigned Width>
+static void separate_with_width(const std::vector<uint8_t>& raw_data, const uint64_t byte_hist[256], const uint8_t* remap, std::optional<bool> forced_aux_mask_1_represents_11,
+                                const std::vector<SeparationRange>& ranges, SeparatedStreams& result) {
+    uint64_t n_all_zeros, n_all_ones, n_value_ones;
+    count_uniform_symbols<Width>(byte_hist, n_all_zeros, n_all_ones, n_value_ones);
+
+    // KO: 모두 0인 심볼과 모두 1인 심볼 중 더 드물게 나타나는 심볼을 결정합니다.
+    //     이 정보는 auxiliary_mask에서 '1'이 무엇을 의미하는지를 나타내는 메타데이터가 됩니다.
+    //     학습된 모델을 사용할 때는 모델의 극성을 그대로 따릅니다.
+    // EN: Determines which symbol is rarer between the all-zeros and the all-ones symbol.
+    //     This information becomes the metadata indicating what a '1' in the auxiliary_mask represents.
+    //     When a trained model is used, the model's polarity is followed as is.
+    result.aux_mask_1_represents_11 = forced_aux_mask_1_represents_11.value_or(n_all_ones <= n_all_zeros);
+    if (ranges.size() > 1) {
+        if (result.aux_mask_1_represents_11) separate_kernel_parallel<Width, true>(raw_data, remap, ranges, result);
+        else separate_kernel_parallel<Width, false>(raw_data, remap, ranges, result);
+    }
+    else {
+        if (result.aux_mask_1_represents_11) separate_kernel<Width, true>(raw_data, remap, n_all_zeros + n_all_ones, result);
+        else separate_kernel<Width, false>(raw_data, remap, n_all_zeros + n_all_ones, result);
+    }
+}
 
 // KO: 원본 데이터를 3개의 특화된 스트림으로 분리하는 함수입니다.
 // EN: A function that separates the original data into three specialized streams.
-SeparatedStreams SeparationEngine::separate(const std::vector<uint8_t>& raw_data) {
+SeparatedStreams SeparationEngine::separate(const std::vector<uint8_t>& raw_data, std::optional<bool> forced_aux_mask_1_represents_11, unsigned symbol_width, SymbolPairing pairing, unsigned threads) {
     // --- 단계 1: 사전 분석 (빈도수 계산) ---
     // --- Phase 1: Pre-analysis (Frequency Counting) ---
-    // KO: 원본 데이터를 2비트 심볼(00, 01, 10, 11) 단위로 보고 각 심볼의 등장 빈도를 계산합니다.
-    //     이 정보는 'auxiliary_mask'를 생성하는 데 사용됩니다.
-    // EN: Treats the original data as 2-bit symbols (00, 01, 10, 11) and counts the occurrence frequency of each symbol.
-    //     This information is used to generate the 'auxiliary_mask'.
-    size_t freqs[4] = { 0 };
-    for (uint8_t byte : raw_data) {
-        freqs[(byte >> 6) & 0x03]++; // 1st 2-bit symbol
-        freqs[(byte >> 4) & 0x03]++; // 2nd 2-bit symbol
-        freqs[(byte >> 2) & 0x03]++; // 3rd 2-bit symbol
-        freqs[(byte >> 0) & 0x03]++; // 4th 2-bit symbol
-    }
-
-    // --- 단계 2: 메타데이터 결정 ---
-    // --- Phase 2: Metadata Decision ---
-    SeparatedStreams result;
-    // KO: 00과 11 심볼 중 더 드물게 나타나는 심볼을 결정합니다.
-    //     이 정보는 auxiliary_mask에서 '1'이 무엇을 의미하는지를 나타내는 메타데이터가 됩니다.
-    // EN: Determines which symbol is rarer between '00' and '11'.
-    //     This information becomes the metadata indicating what a '1' in the auxiliary_mask represents.
-    result.aux_mask_1_represents_11 = (freqs[0b11] <= freqs[0b00]);
-
-    // --- 단계 3: 스트림 분리 ---
-    // --- Phase 3: Stream Separation ---
-    // KO: 메모리 재할당을 최소화하기 위해 각 스트림의 크기를 미리 예약합니다.
-    // EN: Reserves the capacity for each stream in advance to minimize memory reallocations.
-    result.value_bitmap.reserve(freqs[0b10] + freqs[0b01]);
-    result.reconstructed_stream.reserve(raw_data.size() * 4);
-    result.auxiliary_mask.reserve(freqs[0b00] + freqs[0b11]);
-
-    // KO: 다시 원본 데이터를 순회하며 각 2비트 심볼을 3개의 스트림으로 분해합니다.
-    // EN: Iterates through the original data again, deconstructing each 2-bit symbol into the three streams.
-    for (uint8_t byte : raw_data) {
-        uint8_t symbols[4] = {
-            static_cast<uint8_t>((byte >> 6) & 0x03),
-            static_cast<uint8_t>((byte >> 4) & 0x03),
-            static_cast<uint8_t>((byte >> 2) & 0x03),
-            static_cast<uint8_t>((byte >> 0) & 0x03)
-        };
-
-        for (uint8_t sym : symbols) {
-            switch (sym) {
-            case 0b10: // Symbol '10'
-                // KO: 값 정보(0)를 value_bitmap에 저장합니다.
-                // EN: Store the value information (0) in the value_bitmap.
-                result.value_bitmap.push_back(0);
-                // KO: '10'/'01' 심볼의 위치를 나타내는 마커(0)를 reconstructed_stream에 저장합니다.
-                // EN: Store a marker (0) in the reconstructed_stream to indicate the position of a '10'/'01' symbol.
-                result.reconstructed_stream.push_back(0);
-                break;
-            case 0b01: // Symbol '01'
-                // KO: 값 정보(1)를 value_bitmap에 저장합니다.
-                // EN: Store the value information (1) in the value_bitmap.
-                result.value_bitmap.push_back(1);
-                // KO: '10'/'01' 심볼의 위치를 나타내는 마커(0)를 reconstructed_stream에 저장합니다.
-                // EN: Store a marker (0) in the reconstructed_stream to indicate the position of a '10'/'01' symbol.
-                result.reconstructed_stream.push_back(0);
-                break;
-            case 0b00: // Symbol '00'
-                // KO: '00'/'11' 심볼의 위치를 나타내는 자리표시자(1)를 reconstructed_stream에 저장합니다.
-                // EN: Store a placeholder (1) in the reconstructed_stream to indicate the position of a '00'/'11' symbol.
-                result.reconstructed_stream.push_back(1);
-                // KO: '00'이 희소 심볼인지 아닌지에 따라 auxiliary_mask에 0 또는 1을 저장합니다.
-                // EN: Store 0 or 1 in the auxiliary_mask depending on whether '00' is the rare symbol.
-                result.auxiliary_mask.push_back(result.aux_mask_1_represents_11 ? 0 : 1);
-                break;
-            case 0b11: // Symbol '11'
-                // KO: '00'/'11' 심볼의 위치를 나타내는 자리표시자(1)를 reconstructed_stream에 저장합니다.
-                // EN: Store a placeholder (1) in the reconstructed_stream to indicate the position of a '00'/'11' symbol.
-                result.reconstructed_stream.push_back(1);
-                // KO: '11'이 희소 심볼인지 아닌지에 따라 auxiliary_mask에 0 또는 1을 저장합니다.
-                // EN: Store 0 or 1 in the auxiliary_mask depending on whether '11' is the rare symbol.
-                result.auxiliary_mask.push_back(result.aux_mask_1_represents_11 ? 1 : 0);
-                break;
-            }
-        }
+    // KO: 여러 스레드를 사용하면 데이터를 같은 크기의 연속 구간으로 나누고, 각 스레드가 자기 구간의 히스토그램을 만듭니다.
+    // EN: With several threads the data is cut into contiguous ranges of equal size, and every thread builds the histogram of its own range.
+    const unsigned n_threads = separation_thread_count(raw_data.size(), threads);
+    std::vector<SeparationRange> ranges(n_threads);
+    for (unsigned t = 0; t < n_threads; ++t) {
+        ranges[t].begin = raw_data.size() * t / n_threads;
+        ranges[t].end = raw_data.size() * (t + 1) / n_threads;
     }
+    uint64_t byte_hist[256];
+    const uint8_t* remap = analyze_separation(raw_data, symbol_width, pairing, byte_hist, (n_threads > 1) ? &ranges : nullptr);
 
+    // --- 단계 2: 메타데이터 결정 및 스트림 분리 ---
+    // --- Phase 2: Metadata Decision and Stream Separation ---
+    // KO: 다시 원본 데이터를 순회하며, 바이트마다 조회 테이블에서 각 스트림에 덧붙일 비트 묶음을 가져옵니다.
+    //     - 혼합 심볼: value_bitmap에 값 정보, reconstructed_stream에 마커(0)
+    //     - 균일 심볼: reconstructed_stream에 자리표시자(1), auxiliary_mask에 희소 심볼 여부(0/1)
+    // EN: Iterates through the original data again, fetching from the lookup table the bit groups to append to each stream for every byte.
+    //     - Mixed symbols: value information into the value_bitmap, a marker (0) into the reconstructed_stream
+    //     - Uniform symbols: a placeholder (1) into the reconstructed_stream, whether it is the rare symbol (0/1) into the auxiliary_mask
+    SeparatedStreams result;
+    result.symbol_width = symbol_width;
+    result.pairing = pairing;
+    switch (symbol_width) {
+    case 1: separate_with_width<1>(raw_data, byte_hist, nullptr, forced_aux_mask_1_represents_11, ranges, result); break;
+    case 2: separate_with_width<2>(raw_data, byte_hist, remap, forced_aux_mask_1_represents_11, ranges, result); break;
+    default: separate_with_width<4>(raw_data, byte_hist, nullptr, forced_aux_mask_1_represents_11, ranges, result); break;
+    }
     return result;
 }
 
+// KO: 분리 통계를 바탕으로 데이터를 청크 단위로 역순 분리하여 수신자에 넘깁니다.
+// EN: Separates the data chunk by chunk in reverse according to the separation statistics and hands the chunks to the sinks.
+void SeparationEngine::separate_reverse(const std::vector<uint8_t>& raw_data, const SeparationEstimate& plan,
+                                        PackedBitSink& reconstructed_stream, PackedBitSink& value_bitmap, PackedBitSink& auxiliary_mask, size_t chunk_bytes) {
+    if (!is_supported_width(plan.symbol_width)) {
+        throw std::invalid_argument("Unsupported symbol width (must be 1, 2 or 4).");
+    }
+    if (plan.pairing == SymbolPairing::Auto || (plan.symbol_width != 2 && plan.pairing != SymbolPairing::Canonical)) {
+        throw std::invalid_argument("The separation plan needs a settled symbol pairing.");
+    }
+    if (chunk_bytes == 0) {
+        throw std::invalid_argument("The separation chunk size must not be zero.");
+    }
+    const uint8_t* remap = (plan.pairing != SymbolPairing::Canonical) ? pairing_byte_map(plan.pairing, false) : nullptr;
+    const bool rep11 = plan.aux_mask_1_represents_11;
+    switch (plan.symbol_width) {
+    case 1:
+        if (rep11) separate_reverse_kernel<1, true>(raw_data, nullptr, chunk_bytes, reconstructed_stream, value_bitmap, auxiliary_mask);
+        else separate_reverse_kernel<1, false>(raw_data, nullptr, chunk_bytes, reconstructed_stream, value_bitmap, auxiliary_mask);
+        break;
+    case 2:
+        if (rep11) separate_reverse_kernel<2, true>(raw_data, remap, chunk_bytes, reconstructed_stream, value_bitmap, auxiliary_mask);
+        else separate_reverse_kernel<2, false>(raw_data, remap, chunk_bytes, reconstructed_stream, value_bitmap, auxiliary_mask);
+        break;
+    default:
+        if (rep11) separate_reverse_kernel<4, true>(raw_data, nullptr, chunk_bytes, reconstructed_stream, value_bitmap, auxiliary_mask);
+        else separate_reverse_kernel<4, false>(raw_data, nullptr, chunk_bytes, reconstructed_stream, value_bitmap, auxiliary_mask);
+        break;
+    }
+}
+
+// KO: 재조립 커널입니다. 재구성 스트림에서 심볼 8/Width개의 비트를 읽고, 마커 수만큼 value_bitmap 비트를,
+//     자리표시자 수만큼 auxiliary_mask 비트를 읽은 뒤, 조회 테이블로 원본 바이트를 바로 만듭니다.
+//     inverse_remap이 주어지면 병합 테이블의 결과에 미리 합성합니다. (2비트 심볼의 병합 테이블은 256바이트뿐입니다.)
+//     판독기(Reader)는 PackedBitReader(만들어진 스트림) 또는 BufferedBitReader(융합 파이프라인의 공급원)입니다.
+// EN: The reassembly kernel. Reads the bits of 8/Width symbols from the reconstructed stream, then as many value_bitmap bits as
+//     the markers need and as many auxiliary_mask bits as there are placeholders, and builds the original byte directly via the lookup table.
+//     If `inverse_remap` is given it is composed onto the results of the merge table beforehand. (The merge table of 2-bit symbols is only 256 bytes.)
+//     The Reader is a PackedBitReader (materialized streams) or a BufferedBitReader (the sources of the fused pipeline).
+template <unsigned Width, bool Rep11, typename Reader>
+static void reconstruct_kernel(Reader& value_reader, Reader& mask_reader, Reader& recon_reader, const uint8_t* inverse_remap, std::vector<uint8_t>& final_bytes) {
+    using L = SymbolLayout<Width>;
+    const uint8_t* merge_table = byte_merge_table<Width, Rep11>();
+    std::vector<uint8_t> remapped_table;
+    if (inverse_remap != nullptr) {
+        remapped_table.resize(size_t(1) << (L::symbols_per_byte + L::max_payload_bits));
+        for (size_t i = 0; i < remapped_table.size(); ++i) remapped_table[i] = inverse_remap[merge_table[i]];
+        merge_table = remapped_table.data();
+    }
+    for (size_t i = 0; i < final_bytes.size(); ++i) {
+        const unsigned recon = static_cast<unsigned>(recon_reader.get_bits(L::symbols_per_byte));
+        const unsigned n_mask = static_cast<unsigned>(std::popcount(recon));
+        const unsigned value_bits = static_cast<unsigned>(value_reader.get_bits((L::symbols_per_byte - n_mask) * L::value_bits_per_symbol));
+        const unsigned mask_bits = static_cast<unsigned>(mask_reader.get_bits(n_mask));
+        final_bytes[i] = merge_table[(static_cast<size_t>(recon) << L::max_payload_bits) | (value_bits << n_mask) | mask_bits];
+    }
+}
+
+template <typename Reader>
+static void reconstruct_with_width(unsigned symbol_width, Reader& value_reader, Reader& mask_reader, Reader& recon_reader, bool aux_mask_1_represents_11, const uint8_t* inverse_remap, std::vector<uint8_t>& final_bytes) {
+    switch (symbol_width) {
+    case 1:
+        if (aux_mask_1_represents_11) reconstruct_kernel<1, true>(value_reader, mask_reader, recon_reader, nullptr, final_bytes);
+        else reconstruct_kernel<1, false>(value_reader, mask_reader, recon_reader, nullptr, final_bytes);
+        break;
+    case 2:
+        if (aux_mask_1_represents_11) reconstruct_kernel<2, true>(value_reader, mask_reader, recon_reader, inverse_remap, final_bytes);
+        else reconstruct_kernel<2, false>(value_reader, mask_reader, recon_reader, inverse_remap, final_bytes);
+        break;
+    default:
+        if (aux_mask_1_represents_11) reconstruct_kernel<4, true>(value_reader, mask_reader, recon_reader, nullptr, final_bytes);
+        else reconstruct_kernel<4, false>(value_reader, mask_reader, recon_reader, nullptr, final_bytes);
+        break;
+    }
+}
 
 // KO: 분리된 3개의 스트림을 원본 데이터로 재조립(복원)하는 함수입니다.
 // EN: A function that reassembles (reconstructs) the original data from the three separated streams.
 std::vector<uint8_t> SeparationEngine::reconstruct(
-    const std::vector<uint8_t>& value_bitmap,
-    const std::vector<uint8_t>& auxiliary_mask,
-    const std::vector<uint8_t>& reconstructed_stream,
+    const PackedBits& value_bitmap,
+    const PackedBits& auxiliary_mask,
+    const PackedBits& reconstructed_stream,
     bool aux_mask_1_represents_11,
-    uint64_t original_size)
+    uint64_t original_size,
+    unsigned symbol_width,
+    SymbolPairing pairing)
 {
-    // KO: 복원된 2비트 심볼들을 임시로 저장할 벡터입니다.
-    // EN: A vector to temporarily store the reconstructed 2-bit symbols.
-    std::vector<uint8_t> two_bit_chunks;
-    two_bit_chunks.reserve(reconstructed_stream.size());
-
-    // KO: 각 스트림을 순회하기 위한 인덱스 변수들입니다.
-    // EN: Index variables for iterating through each stream.
-    size_t bitmap_idx = 0;
-    size_t mask_idx = 0;
-
-    // KO: 메타데이터 플래그를 기반으로 auxiliary_mask의 0과 1이 어떤 심볼을 나타내는지 결정합니다.
-    // EN: Determines which symbol a 0 or 1 in the auxiliary_mask represents, based on the metadata flag.
-    uint8_t symbol_for_mask_0, symbol_for_mask_1;
-    if (aux_mask_1_represents_11) {
-        symbol_for_mask_0 = 0b00;
-        symbol_for_mask_1 = 0b11;
+    if (!is_supported_width(symbol_width)) {
+        std::cerr << "Warning: unsupported symbol width " << symbol_width << "." << std::endl;
+        return {};
     }
-    else {
-        symbol_for_mask_0 = 0b11;
-        symbol_for_mask_1 = 0b00;
-    }
-
-    // KO: 재구성 스트림(reconstructed_stream)을 순회하며 원본 2비트 심볼을 복원합니다.
-    // EN: Iterates through the reconstructed_stream to restore the original 2-bit symbols.
-    for (size_t i = 0; i < reconstructed_stream.size(); ++i) {
-        uint8_t symbol_type = reconstructed_stream[i];
-        if (symbol_type == 0) { // KO: 마커(Marker)인 경우, '01' 또는 '10' 심볼을 의미합니다.
-            // EN: If it's a marker, it signifies a '01' or '10' symbol.
-            if (bitmap_idx < value_bitmap.size()) {
-                uint8_t bit = value_bitmap[bitmap_idx++];
-                two_bit_chunks.push_back(bit == 0 ? 0b10 : 0b01);
-            }
-            else {
-                // KO: 데이터 손상을 의미. 경고를 출력하고 중단합니다.
-                // EN: Indicates data corruption. Print a warning and break.
-                std::cerr << "Warning: value_bitmap index out of bounds." << std::endl;
-                break;
-            }
-        }
-        else { // KO: 자리표시자(Placeholder)인 경우, '00' 또는 '11' 심볼을 의미합니다.
-            // EN: If it's a placeholder, it signifies a '00' or '11' symbol.
-            if (mask_idx < auxiliary_mask.size()) {
-                uint8_t bit = auxiliary_mask[mask_idx++];
-                two_bit_chunks.push_back(bit == 0 ? symbol_for_mask_0 : symbol_for_mask_1);
-            }
-            else {
-                // KO: 데이터 손상을 의미. 경고를 출력하고 중단합니다.
-                // EN: Indicates data corruption. Print a warning and break.
-                std::cerr << "Warning: auxiliary_mask index out of bounds." << std::endl;
-                break;
-            }
-        }
+    if (pairing == SymbolPairing::Auto || (symbol_width != 2 && pairing != SymbolPairing::Canonical)) {
+        std::cerr << "Warning: invalid symbol pairing for symbol width " << symbol_width << "." << std::endl;
+        return {};
     }
+    const uint8_t* inverse_remap = (pairing != SymbolPairing::Canonical) ? pairing_byte_map(pairing, true) : nullptr;
 
-    // --- 최종 조립 ---
-    // --- Final Assembly ---
-    // KO: 복원된 2비트 청크(심볼)들을 4개씩 묶어 다시 1바이트로 합칩니다.
-    // EN: Groups the reconstructed 2-bit chunks (symbols) by four and combines them back into 1-byte values.
-    std::vector<uint8_t> final_bytes;
-    final_bytes.reserve(two_bit_chunks.size() / 4 + 1);
-    for (size_t i = 0; i < two_bit_chunks.size(); i += 4) {
-        uint8_t byte = 0;
-        if (i + 0 < two_bit_chunks.size()) byte |= (two_bit_chunks[i + 0] << 6);
-        if (i + 1 < two_bit_chunks.size()) byte |= (two_bit_chunks[i + 1] << 4);
-        if (i + 2 < two_bit_chunks.size()) byte |= (two_bit_chunks[i + 2] << 2);
-        if (i + 3 < two_bit_chunks.size()) byte |= (two_bit_chunks[i + 3] << 0);
-        final_bytes.push_back(byte);
+    // KO: 재구성 스트림의 마커(0) 수에 심볼당 값 비트 수를 곱한 값은 value_bitmap의 길이와, 자리표시자(1) 수는 auxiliary_mask의 길이와
+    //     같아야 합니다. 루프 전에 popcount로 한 번에 검증하므로, 루프 안에서는 심볼마다 범위 검사를 하지 않아도 됩니다.
+    // EN: The number of markers (0) in the reconstructed stream times the value bits per symbol must equal the length of the
+    //     value_bitmap, and the number of placeholders (1) the length of the auxiliary_mask. This is validated once with popcount
+    //     before the loop, so the loop itself needs no per-symbol bounds checks.
+    const uint64_t n_placeholders = reconstructed_stream.count_ones();
+    if (reconstructed_stream.size() % symbols_per_byte(symbol_width) != 0 ||
+        n_placeholders != auxiliary_mask.size() ||
+        (reconstructed_stream.size() - n_placeholders) * value_bits_per_symbol(symbol_width) != value_bitmap.size()) {
+        // KO: 데이터 손상을 의미. 경고를 출력하고 중단합니다.
+        // EN: Indicates data corruption. Print a warning and stop.
+        std::cerr << "Warning: stream sizes do not match the reconstructed_stream." << std::endl;
+        return {};
     }
 
+    std::vector<uint8_t> final_bytes(static_cast<size_t>(reconstructed_stream.size() / symbols_per_byte(symbol_width)));
+    PackedBitReader recon_reader(reconstructed_stream);
+    PackedBitReader value_reader(value_bitmap);
+    PackedBitReader mask_reader(auxiliary_mask);
+    reconstruct_with_width(symbol_width, value_reader, mask_reader, recon_reader, aux_mask_1_represents_11, inverse_remap, final_bytes);
+
     // KO: (선택적) 최종 복원된 크기가 헤더에 기록된 원본 크기와 일치하는지 확인합니다.
     // EN: (Optional) Verifies if the final reconstructed size matches the original size recorded in the header.
     if (final_bytes.size() != original_size) {
@@ -181,4 +688,47 @@ std::vector<uint8_t> SeparationEngine::reconstruct(
     }
 
     return final_bytes;
-}
\ No newline at end of file
+}
+
+// KO: 세 공급원에서 비트를 필요한 만큼씩 받아 원본 데이터를 재조립합니다. 스트림 길이는 미리 검증할 수 없으므로,
+//     재조립이 끝난 뒤 각 판독기가 읽은 비트 수가 스트림 길이와 정확히 같은지 확인합니다.
+// EN: Reassembles the original data, taking bits from the three sources as they are needed. The stream lengths cannot be
+//     validated beforehand, so after the reassembly every reader must have consumed exactly the length of its stream.
+std::vector<uint8_t> SeparationEngine::reconstruct(
+    PackedBitSource& value_bitmap,
+    PackedBitSource& auxiliary_mask,
+    PackedBitSource& reconstructed_stream,
+    bool aux_mask_1_represents_11,
+    uint64_t original_size,
+    unsigned symbol_width,
+    SymbolPairing pairing)
+{
+    if (!is_supported_width(symbol_width)) {
+        std::cerr << "Warning: unsupported symbol width " << symbol_width << "." << std::endl;
+        return {};
+    }
+    if (pairing == SymbolPairing::Auto || (symbol_width != 2 && pairing != SymbolPairing::Canonical)) {
+        std::cerr << "Warning: invalid symbol pairing for symbol width " << symbol_width << "." << std::endl;
+        return {};
+    }
+    if (reconstructed_stream.size() % symbols_per_byte(symbol_width) != 0 ||
+        reconstructed_stream.size() / symbols_per_byte(symbol_width) != original_size) {
+        std::cerr << "Warning: stream sizes do not match the reconstructed_stream." << std::endl;
+        return {};
+    }
+    const uint8_t* inverse_remap = (pairing != SymbolPairing::Canonical) ? pairing_byte_map(pairing, true) : nullptr;
+
+    std::vector<uint8_t> final_bytes(static_cast<size_t>(original_size));
+    BufferedBitReader recon_reader(reconstructed_stream);
+    BufferedBitReader value_reader(value_bitmap);
+    BufferedBitReader mask_reader(auxiliary_mask);
+    reconstruct_with_width(symbol_width, value_reader, mask_reader, recon_reader, aux_mask_1_represents_11, inverse_remap, final_bytes);
+
+    if (value_reader.position() != value_bitmap.size() || mask_reader.position() != auxiliary_mask.size()) {
+        // KO: 데이터 손상을 의미. 경고를 출력하고 중단합니다.
+        // EN: Indicates data corruption. Print a warning and stop.
+        std::cerr << "Warning: stream sizes do not match the reconstructed_stream." << std::endl;
+        return {};
+    }
+    return final_bytes;
+}
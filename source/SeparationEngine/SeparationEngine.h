@@ -4,30 +4,83 @@
 // EN: Prevents the header file from being included multiple times.
 #include <vector>
 #include <cstdint>
+#include <optional>
+#include "../PackedBits/PackedBits.h"
+
+// KO: 네 가지 2비트 심볼을 두 쌍으로 나누는 방법(짝짓기)입니다. 한 쌍은 value_bitmap으로, 다른 쌍은 auxiliary_mask로 갑니다.
+//     - Canonical: {01, 10} / {00, 11} (기본값)
+//     - Pair00_01: {00, 01} / {10, 11}
+//     - Pair00_10: {00, 10} / {01, 11}
+//     - Auto: 블록마다 심볼 빈도로 부호화 크기를 추정하여 가장 작은 짝짓기를 고릅니다. (separate 전용)
+// EN: How the four 2-bit symbols are split into two pairs (the pairing). One pair goes to the value_bitmap, the other to the auxiliary_mask.
+//     - Canonical: {01, 10} / {00, 11} (default)
+//     - Pair00_01: {00, 01} / {10, 11}
+//     - Pair00_10: {00, 10} / {01, 11}
+//     - Auto: Picks the pairing with the smallest estimated coded size from the symbol frequencies of every block. (separate only)
+enum class SymbolPairing : uint8_t {
+    Canonical = 0,
+    Pair00_01 = 1,
+    Pair00_10 = 2,
+    Auto = 0xFF
+};
 
 // KO: SeparationEngine이 원본 데이터를 분리한 후 3개의 스트림을 담는 구조체입니다.
-//     각 스트림은 0 또는 1의 값만 가지는 단순한 형태로 변환됩니다.
+//     각 스트림은 0 또는 1의 값만 가지는 단순한 형태로 변환되며, uint64_t 워드에 촘촘하게 담긴 PackedBits로 저장됩니다.
+//     아래 설명은 기본 심볼 폭인 2비트 기준이며, 다른 폭에서는 '00'/'11'이 모두 0/모두 1인 균일 심볼을, '01'/'10'이 나머지 혼합 심볼을 뜻합니다.
 // EN: A struct that holds the three streams after the SeparationEngine separates the original data.
-//     Each stream is converted into a simple form containing only values of 0 or 1.
+//     Each stream is converted into a simple form containing only values of 0 or 1, stored as PackedBits packed densely into uint64_t words.
+//     The descriptions below use the default 2-bit symbol width; for other widths '00'/'11' stand for the all-zeros/all-ones
+//     uniform symbols and '01'/'10' for the remaining mixed symbols.
 struct SeparatedStreams {
     // KO: '01', '10' 심볼의 값 정보(각각 1, 0)를 저장합니다. 순수한 정보 스트림입니다.
     // EN: Stores the value information of '01' and '10' symbols (1 and 0, respectively). This is a pure information stream.
-    std::vector<uint8_t> value_bitmap;
+    PackedBits value_bitmap;
 
     // KO: 원본 심볼의 구조적 정보를 담습니다. '00'/'11'의 위치는 한 종류의 값으로, '01'/'10'의 위치는 다른 종류의 값으로 표시됩니다.
     // EN: Contains the structural information of the original symbols. The positions of '00'/'11' are marked with one value, 
     //     and the positions of '01'/'10' are marked with another.
-    std::vector<uint8_t> reconstructed_stream;
+    PackedBits reconstructed_stream;
 
     // KO: '00'과 '11' 중 더 드물게 나타나는 심볼의 위치만 1로 표시하는 희소 비트 마스크입니다. 예외적 정보 스트림입니다.
     // EN: A sparse bitmask that marks the positions of the rarer symbol between '00' and '11' with a 1. This is an exceptional information stream.
-    std::vector<uint8_t> auxiliary_mask;
+    PackedBits auxiliary_mask;
 
     // KO: 보조 마스크(auxiliary_mask)의 '1'이 '11' 심볼을 의미하는지 여부를 저장하는 메타데이터 플래그입니다.
     //     false일 경우 '1'은 '00'을 의미합니다.
     // EN: A metadata flag that stores whether a '1' in the auxiliary_mask represents the '11' symbol.
     //     If false, a '1' represents '00'.
     bool aux_mask_1_represents_11 = false;
+
+    // KO: 분리에 사용된 심볼 폭(비트). 1, 2, 4 중 하나입니다.
+    // EN: The symbol width (in bits) used for the separation. One of 1, 2 and 4.
+    unsigned symbol_width = 2;
+
+    // KO: 분리에 사용된 심볼 짝짓기. (2비트 심볼 전용, Auto는 실제로 선택된 짝짓기로 바뀌어 기록됩니다.)
+    // EN: The symbol pairing used for the separation. (2-bit symbols only; Auto is replaced by the pairing actually chosen.)
+    SymbolPairing pairing = SymbolPairing::Canonical;
+};
+
+// KO: 분리를 실제로 수행하지 않고 바이트 히스토그램만으로 계산한 분리 결과의 통계와, 세 스트림의 0차 엔트로피(비트)입니다.
+//     엔트로피는 rANS_Coder가 각 스트림을 부호화하는 방식(재구성 스트림은 심볼마다 접두 비트를 붙인 2배 길이 스트림)을 따릅니다.
+// EN: The statistics of a separation computed from the byte histogram alone, without performing it, and the order-0
+//     entropies (in bits) of the three streams. The entropies follow how the rANS_Coder codes every stream
+//     (the reconstructed stream as a stream of twice the length, with a prefix bit per symbol).
+struct SeparationEstimate {
+    unsigned symbol_width = 2;
+    SymbolPairing pairing = SymbolPairing::Canonical;
+    bool aux_mask_1_represents_11 = false;
+
+    uint64_t reconstructed_bits = 0;  // KO: 심볼 수 / EN: The symbol count
+    uint64_t value_bitmap_bits = 0;
+    uint64_t value_bitmap_ones = 0;
+    uint64_t auxiliary_mask_bits = 0; // KO: 자리표시자 수 / EN: The placeholder count
+    uint64_t auxiliary_mask_ones = 0;
+
+    double reconstructed_entropy_bits = 0.0;
+    double value_bitmap_entropy_bits = 0.0;
+    double auxiliary_mask_entropy_bits = 0.0;
+
+    double total_entropy_bits() const { return reconstructed_entropy_bits + value_bitmap_entropy_bits + auxiliary_mask_entropy_bits; }
 };
 
 // KO: TriSplit 압축기의 핵심 로직 중 하나로, 원본 데이터를 통계적 특성이 다른 3개의 스트림으로 분리하고,
@@ -36,13 +89,68 @@ struct SeparatedStreams {
 //     three streams with different statistical properties, and reassembling them back into the original data.
 class SeparationEngine {
 public:
+    // KO: 원본 데이터를 2비트 심볼 단위로 보고 각 심볼(00, 01, 10, 11)의 등장 빈도를 계산합니다.
+    // @param data - 분석할 원본 데이터.
+    // @param freqs - 심볼 값으로 색인되는 4개의 빈도가 기록될 배열.
+    // EN: Treats the data as 2-bit symbols and counts the occurrence frequency of each symbol (00, 01, 10, 11).
+    // @param data - The original data to be analyzed.
+    // @param freqs - An array receiving the four frequencies, indexed by symbol value.
+    static void count_symbols(const std::vector<uint8_t>& data, uint64_t freqs[4]);
+
+    // KO: 지원되는 심볼 폭(1, 2, 4비트)인지 확인합니다.
+    // EN: Checks whether the symbol width is supported (1, 2 or 4 bits).
+    static bool is_supported_width(unsigned symbol_width);
+
+    // KO: 주어진 심볼 폭에서 바이트당 심볼 수 (= 바이트당 reconstructed_stream 비트 수)를 반환합니다.
+    // EN: Returns the number of symbols per byte (= reconstructed_stream bits per byte) for the given symbol width.
+    static unsigned symbols_per_byte(unsigned symbol_width);
+
+    // KO: 주어진 심볼 폭에서 혼합 심볼 하나가 value_bitmap에 남기는 비트 수를 반환합니다.
+    // EN: Returns the number of value_bitmap bits one mixed symbol leaves for the given symbol width.
+    static unsigned value_bits_per_symbol(unsigned symbol_width);
+
+    // KO: 2비트 심볼 빈도로부터 세 짝짓기의 부호화 크기를 추정하여 가장 작은 짝짓기를 반환합니다.
+    // EN: Estimates the coded size of the three pairings from the 2-bit symbol frequencies and returns the smallest one.
+    static SymbolPairing best_pairing(const uint64_t freqs[4]);
+
+    // KO: 'separate'와 같은 인자로 분리 결과의 통계와 스트림별 엔트로피를 추정합니다.
+    //     바이트 히스토그램 한 번만 만들고 스트림은 만들지 않으므로, 압축 전에 블록의 압축률을 빠르게 예측하는 데 사용합니다.
+    // @return 'separate'가 만들 스트림의 크기, 1의 개수, 엔트로피를 담은 SeparationEstimate 구조체.
+    // EN: Estimates the statistics of the separation and the entropy of every stream, taking the same arguments as 'separate'.
+    //     Only a byte histogram is built and no stream is produced, so it quickly predicts how well a block will compress.
+    // @return A SeparationEstimate holding the sizes, one counts and entropies of the streams 'separate' would produce.
+    SeparationEstimate estimate(const std::vector<uint8_t>& data, std::optional<bool> forced_aux_mask_1_represents_11 = std::nullopt, unsigned symbol_width = 2, SymbolPairing pairing = SymbolPairing::Canonical);
+
     // KO: 원본 바이트 스트림을 입력받아 3개의 특화된 스트림으로 분리합니다.
     // @param data - 분리할 원본 데이터.
+    // @param forced_aux_mask_1_represents_11 - 값이 있으면 빈도로 결정하는 대신 이 극성을 사용합니다. (학습된 모델용)
+    // @param symbol_width - 심볼 폭 (1, 2, 4비트). 폭과 극성의 조합마다 분기 없는 전용 커널이 사용됩니다.
+    // @param pairing - 심볼 짝짓기 (2비트 심볼 전용).
+    // @param threads - 분리에 사용할 최대 스레드 수 (0이면 하드웨어 스레드 수). 큰 블록은 구간으로 나누어 동시에 분리하며, 결과는 스레드 수와 관계없이 같습니다.
     // @return 분리된 스트림들을 담고 있는 SeparatedStreams 구조체.
     // EN: Takes the original byte stream as input and separates it into three specialized streams.
     // @param data - The original data to be separated.
+    // @param forced_aux_mask_1_represents_11 - If set, this polarity is used instead of deciding it from the frequencies. (For trained models)
+    // @param symbol_width - The symbol width (1, 2 or 4 bits). Every combination of width and polarity uses its own branch-free kernel.
+    // @param pairing - The symbol pairing (2-bit symbols only).
+    // @param threads - The most threads the separation may use (0 for the hardware thread count). A large block is cut into ranges
+    //                  that are separated concurrently, and the result is the same whatever the thread count.
     // @return A SeparatedStreams struct containing the separated streams.
-    SeparatedStreams separate(const std::vector<uint8_t>& data);
+    SeparatedStreams separate(const std::vector<uint8_t>& data, std::optional<bool> forced_aux_mask_1_represents_11 = std::nullopt, unsigned symbol_width = 2, SymbolPairing pairing = SymbolPairing::Canonical, unsigned threads = 1);
+
+    // KO: 융합 부호화 파이프라인에서 역순 분리가 한 번에 처리하는 원본 바이트 수입니다. 청크의 세 스트림이 L2 캐시에 들어갑니다.
+    // EN: The number of original bytes the reverse separation handles at a time in the fused encoding pipeline. The three streams of a chunk fit in the L2 cache.
+    static constexpr size_t SEPARATION_CHUNK_BYTES = 16 * 1024;
+
+    // KO: 'separate'와 같은 스트림을 만들지 않고, 데이터를 청크 단위로 마지막 청크부터 분리하여 각 청크의 스트림을 수신자에 넘깁니다.
+    //     (rANS는 역순으로 부호화하므로, 수신자가 청크를 받는 즉시 부호화할 수 있습니다.)
+    // @param plan - 'estimate'가 반환한 분리 통계. 심볼 폭, 짝짓기, 극성을 이 값에서 가져옵니다.
+    // EN: Instead of producing the streams of 'separate', separates the data chunk by chunk starting from the last chunk and hands the
+    //     streams of every chunk to the sinks. (rANS codes in reverse, so the sinks can code every chunk as soon as it arrives.)
+    // @param plan - The separation statistics returned by 'estimate'. The symbol width, pairing and polarity are taken from it.
+    void separate_reverse(const std::vector<uint8_t>& data, const SeparationEstimate& plan,
+                          PackedBitSink& reconstructed_stream, PackedBitSink& value_bitmap, PackedBitSink& auxiliary_mask,
+                          size_t chunk_bytes = SEPARATION_CHUNK_BYTES);
 
     // KO: 분리된 3개의 스트림과 메타데이터를 이용해 원본 데이터를 재조립(복원)합니다.
     // @param value_bitmap - 값 비트맵 스트림.
@@ -50,6 +158,8 @@ public:
     // @param reconstructed_stream - 재구성된 스트림.
     // @param aux_mask_1_represents_11 - 보조 마스크의 '1'이 '11'을 의미하는지에 대한 플래그.
     // @param original_size - 원본 데이터의 크기 (바이트 단위). 복원 후 데이터 검증에 사용됩니다.
+    // @param symbol_width - 분리에 사용된 심볼 폭.
+    // @param pairing - 분리에 사용된 심볼 짝짓기.
     // @return 재조립된 원본 데이터.
     // EN: Reassembles (reconstructs) the original data from the three separated streams and metadata.
     // @param value_bitmap - The value bitmap stream.
@@ -57,12 +167,31 @@ public:
     // @param reconstructed_stream - The reconstructed stream.
     // @param aux_mask_1_represents_11 - Flag indicating whether '1' in the aux mask represents '11'.
     // @param original_size - The size of the original data in bytes. Used for data verification after reconstruction.
+    // @param symbol_width - The symbol width used for the separation.
+    // @param pairing - The symbol pairing used for the separation.
     // @return The reassembled original data.
     std::vector<uint8_t> reconstruct(
-        const std::vector<uint8_t>& value_bitmap,
-        const std::vector<uint8_t>& auxiliary_mask,
-        const std::vector<uint8_t>& reconstructed_stream,
+        const PackedBits& value_bitmap,
+        const PackedBits& auxiliary_mask,
+        const PackedBits& reconstructed_stream,
         bool aux_mask_1_represents_11,
-        uint64_t original_size
+        uint64_t original_size,
+        unsigned symbol_width = 2,
+        SymbolPairing pairing = SymbolPairing::Canonical
     );
-};
\ No newline at end of file
+
+    // KO: 세 스트림을 공급원에서 필요한 만큼씩 받아 원본 데이터를 재조립합니다. (융합 복호화 파이프라인)
+    //     중간 스트림을 만들지 않으므로, 압축 데이터에서 바로 원본 바이트가 만들어집니다. 스트림 길이가 맞지 않으면 빈 벡터를 반환합니다.
+    // EN: Reassembles the original data, taking the three streams from sources as they are needed. (The fused decoding pipeline)
+    //     No intermediate stream is materialized, so the original bytes are produced straight from the compressed data.
+    //     An empty vector is returned if the stream lengths do not match.
+    std::vector<uint8_t> reconstruct(
+        PackedBitSource& value_bitmap,
+        PackedBitSource& auxiliary_mask,
+        PackedBitSource& reconstructed_stream,
+        bool aux_mask_1_represents_11,
+        uint64_t original_size,
+        unsigned symbol_width = 2,
+        SymbolPairing pairing = SymbolPairing::Canonical
+    );
+};
@@ -0,0 +1,132 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 학습된 모델(TrainedModel)의 학습, 저장, 읽기를 구현합니다.
+// EN: This file implements training, saving and loading of trained models (TrainedModel).
+#include "TrainedModel.h"
+#include "../SeparationEngine/SeparationEngine.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+// KO: 모델 파일의 형식: ["TSPM"][uint8 버전][uint8 플래그][uint16 예약][uint32 model_id]
+//                       [uint32 prob0 x 3 (bitmap, mask, reconstructed)][uint64 학습 바이트 수]
+// EN: Model file format: ["TSPM"][uint8 version][uint8 flags][uint16 reserved][uint32 model_id]
+//                        [uint32 prob0 x 3 (bitmap, mask, reconstructed)][uint64 trained bytes]
+static const char MODEL_MAGIC[4] = { 'T', 'S', 'P', 'M' };
+constexpr uint8_t MODEL_VERSION = 1;
+constexpr size_t MODEL_FILE_SIZE = 4 + 1 + 1 + 2 + 4 + 3 * 4 + 8;
+
+// KO: 0의 개수와 전체 개수로부터 (0, 1) 구간으로 제한된 0.24 고정소수점 확률을 계산합니다.
+// EN: Computes a 0.24 fixed-point probability, kept inside (0, 1), from the number of zeros and the total count.
+static uint32_t quantize_prob0(uint64_t zeros, uint64_t total) {
+    constexpr uint64_t one = 1ull << TrainedModel::PROB_BITS;
+    if (total == 0) return static_cast<uint32_t>(one / 2);
+    uint64_t prob = static_cast<uint64_t>((static_cast<long double>(zeros) / total) * one + 0.5L);
+    if (prob < 1) prob = 1;
+    if (prob > one - 1) prob = one - 1;
+    return static_cast<uint32_t>(prob);
+}
+
+uint32_t TrainedModel::compute_id() const {
+    uint8_t content[1 + 3 * 4];
+    content[0] = aux_mask_1_represents_11 ? 1 : 0;
+    memcpy(content + 1, &prob0_bitmap, 4);
+    memcpy(content + 5, &prob0_mask, 4);
+    memcpy(content + 9, &prob0_reconstructed, 4);
+
+    // KO: FNV-1a (32비트). 0은 '모델 없음'을 뜻하므로 사용하지 않습니다.
+    // EN: FNV-1a (32-bit). 0 means 'no model', so it is never used.
+    uint32_t hash = 2166136261u;
+    for (uint8_t byte : content) {
+        hash ^= byte;
+        hash *= 16777619u;
+    }
+    return (hash == 0) ? 1 : hash;
+}
+
+bool TrainedModel::save(const std::filesystem::path& path) const {
+    uint8_t buffer[MODEL_FILE_SIZE] = { 0 };
+    memcpy(buffer, MODEL_MAGIC, 4);
+    buffer[4] = MODEL_VERSION;
+    buffer[5] = aux_mask_1_represents_11 ? 1 : 0;
+    memcpy(buffer + 8, &model_id, 4);
+    memcpy(buffer + 12, &prob0_bitmap, 4);
+    memcpy(buffer + 16, &prob0_mask, 4);
+    memcpy(buffer + 20, &prob0_reconstructed, 4);
+    memcpy(buffer + 24, &trained_bytes, 8);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open() || !file.write(reinterpret_cast<const char*>(buffer), sizeof(buffer))) {
+        std::cerr << "Error: Cannot write model file '" << path.string() << "'." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TrainedModel::load(const std::filesystem::path& path) {
+    uint8_t buffer[MODEL_FILE_SIZE];
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open() || !file.read(reinterpret_cast<char*>(buffer), sizeof(buffer))) {
+        std::cerr << "Error: Cannot read model file '" << path.string() << "'." << std::endl;
+        return false;
+    }
+    if (memcmp(buffer, MODEL_MAGIC, 4) != 0 || buffer[4] != MODEL_VERSION) {
+        std::cerr << "Error: '" << path.string() << "' is not a TriSplit model file." << std::endl;
+        return false;
+    }
+
+    TrainedModel loaded;
+    loaded.aux_mask_1_represents_11 = (buffer[5] & 1) != 0;
+    memcpy(&loaded.model_id, buffer + 8, 4);
+    memcpy(&loaded.prob0_bitmap, buffer + 12, 4);
+    memcpy(&loaded.prob0_mask, buffer + 16, 4);
+    memcpy(&loaded.prob0_reconstructed, buffer + 20, 4);
+    memcpy(&loaded.trained_bytes, buffer + 24, 8);
+
+    // KO: 확률이 (0, 1) 구간을 벗어나거나 model_id가 내용과 맞지 않으면 손상된 모델입니다.
+    // EN: The model is corrupted if a probability leaves the interval (0, 1) or the model_id does not match the content.
+    constexpr uint32_t one = 1u << PROB_BITS;
+    for (uint32_t prob : { loaded.prob0_bitmap, loaded.prob0_mask, loaded.prob0_reconstructed }) {
+        if (prob == 0 || prob >= one) {
+            std::cerr << "Error: Corrupted model file '" << path.string() << "'." << std::endl;
+            return false;
+        }
+    }
+    if (loaded.model_id != loaded.compute_id()) {
+        std::cerr << "Error: Corrupted model file '" << path.string() << "' (model id mismatch)." << std::endl;
+        return false;
+    }
+
+    *this = loaded;
+    return true;
+}
+
+void ModelTrainer::add_sample(const std::vector<uint8_t>& sample) {
+    uint64_t sample_freqs[4];
+    SeparationEngine::count_symbols(sample, sample_freqs);
+    for (int s = 0; s < 4; ++s) freqs[s] += sample_freqs[s];
+    trained_bytes += sample.size();
+}
+
+TrainedModel ModelTrainer::build() const {
+    TrainedModel model;
+    model.trained_bytes = trained_bytes;
+    model.aux_mask_1_represents_11 = (freqs[0b11] <= freqs[0b00]);
+
+    // KO: 각 스트림에서 0이 나타나는 횟수를 심볼 빈도로부터 직접 계산합니다.
+    //     - value_bitmap: '10'이 0, '01'이 1
+    //     - auxiliary_mask: 흔한 자리표시자 심볼이 0
+    //     - reconstructed_stream: 마커('10'/'01')가 0, 자리표시자('00'/'11')가 1
+    // EN: The number of zeros in each stream is computed directly from the symbol frequencies.
+    //     - value_bitmap: '10' is 0, '01' is 1
+    //     - auxiliary_mask: the common placeholder symbol is 0
+    //     - reconstructed_stream: markers ('10'/'01') are 0, placeholders ('00'/'11') are 1
+    const uint64_t n_markers = freqs[0b10] + freqs[0b01];
+    const uint64_t n_placeholders = freqs[0b00] + freqs[0b11];
+    const uint64_t n_common_placeholders = model.aux_mask_1_represents_11 ? freqs[0b00] : freqs[0b11];
+
+    model.prob0_bitmap = quantize_prob0(freqs[0b10], n_markers);
+    model.prob0_mask = quantize_prob0(n_common_placeholders, n_placeholders);
+    model.prob0_reconstructed = quantize_prob0(n_markers, n_markers + n_placeholders);
+    model.model_id = model.compute_id();
+    return model;
+}
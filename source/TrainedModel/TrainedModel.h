@@ -0,0 +1,56 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+// KO: 샘플 코퍼스로부터 학습한 스트림 통계입니다. 작은 블록이 많은 작업(센서 레코드 등)에서는
+//     블록마다 기록되는 헤더와 빈도 정보가 압축 데이터보다 커지기 쉬우므로, 이 통계를 모델 파일로 공유하고
+//     블록에는 model_id만 기록합니다. 확률은 0.24 고정소수점으로 저장되며 엔진의 정밀도에 맞게 변환됩니다.
+// EN: Stream statistics trained from a sample corpus. For workloads with many small blocks (sensor records, etc.)
+//     the per-block headers and frequencies easily outweigh the compressed data, so these statistics are shared
+//     through a model file and blocks only record the model_id. Probabilities are stored in 0.24 fixed point
+//     and converted to the precision of the engine.
+struct TrainedModel {
+    static constexpr uint32_t PROB_BITS = 24;
+
+    uint32_t model_id = 0; // KO: 모델 내용의 FNV-1a 해시 (0은 '모델 없음') / EN: FNV-1a hash of the model content (0 means 'no model')
+    bool aux_mask_1_represents_11 = true; // KO: 모든 블록에 강제되는 auxiliary_mask 극성 / EN: The auxiliary_mask polarity forced on every block
+    uint32_t prob0_bitmap = 1u << 23;        // KO: value_bitmap에서 0의 확률 / EN: Probability of a 0 in the value_bitmap
+    uint32_t prob0_mask = 1u << 23;          // KO: auxiliary_mask에서 0의 확률 / EN: Probability of a 0 in the auxiliary_mask
+    uint32_t prob0_reconstructed = 1u << 23; // KO: reconstructed_stream에서 마커(0)의 확률 / EN: Probability of a marker (0) in the reconstructed_stream
+    uint64_t trained_bytes = 0; // KO: 학습에 사용된 바이트 수 (정보용) / EN: Number of bytes used for training (informational)
+
+    // KO: 모델을 파일로 저장합니다. 실패하면 오류를 출력하고 false를 반환합니다.
+    // EN: Saves the model to a file. Prints an error and returns false on failure.
+    bool save(const std::filesystem::path& path) const;
+
+    // KO: 파일에서 모델을 읽고 형식과 model_id를 검증합니다. 실패하면 오류를 출력하고 false를 반환합니다.
+    // EN: Loads a model from a file and validates its format and model_id. Prints an error and returns false on failure.
+    bool load(const std::filesystem::path& path);
+
+    // KO: 모델 내용(극성과 확률)으로부터 model_id를 계산합니다.
+    // EN: Computes the model_id from the model content (polarity and probabilities).
+    uint32_t compute_id() const;
+};
+
+// KO: 샘플 데이터의 2비트 심볼 빈도를 누적하여 TrainedModel을 만듭니다.
+// EN: Accumulates the 2-bit symbol frequencies of sample data and builds a TrainedModel from them.
+class ModelTrainer {
+public:
+    // KO: 샘플 데이터 하나를 학습 통계에 더합니다.
+    // EN: Adds one piece of sample data to the training statistics.
+    void add_sample(const std::vector<uint8_t>& sample);
+
+    // KO: 누적된 통계로부터 모델을 만듭니다. 학습 데이터에 없던 심볼도 부호화할 수 있도록
+    //     모든 확률은 (0, 1) 구간 안으로 제한됩니다.
+    // EN: Builds the model from the accumulated statistics. All probabilities are kept inside the open
+    //     interval (0, 1) so that symbols absent from the training data can still be encoded.
+    TrainedModel build() const;
+
+private:
+    uint64_t freqs[4] = { 0 };
+    uint64_t trained_bytes = 0;
+};
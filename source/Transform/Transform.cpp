@@ -0,0 +1,225 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 분리 전에 블록에 적용하는 가역 사전 변환(바이트 필터와 레코드 전치)을 구현합니다.
+// EN: This file implements the reversible pre-transforms (byte filters and record transpositions) applied to a block before separation.
+#include "Transform.h"
+#include <stdexcept>
+#include <cstring>
+
+// KO: SSE2는 x64에서 항상 사용할 수 있습니다. 사용할 수 없는 환경에서는 스칼라 구현만 사용합니다.
+// EN: SSE2 is always available on x64. Where it is not, only the scalar code is used.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRISPLIT_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+bool is_valid_transform(const TransformSpec& spec) {
+    if (static_cast<uint8_t>(spec.filter) > static_cast<uint8_t>(ByteFilter::Xor)) return false;
+    if (static_cast<uint8_t>(spec.transposition) > static_cast<uint8_t>(Transposition::BitPlanes)) return false;
+    if (spec.filter_lag < 1 || spec.filter_lag > MAX_TRANSFORM_DISTANCE) return false;
+    if (spec.stride < 1 || spec.stride > MAX_TRANSFORM_DISTANCE) return false;
+    return true;
+}
+
+// --- Byte Filters ---
+// --- 바이트 필터 ---
+
+// KO: 순방향 필터입니다. 출력의 각 바이트는 입력에서만 계산되므로, lag와 관계없이 16바이트씩 독립적으로 처리할 수 있습니다.
+// EN: The forward filter. Every output byte is computed from the input alone, so it works 16 bytes at a time regardless of the lag.
+template <ByteFilter Filter>
+static void filter_forward(const uint8_t* in, uint8_t* out, size_t size, size_t lag) {
+    const size_t head = (lag < size) ? lag : size;
+    memcpy(out, in, head);
+    size_t i = head;
+#ifdef TRISPLIT_HAVE_SSE2
+    for (; i + 16 <= size; i += 16) {
+        const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i - lag));
+        const __m128i result = (Filter == ByteFilter::Delta) ? _mm_sub_epi8(current, previous) : _mm_xor_si128(current, previous);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+    }
+#endif
+    for (; i < size; ++i) {
+        out[i] = (Filter == ByteFilter::Delta) ? static_cast<uint8_t>(in[i] - in[i - lag]) : static_cast<uint8_t>(in[i] ^ in[i - lag]);
+    }
+}
+
+// KO: 역방향 필터입니다. 각 바이트는 lag 바이트 앞의 복원된 바이트에 의존하므로, lag가 16 이상일 때만 16바이트씩 처리합니다.
+// EN: The inverse filter. Every byte depends on the restored byte lag bytes back, so it only works 16 bytes at a time when the lag is at least 16.
+template <ByteFilter Filter>
+static void filter_inverse(const uint8_t* in, uint8_t* out, size_t size, size_t lag) {
+    const size_t head = (lag < size) ? lag : size;
+    memcpy(out, in, head);
+    size_t i = head;
+#ifdef TRISPLIT_HAVE_SSE2
+    if (lag >= 16) {
+        for (; i + 16 <= size; i += 16) {
+            const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i - lag));
+            const __m128i result = (Filter == ByteFilter::Delta) ? _mm_add_epi8(current, previous) : _mm_xor_si128(current, previous);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        out[i] = (Filter == ByteFilter::Delta) ? static_cast<uint8_t>(in[i] + out[i - lag]) : static_cast<uint8_t>(in[i] ^ out[i - lag]);
+    }
+}
+
+// --- Byte Transposition ---
+// --- 바이트 전치 ---
+
+// KO: n개의 레코드(stride 바이트)를 열 단위로 배치합니다. 레코드에 속하지 않는 끝부분은 그대로 뒤에 붙습니다.
+// EN: Lays out n records (stride bytes each) column by column. The tail that does not form a whole record is appended as is.
+static void transpose_bytes(const uint8_t* in, uint8_t* out, size_t size, size_t stride) {
+    const size_t n_records = size / stride;
+    for (size_t column = 0; column < stride; ++column) {
+        const uint8_t* src = in + column;
+        uint8_t* dst = out + column * n_records;
+        for (size_t r = 0; r < n_records; ++r, src += stride) dst[r] = *src;
+    }
+    memcpy(out + n_records * stride, in + n_records * stride, size - n_records * stride);
+}
+
+static void untranspose_bytes(const uint8_t* in, uint8_t* out, size_t size, size_t stride) {
+    const size_t n_records = size / stride;
+    for (size_t column = 0; column < stride; ++column) {
+        const uint8_t* src = in + column * n_records;
+        uint8_t* dst = out + column;
+        for (size_t r = 0; r < n_records; ++r, dst += stride) *dst = src[r];
+    }
+    memcpy(out + n_records * stride, in + n_records * stride, size - n_records * stride);
+}
+
+// --- Bit-Plane Transposition ---
+// --- 비트 평면 전치 ---
+
+// KO: 한 열(n바이트)을 비트 평면으로 나눕니다. 앞의 n8 = n - n % 8 바이트가 8개의 평면(각 n8/8 바이트, 비트 7 평면부터)이 되고,
+//     평면 b의 g번째 바이트의 k번 비트는 열의 8g+k번째 바이트의 비트 b입니다. 나머지 바이트는 평면 뒤에 그대로 붙습니다.
+// EN: Splits one column (n bytes) into bit planes. The first n8 = n - n % 8 bytes become eight planes (n8/8 bytes each, bit 7 plane first);
+//     bit k of byte g of plane b is bit b of byte 8g+k of the column. The remaining bytes follow the planes as is.
+static void split_bit_planes(const uint8_t* in, uint8_t* out, size_t n) {
+    const size_t plane_size = n / 8;
+    size_t g = 0;
+#ifdef TRISPLIT_HAVE_SSE2
+    // KO: movemask는 16바이트의 최상위 비트를 한 번에 모읍니다. 바이트마다 자신을 더해 다음 비트를 최상위로 올립니다.
+    // EN: movemask gathers the top bit of 16 bytes at once. Adding every byte to itself moves the next bit to the top.
+    for (; g + 2 <= plane_size; g += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + g * 8));
+        for (int b = 7; b >= 0; --b) {
+            const unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(v));
+            uint8_t* plane = out + (7 - b) * plane_size;
+            plane[g] = static_cast<uint8_t>(bits);
+            plane[g + 1] = static_cast<uint8_t>(bits >> 8);
+            v = _mm_add_epi8(v, v);
+        }
+    }
+#endif
+    for (; g < plane_size; ++g) {
+        for (int b = 7; b >= 0; --b) {
+            unsigned bits = 0;
+            for (unsigned k = 0; k < 8; ++k) bits |= ((in[g * 8 + k] >> b) & 1u) << k;
+            out[(7 - b) * plane_size + g] = static_cast<uint8_t>(bits);
+        }
+    }
+    memcpy(out + plane_size * 8, in + plane_size * 8, n - plane_size * 8);
+}
+
+static void merge_bit_planes(const uint8_t* in, uint8_t* out, size_t n) {
+    const size_t plane_size = n / 8;
+    size_t g = 0;
+#ifdef TRISPLIT_HAVE_SSE2
+    // KO: 평면의 16비트를 16바이트에 펼친 뒤, 바이트마다 자기 비트를 골라 비교 결과(0x00/0xFF)를 해당 비트로 바꿉니다.
+    // EN: The 16 bits of a plane are spread over 16 bytes, every byte picks its own bit, and the comparison result (0x00/0xFF) is narrowed to that plane's bit.
+    const __m128i select = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+    for (; g + 2 <= plane_size; g += 2) {
+        __m128i acc = _mm_setzero_si128();
+        for (int b = 7; b >= 0; --b) {
+            const uint8_t* plane = in + (7 - b) * plane_size;
+            const __m128i spread = _mm_set_epi64x(
+                static_cast<long long>(plane[g + 1] * 0x0101010101010101ull),
+                static_cast<long long>(plane[g] * 0x0101010101010101ull));
+            const __m128i is_set = _mm_cmpeq_epi8(_mm_and_si128(spread, select), select);
+            acc = _mm_or_si128(acc, _mm_and_si128(is_set, _mm_set1_epi8(static_cast<char>(1u << b))));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + g * 8), acc);
+    }
+#endif
+    for (; g < plane_size; ++g) {
+        for (unsigned k = 0; k < 8; ++k) {
+            unsigned byte = 0;
+            for (int b = 7; b >= 0; --b) byte |= ((in[(7 - b) * plane_size + g] >> k) & 1u) << b;
+            out[g * 8 + k] = static_cast<uint8_t>(byte);
+        }
+    }
+    memcpy(out + plane_size * 8, in + plane_size * 8, n - plane_size * 8);
+}
+
+// --- Public Functions ---
+// --- 공개 함수 ---
+
+std::vector<uint8_t> forward_transform(const std::vector<uint8_t>& data, const TransformSpec& spec) {
+    if (!is_valid_transform(spec)) {
+        throw std::invalid_argument("Invalid transform (unknown kind, or lag/stride out of range).");
+    }
+    const size_t size = data.size();
+
+    // KO: 1단계: 바이트 필터
+    // EN: Step 1: Byte filter
+    std::vector<uint8_t> filtered(size);
+    switch (spec.filter) {
+    case ByteFilter::Delta: filter_forward<ByteFilter::Delta>(data.data(), filtered.data(), size, spec.filter_lag); break;
+    case ByteFilter::Xor: filter_forward<ByteFilter::Xor>(data.data(), filtered.data(), size, spec.filter_lag); break;
+    default: filtered = data; break;
+    }
+    if (spec.transposition == Transposition::None) return filtered;
+
+    // KO: 2단계: 레코드 전치. 비트 평면 전치는 바이트 전치의 결과를 열마다 다시 나눕니다.
+    // EN: Step 2: Record transposition. The bit-plane transposition splits every column of the byte transposition once more.
+    std::vector<uint8_t> transposed(size);
+    transpose_bytes(filtered.data(), transposed.data(), size, spec.stride);
+    if (spec.transposition == Transposition::Bytes) return transposed;
+
+    const size_t n_records = size / spec.stride;
+    for (size_t column = 0; column < spec.stride; ++column) {
+        split_bit_planes(transposed.data() + column * n_records, filtered.data() + column * n_records, n_records);
+    }
+    memcpy(filtered.data() + n_records * spec.stride, transposed.data() + n_records * spec.stride, size - n_records * spec.stride);
+    return filtered;
+}
+
+std::vector<uint8_t> inverse_transform(const std::vector<uint8_t>& data, const TransformSpec& spec) {
+    if (!is_valid_transform(spec)) {
+        throw std::invalid_argument("Invalid transform (unknown kind, or lag/stride out of range).");
+    }
+    const size_t size = data.size();
+
+    // KO: 순방향의 역순으로, 전치를 먼저 되돌린 뒤 필터를 되돌립니다.
+    // EN: In the reverse order of the forward direction: the transposition is undone first, then the filter.
+    std::vector<uint8_t> untransposed;
+    if (spec.transposition == Transposition::None) {
+        untransposed = data;
+    }
+    else {
+        untransposed.resize(size);
+        const uint8_t* columns = data.data();
+        std::vector<uint8_t> merged;
+        if (spec.transposition == Transposition::BitPlanes) {
+            merged.resize(size);
+            const size_t n_records = size / spec.stride;
+            for (size_t column = 0; column < spec.stride; ++column) {
+                merge_bit_planes(data.data() + column * n_records, merged.data() + column * n_records, n_records);
+            }
+            memcpy(merged.data() + n_records * spec.stride, data.data() + n_records * spec.stride, size - n_records * spec.stride);
+            columns = merged.data();
+        }
+        untranspose_bytes(columns, untransposed.data(), size, spec.stride);
+    }
+
+    std::vector<uint8_t> original(size);
+    switch (spec.filter) {
+    case ByteFilter::Delta: filter_inverse<ByteFilter::Delta>(untransposed.data(), original.data(), size, spec.filter_lag); break;
+    case ByteFilter::Xor: filter_inverse<ByteFilter::Xor>(untransposed.data(), original.data(), size, spec.filter_lag); break;
+    default: return untransposed;
+    }
+    return original;
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+
+// KO: 분리 전에 적용하는 바이트 필터입니다. 각 바이트를 lag 바이트 앞의 값과 비교한 결과로 바꿉니다.
+//     - None: 필터 없음
+//     - Delta: 차분 (x[i] - x[i - lag], 바이트 단위 모듈러 연산)
+//     - Xor: 배타적 논리합 (x[i] ^ x[i - lag])
+// EN: The byte filter applied before separation. Every byte is replaced by how it compares to the value lag bytes back.
+//     - None: No filter
+//     - Delta: The difference (x[i] - x[i - lag], byte-wise modular arithmetic)
+//     - Xor: The exclusive or (x[i] ^ x[i - lag])
+enum class ByteFilter : uint8_t {
+    None = 0,
+    Delta = 1,
+    Xor = 2
+};
+
+// KO: 고정 길이 레코드(stride 바이트)를 열 단위로 다시 배치하는 전치 방식입니다.
+//     - None: 전치 없음
+//     - Bytes: 바이트 전치. 모든 레코드의 0번 바이트, 1번 바이트, ... 순서로 배치합니다.
+//     - BitPlanes: 비트 평면 전치. 바이트 전치 후 각 열을 최상위 비트부터 비트 평면별로 모읍니다.
+// EN: How records of a fixed length (stride bytes) are rearranged into columns.
+//     - None: No transposition
+//     - Bytes: Byte transposition. Byte 0 of every record comes first, then byte 1, and so on.
+//     - BitPlanes: Bit-plane transposition. After the byte transposition every column is gathered plane by plane, most significant bit first.
+enum class Transposition : uint8_t {
+    None = 0,
+    Bytes = 1,
+    BitPlanes = 2
+};
+
+// KO: 필터의 lag와 전치의 stride가 가질 수 있는 최댓값입니다.
+// EN: The largest value the filter lag and the transposition stride may take.
+constexpr uint32_t MAX_TRANSFORM_DISTANCE = 1u << 16;
+
+// KO: 블록에 적용할 가역 사전 변환입니다. 순방향은 필터를 먼저, 전치를 나중에 적용하며 역방향은 그 반대입니다.
+//     고정 길이 레코드의 구조는 인접 비트가 아닌 열 위치에 있으므로, 이 변환으로 균일 심볼('00'/'11')이 크게 늘어납니다.
+// EN: The reversible pre-transform applied to a block. The forward direction applies the filter first and the transposition
+//     second, the inverse the other way round. The structure of fixed-length records lives in column positions rather than
+//     adjacent bits, so this transform greatly increases the uniform symbols ('00'/'11').
+struct TransformSpec {
+    ByteFilter filter = ByteFilter::None;
+    uint32_t filter_lag = 1;
+    Transposition transposition = Transposition::None;
+    uint32_t stride = 1;
+
+    bool is_identity() const { return filter == ByteFilter::None && transposition == Transposition::None; }
+};
+
+// KO: 변환 설정이 유효한지 확인합니다. (알려진 종류이며 lag와 stride가 1 이상 MAX_TRANSFORM_DISTANCE 이하)
+// EN: Checks whether a transform setting is valid. (Known kinds, with lag and stride between 1 and MAX_TRANSFORM_DISTANCE)
+bool is_valid_transform(const TransformSpec& spec);
+
+// KO: 블록에 순방향 변환을 적용합니다. 출력의 크기는 입력과 같습니다.
+//     SSE2를 사용할 수 있으면 필터와 비트 평면 전치를 16바이트 단위로 처리하며, 결과는 스칼라 구현과 동일합니다.
+// EN: Applies the forward transform to a block. The output has the same size as the input.
+//     When SSE2 is available, the filter and the bit-plane transposition work 16 bytes at a time, with results identical to the scalar code.
+std::vector<uint8_t> forward_transform(const std::vector<uint8_t>& data, const TransformSpec& spec);
+
+// KO: 'forward_transform'의 결과에 역변환을 적용하여 원본 블록을 복원합니다.
+// EN: Applies the inverse transform to the output of 'forward_transform', restoring the original block.
+std::vector<uint8_t> inverse_transform(const std::vector<uint8_t>& data, const TransformSpec& spec);
@@ -1,10 +1,10 @@
 ﻿// Author: SnowPing00
 // KO: 이 파일은 TriSplit 압축/복호화 프로그램의 메인 진입점(main function)입니다.
 //     명령줄 인자를 파싱하여 압축 또는 복호화 모드를 결정하고,
-//     파일을 블록 단위로 읽어와 SeparationEngine과 rANS_Coder를 사용하여 작업을 수행합니다.
+//     파일을 블록 단위로 읽어와 BlockCodec(SeparationEngine과 rANS_Coder)을 사용하여 작업을 수행합니다.
 // EN: This file is the main entry point for the TriSplit compression/decompression program.
 //     It parses command-line arguments to determine the mode (compress or decompress),
-//     and processes files block by block using the SeparationEngine and rANS_Coder.
+//     and processes files block by block using the BlockCodec (SeparationEngine and rANS_Coder).
 #include <iostream>
 #include <vector>
 #include <string>
@@ -12,242 +12,871 @@
 #include <filesystem>
 #include <numeric>
 #include <stdexcept>
-
-#include "rANS_Coder/rANS_Coder.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <charconv>
+
+#include "BlockCodec/BlockCodec.h"
+#include "BlockHash/BlockHash.h"
+#include "Container/Container.h"
+#include "ArchiveReader/ArchiveReader.h"
+#include "PerfCounters/PerfCounters.h"
+#include "TrainedModel/TrainedModel.h"
 #include "SeparationEngine/SeparationEngine.h"
+#include "Varint/Varint.h"
+#include "WorkPool/WorkPool.h"
 
 #include <cstdint>
 
-// KO: 메모리 정렬(padding)을 비활성화하여 구조체를 파일에 쓰거나 읽을 때 크기가 그대로 유지되도록 합니다.
-// EN: Disables memory alignment (padding) to ensure the struct's size remains consistent when writing to or reading from a file.
-#pragma pack(push, 1)
-// KO: 압축된 각 블록의 시작 부분에 위치하는 헤더 정보입니다.
-//     복호화에 필요한 모든 메타데이터와 각 데이터 스트림의 크기를 담고 있습니다.
-// EN: The header information located at the beginning of each compressed block.
-//     It contains all the necessary metadata for decompression and the size of each data stream.
-struct TriSplitBlockHeader {
-    // KO: 비트 플래그 필드. 
-    //     - 0번 비트: aux_mask_1_represents_11 (1이면 true)
-    //     - 1번 비트: is_placeholder_common (1이면 true)
-    //     - 2번 비트: 사용된 엔진 (항상 1, rANS 의미)
-    // EN: A bitfield for flags.
-    //     - Bit 0: aux_mask_1_represents_11 (1 if true)
-    //     - Bit 1: is_placeholder_common (1 if true)
-    //     - Bit 2: Engine used (always 1, means rANS)
-    uint8_t  metadata_flags;
-    uint8_t  reserved[7]; // KO: 예약된 공간. 향후 확장을 위함. / EN: Reserved space for future expansion.
-    uint64_t original_data_size; // KO: 원본 블록 데이터의 크기 / EN: The size of the original block data.
-    uint64_t compressed_bitmap_size; // KO: 압축된 value_bitmap 스트림의 크기 / EN: The size of the compressed value_bitmap stream.
-    uint64_t compressed_mask_size; // KO: 압축된 auxiliary_mask 스트림의 크기 / EN: The size of the compressed auxiliary_mask stream.
-    uint64_t compressed_reconstructed_size; // KO: 압축된 reconstructed_stream의 크기 / EN: The size of the compressed reconstructed_stream.
-};
-#pragma pack(pop)
+// KO: 연결 블록의 재시작 간격(-l)의 상한입니다.
+//     임의 접근은 재시작 지점부터 연결 사슬을 따라 복호화하므로, 간격이 길수록 한 블록을 읽는 데 드는 시간도 늘어납니다.
+// EN: The upper bound of the linked-block reset interval (-l).
+//     Random access decodes along the linked chain from the reset point, so a longer interval makes reading one block slower too.
+constexpr uint64_t MAX_LINK_INTERVAL = 1 << 16;
 
 void print_usage();
-std::vector<uint8_t> compress_block(const std::vector<uint8_t>& block_data);
-std::vector<uint8_t> decompress_block(const std::vector<uint8_t>& compressed_block_data);
 
 void print_usage() {
-    std::cerr << "Usage: TriSplit.exe [mode] <input_file> <output_file>" << std::endl;
+    std::cerr << "Usage: TriSplit.exe [mode] [options] <input_file> <output_file>" << std::endl;
     std::cerr << "  mode:" << std::endl;
     std::cerr << "    -c : Compress" << std::endl;
     std::cerr << "    -d : Decompress" << std::endl;
+    std::cerr << "    -t : Train a model from <input_file> (sample corpus) and save it to <output_file>" << std::endl;
+    std::cerr << "    -C : Compress every file of the directory or file list <input_file> at once, to <file>.tsp under the directory <output_file>" << std::endl;
+    std::cerr << "    -E : Extract every member of the multi-member archive <input_file> into the directory <output_file>" << std::endl;
+    std::cerr << "    -A : Append <input_file> to the existing archive <output_file> without recompressing it" << std::endl;
+    std::cerr << "    -x : Extract a range of the original data from the archive <input_file> to <output_file> by random access" << std::endl;
+    std::cerr << "    -q : Write the per-block statistics stored in the index of the archive <input_file> (CSV) to <output_file>, without decompressing" << std::endl;
+    std::cerr << "    -a : Analyze <input_file> without compressing it and write a per-block size prediction (CSV) to <output_file>" << std::endl;
+    std::cerr << "  options:" << std::endl;
+    std::cerr << "    -O <offset> : Start of the range to extract (-x, default: 0)" << std::endl;
+    std::cerr << "    -N <bytes> : Length of the range to extract (-x, default: up to the end)" << std::endl;
+    std::cerr << "    -Q <symbol> : Only list blocks that contain the 2-bit symbol <symbol> (0-3) (-q)" << std::endl;
+    std::cerr << "    -V <byte> : Only list blocks that may contain the byte value <byte> (0-255) (-q)" << std::endl;
+    std::cerr << "    -M : Write one multi-member archive <output_file> with a member table instead of one archive per file (-C)" << std::endl;
+    std::cerr << "    --perf : Report hardware performance counters (cycles/byte, IPC, branch and cache misses) per pipeline stage" << std::endl;
+    std::cerr << "    -1 ... -9 : Compression level, from fastest to strongest (the options below refine it, default: " << DEFAULT_COMPRESSION_LEVEL << ")" << std::endl;
+    std::cerr << "    -b <bytes> : Block size in bytes for compression (default: 8 MiB; small blocks suit small records)" << std::endl;
+    std::cerr << "    -m <model> : Use a trained model file (for small blocks; also needed to decompress them)" << std::endl;
+    std::cerr << "    -w <1|2|4> : Symbol width in bits for stream separation (default: 2)" << std::endl;
+    std::cerr << "    -p : Pick the best symbol pairing per block (2-bit symbols)" << std::endl;
+    std::cerr << "    -r : Code every stream with rANS (by default streams may use the faster-decoding tANS)" << std::endl;
+    std::cerr << "    -W : Code long rANS streams in the 32-lane interleaved layout, which decodes with SIMD (AVX2/AVX-512)" << std::endl;
+    std::cerr << "    -k <KiB> : Recompute rANS stream frequencies every <KiB> KiB of stream bits (for blocks whose statistics drift)" << std::endl;
+    std::cerr << "    -z : Turn long repeats into matches before separation (LZ prepass, for repetitive data)" << std::endl;
+    std::cerr << "    -L <depth> : Separate the derived streams again, up to <depth> levels, where it pays off (default: 0)" << std::endl;
+    std::cerr << "    -i : Store per-block symbol statistics in the index for -q (about 8 bytes per block; -A keeps the setting of the archive)" << std::endl;
+    std::cerr << "    -u : Write every block identical to an earlier one as a reference to it (block-level deduplication)" << std::endl;
+    std::cerr << "    -l <blocks> : Link every block to the statistics of the previous one, with a reset point every <blocks> blocks (at most " << MAX_LINK_INTERVAL << ", for small blocks)" << std::endl;
+    std::cerr << "    -j <threads> : Most threads used to separate a large block, or the worker count of -C (default: 0 = every core)" << std::endl;
+    std::cerr << "    -D <lag> : Delta-filter every byte against the byte <lag> bytes back before separation" << std::endl;
+    std::cerr << "    -X <lag> : XOR-filter every byte against the byte <lag> bytes back before separation" << std::endl;
+    std::cerr << "    -s <stride> : Transpose the bytes of <stride>-byte records into columns before separation" << std::endl;
+    std::cerr << "    -S <stride> : Transpose <stride>-byte records into columns and bit planes before separation" << std::endl;
 }
 
-// KO: 파일을 처리할 블록의 크기를 정의합니다. (8MB)
-// EN: Defines the size of the blocks for file processing. (8MB)
+// KO: 파일을 처리할 블록의 기본 크기를 정의합니다. (8MB)
+// EN: Defines the default size of the blocks for file processing. (8MB)
 constexpr size_t BLOCK_SIZE = 8 * 1024 * 1024;
 
+// KO: 스레드 수(-j)의 상한입니다. 각 스레드는 블록을 나눈 조각 하나나 일괄 압축의 작업자 하나를 맡습니다.
+// EN: The upper bound of the thread count (-j). Every thread takes one slice of a block or one worker of batch compression.
+constexpr uint64_t MAX_THREADS = 1024;
+
+// KO: text 전체를 [min_value, max_value] 범위의 십진수로 읽습니다. 부호, 남는 문자, 범위를 벗어난 값이면 false를 반환합니다.
+// EN: Parses the whole of text as a decimal number in [min_value, max_value]. Returns false for a sign, trailing characters or an out-of-range value.
+static bool parse_number(const char* text, uint64_t min_value, uint64_t max_value, uint64_t& value) {
+    const char* end = text + std::strlen(text);
+    const auto [ptr, ec] = std::from_chars(text, end, value);
+    return ec == std::errc() && ptr != text && ptr == end && value >= min_value && value <= max_value;
+}
+
+// KO: 입력에서 position부터 block과 같은 바이트가 있는지 확인하고, 읽기 위치를 되돌립니다. 탐색할 수 없는 입력이면 false를 반환합니다.
+// EN: Checks whether the input holds the same bytes as block at position, and restores the read position. Returns false for an input that cannot seek.
+static bool input_matches(std::istream& input_file, uint64_t position, const std::vector<uint8_t>& block, std::vector<uint8_t>& scratch) {
+    input_file.clear();
+    const std::streampos resume = input_file.tellg();
+    if (resume == std::streampos(-1)) return false;
+    scratch.resize(block.size());
+    input_file.seekg(static_cast<std::streamoff>(position));
+    const bool same = input_file.read(reinterpret_cast<char*>(scratch.data()), scratch.size()) && memcmp(scratch.data(), block.data(), block.size()) == 0;
+    input_file.clear();
+    input_file.seekg(resume);
+    return same;
+}
+
+// KO: 입력을 블록 단위로 압축하여 컨테이너의 index.blocks_end 위치부터 기록하고 색인에 추가합니다. (압축과 덧붙이기 모드가 공유)
+//     중복 제거를 사용하면 블록 해시마다 그 블록이 처음 나온 원본 오프셋을 기억합니다.
+//     같은 해시의 블록은 입력에서 처음 블록을 다시 읽어 바이트 단위로 같을 때만 분리와 부호화를 모두 건너뛰고 참조 블록으로 기록됩니다.
+//     link_interval이 0보다 크면 첫 블록 뒤의 블록은 앞 블록에 연결되며, link_interval 블록마다 오는 재시작 지점에서만 끊깁니다.
+//     덧붙인 데이터는 항상 재시작 지점에서 시작합니다. 블록 통계는 index.has_stats일 때만 계산합니다.
+// EN: Compresses the input block by block, writing the blocks from index.blocks_end of the container and adding them to the index. (Shared by the compress and append modes)
+//     With deduplication the original offset where every block hash first appeared is remembered.
+//     A block with a known hash is compared byte for byte with the first block, read back from the input, and only if they
+//     are equal does it skip both separation and coding and get written as a reference block.
+//     With link_interval > 0 every block after the first is linked to the previous one, except at the reset points every
+//     link_interval blocks. Appended data always starts at a reset point. Block statistics are only computed if index.has_stats.
+static void compress_blocks(std::istream& input_file, std::ostream& output_file, size_t block_size, const TrainedModel* model,
+                            const CompressionOptions& options, bool deduplicate, uint64_t link_interval, ContainerIndex& index) {
+    std::vector<uint8_t> buffer(block_size), previous_block, earlier_block;
+    uint64_t block_number = 0;
+    const uint64_t input_start = index.original_size();
+    std::unordered_map<BlockHash, uint64_t, BlockHashHasher> first_offsets;
+    while (input_file) {
+        buffer.resize(block_size);
+        input_file.read(reinterpret_cast<char*>(buffer.data()), block_size);
+        size_t bytes_read = input_file.gcount();
+        if (bytes_read == 0) break;
+        buffer.resize(bytes_read);
+
+        std::cout << "Processing block of " << bytes_read << " bytes..." << std::endl;
+        std::vector<uint8_t> compressed_block;
+        if (deduplicate) {
+            const auto [entry, inserted] = first_offsets.try_emplace(hash_block(buffer.data(), buffer.size()), index.original_size());
+            if (!inserted && input_matches(input_file, entry->second - input_start, buffer, earlier_block)) {
+                std::cout << "  - Duplicate of the block at offset " << entry->second << "." << std::endl;
+                compressed_block = make_reference_block(entry->second, bytes_read);
+            }
+        }
+        if (compressed_block.empty()) {
+            const bool linked = link_interval > 0 && block_number % link_interval != 0;
+            compressed_block = linked ? compress_linked_block(buffer, previous_block, model, options) : compress_block(buffer, model, options);
+        }
+
+        // KO: 압축된 블록의 크기를 varint로 먼저 기록하고, 그 다음에 실제 블록 데이터를 기록합니다. (프레이밍)
+        // EN: First write the size of the compressed block as a varint, and then write the actual block data. (Framing)
+        const BlockStats stats = index.has_stats ? compute_block_stats(buffer.data(), buffer.size()) : BlockStats();
+        write_container_block(output_file, compressed_block, bytes_read, stats, index);
+        if (link_interval > 0) std::swap(previous_block, buffer);
+        block_number++;
+    }
+}
+
+// KO: 일괄 압축의 입력 파일 하나입니다. name은 출력 경로와 멤버 이름에 쓰는 상대 경로입니다.
+// EN: One input file of batch compression. name is the relative path used for the output path and the member name.
+struct BatchFile {
+    std::filesystem::path path;
+    std::string name;
+    uint64_t size = 0;
+};
+
+// KO: 일괄 압축할 파일을 모읍니다. 디렉터리이면 그 아래의 모든 일반 파일을, 아니면 한 줄에 경로 하나씩 적힌 목록 파일을 읽습니다.
+//     목록의 경로는 루트와 앞쪽의 '..'를 떼어 이름으로 쓰므로, 출력이 출력 디렉터리 밖으로 나가지 않습니다.
+// EN: Gathers the files to batch-compress. For a directory every regular file below it is taken; otherwise the input is a
+//     list file with one path per line. The root and leading '..' of a listed path are dropped to form its name, so the
+//     outputs never leave the output directory.
+static bool collect_batch_files(const std::filesystem::path& input_path, std::vector<BatchFile>& files) {
+    std::error_code error;
+    if (std::filesystem::is_directory(input_path)) {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(input_path, error)) {
+            if (!entry.is_regular_file()) continue;
+            files.push_back({ entry.path(), std::filesystem::relative(entry.path(), input_path).generic_string(), 0 });
+        }
+        std::sort(files.begin(), files.end(), [](const BatchFile& a, const BatchFile& b) { return a.name < b.name; });
+    }
+    else {
+        std::ifstream list_file(input_path);
+        if (!list_file.is_open()) {
+            std::cerr << "Error: Cannot open the file list '" << input_path.string() << "'." << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(list_file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            const std::filesystem::path path(line);
+            std::filesystem::path name;
+            for (const std::filesystem::path& part : path.lexically_normal().relative_path()) {
+                if (name.empty() && part == "..") continue;
+                name /= part;
+            }
+            files.push_back({ path, name.generic_string(), 0 });
+        }
+    }
+    for (BatchFile& file : files) {
+        file.size = std::filesystem::file_size(file.path, error);
+        if (error) {
+            std::cerr << "Error: Cannot read '" << file.path.string() << "'." << std::endl;
+            return false;
+        }
+    }
+    return !error;
+}
+
+// KO: 여러 파일을 한 번에 압축합니다. 모든 파일의 블록이 작업 하나씩이 되어 하나의 작업 훔치기 풀에서 압축되므로,
+//     파일 크기의 분포와 관계없이 코어 수만큼 처리량이 늘어납니다. 작업은 자기 작업자의 읽기 버퍼를 재사용하므로
+//     작은 파일마다 블록 크기의 버퍼를 새로 할당하지 않습니다. 압축된 블록은 입력 순서대로 기록되며, 기록을 기다리는 블록이
+//     작업자 수의 몇 배를 넘지 않도록 작업을 조금씩 넣습니다.
+//     single_archive이면 output_path 하나에 멤버 표와 함께 기록하고, 아니면 output_path 디렉터리 아래에 파일마다 <이름>.tsp를 씁니다.
+//     연결 블록은 파일마다 첫 블록에서 새로 시작하므로, 연결이 멤버 경계를 넘지 않습니다. block_stats이면 색인에 블록 통계를 기록합니다.
+// EN: Compresses many files at once. Every block of every file becomes one task of a single work-stealing pool, so the
+//     throughput scales with the cores whatever the distribution of file sizes. Tasks reuse the read buffer of their
+//     worker, so no block-sized buffer is allocated per small file. Compressed blocks are written in input order, and tasks
+//     are fed in gradually so that the blocks waiting to be written stay within a few times the worker count.
+//     With single_archive everything goes into output_path with a member table; otherwise <name>.tsp is written per file
+//     under the directory output_path. Linked blocks restart at the first block of every file, so no chain crosses a member.
+//     With block_stats the index stores the block statistics.
+static bool compress_batch(const std::vector<BatchFile>& files, const std::filesystem::path& output_path, bool single_archive,
+                           size_t block_size, const TrainedModel* model, CompressionOptions options, uint64_t link_interval, bool block_stats) {
+    struct BatchBlock {
+        size_t file = 0;
+        uint64_t offset = 0;
+        size_t size = 0;
+        std::vector<uint8_t> compressed;
+        BlockStats stats;
+        bool ready = false;
+    };
+    std::vector<BatchBlock> blocks;
+    for (size_t f = 0; f < files.size(); ++f) {
+        for (uint64_t offset = 0; offset < files[f].size; offset += block_size) {
+            BatchBlock block;
+            block.file = f;
+            block.offset = offset;
+            block.size = static_cast<size_t>(std::min<uint64_t>(block_size, files[f].size - offset));
+            blocks.push_back(std::move(block));
+        }
+    }
+
+    // KO: 병렬성은 블록 사이에서 얻으므로, 블록 안의 분리는 한 스레드로 합니다.
+    // EN: The parallelism comes from across the blocks, so the separation inside a block uses a single thread.
+    WorkStealingPool pool(options.threads);
+    options.threads = 1;
+    std::vector<std::vector<uint8_t>> buffers(pool.size()), previous_buffers(pool.size());
+    std::mutex ready_mutex;
+    std::condition_variable block_ready;
+
+    auto compress_task = [&](size_t b, unsigned worker) {
+        BatchBlock& block = blocks[b];
+        std::vector<uint8_t>& buffer = buffers[worker];
+        std::vector<uint8_t>& previous_block = previous_buffers[worker];
+        const uint64_t block_number = block.offset / block_size;
+        const bool linked = link_interval > 0 && block_number % link_interval != 0;
+        std::vector<uint8_t> compressed;
+        try {
+            std::ifstream input_file(files[block.file].path, std::ios::binary);
+            buffer.resize(block.size);
+            input_file.seekg(static_cast<std::streamoff>(block.offset));
+            input_file.read(reinterpret_cast<char*>(buffer.data()), block.size);
+            if (linked) {
+                previous_block.resize(block_size);
+                input_file.seekg(static_cast<std::streamoff>(block.offset - block_size));
+                input_file.read(reinterpret_cast<char*>(previous_block.data()), block_size);
+            }
+            if (input_file) {
+                compressed = linked ? compress_linked_block(buffer, previous_block, model, options) : compress_block(buffer, model, options);
+                if (block_stats) block.stats = compute_block_stats(buffer.data(), buffer.size());
+            }
+        }
+        catch (const std::exception& error) {
+            std::cerr << "Error: " << error.what() << std::endl;
+            compressed.clear();
+        }
+        {
+            std::lock_guard<std::mutex> lock(ready_mutex);
+            block.compressed = std::move(compressed);
+            block.ready = true;
+        }
+        block_ready.notify_all();
+    };
+
+    const size_t window = 4 * static_cast<size_t>(pool.size());
+    size_t next_submit = 0, next_block = 0;
+    auto feed = [&]() {
+        for (; next_submit < blocks.size() && next_submit < next_block + window; ++next_submit) {
+            pool.submit([&compress_task, b = next_submit](unsigned worker) { compress_task(b, worker); });
+        }
+    };
+
+    std::ofstream output_file;
+    ContainerIndex index;
+    index.has_stats = block_stats;
+    if (single_archive) {
+        output_file.open(output_path, std::ios::binary);
+        if (!output_file.is_open()) {
+            std::cerr << "Error: Cannot open output file '" << output_path.string() << "'." << std::endl;
+            return false;
+        }
+        output_file.write(reinterpret_cast<const char*>(CONTAINER_MAGIC), sizeof(CONTAINER_MAGIC));
+    }
+    bool ok = true;
+    for (size_t f = 0; f < files.size() && ok; ++f) {
+        std::cout << "Compressing " << files[f].name << " (" << files[f].size << " bytes)..." << std::endl;
+        if (!single_archive) {
+            const std::filesystem::path file_output = output_path / (files[f].name + ".tsp");
+            std::error_code error;
+            std::filesystem::create_directories(file_output.parent_path(), error);
+            output_file.open(file_output, std::ios::binary);
+            if (!output_file.is_open()) {
+                std::cerr << "Error: Cannot open output file '" << file_output.string() << "'." << std::endl;
+                ok = false;
+                break;
+            }
+            output_file.write(reinterpret_cast<const char*>(CONTAINER_MAGIC), sizeof(CONTAINER_MAGIC));
+            index = ContainerIndex();
+            index.has_stats = block_stats;
+        }
+        for (; next_block < blocks.size() && blocks[next_block].file == f; ++next_block) {
+            feed();
+            BatchBlock& block = blocks[next_block];
+            {
+                std::unique_lock<std::mutex> lock(ready_mutex);
+                block_ready.wait(lock, [&block] { return block.ready; });
+            }
+            if (block.compressed.empty()) {
+                std::cerr << "Error: Cannot compress '" << files[f].path.string() << "' at offset " << block.offset << "." << std::endl;
+                ok = false;
+                break;
+            }
+            write_container_block(output_file, block.compressed, block.size, block.stats, index);
+            std::vector<uint8_t>().swap(block.compressed);
+        }
+        if (single_archive) {
+            add_container_member(index, files[f].name);
+        }
+        else if (ok) {
+            write_container_index(output_file, index);
+            output_file.close();
+            ok = static_cast<bool>(output_file);
+        }
+    }
+    if (single_archive && ok) {
+        write_container_index(output_file, index);
+        output_file.close();
+        ok = static_cast<bool>(output_file);
+    }
+    // KO: 실패하여 일찍 멈추었더라도, 작업이 blocks를 가리키므로 이미 넣은 작업이 끝날 때까지 기다립니다.
+    // EN: Even after stopping early on a failure, the tasks point into blocks, so the ones already submitted are waited for.
+    pool.wait();
+    if (!ok) return false;
+    std::cout << "Compressed " << files.size() << " files in " << blocks.size() << " blocks with " << pool.size() << " workers." << std::endl;
+    return true;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 4) {
+    if (argc < 4) {
         print_usage();
         return 1;
     }
     const std::string mode = argv[1];
-    const std::filesystem::path input_path = argv[2];
-    const std::filesystem::path output_path = argv[3];
+    const std::filesystem::path input_path = argv[argc - 2];
+    const std::filesystem::path output_path = argv[argc - 1];
 
-    if (mode != "-c" && mode != "-d") {
+    if (mode != "-c" && mode != "-d" && mode != "-t" && mode != "-a" && mode != "-A" && mode != "-x" && mode != "-q" && mode != "-C" && mode != "-E") {
         std::cerr << "Error: Invalid mode '" << mode << "'" << std::endl;
         print_usage(); return 1;
     }
 
+    // KO: 모드와 입출력 경로 사이의 선택적 인자들을 파싱합니다.
+    //     V2 스트림 헤더는 64비트 심볼 수를 사용하므로, 512MiB를 넘는 대형 블록도 안전하게 처리할 수 있습니다.
+    //     압축 수준은 나머지 선택 사항의 바탕이 되므로, 위치와 관계없이 먼저 적용합니다.
+    // EN: Parses the optional arguments between the mode and the input/output paths.
+    //     V2 stream headers use 64-bit symbol counts, so large blocks beyond 512MiB are handled safely.
+    //     Compression levels are the base the other options refine, so they are applied first wherever they appear.
+    size_t block_size = BLOCK_SIZE;
+    CompressionOptions options = compression_level_options(DEFAULT_COMPRESSION_LEVEL);
+    TrainedModel model;
+    bool use_model = false;
+    bool deduplicate = false;
+    bool block_stats = false;
+    uint64_t link_interval = 0;
+    bool single_archive = false;
+    uint64_t extract_offset = 0, extract_length = UINT64_MAX;
+    int query_symbol = -1, query_byte = -1;
+    auto is_level_option = [](const std::string& option) {
+        return option.size() == 2 && option[0] == '-' && option[1] >= '0' + static_cast<int>(MIN_COMPRESSION_LEVEL) && option[1] <= '0' + static_cast<int>(MAX_COMPRESSION_LEVEL);
+    };
+    for (int i = 2; i < argc - 2; ++i) {
+        if (is_level_option(argv[i])) options = compression_level_options(static_cast<unsigned>(argv[i][1] - '0'));
+    }
+    // KO: 다음 인자를 [min_value, max_value] 범위의 수로 읽습니다. 잘못된 값이면 오류와 사용법을 출력하고 false를 반환합니다.
+    // EN: Reads the next argument as a number in [min_value, max_value]. Prints the error and the usage and returns false for a bad value.
+    auto read_number = [&](int& i, const char* what, uint64_t min_value, uint64_t max_value, uint64_t& value) {
+        const char* text = argv[++i];
+        if (parse_number(text, min_value, max_value, value)) return true;
+        std::cerr << "Error: Invalid " << what << " '" << text << "' (must be " << min_value << " to " << max_value << ")" << std::endl;
+        print_usage();
+        return false;
+    };
+    uint64_t value = 0;
+    for (int i = 2; i < argc - 2; ++i) {
+        const std::string option = argv[i];
+        if (is_level_option(option)) {
+            continue;
+        }
+        else if (option == "-b" && i + 1 < argc - 2) {
+            if (!read_number(i, "block size", 1, SIZE_MAX, value)) return 1;
+            block_size = static_cast<size_t>(value);
+        }
+        else if (option == "-w" && i + 1 < argc - 2) {
+            if (!parse_number(argv[++i], 1, 4, value) || !SeparationEngine::is_supported_width(static_cast<unsigned>(value))) {
+                std::cerr << "Error: Invalid symbol width '" << argv[i] << "' (must be 1, 2 or 4)" << std::endl;
+                print_usage(); return 1;
+            }
+            options.symbol_width = static_cast<unsigned>(value);
+        }
+        else if (option == "-p") {
+            options.optimize_pairing = true;
+        }
+        else if (option == "-r") {
+            options.allow_table_ans = false;
+        }
+        else if (option == "-W") {
+            options.lane_interleaved = true;
+        }
+        else if (option == "-k" && i + 1 < argc - 2) {
+            if (!read_number(i, "frequency chunk size (KiB)", 1, MAX_FREQ_CHUNK_KIB, options.freq_chunk_kib)) return 1;
+        }
+        else if (option == "-z") {
+            options.match_prepass = true;
+        }
+        else if (option == "-L" && i + 1 < argc - 2) {
+            if (!read_number(i, "stream tree depth", 0, MAX_STREAM_TREE_DEPTH, value)) return 1;
+            options.stream_tree_depth = static_cast<unsigned>(value);
+        }
+        else if (option == "-O" && i + 1 < argc - 2) {
+            if (!read_number(i, "offset", 0, UINT64_MAX, extract_offset)) return 1;
+        }
+        else if (option == "-N" && i + 1 < argc - 2) {
+            if (!read_number(i, "length", 0, UINT64_MAX, extract_length)) return 1;
+        }
+        else if (option == "-Q" && i + 1 < argc - 2) {
+            if (!read_number(i, "symbol", 0, 3, value)) return 1;
+            query_symbol = static_cast<int>(value);
+        }
+        else if (option == "-V" && i + 1 < argc - 2) {
+            if (!read_number(i, "byte value", 0, 255, value)) return 1;
+            query_byte = static_cast<int>(value);
+        }
+        else if (option == "--perf") {
+            if (!enable_perf_profiling()) {
+                std::cerr << "Warning: Hardware performance counters are unavailable on this host; only wall-clock time is reported." << std::endl;
+            }
+        }
+        else if (option == "-i") {
+            block_stats = true;
+        }
+        else if (option == "-u") {
+            deduplicate = true;
+        }
+        else if (option == "-M") {
+            single_archive = true;
+        }
+        else if (option == "-l" && i + 1 < argc - 2) {
+            if (!read_number(i, "reset interval (blocks)", 1, MAX_LINK_INTERVAL, link_interval)) return 1;
+        }
+        else if (option == "-j" && i + 1 < argc - 2) {
+            if (!read_number(i, "thread count", 0, MAX_THREADS, value)) return 1;
+            options.threads = static_cast<unsigned>(value);
+        }
+        else if ((option == "-D" || option == "-X" || option == "-s" || option == "-S") && i + 1 < argc - 2) {
+            // KO: 필터와 전치는 각각 하나씩만 지정할 수 있으며, 나중에 지정한 값이 앞의 값을 대신합니다.
+            // EN: At most one filter and one transposition can be given; a later value replaces an earlier one.
+            uint64_t distance = 0;
+            if (!read_number(i, "lag/stride", 1, MAX_TRANSFORM_DISTANCE, distance)) return 1;
+            if (option == "-D" || option == "-X") {
+                options.transform.filter = (option == "-D") ? ByteFilter::Delta : ByteFilter::Xor;
+                options.transform.filter_lag = static_cast<uint32_t>(distance);
+            }
+            else {
+                options.transform.transposition = (option == "-s") ? Transposition::Bytes : Transposition::BitPlanes;
+                options.transform.stride = static_cast<uint32_t>(distance);
+            }
+        }
+        else if (option == "-m" && i + 1 < argc - 2) {
+            if (!model.load(argv[++i])) return 1;
+            use_model = true;
+        }
+        else {
+            std::cerr << "Error: Invalid option '" << option << "'" << std::endl;
+            print_usage(); return 1;
+        }
+    }
+
+    if (mode == "-C") {
+        // --- 일괄 압축 모드 ---
+        // --- Batch Compression Mode ---
+        // KO: 블록 해시는 입력 순서대로 보아야 하므로, 블록을 동시에 압축하는 일괄 모드는 중복 제거를 받지 않습니다.
+        // EN: Block hashes must be seen in input order, so the batch mode, which compresses blocks concurrently, does not take deduplication.
+        std::cout << "Batch compression mode selected." << std::endl;
+        if (deduplicate) {
+            std::cerr << "Error: -u is not supported with -C." << std::endl;
+            return 1;
+        }
+        std::vector<BatchFile> files;
+        if (!collect_batch_files(input_path, files)) return 1;
+        if (!compress_batch(files, output_path, single_archive, block_size, use_model ? &model : nullptr, options, link_interval, block_stats)) return 1;
+        if (perf_profiling_enabled()) report_perf_profile(std::cout);
+        std::cout << "Batch compression finished." << std::endl;
+        return 0;
+    }
+
+    if (mode == "-E") {
+        // --- 멤버 추출 모드 ---
+        // --- Member Extraction Mode ---
+        // KO: 멤버마다 그 블록만 리더로 복호화하여 출력 디렉터리 아래에 멤버 이름으로 씁니다.
+        //     이름이 절대 경로이거나 '..'를 포함하면 출력 디렉터리 밖을 가리킬 수 있으므로 건너뜁니다.
+        // EN: For every member only its blocks are decoded through the reader and written under the output directory by the
+        //     member name. A name that is absolute or contains '..' could point outside the output directory, so it is skipped.
+        std::cout << "Member extraction mode selected." << std::endl;
+        ArchiveReader reader(block_size * 4, use_model ? &model : nullptr);
+        if (!reader.open(input_path)) return 1;
+        if (reader.index().members.empty()) {
+            std::cerr << "Error: '" << input_path.string() << "' is not a multi-member archive (use -d)." << std::endl;
+            return 1;
+        }
+        std::vector<uint8_t> buffer;
+        for (const ContainerMember& member : reader.index().members) {
+            const std::filesystem::path name = std::filesystem::path(member.name).lexically_normal();
+            if (member.name.empty() || name.has_root_path() || std::find(name.begin(), name.end(), "..") != name.end()) {
+                std::cerr << "Warning: Skipping member '" << member.name << "' with an unsafe name." << std::endl;
+                continue;
+            }
+            const std::filesystem::path member_path = output_path / name;
+            std::error_code error;
+            std::filesystem::create_directories(member_path.parent_path(), error);
+            std::ofstream member_file(member_path, std::ios::binary);
+            if (!member_file.is_open()) {
+                std::cerr << "Error: Cannot open output file '" << member_path.string() << "'." << std::endl;
+                return 1;
+            }
+            std::cout << "Extracting " << member.name << " (" << member.original_size << " bytes)..." << std::endl;
+            for (uint64_t done = 0; done < member.original_size;) {
+                buffer.resize(static_cast<size_t>(std::min<uint64_t>(member.original_size - done, block_size)));
+                const size_t copied = reader.read(member.original_offset + done, buffer.data(), buffer.size());
+                member_file.write(reinterpret_cast<const char*>(buffer.data()), copied);
+                if (copied != buffer.size()) {
+                    std::cerr << "Error: Cannot read member '" << member.name << "' at offset " << done + copied << "." << std::endl;
+                    return 1;
+                }
+                done += copied;
+            }
+        }
+        std::cout << "Extracted " << reader.index().members.size() << " members." << std::endl;
+        return 0;
+    }
+
     std::ifstream input_file(input_path, std::ios::binary);
-    std::ofstream output_file(output_path, std::ios::binary);
-    if (!input_file.is_open() || !output_file.is_open()) {
+    // KO: 덧붙이기 모드는 기존 아카이브를 그 자리에서 고치므로, 출력 파일을 새로 만들지 않습니다.
+    // EN: The append mode updates the existing archive in place, so the output file is not recreated.
+    std::ofstream output_file;
+    if (mode != "-A") output_file.open(output_path, std::ios::binary);
+    if (!input_file.is_open() || (mode != "-A" && !output_file.is_open())) {
         std::cerr << "Error: Cannot open input or output file." << std::endl;
         return 1;
     }
 
-    if (mode == "-c") {
-        // --- 압축 모드 ---
-        // --- Compression Mode ---
-        std::cout << "Compression mode selected." << std::endl;
-        std::vector<uint8_t> buffer(BLOCK_SIZE);
+    if (mode == "-t") {
+        // --- 모델 학습 모드 ---
+        // --- Model Training Mode ---
+        // KO: 샘플 코퍼스 전체의 심볼 통계를 블록 단위로 누적한 뒤 모델 파일로 저장합니다.
+        // EN: Accumulates the symbol statistics of the whole sample corpus block by block, then saves them as a model file.
+        std::cout << "Model training mode selected." << std::endl;
+        input_file.close();
+        output_file.close();
+        std::ifstream corpus_file(input_path, std::ios::binary);
+        ModelTrainer trainer;
+        std::vector<uint8_t> buffer(block_size);
+        while (corpus_file) {
+            buffer.resize(block_size);
+            corpus_file.read(reinterpret_cast<char*>(buffer.data()), block_size);
+            size_t bytes_read = corpus_file.gcount();
+            if (bytes_read == 0) break;
+            buffer.resize(bytes_read);
+            trainer.add_sample(buffer);
+        }
+        TrainedModel trained = trainer.build();
+        if (!trained.save(output_path)) return 1;
+        std::cout << "Model " << std::hex << trained.model_id << std::dec << " trained from " << trained.trained_bytes << " bytes." << std::endl;
+        return 0;
+    }
+
+    if (mode == "-a") {
+        // --- 분석 모드 ---
+        // --- Analysis Mode ---
+        // KO: 블록마다 rANS를 실행하지 않고 세 스트림의 0차 엔트로피로 압축 크기를 예측하여 CSV 보고서로 기록합니다.
+        //     엔트로피 열은 비트 단위의 실수입니다. 예측은 모든 스트림을 rANS로 부호화하는 단일 단계 블록 기준이므로,
+        //     같은 블록 크기와 옵션에 -r을 더한 -c 결과와 블록 단위로 대응합니다. tANS 스트림은 비트 사이의 상관관계를 활용하므로
+        //     tANS를 허용하는 옵션(기본값)의 결과는 예측보다 작을 수 있으며, 청크 빈도, 다단계 블록과 일치 사전 처리도 반영하지 않습니다.
+//     수준 5~9의 심볼 폭 찾기는 압축과 같은 기준으로 폭을 골라 예측하므로, symbol_width 열은 -c가 쓰는 폭입니다.
+        // EN: Predicts the compressed size of every block from the order-0 entropies of the three streams, without running rANS,
+        //     and writes a CSV report. The entropy columns are fractional bit counts. The prediction is for a single-level block
+        //     with every stream coded with rANS, so it lines up block by block with the output of -c with the same block size
+        //     and options plus -r. tANS streams exploit correlations between bits, so with tANS allowed (the default) the output
+        //     may come out smaller, and chunked frequencies, multi-level blocks and the match prepass are not modelled either.
+//     The symbol width search of levels 5-9 picks the width by the same measure as compression, so the symbol_width
+//     column is the width -c uses.
+        std::cout << "Analysis mode selected." << std::endl;
+        if (options.allow_table_ans) {
+            std::cout << "Note: The prediction assumes rANS streams (-r); streams that pick tANS may compress smaller." << std::endl;
+        }
+        output_file << "block,offset,original_size,predicted_size,ratio,symbol_width,pairing,reconstructed_entropy_bits,value_bitmap_entropy_bits,auxiliary_mask_entropy_bits" << std::endl;
+        std::vector<uint8_t> buffer(block_size);
+        uint64_t block_index = 0, total_original = 0, total_predicted = sizeof(CONTAINER_MAGIC);
         while (input_file) {
-            input_file.read(reinterpret_cast<char*>(buffer.data()), BLOCK_SIZE);
+            buffer.resize(block_size);
+            input_file.read(reinterpret_cast<char*>(buffer.data()), block_size);
             size_t bytes_read = input_file.gcount();
             if (bytes_read == 0) break;
             buffer.resize(bytes_read);
 
-            std::cout << "Processing block of " << bytes_read << " bytes..." << std::endl;
-            std::vector<uint8_t> compressed_block = compress_block(buffer);
+            const BlockEstimate estimate = estimate_block(buffer, use_model ? &model : nullptr, options);
+            output_file << block_index << ',' << total_original << ',' << estimate.original_size << ',' << estimate.predicted_size << ','
+                        << static_cast<double>(estimate.predicted_size) / estimate.original_size << ','
+                        << estimate.streams.symbol_width << ',' << static_cast<int>(estimate.streams.pairing) << ','
+                        << estimate.streams.reconstructed_entropy_bits << ',' << estimate.streams.value_bitmap_entropy_bits << ','
+                        << estimate.streams.auxiliary_mask_entropy_bits << '\n';
+            block_index++;
+            total_original += estimate.original_size;
+            total_predicted += varint_size(estimate.predicted_size) + estimate.predicted_size;
+        }
+        std::cout << "Analyzed " << block_index << " blocks, " << total_original << " bytes." << std::endl;
+        std::cout << "Predicted compressed size: " << total_predicted << " bytes";
+        if (total_original > 0) std::cout << " (ratio " << static_cast<double>(total_predicted) / total_original << ")";
+        std::cout << std::endl;
+        return 0;
+    }
+
+    if (mode == "-q") {
+        // --- 질의 모드 ---
+        // --- Query Mode ---
+        // KO: 색인의 블록 통계만 읽으므로 블록은 하나도 복호화하지 않습니다. 필터를 주면 조건을 만족할 수 있는 블록만 남깁니다.
+        // EN: Only the block statistics of the index are read, so no block is decompressed. With a filter only the blocks
+        //     that may satisfy it are kept.
+        std::cout << "Query mode selected." << std::endl;
+        ContainerIndex index;
+        if (!read_container_index(input_file, index) || !index.has_stats) {
+            std::cerr << "Error: '" << input_path.string() << "' has no block statistics; they are only stored when compressing with -i." << std::endl;
+            return 1;
+        }
+        std::vector<size_t> selected = find_blocks(index, [](const BlockStats&) { return true; });
+        if (query_symbol >= 0) {
+            const std::vector<size_t> with_symbol = blocks_with_symbol(index, static_cast<unsigned>(query_symbol));
+            std::erase_if(selected, [&](size_t block) { return !std::binary_search(with_symbol.begin(), with_symbol.end(), block); });
+        }
+        if (query_byte >= 0) {
+            const std::vector<size_t> with_byte = blocks_with_byte_range(index, static_cast<uint8_t>(query_byte), static_cast<uint8_t>(query_byte));
+            std::erase_if(selected, [&](size_t block) { return !std::binary_search(with_byte.begin(), with_byte.end(), block); });
+        }
+
+        output_file << "block,offset,original_size,compressed_size,symbol_00,symbol_01,symbol_10,symbol_11,min_byte,max_byte" << std::endl;
+        BlockStats total;
+        for (size_t i = 0; i < selected.size(); ++i) {
+            const ContainerBlock& block = index.blocks[selected[i]];
+            output_file << selected[i] << ',' << block.original_offset << ',' << block.original_size << ',' << block.compressed_size;
+            for (uint64_t count : block.stats.symbol_counts) output_file << ',' << count;
+            output_file << ',' << static_cast<int>(block.stats.min_byte) << ',' << static_cast<int>(block.stats.max_byte) << '\n';
+            total.merge(block.stats, i == 0);
+        }
+        std::cout << "Selected " << selected.size() << " of " << index.blocks.size() << " blocks." << std::endl;
+        std::cout << "Symbol histogram (00, 01, 10, 11): " << total.symbol_counts[0] << ", " << total.symbol_counts[1] << ", "
+                  << total.symbol_counts[2] << ", " << total.symbol_counts[3] << std::endl;
+        return 0;
+    }
 
-            // KO: 압축된 블록의 크기를 먼저 기록하고, 그 다음에 실제 블록 데이터를 기록합니다. (프레이밍)
-            // EN: First write the size of the compressed block, and then write the actual block data. (Framing)
-            uint64_t compressed_size = compressed_block.size();
-            output_file.write(reinterpret_cast<const char*>(&compressed_size), sizeof(compressed_size));
-            if (compressed_size > 0) {
-                output_file.write(reinterpret_cast<const char*>(compressed_block.data()), compressed_size);
+    if (mode == "-x") {
+        // --- 추출 모드 ---
+        // --- Extraction Mode ---
+        // KO: 블록 색인으로 구간을 덮는 블록만 복호화하여, 원본 데이터의 일부를 아카이브 전체를 풀지 않고 꺼냅니다.
+        // EN: Only the blocks covering the range are decoded through the block index, so part of the original data is
+        //     taken out without decompressing the whole archive.
+        std::cout << "Extraction mode selected." << std::endl;
+        ArchiveReader reader(block_size * 4, use_model ? &model : nullptr);
+        if (!reader.open(input_path)) return 1;
+        if (extract_offset > reader.size()) extract_offset = reader.size();
+        uint64_t remaining = std::min(extract_length, reader.size() - extract_offset);
+        std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(remaining, block_size)));
+        while (remaining > 0) {
+            const size_t length = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+            const size_t copied = reader.read(extract_offset, buffer.data(), length);
+            output_file.write(reinterpret_cast<const char*>(buffer.data()), copied);
+            if (copied != length) {
+                std::cerr << "Error: Cannot read the archive at offset " << extract_offset + copied << "." << std::endl;
+                return 1;
             }
+            extract_offset += copied;
+            remaining -= copied;
         }
+        std::cout << "Extraction finished." << std::endl;
+    }
+    else if (mode == "-c") {
+        // --- 압축 모드 ---
+        // --- Compression Mode ---
+        std::cout << "Compression mode selected." << std::endl;
+        output_file.write(reinterpret_cast<const char*>(CONTAINER_MAGIC), sizeof(CONTAINER_MAGIC));
+        ContainerIndex index;
+        index.has_stats = block_stats;
+        compress_blocks(input_file, output_file, block_size, use_model ? &model : nullptr, options, deduplicate, link_interval, index);
+        write_container_index(output_file, index);
         std::cout << "Compression finished." << std::endl;
     }
+    else if (mode == "-A") {
+        // --- 덧붙이기 모드 ---
+        // --- Append Mode ---
+        // KO: 기존 블록은 다시 압축하지 않습니다. 색인을 읽고 마지막 블록을 검증한 뒤, 색인 자리부터 새 블록과 새 색인을 씁니다.
+        //     색인이 없는 아카이브는 블록 헤더를 훑어 색인을 만듭니다. 시간은 새 데이터의 크기에 비례합니다.
+        // EN: Existing blocks are never recompressed. The index is read and the last block validated, then the new blocks
+        //     and a new index are written from where the old index was. An archive without an index gets one by scanning the
+        //     block headers. The time is proportional to the size of the new data.
+        std::cout << "Append mode selected." << std::endl;
+        std::fstream archive_file(output_path, std::ios::in | std::ios::out | std::ios::binary);
+        ContainerIndex index;
+        if (!archive_file.is_open() || !read_container_index(archive_file, index)) {
+            std::cerr << "Error: '" << output_path.string() << "' is not a TriSplit archive that can be appended to." << std::endl;
+            return 1;
+        }
+        if (!index.blocks.empty()) {
+            const ContainerBlock& last = index.blocks.back();
+            std::vector<uint8_t> last_block;
+            uint64_t reference_offset, reference_size;
+            bool valid = read_container_block(archive_file, last, last_block);
+            if (valid && read_reference_block(last_block, reference_offset, reference_size)) {
+                valid = reference_size == last.original_size && reference_size <= last.original_offset && reference_offset <= last.original_offset - reference_size;
+            }
+            else if (valid && is_linked_block(last_block)) {
+                // KO: 연결 블록은 앞 블록이 있어야 풀리므로, 리더로 가장 가까운 재시작 지점부터 복호화합니다.
+                // EN: A linked block needs the previous block, so the reader decodes it from the nearest reset point.
+                std::cout << "Validating the last block..." << std::endl;
+                ArchiveReader reader(block_size * 4, use_model ? &model : nullptr);
+                valid = reader.open(output_path) && reader.block(index.blocks.size() - 1) != nullptr;
+            }
+            else if (valid) {
+                // KO: 엔트로피 복호기는 손상된 페이로드에서 예외를 던지므로, 예외도 검증 실패로 처리합니다.
+                // EN: The entropy decoders throw on corrupted payloads, so an exception fails the validation as well.
+                std::cout << "Validating the last block..." << std::endl;
+                try {
+                    valid = decompress_block(last_block, use_model ? &model : nullptr).size() == last.original_size;
+                }
+                catch (const std::exception&) {
+                    valid = false;
+                }
+            }
+            if (!valid) {
+                std::cerr << "Error: The last block of the archive is corrupted." << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "Appending after " << index.blocks.size() << " blocks (" << index.original_size() << " bytes)." << std::endl;
+        archive_file.clear();
+        archive_file.seekp(static_cast<std::streamoff>(index.blocks_end));
+        compress_blocks(input_file, archive_file, block_size, use_model ? &model : nullptr, options, deduplicate, link_interval, index);
+        // KO: 다중 멤버 아카이브에는 덧붙인 데이터를 입력 파일 이름의 멤버로 더합니다.
+        // EN: In a multi-member archive the appended data becomes a member named after the input file.
+        if (!index.members.empty()) add_container_member(index, input_path.filename().generic_string());
+        write_container_index(archive_file, index);
+        const uint64_t archive_size = static_cast<uint64_t>(archive_file.tellp());
+        archive_file.close();
+        if (!archive_file) {
+            std::cerr << "Error: Cannot write the archive." << std::endl;
+            return 1;
+        }
+        std::filesystem::resize_file(output_path, archive_size);
+        std::cout << "Append finished." << std::endl;
+    }
     else { // mode == "-d"
         // --- 복호화 모드 ---
         // --- Decompression Mode ---
         std::cout << "Decompression mode selected." << std::endl;
+
+        // KO: 파일 매직이 있으면 varint 프레이밍, 없으면 uint64 프레이밍을 사용하는 기존 컨테이너입니다.
+        // EN: With the file magic the blocks use varint framing; without it this is a legacy container with uint64 framing.
+        uint8_t magic[sizeof(CONTAINER_MAGIC)] = { 0 };
+        input_file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+        const bool compact_container = input_file.gcount() == sizeof(magic) && memcmp(magic, CONTAINER_MAGIC, sizeof(magic)) == 0;
+        if (!compact_container) {
+            input_file.clear();
+            input_file.seekg(0);
+        }
+        // KO: 색인이 있으면 블록은 색인 오프셋에서 끝납니다.
+        // EN: With an index the blocks end at the index offset.
+        uint64_t blocks_end = UINT64_MAX;
+        if (compact_container) find_container_index(input_file, blocks_end);
+        auto read_block_size = [&](uint64_t& size) -> bool {
+            if (static_cast<uint64_t>(input_file.tellg()) >= blocks_end) return false;
+            if (compact_container) return read_varint(input_file, size);
+            return static_cast<bool>(input_file.read(reinterpret_cast<char*>(&size), sizeof(size)));
+        };
+
+        // KO: 블록을 풀지 못하면 잘린 출력이 남지 않도록 출력 파일을 지우고 실패로 끝냅니다.
+        // EN: If a block cannot be decoded the output file is removed, so that no truncated output is left behind, and the run fails.
+        auto fail_decompression = [&]() {
+            output_file.close();
+            std::error_code error;
+            std::filesystem::remove(output_path, error);
+            return 1;
+        };
         uint64_t compressed_size;
+        uint64_t decompressed_offset = 0;
+        // KO: 연결 블록을 풀기 위해 바로 앞 블록의 복호화된 바이트를 보관합니다.
+        // EN: The decoded bytes of the block right before are kept to decode linked blocks.
+        std::vector<uint8_t> previous_block;
+        std::unique_ptr<ArchiveReader> reference_reader;
         // KO: 블록 크기를 먼저 읽고, 해당 크기만큼 블록 데이터를 읽어 복호화를 진행합니다.
         // EN: Reads the block size first, then reads that much block data to proceed with decompression.
-        while (output_file && input_file.read(reinterpret_cast<char*>(&compressed_size), sizeof(compressed_size))) {
+        while (output_file && read_block_size(compressed_size)) {
             if (compressed_size == 0) continue;
             std::vector<uint8_t> compressed_buffer(compressed_size);
-            input_file.read(reinterpret_cast<char*>(compressed_buffer.data()), compressed_size);
+            if (!input_file.read(reinterpret_cast<char*>(compressed_buffer.data()), compressed_size)) {
+                std::cerr << "Error: The archive ends inside the block at offset " << decompressed_offset << "." << std::endl;
+                return fail_decompression();
+            }
 
             std::cout << "Decompressing block of " << compressed_size << " bytes..." << std::endl;
-            std::vector<uint8_t> decompressed_block = decompress_block(compressed_buffer);
+            std::vector<uint8_t> decompressed_block;
+            uint64_t reference_offset, reference_size;
+            if (read_reference_block(compressed_buffer, reference_offset, reference_size)) {
+                // KO: 참조 블록은 리더로 아카이브에서 원본 블록을 다시 풀어 복사하므로, 출력은 탐색할 수 없는 파이프여도 됩니다.
+                //     리더는 첫 참조 블록에서 열리며, 복호화된 블록을 캐시에 보관합니다.
+                // EN: A reference block decodes the original block again from the archive through a reader and copies it, so the
+                //     output may be a pipe that cannot seek. The reader is opened at the first reference block and caches decoded blocks.
+                if (reference_size > decompressed_offset || reference_offset > decompressed_offset - reference_size) {
+                    std::cerr << "Error: Reference block points outside the decompressed data." << std::endl;
+                    return fail_decompression();
+                }
+                if (reference_reader == nullptr) {
+                    reference_reader = std::make_unique<ArchiveReader>(block_size * 4, use_model ? &model : nullptr);
+                    if (!reference_reader->open(input_path)) return fail_decompression();
+                }
+                decompressed_block.resize(reference_size);
+                if (reference_reader->read(reference_offset, decompressed_block.data(), decompressed_block.size()) != reference_size) {
+                    std::cerr << "Error: Cannot read the block referenced at offset " << reference_offset << "." << std::endl;
+                    return fail_decompression();
+                }
+            }
+            else {
+                // KO: 엔트로피 복호기는 손상된 페이로드에서 예외를 던지므로, 오류를 출력하고 복호화를 멈춥니다.
+                // EN: The entropy decoders throw on corrupted payloads, so the error is printed and decompression stops.
+                try {
+                    decompressed_block = decompress_block(compressed_buffer, use_model ? &model : nullptr, &previous_block);
+                }
+                catch (const std::exception& error) {
+                    std::cerr << "Error: Block at offset " << decompressed_offset << " is corrupted (" << error.what() << ")." << std::endl;
+                    return fail_decompression();
+                }
+                // KO: decompress_block은 복호화할 수 없는 블록(모델이 없는 학습된 모델 블록 등)에서 빈 결과를 반환하므로, 헤더의 원본 크기와 비교합니다.
+                // EN: decompress_block returns an empty result for a block it cannot decode (a trained-model block without its model, etc.),
+                //     so the result is checked against the original size in the header.
+                uint64_t expected_size;
+                if (!read_block_original_size(compressed_buffer, expected_size) || decompressed_block.size() != expected_size) {
+                    std::cerr << "Error: Cannot decompress the block at offset " << decompressed_offset << "." << std::endl;
+                    return fail_decompression();
+                }
+            }
 
             if (!decompressed_block.empty()) {
                 output_file.write(reinterpret_cast<const char*>(decompressed_block.data()), decompressed_block.size());
+                decompressed_offset += decompressed_block.size();
             }
+            previous_block = std::move(decompressed_block);
         }
         std::cout << "Decompression finished." << std::endl;
     }
 
+    if (perf_profiling_enabled()) report_perf_profile(std::cout);
     input_file.close();
     output_file.close();
     return 0;
 }
-
-// KO: 단일 데이터 블록을 압축하는 전체 과정을 수행합니다.
-// EN: Performs the entire process of compressing a single data block.
-std::vector<uint8_t> compress_block(const std::vector<uint8_t>& block_data) {
-    // --- 1단계: 스트림 분리 ---
-    // --- Step 1: Separate Streams ---
-    std::cout << "  [1/3] Separating streams..." << std::endl;
-    SeparationEngine separation_engine;
-    SeparatedStreams streams = separation_engine.separate(block_data);
-
-    // --- 2단계: 각 스트림 압축 ---
-    // --- Step 2: Compress Each Stream ---
-    std::cout << "  [2/3] Compressing Value Bitmap & Auxiliary Mask streams..." << std::endl;
-    rANS_Coder byte_coder;
-    std::vector<uint8_t> compressed_bitmap = byte_coder.encode(streams.value_bitmap);
-    std::vector<uint8_t> compressed_mask = byte_coder.encode(streams.auxiliary_mask);
-
-    std::cout << "  [2/3] Compressing Reconstructed stream with rANS engine..." << std::endl;
-    size_t n_placeholders = std::count(streams.reconstructed_stream.begin(), streams.reconstructed_stream.end(), 1);
-    bool is_placeholder_common = (n_placeholders >= streams.reconstructed_stream.size() / 2);
-    std::vector<uint8_t> compressed_reconstructed = byte_coder.encode_reconstructed_stream(streams.reconstructed_stream, is_placeholder_common);
-    std::cout << "    - Done. Reconstructed stream compressed size: " << compressed_reconstructed.size() << " bytes." << std::endl;
-
-    // --- 3단계: 최종 블록 조립 ---
-    // --- Step 3: Assemble Final Block ---
-    std::cout << "  [3/3] Assembling final block..." << std::endl;
-    TriSplitBlockHeader header;
-    memset(&header, 0, sizeof(header));
-    header.original_data_size = block_data.size();
-
-    // KO: 복호화에 필요한 플래그들을 'metadata_flags' 비트 필드에 설정합니다.
-    // EN: Set the flags required for decompression in the 'metadata_flags' bitfield.
-    header.metadata_flags = 0;
-    if (streams.aux_mask_1_represents_11) header.metadata_flags |= (1 << 0);
-    if (is_placeholder_common)            header.metadata_flags |= (1 << 1);
-    header.metadata_flags |= (1 << 2); // rANS engine used
-
-    header.compressed_bitmap_size = compressed_bitmap.size();
-    header.compressed_mask_size = compressed_mask.size();
-    header.compressed_reconstructed_size = compressed_reconstructed.size();
-
-    // KO: 최종 블록을 위한 메모리를 할당하고 헤더와 압축된 데이터들을 순서대로 복사합니다.
-    // EN: Allocate memory for the final block and copy the header and compressed data streams in order.
-    size_t total_size = sizeof(header) + header.compressed_bitmap_size + header.compressed_mask_size + header.compressed_reconstructed_size;
-    std::vector<uint8_t> final_block(total_size);
-
-    uint8_t* write_ptr = final_block.data();
-    memcpy(write_ptr, &header, sizeof(header));
-    write_ptr += sizeof(header);
-
-    if (header.compressed_bitmap_size > 0) { memcpy(write_ptr, compressed_bitmap.data(), header.compressed_bitmap_size); write_ptr += header.compressed_bitmap_size; }
-    if (header.compressed_mask_size > 0) { memcpy(write_ptr, compressed_mask.data(), header.compressed_mask_size); write_ptr += header.compressed_mask_size; }
-    if (header.compressed_reconstructed_size > 0) { memcpy(write_ptr, compressed_reconstructed.data(), header.compressed_reconstructed_size); }
-
-    std::cout << "    - Done. Final block size: " << final_block.size() << " bytes." << std::endl;
-    return final_block;
-}
-
-// KO: 단일 압축 블록을 복호화하는 전체 과정을 수행합니다.
-// EN: Performs the entire process of decompressing a single compressed block.
-std::vector<uint8_t> decompress_block(const std::vector<uint8_t>& compressed_block_data) {
-    // --- 1단계: 블록 헤더 파싱 ---
-    // --- Step 1: Parse Block Header ---
-    std::cout << "  [1/4] Parsing block header..." << std::endl;
-    if (compressed_block_data.size() < sizeof(TriSplitBlockHeader)) {
-        std::cerr << "Error: Compressed data is smaller than header size." << std::endl;
-        return {};
-    }
-
-    TriSplitBlockHeader header;
-    memcpy(&header, compressed_block_data.data(), sizeof(header));
-
-    const uint8_t* read_ptr = compressed_block_data.data() + sizeof(header);
-    const uint8_t* data_end = compressed_block_data.data() + compressed_block_data.size();
-
-    // KO: 헤더에 기록된 크기 정보가 실제 데이터 크기와 맞는지 검증하여 데이터 손상을 확인합니다.
-    // EN: Validates if the size information in the header matches the actual data size to check for corruption.
-    if (read_ptr + header.compressed_bitmap_size > data_end ||
-        read_ptr + header.compressed_bitmap_size + header.compressed_mask_size > data_end ||
-        read_ptr + header.compressed_bitmap_size + header.compressed_mask_size + header.compressed_reconstructed_size > data_end) {
-        std::cerr << "Error: Corrupted block header, size mismatch." << std::endl;
-        return {};
-    }
-
-    // KO: 헤더 정보를 바탕으로 각 압축 스트림을 별도의 벡터로 분리합니다.
-    // EN: Separates each compressed stream into its own vector based on the header information.
-    std::vector<uint8_t> compressed_bitmap(read_ptr, read_ptr + header.compressed_bitmap_size);
-    read_ptr += header.compressed_bitmap_size;
-    std::vector<uint8_t> compressed_mask(read_ptr, read_ptr + header.compressed_mask_size);
-    read_ptr += header.compressed_mask_size;
-    std::vector<uint8_t> compressed_reconstructed_data(read_ptr, read_ptr + header.compressed_reconstructed_size);
-
-    // --- 2단계: 각 스트림 복호화 ---
-    // --- Step 2: Decompress Each Stream ---
-    std::cout << "  [2/4] Decompressing Value Bitmap & Auxiliary Mask streams..." << std::endl;
-    rANS_Coder byte_coder;
-    std::vector<uint8_t> value_bitmap = byte_coder.decode(compressed_bitmap);
-    std::vector<uint8_t> auxiliary_mask = byte_coder.decode(compressed_mask);
-
-    std::cout << "  [3/4] Decompressing Reconstructed stream with rANS engine..." << std::endl;
-    // KO: 헤더의 메타데이터 플래그를 읽어 복호화 함수에 전달합니다.
-    // EN: Reads the metadata flags from the header and passes them to the decompression function.
-    bool is_placeholder_common = (header.metadata_flags & (1 << 1));
-    std::vector<uint8_t> reconstructed_stream = byte_coder.decode_reconstructed_stream(compressed_reconstructed_data, is_placeholder_common);
-
-    // --- 3단계: 최종 데이터 재조립 ---
-    // --- Step 3: Reconstruct Final Data ---
-    std::cout << "  [4/4] Reconstructing final data..." << std::endl;
-    SeparationEngine separation_engine;
-    bool aux_mask_1_represents_11 = (header.metadata_flags & (1 << 0));
-
-    std::vector<uint8_t> original_block = separation_engine.reconstruct(
-        value_bitmap,
-        auxiliary_mask,
-        reconstructed_stream,
-        aux_mask_1_represents_11,
-        header.original_data_size
-    );
-
-    std::cout << "    - Done. Decompressed block size: " << original_block.size() << " bytes." << std::endl;
-    return original_block;
-}
\ No newline at end of file
@@ -0,0 +1,67 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+// KO: 블록 헤더와 컨테이너에서 크기를 기록하는 LEB128 가변 길이 정수입니다.
+//     7비트씩 하위 비트부터 기록하며, 최상위 비트가 1이면 다음 바이트가 이어집니다. (127 이하는 1바이트)
+// EN: LEB128 variable-length integers, used for the sizes in block headers and in the container.
+//     7 bits are written at a time, least significant first, and a set top bit means another byte follows. (1 byte up to 127)
+constexpr size_t MAX_VARINT_SIZE = 10;
+
+// KO: 부호 없는 정수를 가변 길이 정수로 덧붙입니다.
+// EN: Appends an unsigned integer as a variable-length integer.
+inline void write_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline void write_varint(std::ostream& out, uint64_t value) {
+    std::vector<uint8_t> bytes;
+    write_varint(bytes, value);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+// KO: 값을 가변 길이 정수로 기록했을 때의 바이트 수를 반환합니다.
+// EN: Returns the number of bytes a value takes as a variable-length integer.
+inline size_t varint_size(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+// KO: 가변 길이 정수를 읽습니다. 데이터가 끝나거나 값이 64비트를 넘으면 false를 반환합니다.
+// EN: Reads a variable-length integer. Returns false if the data ends or the value exceeds 64 bits.
+inline bool read_varint(const uint8_t*& ptr, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (ptr == end) return false;
+        const uint8_t byte = *ptr++;
+        if (shift == 63 && byte > 1) return false;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+inline bool read_varint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        const int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) return false;
+        if (shift == 63 && byte > 1) return false;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
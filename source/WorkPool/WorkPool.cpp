@@ -0,0 +1,94 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 일괄 압축에서 모든 파일의 블록을 나눠 맡는 작업 훔치기 스레드 풀을 구현합니다.
+// EN: This file implements the work-stealing thread pool that shares the blocks of every file in batch compression.
+#include "WorkPool.h"
+#include <algorithm>
+
+// KO: 현재 스레드가 이 풀의 작업자이면 그 풀과 작업자 번호입니다. 작업자가 넣은 작업을 자기 큐로 보내는 데 씁니다.
+// EN: The pool and worker number of the current thread, if it is a worker. Used to route tasks a worker submits to its own queue.
+static thread_local const WorkStealingPool* current_pool = nullptr;
+static thread_local unsigned current_worker = 0;
+
+WorkStealingPool::WorkStealingPool(unsigned n_threads) {
+    if (n_threads == 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < n_threads; ++t) queues.push_back(std::make_unique<WorkerQueue>());
+    workers.reserve(n_threads);
+    for (unsigned t = 0; t < n_threads; ++t) workers.emplace_back(&WorkStealingPool::run, this, t);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void WorkStealingPool::submit(Task task) {
+    unsigned target;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        target = (current_pool == this) ? current_worker : next_queue++ % size();
+        queued++;
+        unfinished++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    work_available.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    all_done.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool WorkStealingPool::pop_local(unsigned worker, Task& task) {
+    WorkerQueue& queue = *queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(unsigned worker, Task& task) {
+    // KO: 바로 다음 작업자부터 돌아가며 살펴, 여러 도둑이 같은 큐에 몰리지 않게 합니다.
+    // EN: Victims are visited starting from the next worker, so several thieves do not pile onto the same queue.
+    for (unsigned i = 1; i < size(); ++i) {
+        WorkerQueue& queue = *queues[(worker + i) % size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::run(unsigned worker) {
+    current_pool = this;
+    current_worker = worker;
+    for (;;) {
+        {
+            // KO: 대기 작업 수를 먼저 줄여 자리를 맡은 뒤 큐에서 꺼냅니다. 큐에 넣는 쪽이 수를 먼저 늘리므로,
+            //     자리를 맡은 작업자는 어느 큐에서든 작업을 반드시 찾습니다.
+            // EN: A worker first claims a task by decrementing the queued count, then takes one from the queues. Submitters
+            //     increment the count first, so a worker holding a claim always finds a task in some queue.
+            std::unique_lock<std::mutex> lock(state_mutex);
+            work_available.wait(lock, [this] { return queued > 0 || stopping; });
+            if (queued == 0) return;
+            queued--;
+        }
+        Task task;
+        while (!pop_local(worker, task) && !steal(worker, task)) std::this_thread::yield();
+        task(worker);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (--unfinished == 0) all_done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// KO: 작업 훔치기 스레드 풀입니다. 작업자마다 자기 작업 큐가 있어, 작업자가 넣은 작업은 자기 큐의 뒤에서 꺼내고(LIFO),
+//     자기 큐가 비면 다른 작업자 큐의 앞에서 훔칩니다(FIFO). 작업자가 아닌 스레드가 넣은 작업은 큐에 돌아가며 나눠 넣습니다.
+//     따라서 작업의 크기가 제각각이어도(작은 파일과 큰 파일의 블록이 섞여도) 일이 남은 동안 모든 작업자가 바쁩니다.
+//     작업은 자기를 실행하는 작업자 번호를 받으므로, 작업자별 버퍼를 잠금 없이 재사용할 수 있습니다.
+// EN: A work-stealing thread pool. Every worker has its own task queue: tasks a worker submits are taken from the back of
+//     its own queue (LIFO), and a worker whose queue is empty steals from the front of another worker's queue (FIFO).
+//     Tasks submitted from outside the pool are dealt round-robin across the queues. All workers thus stay busy while work
+//     remains, however uneven the tasks are (blocks of small and large files mixed together).
+//     A task receives the number of the worker running it, so per-worker buffers can be reused without locking.
+class WorkStealingPool {
+public:
+    using Task = std::function<void(unsigned worker)>;
+
+    // KO: @param n_threads - 작업자 수 (0이면 하드웨어 스레드 수)
+    // EN: @param n_threads - The number of workers (0 for the hardware thread count)
+    explicit WorkStealingPool(unsigned n_threads = 0);
+
+    // KO: 남은 작업을 모두 마친 뒤 작업자를 종료합니다.
+    // EN: Finishes every remaining task, then stops the workers.
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // KO: 작업을 넣습니다. 작업은 예외를 던지지 않아야 합니다.
+    // EN: Submits a task. Tasks must not throw.
+    void submit(Task task);
+
+    // KO: 지금까지 넣은 작업이 모두 끝날 때까지 기다립니다. 작업자 안에서 호출하면 안 됩니다.
+    // EN: Waits until every task submitted so far has finished. Must not be called from inside a worker.
+    void wait();
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(unsigned worker);
+    bool pop_local(unsigned worker, Task& task);
+    bool steal(unsigned worker, Task& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    // KO: 대기 중인 작업 수와 끝나지 않은 작업 수입니다. 작업자는 대기 작업이 없을 때만 잠듭니다.
+    // EN: The numbers of queued and unfinished tasks. Workers only sleep while nothing is queued.
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    size_t queued = 0;
+    size_t unfinished = 0;
+    unsigned next_queue = 0;
+    bool stopping = false;
+};
@@ -1,124 +1,775 @@
 ﻿// Author: SnowPing00
 // KO: 이 파일은 rANS_Coder 클래스의 멤버 함수들을 구현합니다.
-//     rANS_Coder는 Fabian 'ryg' Giesen의 'rans_byte.h' 라이브러리를 사용하여,
+//     rANS_Coder는 Fabian 'ryg' Giesen의 'rans_byte.h' / 'rans64.h' 라이브러리를 사용하여,
 //     TriSplit 프로젝트에 필요한 특정 종류의 데이터 스트림(바이너리, 비트, 재구성 스트림)을
 //     압축 및 복호화하는 고수준 인터페이스를 제공합니다.
 // EN: This file implements the member functions of the rANS_Coder class.
-//     rANS_Coder uses Fabian 'ryg' Giesen's 'rans_byte.h' library to provide
+//     rANS_Coder uses Fabian 'ryg' Giesen's 'rans_byte.h' / 'rans64.h' libraries to provide
 //     a high-level interface for compressing and decompressing specific types of data streams
 //     (binary, bit, reconstructed streams) required for the TriSplit project.
 #include "rANS_Coder.h"
 #include "../rans_byte.h"
+#include "../rans64.h"
 #include <stdexcept>
 #include <vector>
 #include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <optional>
+#include <iterator>
+#include <type_traits>
+#include "../Varint/Varint.h"
 
-// --- ENCODE (Legacy byte-wise encoder) ---
-// --- 인코딩 (기존 바이트 단위 인코더) ---
-// KO: 0 또는 1의 값을 갖는 바이트(uint8_t) 스트림을 rANS 알고리즘으로 압축합니다.
-// EN: Compresses a stream of bytes (uint8_t) containing values of 0 or 1 using the rANS algorithm.
-std::vector<uint8_t> rANS_Coder::encode(const std::vector<uint8_t>& symbol_stream) {
-    if (symbol_stream.empty()) {
-        return {};
+// KO: x64에서는 레인 배치 복호기의 AVX2 / AVX-512 커널을 함께 빌드하고, 실행 시 CPU를 확인하여 고릅니다.
+//     TRISPLIT_NO_LANE_SIMD를 정의하면 스칼라 커널만 사용합니다.
+// EN: On x64 the AVX2 / AVX-512 kernels of the lane-interleaved decoder are built as well, and picked by checking the CPU at run time.
+//     Defining TRISPLIT_NO_LANE_SIMD keeps only the scalar kernel.
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(TRISPLIT_NO_LANE_SIMD)
+#define TRISPLIT_HAVE_LANE_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TRISPLIT_TARGET_AVX2
+#define TRISPLIT_TARGET_AVX512
+// KO: CPUID 7번 잎의 EBX 비트와, 운영체제가 해당 레지스터 상태를 저장하는지(XCR0)를 함께 확인합니다.
+// EN: Checks a bit of EBX in CPUID leaf 7 together with whether the operating system saves the matching register state (XCR0).
+static bool cpu_supports(unsigned leaf7_ebx_bit, unsigned long long xcr0_mask) {
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7) return false;
+    __cpuid(regs, 1);
+    if (!(regs[2] & (1 << 27)) || (_xgetbv(0) & xcr0_mask) != xcr0_mask) return false;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << leaf7_ebx_bit)) != 0;
+}
+static bool cpu_has_avx2() { return cpu_supports(5, 0x06); }
+static bool cpu_has_avx512f() { return cpu_supports(16, 0xE6); }
+#else
+#define TRISPLIT_TARGET_AVX2 __attribute__((target("avx2")))
+#define TRISPLIT_TARGET_AVX512 __attribute__((target("avx512f")))
+static bool cpu_has_avx2() { return __builtin_cpu_supports("avx2"); }
+static bool cpu_has_avx512f() { return __builtin_cpu_supports("avx512f"); }
+#endif
+#endif
+
+rANS_Coder::rANS_Coder(StreamHeaderVersion header_version, RansEngine engine, uint64_t chunk_bits)
+    : header_version(header_version), engine(engine), chunk_bits(chunk_bits) {
+    if (chunk_bits % 64 != 0) {
+        throw std::invalid_argument("The frequency chunk size must be a multiple of 64 bits.");
+    }
+    if (engine == RansEngine::RansLanes && chunk_bits != 0) {
+        throw std::invalid_argument("The lane-interleaved engine does not support chunked frequencies.");
     }
+}
+
+// KO: 지정된 형식의 스트림 헤더 크기(바이트)를 반환합니다.
+// EN: Returns the size in bytes of a stream header in the given format.
+static size_t stream_header_size(StreamHeaderVersion version) {
+    if (version == StreamHeaderVersion::Detached) return 0;
+    return (version == StreamHeaderVersion::V1) ? 8 : 12;
+}
 
-    const uint32_t total_symbols = static_cast<uint32_t>(symbol_stream.size());
-    uint32_t freqs[2] = { 0, 0 }; // [0] = '0'의 빈도, [1] = '1'의 빈도
-    for (uint8_t sym : symbol_stream) {
-        if (sym < 2) freqs[sym]++;
+// KO: 스트림 헤더(심볼 수, norm_freqs[0])를 출력 버퍼의 앞부분에 기록합니다.
+//     V1 형식은 32비트 심볼 수만 표현할 수 있으므로, 이를 넘으면 조용히 잘리지 않도록 예외를 던집니다.
+// EN: Writes the stream header (symbol count, norm_freqs[0]) at the front of the output buffer.
+//     The V1 format can only express a 32-bit symbol count, so an exception is thrown instead of silently truncating it.
+static void write_stream_header(uint8_t* out, StreamHeaderVersion version, uint64_t total_symbols, uint32_t norm_freq0, StreamDescriptor* descriptor) {
+    if (descriptor != nullptr) {
+        descriptor->symbol_count = total_symbols;
+        descriptor->norm_freq0 = norm_freq0;
+    }
+    if (version == StreamHeaderVersion::Detached) {
+        return;
     }
+    if (version == StreamHeaderVersion::V1) {
+        if (total_symbols > UINT32_MAX) {
+            throw std::length_error("Stream too large for a V1 stream header (2^32 symbols or more).");
+        }
+        uint32_t total32 = static_cast<uint32_t>(total_symbols);
+        memcpy(out, &total32, 4);
+        memcpy(out + 4, &norm_freq0, 4);
+    }
+    else {
+        memcpy(out, &total_symbols, 8);
+        memcpy(out + 8, &norm_freq0, 4);
+    }
+}
 
-    const uint32_t scale_bits = 14;
-    const uint32_t prob_scale = 1 << scale_bits;
+// KO: 압축 데이터의 앞부분에서 스트림 헤더를 읽고, 헤더 크기를 반환합니다.
+//     Detached 형식에서는 호출자가 제공한 StreamDescriptor를 사용합니다.
+// EN: Reads the stream header from the front of the compressed data and returns the header size.
+//     With the Detached format, the StreamDescriptor supplied by the caller is used.
+static size_t read_stream_header(const std::vector<uint8_t>& compressed_data, StreamHeaderVersion version, const StreamDescriptor* descriptor, uint64_t& total_symbols, uint32_t& norm_freq0) {
+    if (version == StreamHeaderVersion::Detached) {
+        if (descriptor == nullptr) {
+            throw std::invalid_argument("A detached stream needs a stream descriptor.");
+        }
+        total_symbols = descriptor->symbol_count;
+        norm_freq0 = descriptor->norm_freq0;
+        return 0;
+    }
+    const size_t header_size = stream_header_size(version);
+    if (compressed_data.size() < header_size) {
+        throw std::runtime_error("Invalid compressed data: header too small.");
+    }
+    if (version == StreamHeaderVersion::V1) {
+        uint32_t total32;
+        memcpy(&total32, compressed_data.data(), 4);
+        memcpy(&norm_freq0, compressed_data.data() + 4, 4);
+        total_symbols = total32;
+    }
+    else {
+        memcpy(&total_symbols, compressed_data.data(), 8);
+        memcpy(&norm_freq0, compressed_data.data() + 8, 4);
+    }
+    return header_size;
+}
 
-    if (freqs[0] == 0 || freqs[1] == 0) {
-        std::vector<uint8_t> output(8);
-        uint32_t freq0_val = (freqs[0] == 0) ? 0 : prob_scale;
-        memcpy(output.data(), &total_symbols, 4);
-        memcpy(output.data() + 4, &freq0_val, 4);
-        return output;
+// KO: 두 이진 심볼의 빈도를 prob_scale 합으로 정규화합니다.
+//     등장한 심볼은 심볼 수가 매우 큰 대형 블록에서도 반드시 1 이상의 빈도를 받습니다.
+// EN: Normalizes the frequencies of the two binary symbols so that they sum to prob_scale.
+//     A symbol that occurs always receives a frequency of at least 1, even in very large blocks.
+static void normalize_binary_freqs(const uint64_t freqs[2], uint32_t norm_freqs[2], uint32_t prob_scale) {
+    const uint64_t total = freqs[0] + freqs[1];
+    uint64_t freq0 = ((uint64_t)prob_scale * freqs[0]) / total;
+    if (freqs[0] > 0 && freq0 == 0) freq0 = 1;
+    if (freqs[1] > 0 && freq0 == prob_scale) freq0 = prob_scale - 1;
+    norm_freqs[0] = static_cast<uint32_t>(freq0);
+    norm_freqs[1] = prob_scale - norm_freqs[0];
+}
+
+// --- MAX_ENCODED_SIZE ---
+// KO: rANS 출력 크기의 최악 상한입니다. 증명의 개요는 다음과 같습니다.
+//     - 인코더 상태 x는 하한 L에서 시작하고, 각 심볼 인코딩 후에도 항상 L 이상입니다.
+//     - 빈도 f인 심볼 하나를 인코딩하면 log2(x)는 최대 log2(M/f) + log2(1 + f/x)만큼 증가합니다.
+//       (C(s,x) <= (x/f)*M + M = (x*M/f)*(1 + f/x)) 재정규화 후 x >= 2^7 * f 이므로 두 번째 항은 2^-6비트 미만입니다.
+//     - 출력 단위(바이트 또는 32비트 워드)를 하나 내보낼 때마다 log2(x)는 그 비트 수 이상 감소합니다.
+//     따라서 내보낸 비트 수는 sum(log2(M/f_s) + 2^-6) 이하입니다.
+//     비용은 1/256비트 고정소수점으로 올림하여 계산하며, 여기에 워드 반올림, 플러시 8바이트와 여유분을 더합니다.
+// EN: Worst-case upper bound of the rANS output size. Outline of the proof:
+//     - The encoder state x starts at the lower bound L and stays at or above L after every symbol.
+//     - Encoding a symbol with frequency f grows log2(x) by at most log2(M/f) + log2(1 + f/x)
+//       (C(s,x) <= (x/f)*M + M = (x*M/f)*(1 + f/x)); after renormalization x >= 2^7 * f, so the second term is below 2^-6 bits.
+//     - Every emitted output unit (a byte, or a 32-bit word) shrinks log2(x) by at least its width in bits.
+//     Hence the number of emitted bits is at most sum(log2(M/f_s) + 2^-6).
+//     Costs are rounded up in 1/256-bit fixed point, then word rounding, the 8-byte flush and some slack are added.
+size_t rANS_Coder::max_encoded_size(uint64_t count0, uint64_t count1, uint32_t norm_freq0, uint32_t norm_freq1, uint32_t scale_bits) {
+    const double prob_scale = static_cast<double>(1u << scale_bits);
+    auto cost_per_symbol = [&](uint32_t freq) -> uint64_t {
+        // KO: 1/256비트 단위로 올림한 뒤 4단위(2^-6비트)를 더해 log2(1 + f/x)와 부동소수점 오차를 흡수합니다.
+        // EN: Rounds up in 1/256-bit units, then adds 4 units (2^-6 bits) to absorb log2(1 + f/x) and floating-point error.
+        return static_cast<uint64_t>(std::ceil(256.0 * std::log2(prob_scale / freq))) + 4;
+    };
+
+    uint64_t total_cost = 0;
+    if (count0 > 0) total_cost += count0 * cost_per_symbol(norm_freq0);
+    if (count1 > 0) total_cost += count1 * cost_per_symbol(norm_freq1);
+    return static_cast<size_t>(total_cost / (256 * 8)) + 4 + 8 + 16;
+}
+
+// KO: 레인 배치 출력 크기의 최악 상한입니다. 증명은 max_encoded_size와 같되, 재정규화 뒤의 상태가 빈도의 8배 이상일 뿐이므로
+//     심볼마다 log2(1 + 1/8)비트를 더하고, 레인마다 따로 내보내는 워드는 각 레인의 비용을 넘지 않습니다. 플러시는 상태 32개입니다.
+// EN: Worst-case upper bound of the lane-interleaved output size. The proof is that of max_encoded_size, except that a renormalized state is
+//     only at least 8 times the frequency, so log2(1 + 1/8) bits are added per symbol; the words every lane emits on its own never exceed
+//     the cost of that lane. The flush is the 32 states.
+static size_t max_lane_encoded_size(uint64_t count0, uint64_t count1, uint32_t norm_freq0, uint32_t norm_freq1, uint32_t scale_bits, size_t flush_bytes) {
+    const double prob_scale = static_cast<double>(1u << scale_bits);
+    const uint64_t renorm_cost = static_cast<uint64_t>(std::ceil(256.0 * std::log2(9.0 / 8.0)));
+    auto cost_per_symbol = [&](uint32_t freq) -> uint64_t {
+        return static_cast<uint64_t>(std::ceil(256.0 * std::log2(prob_scale / freq))) + renorm_cost + 1;
+    };
+
+    uint64_t total_cost = 0;
+    if (count0 > 0) total_cost += count0 * cost_per_symbol(norm_freq0);
+    if (count1 > 0) total_cost += count1 * cost_per_symbol(norm_freq1);
+    return static_cast<size_t>(total_cost / (256 * 8)) + flush_bytes + 16;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++ Binary Encoder / Decoder Kernels
+// +++ 이진 인코더 / 디코더 커널
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 바이트 단위 rANS(32비트 상태) 이진 인코더입니다.
+//     RansEncSymbol을 미리 계산해 두어, 심볼마다 나눗셈 대신 역수 곱셈을 사용합니다.
+// EN: Byte-wise rANS (32-bit state) binary encoder.
+//     Precomputes the RansEncSymbols so that every symbol uses a reciprocal multiply instead of a division.
+struct RansByteBinaryEncoder {
+    static constexpr uint32_t scale_bits = 14;
+
+    std::vector<uint8_t> buffer;
+    uint8_t* ptr;
+    RansState state;
+    RansEncSymbol esyms[2];
+
+    RansByteBinaryEncoder(size_t capacity_bytes, const uint32_t norm_freqs[2]) : buffer(capacity_bytes) {
+        ptr = buffer.data() + buffer.size();
+        RansEncInit(&state);
+        set_freqs(norm_freqs);
     }
 
-    uint32_t norm_freqs[2];
-    uint32_t cum_freqs[3] = { 0, freqs[0], freqs[0] + freqs[1] };
-    for (int i = 1; i <= 2; i++) {
-        cum_freqs[i] = ((uint64_t)prob_scale * cum_freqs[i]) / total_symbols;
-    }
-    for (int i = 0; i < 2; i++) {
-        if (freqs[i] > 0 && cum_freqs[i + 1] == cum_freqs[i]) {
-            if (i == 0) { if (cum_freqs[2] > cum_freqs[1]) cum_freqs[2]--; }
-            else { if (cum_freqs[1] > cum_freqs[0]) cum_freqs[1]--; }
+    // KO: 이후 심볼에 사용할 빈도를 바꿉니다. (여러 스트림을 하나의 상태로 이어서 부호화할 때 사용)
+    // EN: Changes the frequencies used for the following symbols. (Used when several streams are coded with one state)
+    void set_freqs(const uint32_t norm_freqs[2]) {
+        RansEncSymbolInit(&esyms[0], 0, norm_freqs[0], scale_bits);
+        RansEncSymbolInit(&esyms[1], norm_freqs[0], norm_freqs[1], scale_bits);
+    }
+
+    inline void put(uint32_t bit) {
+        RansEncPutSymbol(&state, &ptr, &esyms[bit]);
+    }
+
+    // KO: 인코더를 플러시하고, 헤더 자리를 남긴 채 페이로드를 출력 벡터에 복사합니다.
+    // EN: Flushes the encoder and copies the payload into the output vector, leaving room for the header.
+    void finish(std::vector<uint8_t>& output, size_t header_size) {
+        RansEncFlush(&state, &ptr);
+        size_t payload_size = (buffer.data() + buffer.size()) - ptr;
+        output.resize(header_size + payload_size);
+        memcpy(output.data() + header_size, ptr, payload_size);
+    }
+};
+
+// KO: 64비트 상태 rANS(rans64) 이진 인코더입니다. 32비트 워드 단위로 재정규화하므로 분기가 적고,
+//     24비트 확률 정밀도로 희소 스트림(auxiliary_mask)의 양자화 손실도 줄어듭니다.
+// EN: 64-bit state rANS (rans64) binary encoder. It renormalizes in 32-bit words, so it branches less,
+//     and its 24-bit probability precision also reduces the quantization loss on sparse streams (auxiliary_mask).
+struct Rans64BinaryEncoder {
+    static constexpr uint32_t scale_bits = 24;
+
+    std::vector<uint32_t> buffer;
+    uint32_t* ptr;
+    Rans64State state;
+    Rans64EncSymbol esyms[2];
+
+    Rans64BinaryEncoder(size_t capacity_bytes, const uint32_t norm_freqs[2]) : buffer((capacity_bytes + 3) / 4) {
+        ptr = buffer.data() + buffer.size();
+        Rans64EncInit(&state);
+        set_freqs(norm_freqs);
+    }
+
+    void set_freqs(const uint32_t norm_freqs[2]) {
+        Rans64EncSymbolInit(&esyms[0], 0, norm_freqs[0], scale_bits);
+        Rans64EncSymbolInit(&esyms[1], norm_freqs[0], norm_freqs[1], scale_bits);
+    }
+
+    inline void put(uint32_t bit) {
+        Rans64EncPutSymbol(&state, &ptr, &esyms[bit], scale_bits);
+    }
+
+    void finish(std::vector<uint8_t>& output, size_t header_size) {
+        Rans64EncFlush(&state, &ptr);
+        size_t payload_size = ((buffer.data() + buffer.size()) - ptr) * sizeof(uint32_t);
+        output.resize(header_size + payload_size);
+        memcpy(output.data() + header_size, ptr, payload_size);
+    }
+};
+
+// KO: 바이트 단위 rANS 이진 디코더입니다. cum2sym 테이블 대신 norm_freqs[0]과의 비교로 심볼을 찾습니다.
+//     상태가 [RANS_BYTE_L, RANS_BYTE_L << 8) 안에 있으면 심볼 하나는 최대 2바이트를 읽으므로, 페이로드를 출력 워드 하나
+//     (접두 비트 쌍을 포함해 최대 128 심볼)가 읽을 수 있는 만큼 0을 덧붙인 버퍼로 복사하고, 워드마다 check_end로 끝을 확인합니다.
+// EN: Byte-wise rANS binary decoder. Finds the symbol by comparing against norm_freqs[0] instead of a cum2sym table.
+//     With the state within [RANS_BYTE_L, RANS_BYTE_L << 8) a symbol reads at most 2 bytes, so the payload is copied into a buffer
+//     padded with as many zeros as one output word (up to 128 symbols with prefix pairs) can read, and check_end checks the end after every word.
+struct RansByteBinaryDecoder {
+    static constexpr uint32_t scale_bits = 14;
+    static constexpr size_t padding = 2 * 128;
+
+    std::vector<uint8_t> bytes;
+    uint8_t* ptr;
+    const uint8_t* end;
+    RansState state;
+    uint32_t freq0;
+    RansDecSymbol dsyms[2];
+
+    RansByteBinaryDecoder(const std::vector<uint8_t>& compressed_data, size_t header_size, const uint32_t norm_freqs[2]) {
+        if (compressed_data.size() < header_size + 4) {
+            throw std::runtime_error("Invalid compressed data: missing rANS state.");
         }
+        const size_t payload_size = compressed_data.size() - header_size;
+        bytes.assign(compressed_data.begin() + header_size, compressed_data.end());
+        bytes.resize(payload_size + padding, 0);
+
+        set_freqs(norm_freqs);
+        ptr = bytes.data();
+        end = bytes.data() + payload_size;
+        RansDecInit(&state, &ptr);
+        if (state < RANS_BYTE_L || state >= (RANS_BYTE_L << 8)) {
+            throw std::runtime_error("Invalid compressed data: corrupted rANS state.");
+        }
+    }
+
+    void set_freqs(const uint32_t norm_freqs[2]) {
+        freq0 = norm_freqs[0];
+        RansDecSymbolInit(&dsyms[0], 0, norm_freqs[0]);
+        RansDecSymbolInit(&dsyms[1], norm_freqs[0], norm_freqs[1]);
     }
-    norm_freqs[0] = cum_freqs[1] - cum_freqs[0];
-    norm_freqs[1] = cum_freqs[2] - cum_freqs[1];
 
-    size_t original_size = symbol_stream.size();
-    std::vector<uint8_t> compressed_buffer(original_size + (original_size / 5) + 16);
-    uint8_t* ptr = compressed_buffer.data() + compressed_buffer.size();
+    inline uint32_t get() {
+        uint32_t s = (RansDecGet(&state, scale_bits) >= freq0) ? 1 : 0;
+        RansDecAdvanceSymbol(&state, &ptr, &dsyms[s], scale_bits);
+        return s;
+    }
 
-    RansState rans;
-    RansEncInit(&rans);
-    for (size_t i = symbol_stream.size(); i > 0; --i) {
-        uint8_t s = symbol_stream[i - 1];
-        if (s == 0) RansEncPut(&rans, &ptr, 0, norm_freqs[0], scale_bits);
-        else RansEncPut(&rans, &ptr, norm_freqs[0], norm_freqs[1], scale_bits);
+    void check_end() const {
+        if (ptr > end) {
+            throw std::runtime_error("Invalid compressed data: rANS stream read past the payload.");
+        }
     }
-    RansEncFlush(&rans, &ptr);
+};
 
-    size_t compressed_size = (compressed_buffer.data() + compressed_buffer.size()) - ptr;
-    std::vector<uint8_t> final_output(8 + compressed_size);
-    memcpy(final_output.data(), &total_symbols, 4);
-    memcpy(final_output.data() + 4, &norm_freqs[0], 4);
-    memcpy(final_output.data() + 8, ptr, compressed_size);
+// KO: 64비트 상태 rANS(rans64) 이진 디코더입니다. 워드 정렬을 보장하기 위해 페이로드를 uint32_t 버퍼로 복사합니다.
+//     심볼 하나는 최대 한 워드를 읽으므로, 버퍼에는 출력 워드 하나(최대 128 심볼)가 읽을 수 있는 만큼 0 워드를 덧붙입니다.
+// EN: 64-bit state rANS (rans64) binary decoder. Copies the payload into a uint32_t buffer to guarantee word alignment.
+//     A symbol reads at most one word, so the buffer is padded with as many zero words as one output word (up to 128 symbols) can read.
+struct Rans64BinaryDecoder {
+    static constexpr uint32_t scale_bits = 24;
+    static constexpr size_t padding = 128;
 
-    return final_output;
+    std::vector<uint32_t> words;
+    uint32_t* ptr;
+    const uint32_t* end;
+    Rans64State state;
+    uint32_t freq0;
+    Rans64DecSymbol dsyms[2];
+
+    Rans64BinaryDecoder(const std::vector<uint8_t>& compressed_data, size_t header_size, const uint32_t norm_freqs[2]) {
+        if (compressed_data.size() < header_size + 8) {
+            throw std::runtime_error("Invalid compressed data: missing rANS state.");
+        }
+        const size_t payload_size = compressed_data.size() - header_size;
+        words.assign((payload_size + 3) / 4 + padding, 0);
+        memcpy(words.data(), compressed_data.data() + header_size, payload_size);
+
+        set_freqs(norm_freqs);
+        ptr = words.data();
+        end = words.data() + (payload_size + 3) / 4;
+        Rans64DecInit(&state, &ptr);
+        if (state < RANS64_L) {
+            throw std::runtime_error("Invalid compressed data: corrupted rANS state.");
+        }
+    }
+
+    void set_freqs(const uint32_t norm_freqs[2]) {
+        freq0 = norm_freqs[0];
+        Rans64DecSymbolInit(&dsyms[0], 0, norm_freqs[0]);
+        Rans64DecSymbolInit(&dsyms[1], norm_freqs[0], norm_freqs[1]);
+    }
+
+    inline uint32_t get() {
+        uint32_t s = (Rans64DecGet(&state, scale_bits) >= freq0) ? 1 : 0;
+        Rans64DecAdvanceSymbol(&state, &ptr, &dsyms[s], scale_bits);
+        return s;
+    }
+
+    void check_end() const {
+        if (ptr > end) {
+            throw std::runtime_error("Invalid compressed data: rANS stream read past the payload.");
+        }
+    }
+};
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++ Lane-Interleaved Binary Kernels (RansLanes)
+// +++ 레인 배치 이진 커널 (RansLanes)
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 레인 배치의 매개변수입니다. 상태는 [LANE_L, LANE_L << 16) 범위에 머무르므로 항상 2^31 미만이며, 따라서 rans_byte.h의
+//     역수 곱셈이 정확하고 SIMD의 부호 있는 32비트 비교를 그대로 쓸 수 있습니다. LANE_L >> scale_bits = 8이므로,
+//     재정규화 뒤의 상태는 항상 빈도의 8배 이상입니다.
+//     페이로드: [uint32 상태 x 32 (레인 순서)][uint16 워드...]
+// EN: The parameters of the lane layout. The states stay within [LANE_L, LANE_L << 16), always below 2^31, so the reciprocal
+//     multiplies of rans_byte.h are exact and SIMD can use signed 32-bit compares as they are. LANE_L >> scale_bits = 8,
+//     so a renormalized state is always at least 8 times the frequency.
+//     Payload: [uint32 state x 32 (in lane order)][uint16 words...]
+constexpr unsigned LANE_COUNT = 32;
+constexpr uint32_t LANE_SCALE_BITS = 12;
+constexpr uint32_t LANE_L = 1u << 15;
+
+// KO: 복호기가 페이로드 뒤에 덧붙이는 0 워드 수입니다. 출력 워드 하나(두 그룹)는 최대 64워드를 읽고, SIMD 적재는 16워드를 더 읽습니다.
+// EN: The number of zero words the decoder pads the payload with. One output word (two groups) reads at most 64 words, and a SIMD load reads 16 more.
+constexpr size_t LANE_PADDING_WORDS = 2 * LANE_COUNT + 16;
+
+// KO: 레인 배치 이진 인코더입니다. 심볼을 역순으로 받으므로 남은 심볼 수로 각 심볼의 레인을 알아냅니다.
+//     복호기는 그룹마다 레인 0부터 워드를 읽으므로, 역순으로 부호화하는 인코더는 자연히 그 역순으로 워드를 내보냅니다.
+// EN: Lane-interleaved binary encoder. It receives the symbols in reverse, so it tells the lane of every symbol from the count of symbols left.
+//     The decoder reads the words of every group from lane 0 up, so the encoder, coding in reverse, naturally emits them in the opposite order.
+struct LaneBinaryEncoder {
+    static constexpr uint32_t scale_bits = LANE_SCALE_BITS;
+
+    std::vector<uint16_t> buffer;
+    uint16_t* ptr;
+    uint32_t states[LANE_COUNT];
+    RansEncSymbol esyms[2];
+    uint64_t next_index;
+
+    LaneBinaryEncoder(size_t capacity_bytes, const uint32_t norm_freqs[2], uint64_t symbol_count) : buffer((capacity_bytes + 1) / 2), next_index(symbol_count) {
+        ptr = buffer.data() + buffer.size();
+        std::fill(std::begin(states), std::end(states), LANE_L);
+        set_freqs(norm_freqs);
+    }
+
+    // KO: RansEncSymbol의 역수는 그대로 쓰고, 재정규화 한계만 16비트 워드 출력에 맞게 바꿉니다.
+    // EN: Keeps the reciprocals of RansEncSymbol and only changes the renormalization bound to suit 16-bit word output.
+    void set_freqs(const uint32_t norm_freqs[2]) {
+        RansEncSymbolInit(&esyms[0], 0, norm_freqs[0], scale_bits);
+        RansEncSymbolInit(&esyms[1], norm_freqs[0], norm_freqs[1], scale_bits);
+        esyms[0].x_max = ((LANE_L >> scale_bits) << 16) * norm_freqs[0];
+        esyms[1].x_max = ((LANE_L >> scale_bits) << 16) * norm_freqs[1];
+    }
+
+    inline void put(uint32_t bit) {
+        uint32_t& x = states[--next_index % LANE_COUNT];
+        const RansEncSymbol& sym = esyms[bit];
+        if (x >= sym.x_max) {
+            *--ptr = static_cast<uint16_t>(x);
+            x >>= 16;
+        }
+        const uint32_t q = static_cast<uint32_t>((static_cast<uint64_t>(x) * sym.rcp_freq) >> 32) >> sym.rcp_shift;
+        x += sym.bias + q * sym.cmpl_freq;
+    }
+
+    // KO: 플러시는 32개 상태를 레인 순서대로 워드 앞에 기록합니다.
+    // EN: The flush writes the 32 states, in lane order, in front of the words.
+    void finish(std::vector<uint8_t>& output, size_t header_size) {
+        const size_t word_bytes = ((buffer.data() + buffer.size()) - ptr) * sizeof(uint16_t);
+        output.resize(header_size + sizeof(states) + word_bytes);
+        memcpy(output.data() + header_size, states, sizeof(states));
+        memcpy(output.data() + header_size + sizeof(states), ptr, word_bytes);
+    }
+};
+
+// KO: 한 그룹에서 레인 0부터 n_lanes개 레인의 심볼을 복호화하여, 레인 k의 심볼을 k번 비트에 모읍니다. (스칼라 커널과 마지막 부분 워드용)
+// EN: Decodes the symbols of lanes 0 to n_lanes of one group, gathering the symbol of lane k into bit k. (For the scalar kernel and the final partial word)
+static inline uint32_t decode_lane_group(uint32_t* states, const uint16_t*& ptr, uint32_t freq0, unsigned n_lanes) {
+    const uint32_t freq1 = (1u << LANE_SCALE_BITS) - freq0;
+    uint32_t bits = 0;
+    for (unsigned k = 0; k < n_lanes; ++k) {
+        uint32_t x = states[k];
+        const uint32_t slot = x & ((1u << LANE_SCALE_BITS) - 1);
+        const uint32_t s = (slot >= freq0) ? 1 : 0;
+        x = (s ? freq1 : freq0) * (x >> LANE_SCALE_BITS) + slot - (s ? freq0 : 0);
+        if (x < LANE_L) x = (x << 16) | *ptr++;
+        states[k] = x;
+        bits |= s << k;
+    }
+    return bits;
 }
 
-// --- DECODE (Legacy byte-wise decoder) ---
-// --- 디코딩 (기존 바이트 단위 디코더) ---
-// KO: `encode` 함수로 압축된 데이터를 원본 바이트 스트림으로 복호화합니다.
-// EN: Decodes data compressed by the `encode` function back into the original byte stream.
-std::vector<uint8_t> rANS_Coder::decode(const std::vector<uint8_t>& compressed_data) {
-    if (compressed_data.size() < 8) {
-        throw std::runtime_error("Invalid compressed data: header too small.");
+// KO: 레인 커널은 출력 워드 n_words개(그룹 2개씩)를 복호화하여, 워드 안의 심볼 i를 i번 비트에 둡니다.
+//     손상된 데이터가 덧붙인 0 워드 너머를 읽지 않도록 워드마다 읽기 위치를 확인하며, 복호화한 워드 수를 반환합니다.
+// EN: A lane kernel decodes n_words output words (two groups each), placing symbol i of a word in bit i.
+//     It checks the read position at every word so that corrupted data cannot read past the zero padding, and returns the number of words decoded.
+using LaneKernel = size_t (*)(uint32_t* states, const uint16_t*& ptr, const uint16_t* end, uint32_t freq0, uint64_t* out, size_t n_words);
+
+static size_t decode_lane_words_scalar(uint32_t* states, const uint16_t*& ptr, const uint16_t* end, uint32_t freq0, uint64_t* out, size_t n_words) {
+    size_t w = 0;
+    for (; w < n_words && ptr <= end; ++w) {
+        const uint64_t low = decode_lane_group(states, ptr, freq0, LANE_COUNT);
+        out[w] = low | (static_cast<uint64_t>(decode_lane_group(states, ptr, freq0, LANE_COUNT)) << 32);
+    }
+    return w;
+}
+
+#ifdef TRISPLIT_HAVE_LANE_SIMD
+// KO: AVX2는 확장 적재가 없으므로, 8개 워드를 적재한 뒤 재정규화할 레인의 마스크로 찾은 순열로 워드를 각 레인에 펼칩니다.
+// EN: AVX2 has no expanding load, so it loads 8 words and spreads them onto the lanes with a permutation looked up by the mask of lanes to renormalize.
+struct LanePermuteTable {
+    uint32_t index[256][8];
+};
+
+static constexpr LanePermuteTable make_lane_permute_table() {
+    LanePermuteTable table{};
+    for (unsigned mask = 0; mask < 256; ++mask) {
+        uint32_t next = 0;
+        for (unsigned lane = 0; lane < 8; ++lane) table.index[mask][lane] = ((mask >> lane) & 1) ? next++ : 0;
     }
+    return table;
+}
 
-    uint32_t total_symbols;
-    uint32_t norm_freqs[2];
-    const uint32_t scale_bits = 14;
-    const uint32_t prob_scale = 1 << scale_bits;
+alignas(32) static constexpr LanePermuteTable LANE_REFILL_PERMUTE = make_lane_permute_table();
 
-    memcpy(&total_symbols, compressed_data.data(), 4);
-    memcpy(&norm_freqs[0], compressed_data.data() + 4, 4);
+TRISPLIT_TARGET_AVX2
+static size_t decode_lane_words_avx2(uint32_t* states, const uint16_t*& ptr, const uint16_t* end, uint32_t freq0, uint64_t* out, size_t n_words) {
+    const __m256i slot_mask = _mm256_set1_epi32((1 << LANE_SCALE_BITS) - 1);
+    const __m256i f0 = _mm256_set1_epi32(static_cast<int>(freq0));
+    const __m256i f0_minus_one = _mm256_set1_epi32(static_cast<int>(freq0) - 1);
+    const __m256i f1 = _mm256_set1_epi32(static_cast<int>((1u << LANE_SCALE_BITS) - freq0));
+    const __m256i lower_bound = _mm256_set1_epi32(static_cast<int>(LANE_L));
+    __m256i x[4];
+    for (int r = 0; r < 4; ++r) x[r] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states + 8 * r));
 
-    if (total_symbols == 0) return {};
-    if (norm_freqs[0] == 0 || norm_freqs[0] == prob_scale) {
-        uint8_t symbol_to_repeat = (norm_freqs[0] == 0) ? 1 : 0;
-        return std::vector<uint8_t>(total_symbols, symbol_to_repeat);
+    const uint16_t* p = ptr;
+    size_t w = 0;
+    for (; w < n_words && p <= end; ++w) {
+        uint64_t word = 0;
+        for (int g = 0; g < 2; ++g) {
+            // KO: 네 레지스터를 먼저 모두 복호화한 뒤 워드를 읽으므로, 적재 주소가 popcount 하나씩만 기다립니다.
+            // EN: All four registers are decoded before any word is read, so every load address waits on a single popcount.
+            __m256i refill[4];
+            int masks[4];
+            for (int r = 0; r < 4; ++r) {
+                const __m256i slot = _mm256_and_si256(x[r], slot_mask);
+                const __m256i s = _mm256_cmpgt_epi32(slot, f0_minus_one);
+                const __m256i freq = _mm256_blendv_epi8(f0, f1, s);
+                const __m256i start = _mm256_and_si256(s, f0);
+                x[r] = _mm256_add_epi32(_mm256_mullo_epi32(freq, _mm256_srli_epi32(x[r], LANE_SCALE_BITS)), _mm256_sub_epi32(slot, start));
+                word |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(s)))) << (32 * g + 8 * r);
+                refill[r] = _mm256_cmpgt_epi32(lower_bound, x[r]);
+                masks[r] = _mm256_movemask_ps(_mm256_castsi256_ps(refill[r]));
+            }
+            for (int r = 0; r < 4; ++r) {
+                const __m256i words = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+                const __m256i order = _mm256_load_si256(reinterpret_cast<const __m256i*>(LANE_REFILL_PERMUTE.index[masks[r]]));
+                const __m256i spread = _mm256_permutevar8x32_epi32(words, order);
+                x[r] = _mm256_blendv_epi8(x[r], _mm256_or_si256(_mm256_slli_epi32(x[r], 16), spread), refill[r]);
+                p += std::popcount(static_cast<unsigned>(masks[r]));
+            }
+        }
+        out[w] = word;
     }
-    norm_freqs[1] = prob_scale - norm_freqs[0];
 
-    RansDecSymbol dsyms[2];
-    RansDecSymbolInit(&dsyms[0], 0, norm_freqs[0]);
-    RansDecSymbolInit(&dsyms[1], norm_freqs[0], norm_freqs[1]);
-    std::vector<uint8_t> cum2sym(prob_scale);
-    for (uint32_t i = 0; i < norm_freqs[0]; i++) cum2sym[i] = 0;
-    for (uint32_t i = norm_freqs[0]; i < prob_scale; i++) cum2sym[i] = 1;
+    for (int r = 0; r < 4; ++r) _mm256_storeu_si256(reinterpret_cast<__m256i*>(states + 8 * r), x[r]);
+    ptr = p;
+    return w;
+}
+
+// KO: AVX-512는 비교 결과가 마스크 레지스터에 바로 담기고, 확장(expand)이 워드를 재정규화할 레인에 차례로 펼칩니다.
+//     마스크 없는 시프트와 확장 변환은 GCC 헤더에서 정의되지 않은 값을 원본으로 넘겨 -Wmaybe-uninitialized 경고를 내므로,
+//     모든 레인 마스크(ALL_LANES)를 준 maskz 형태와 마스크 시프트를 사용합니다. 생성되는 명령은 같습니다.
+// EN: AVX-512 puts compare results straight into mask registers, and an expand spreads the words onto the lanes to renormalize, in order.
+//     The unmasked shifts and widening conversion pass an undefined source in the GCC headers and trigger -Wmaybe-uninitialized,
+//     so the maskz forms with an all-lanes mask (ALL_LANES) and a masked shift are used instead. The generated instructions are the same.
+TRISPLIT_TARGET_AVX512
+static size_t decode_lane_words_avx512(uint32_t* states, const uint16_t*& ptr, const uint16_t* end, uint32_t freq0, uint64_t* out, size_t n_words) {
+    const __m512i slot_mask = _mm512_set1_epi32((1 << LANE_SCALE_BITS) - 1);
+    const __m512i f0 = _mm512_set1_epi32(static_cast<int>(freq0));
+    const __m512i f1 = _mm512_set1_epi32(static_cast<int>((1u << LANE_SCALE_BITS) - freq0));
+    const __m512i lower_bound = _mm512_set1_epi32(static_cast<int>(LANE_L));
+    const __mmask16 ALL_LANES = 0xFFFF;
+    __m512i x[2];
+    for (int r = 0; r < 2; ++r) x[r] = _mm512_loadu_si512(states + 16 * r);
+
+    const uint16_t* p = ptr;
+    size_t w = 0;
+    for (; w < n_words && p <= end; ++w) {
+        uint64_t word = 0;
+        for (int g = 0; g < 2; ++g) {
+            __mmask16 refill[2];
+            for (int r = 0; r < 2; ++r) {
+                const __m512i slot = _mm512_and_si512(x[r], slot_mask);
+                const __mmask16 s = _mm512_cmpge_epu32_mask(slot, f0);
+                const __m512i freq = _mm512_mask_blend_epi32(s, f0, f1);
+                const __m512i start = _mm512_maskz_mov_epi32(s, f0);
+                x[r] = _mm512_add_epi32(_mm512_mullo_epi32(freq, _mm512_maskz_srli_epi32(ALL_LANES, x[r], LANE_SCALE_BITS)), _mm512_sub_epi32(slot, start));
+                word |= static_cast<uint64_t>(s) << (32 * g + 16 * r);
+                refill[r] = _mm512_cmplt_epu32_mask(x[r], lower_bound);
+            }
+            for (int r = 0; r < 2; ++r) {
+                const __m512i words = _mm512_maskz_cvtepu16_epi32(ALL_LANES, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+                x[r] = _mm512_or_si512(_mm512_mask_slli_epi32(x[r], refill[r], x[r], 16), _mm512_maskz_expand_epi32(refill[r], words));
+                p += std::popcount(static_cast<unsigned>(refill[r]));
+            }
+        }
+        out[w] = word;
+    }
+
+    for (int r = 0; r < 2; ++r) _mm512_storeu_si512(states + 16 * r, x[r]);
+    ptr = p;
+    return w;
+}
+#endif
+
+// KO: 실행 중인 CPU가 지원하는 가장 넓은 커널을 한 번만 골라 둡니다.
+// EN: Picks, once, the widest kernel the running CPU supports.
+static LaneKernel lane_kernel() {
+    static const LaneKernel kernel = []() -> LaneKernel {
+#ifdef TRISPLIT_HAVE_LANE_SIMD
+        if (cpu_has_avx512f()) return decode_lane_words_avx512;
+        if (cpu_has_avx2()) return decode_lane_words_avx2;
+#endif
+        return decode_lane_words_scalar;
+    }();
+    return kernel;
+}
+
+// KO: 64비트 워드의 비트 순서를 뒤집습니다. 커널은 심볼 i를 i번 비트에 두지만, PackedBits는 MSB-first입니다.
+// EN: Reverses the bit order of a 64-bit word. The kernels put symbol i in bit i, but PackedBits is MSB-first.
+static inline uint64_t reverse_bits(uint64_t v) {
+    v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+    v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((v & 0x0F0F0F0F0F0F0F0Full) << 4);
+    v = ((v >> 8) & 0x00FF00FF00FF00FFull) | ((v & 0x00FF00FF00FF00FFull) << 8);
+    v = ((v >> 16) & 0x0000FFFF0000FFFFull) | ((v & 0x0000FFFF0000FFFFull) << 16);
+    return (v >> 32) | (v << 32);
+}
+
+// KO: 선택된 엔진의 확률 정밀도(scale_bits)를 반환합니다.
+// EN: Returns the probability precision (scale_bits) of the selected engine.
+uint32_t rANS_Coder::engine_scale_bits(RansEngine engine) {
+    if (engine == RansEngine::RansLanes) return LaneBinaryEncoder::scale_bits;
+    return (engine == RansEngine::Rans64) ? Rans64BinaryEncoder::scale_bits : RansByteBinaryEncoder::scale_bits;
+}
+
+// KO: 모든 공개 인코딩 함수가 공유하는 단일 이진 부호화 코어입니다.
+//     PackedBits를 워드 단위로 뒤에서부터 읽어(rANS는 역순으로 인코딩) 각 비트를 부호화합니다.
+//     invert는 워드 전체에 XOR되어 비트 의미를 뒤집고, PrefixPairs가 참이면 각 비트 앞에 항상 0인 접두 비트를 덧붙입니다.
+//     (재구성 스트림의 "00"/"01" 패턴) begin/end를 주면 비트 구간 [begin, end)만 부호화합니다. (청크별 빈도를 사용할 때)
+// EN: The single binary coding core shared by every public encoding function.
+//     It reads the PackedBits a word at a time from the back (rANS encodes in reverse) and codes each bit.
+//     `invert` is XORed onto whole words to flip the meaning of the bits, and when PrefixPairs is true every bit is
+//     preceded by a prefix bit that is always 0 (the "00"/"01" patterns of the reconstructed stream).
+//     Given begin/end, only the bit range [begin, end) is coded. (Used with per-chunk frequencies)
+template <bool PrefixPairs, typename Encoder>
+static void put_packed(Encoder& encoder, const PackedBits& bits, uint64_t invert, uint64_t begin, uint64_t end) {
+    for (uint64_t pos = end; pos > begin;) {
+        const uint64_t w = (pos - 1) >> 6;
+        const uint64_t start = (begin > w * 64) ? begin : w * 64;
+        const unsigned valid = static_cast<unsigned>(pos - start);
+        uint64_t word = (bits.words[static_cast<size_t>(w)] ^ invert) >> (64 - (pos - w * 64));
+        for (unsigned k = 0; k < valid; ++k) {
+            encoder.put(static_cast<uint32_t>(word & 1));
+            if (PrefixPairs) encoder.put(0);
+            word >>= 1;
+        }
+        pos = start;
+    }
+}
+
+template <bool PrefixPairs, typename Encoder>
+static void put_packed(Encoder& encoder, const PackedBits& bits, uint64_t invert) {
+    put_packed<PrefixPairs>(encoder, bits, invert, 0, bits.bit_count);
+}
+
+// KO: chunk_freq0가 주어지면 chunk_bits 비트마다 빈도를 바꿔 가며 부호화합니다. rANS는 역순으로 부호화하므로 마지막 청크부터 처리합니다.
+// EN: Given chunk_freq0, the frequencies change every chunk_bits bits. rANS encodes in reverse, so the last chunk is processed first.
+template <typename Encoder, bool PrefixPairs>
+static void encode_packed(const PackedBits& bits, uint64_t invert, const uint32_t norm_freqs[2], size_t capacity, size_t header_size, std::vector<uint8_t>& output,
+                          uint64_t chunk_bits = 0, const std::vector<uint32_t>* chunk_freq0 = nullptr) {
+    Encoder encoder(capacity, norm_freqs);
+    if (chunk_freq0 == nullptr) {
+        put_packed<PrefixPairs>(encoder, bits, invert);
+    }
+    else {
+        for (size_t c = chunk_freq0->size(); c-- > 0;) {
+            const uint32_t chunk_freqs[2] = { (*chunk_freq0)[c], (1u << Encoder::scale_bits) - (*chunk_freq0)[c] };
+            encoder.set_freqs(chunk_freqs);
+            const uint64_t begin = c * chunk_bits;
+            put_packed<PrefixPairs>(encoder, bits, invert, begin, std::min(begin + chunk_bits, bits.bit_count));
+        }
+    }
+    encoder.finish(output, header_size);
+}
+
+// KO: encode_packed에 대응하는 단일 이진 복호화 코어입니다. 비트 valid개(64 이하)를 복호화하여 워드 하나로 모읍니다.
+// EN: The single binary decoding core matching encode_packed. Decodes `valid` bits (at most 64) and gathers them into one word.
+template <bool PrefixPairs, typename Decoder>
+static inline uint64_t get_word(Decoder& decoder, unsigned valid, uint64_t invert) {
+    uint64_t word = 0;
+    for (unsigned k = 0; k < valid; ++k) {
+        if (PrefixPairs) decoder.get(); // prefix bit (always 0)
+        word = (word << 1) | decoder.get();
+    }
+    word <<= (64 - valid);
+    return (word ^ invert) & (~0ull << (64 - valid));
+}
+
+template <bool PrefixPairs, typename Decoder>
+static void get_packed(Decoder& decoder, uint64_t out_bits, uint64_t invert, PackedBits& output) {
+    output.bit_count = out_bits;
+    output.words.assign(PackedBits::words_for(out_bits), 0);
+    for (size_t w = 0; w < output.words.size(); ++w) {
+        const uint64_t remaining = out_bits - static_cast<uint64_t>(w) * 64;
+        output.words[w] = get_word<PrefixPairs>(decoder, (remaining < 64) ? static_cast<unsigned>(remaining) : 64, invert);
+        decoder.check_end();
+    }
+}
+
+template <bool PrefixPairs>
+static void encode_with_engine(RansEngine engine, const PackedBits& bits, uint64_t invert, const uint32_t norm_freqs[2], size_t capacity, size_t header_size, std::vector<uint8_t>& output,
+                               uint64_t chunk_bits = 0, const std::vector<uint32_t>* chunk_freq0 = nullptr) {
+    if (engine == RansEngine::Rans64) encode_packed<Rans64BinaryEncoder, PrefixPairs>(bits, invert, norm_freqs, capacity, header_size, output, chunk_bits, chunk_freq0);
+    else encode_packed<RansByteBinaryEncoder, PrefixPairs>(bits, invert, norm_freqs, capacity, header_size, output, chunk_bits, chunk_freq0);
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++ 청크별 빈도 표 (Semi-static Chunked Frequencies)
+// +++ Per-Chunk Frequency Tables
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-    uint8_t* ptr = const_cast<uint8_t*>(compressed_data.data()) + 8;
-    RansState rans;
-    RansDecInit(&rans, &ptr);
+// KO: 스트림이 청크로 나뉘는지 여부와 청크 수를 반환합니다. 한 청크에 다 들어가는 스트림은 기존처럼 빈도 하나를 사용합니다.
+// EN: Returns the number of chunks a stream is split into, or 0 if it is not split. A stream that fits in one chunk keeps a single frequency as before.
+static size_t chunk_count(uint64_t total_bits, uint64_t chunk_bits) {
+    if (chunk_bits == 0 || total_bits <= chunk_bits) return 0;
+    return static_cast<size_t>((total_bits + chunk_bits - 1) / chunk_bits);
+}
+
+// KO: 청크마다 부호화할 이진 심볼의 빈도를 세어 정규화합니다. 청크 안의 퇴화도 rANS 상태를 유지해야 하므로,
+//     청크 빈도는 항상 [1, prob_scale - 1]로 제한됩니다. 반환값은 모든 청크의 rANS 출력 상한입니다.
+// EN: Counts and normalizes the frequencies of the binary symbols coded in every chunk. Even a degenerate chunk must keep the
+//     rANS state going, so chunk frequencies are always kept within [1, prob_scale - 1]. Returns the rANS output bound of all chunks.
+static size_t chunk_freqs(const PackedBits& bits, uint64_t chunk_bits, bool prefix_pairs, bool inverted, uint32_t scale_bits, std::vector<uint32_t>& chunk_freq0) {
+    const uint32_t prob_scale = 1u << scale_bits;
+    size_t capacity = 0;
+    for (size_t c = 0; c < chunk_freq0.size(); ++c) {
+        const uint64_t begin = c * chunk_bits;
+        const uint64_t end = std::min(begin + chunk_bits, bits.bit_count);
+        uint64_t ones = 0;
+        for (uint64_t w = begin >> 6; w < (end + 63) >> 6; ++w) ones += static_cast<uint64_t>(std::popcount(bits.words[static_cast<size_t>(w)]));
+        if (inverted) ones = (end - begin) - ones;
+
+        uint64_t freqs[2];
+        freqs[1] = ones;
+        freqs[0] = (prefix_pairs ? 2 * (end - begin) : (end - begin)) - ones;
+        uint32_t norm_freqs[2];
+        normalize_binary_freqs(freqs, norm_freqs, prob_scale);
+        norm_freqs[0] = std::clamp<uint32_t>(norm_freqs[0], 1, prob_scale - 1);
+        norm_freqs[1] = prob_scale - norm_freqs[0];
+        chunk_freq0[c] = norm_freqs[0];
+        capacity += rANS_Coder::max_encoded_size(freqs[0], freqs[1], norm_freqs[0], norm_freqs[1], scale_bits);
+    }
+    return capacity;
+}
 
-    std::vector<uint8_t> decoded_output(total_symbols);
-    for (size_t i = 0; i < total_symbols; i++) {
-        uint32_t cf = RansDecGet(&rans, scale_bits);
-        uint8_t s = cum2sym[cf];
-        decoded_output[i] = s;
-        RansDecAdvanceSymbol(&rans, &ptr, &dsyms[s], scale_bits);
+// KO: 청크 빈도 표를 기록합니다. 각 청크의 빈도는 앞 청크(첫 청크는 스트림 전체의 빈도)와의 차이를 지그재그 varint로 기록하므로,
+//     분포가 천천히 변하는 스트림에서는 청크당 1~2바이트에 불과합니다.
+// EN: Writes the chunk frequency table. Every chunk frequency is written as a zigzag varint of its difference from the previous
+//     chunk (the first from the frequency of the whole stream), so a slowly drifting stream costs only 1-2 bytes per chunk.
+static std::vector<uint8_t> write_chunk_table(const std::vector<uint32_t>& chunk_freq0, uint32_t stream_freq0) {
+    std::vector<uint8_t> table;
+    int64_t previous = stream_freq0;
+    for (uint32_t freq0 : chunk_freq0) {
+        const int64_t delta = static_cast<int64_t>(freq0) - previous;
+        write_varint(table, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+        previous = freq0;
     }
+    return table;
+}
 
-    return decoded_output;
+// KO: 압축 데이터의 offset 위치에서 청크 빈도 표를 읽고, 표의 크기(바이트)를 반환합니다.
+// EN: Reads the chunk frequency table at `offset` of the compressed data and returns the size of the table in bytes.
+static size_t read_chunk_table(const std::vector<uint8_t>& compressed_data, size_t offset, uint32_t stream_freq0, uint32_t prob_scale, std::vector<uint32_t>& chunk_freq0) {
+    if (offset > compressed_data.size()) {
+        throw std::runtime_error("Invalid compressed data: truncated chunk frequency table.");
+    }
+    const uint8_t* ptr = compressed_data.data() + offset;
+    const uint8_t* end = compressed_data.data() + compressed_data.size();
+    int64_t previous = stream_freq0;
+    for (uint32_t& freq0 : chunk_freq0) {
+        uint64_t zigzag;
+        if (!read_varint(ptr, end, zigzag)) {
+            throw std::runtime_error("Invalid compressed data: truncated chunk frequency table.");
+        }
+        const int64_t value = previous + static_cast<int64_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+        if (value < 1 || value >= static_cast<int64_t>(prob_scale)) {
+            throw std::runtime_error("Invalid compressed data: corrupted chunk frequency table.");
+        }
+        freq0 = static_cast<uint32_t>(value);
+        previous = value;
+    }
+    return static_cast<size_t>(ptr - (compressed_data.data() + offset));
 }
 
 
@@ -127,67 +778,253 @@ std::vector<uint8_t> rANS_Coder::decode(const std::vector<uint8_t>& compressed_d
 // +++ 비트 스트림 처리용 함수 (encode_bits / decode_bits)
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-// --- ENCODE_BITS ---
-// KO: `std::vector<bool>` 형태의 비트 스트림을 압축합니다. 로직은 바이트 버전과 거의 동일합니다.
-// EN: Compresses a bit stream in the form of `std::vector<bool>`. The logic is almost identical to the byte version.
-std::vector<uint8_t> rANS_Coder::encode_bits(const std::vector<bool>& bit_stream) {
-    if (bit_stream.empty()) {
-        return {};
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++ 스트리밍 공급원 / 수신자 (융합 파이프라인)
+// +++ Streaming Sources / Sinks (Fused Pipelines)
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 모든 비트가 같은 스트림의 공급원입니다. (빈 스트림과 퇴화 스트림)
+// EN: The source of a stream whose bits are all the same. (Empty and degenerate streams)
+class FilledBitSource : public PackedBitSource {
+public:
+    FilledBitSource(uint64_t bit_count, uint32_t bit) : PackedBitSource(bit_count), fill(bit ? ~0ull : 0ull) {}
+
+    size_t read_words(uint64_t* out, size_t max_words) override {
+        size_t n = 0;
+        for (; n < max_words && pos < bit_count; ++n, pos += 64) {
+            const uint64_t remaining = bit_count - pos;
+            out[n] = (remaining < 64) ? (fill & (~0ull << (64 - remaining))) : fill;
+        }
+        return n;
+    }
+
+private:
+    uint64_t fill;
+    uint64_t pos = 0;
+};
+
+// KO: 압축 데이터에서 워드를 요청받을 때마다 복호화하는 rANS 공급원입니다. 청크 빈도를 사용하면 청크 경계(64의 배수)에서 빈도를 바꿉니다.
+// EN: A rANS source that decodes words from the compressed data as they are requested. With chunked frequencies it switches
+//     the frequencies at the chunk boundaries (multiples of 64).
+template <typename Decoder, bool PrefixPairs>
+class RansBitSource : public PackedBitSource {
+public:
+    RansBitSource(const std::vector<uint8_t>& compressed_data, size_t header_size, const uint32_t norm_freqs[2], uint64_t out_bits, uint64_t invert,
+                  uint64_t chunk_bits, std::vector<uint32_t> chunk_freq0)
+        : PackedBitSource(out_bits), decoder(compressed_data, header_size, norm_freqs), invert(invert),
+          chunk_bits(chunk_bits), chunk_freq0(std::move(chunk_freq0)), next_switch(this->chunk_freq0.empty() ? UINT64_MAX : 0) {}
+
+    size_t read_words(uint64_t* out, size_t max_words) override {
+        size_t n = 0;
+        for (; n < max_words && pos < bit_count; ++n, pos += 64) {
+            if (pos == next_switch) {
+                const uint32_t freq0 = chunk_freq0[static_cast<size_t>(pos / chunk_bits)];
+                const uint32_t chunk_freqs[2] = { freq0, (1u << Decoder::scale_bits) - freq0 };
+                decoder.set_freqs(chunk_freqs);
+                next_switch += chunk_bits;
+            }
+            const uint64_t remaining = bit_count - pos;
+            out[n] = get_word<PrefixPairs>(decoder, (remaining < 64) ? static_cast<unsigned>(remaining) : 64, invert);
+            decoder.check_end();
+        }
+        return n;
     }
 
-    const uint32_t total_bits = static_cast<uint32_t>(bit_stream.size());
-    uint32_t freqs[2] = { 0, 0 }; // [0] = frequency of false, [1] = frequency of true
-    for (bool bit : bit_stream) {
-        freqs[bit ? 1 : 0]++;
+private:
+    Decoder decoder;
+    uint64_t invert;
+    uint64_t chunk_bits;
+    std::vector<uint32_t> chunk_freq0;
+    uint64_t next_switch;
+    uint64_t pos = 0;
+};
+
+// KO: 레인 배치의 공급원입니다. 온전한 출력 워드는 선택된 커널이 한꺼번에 풀고, 마지막 부분 워드만 스칼라로 풉니다.
+//     워드 정렬을 보장하고 커널이 페이로드 끝을 넘어 적재할 수 있도록, 페이로드를 0 워드를 덧붙인 uint16_t 버퍼로 복사합니다.
+// EN: The source of the lane layout. The chosen kernel unpacks the whole output words in one go, and only the final partial word is decoded
+//     with scalar code. The payload is copied into a uint16_t buffer padded with zero words, to guarantee alignment and let the kernels load past its end.
+class LaneBitSource : public PackedBitSource {
+public:
+    LaneBitSource(const std::vector<uint8_t>& compressed_data, size_t header_size, const uint32_t norm_freqs[2], uint64_t out_bits, uint64_t invert)
+        : PackedBitSource(out_bits), freq0(norm_freqs[0]), invert(invert), kernel(lane_kernel()) {
+        if (compressed_data.size() < header_size + sizeof(states) || (compressed_data.size() - header_size) % 2 != 0) {
+            throw std::runtime_error("Invalid compressed data: missing rANS lane states.");
+        }
+        memcpy(states, compressed_data.data() + header_size, sizeof(states));
+        for (uint32_t x : states) {
+            if (x < LANE_L || x >= (LANE_L << 16)) {
+                throw std::runtime_error("Invalid compressed data: corrupted rANS lane state.");
+            }
+        }
+        const size_t n_words = (compressed_data.size() - header_size - sizeof(states)) / 2;
+        words.assign(n_words + LANE_PADDING_WORDS, 0);
+        memcpy(words.data(), compressed_data.data() + header_size + sizeof(states), n_words * 2);
+        ptr = words.data();
+        end = words.data() + n_words;
     }
 
-    const uint32_t scale_bits = 14;
-    const uint32_t prob_scale = 1 << scale_bits;
+    size_t read_words(uint64_t* out, size_t max_words) override {
+        const uint64_t full_words = (bit_count - pos) / 64;
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(max_words, full_words));
+        kernel(states, ptr, end, freq0, out, n);
+        if (ptr > end) {
+            throw std::runtime_error("Invalid compressed data: rANS lanes read past the payload.");
+        }
+        for (size_t i = 0; i < n; ++i) out[i] = reverse_bits(out[i]) ^ invert;
+        pos += static_cast<uint64_t>(n) * 64;
+        if (n == max_words || pos == bit_count) return n;
 
-    if (freqs[0] == 0 || freqs[1] == 0) {
-        std::vector<uint8_t> output(8);
-        uint32_t freq0_val = (freqs[0] == 0) ? 0 : prob_scale;
-        memcpy(output.data(), &total_bits, 4);
-        memcpy(output.data() + 4, &freq0_val, 4);
-        return output;
+        const unsigned valid = static_cast<unsigned>(bit_count - pos);
+        uint64_t word = decode_lane_group(states, ptr, freq0, std::min(valid, LANE_COUNT));
+        if (valid > LANE_COUNT) word |= static_cast<uint64_t>(decode_lane_group(states, ptr, freq0, valid - LANE_COUNT)) << 32;
+        if (ptr > end) {
+            throw std::runtime_error("Invalid compressed data: rANS lanes read past the payload.");
+        }
+        out[n] = (reverse_bits(word) ^ invert) & (~0ull << (64 - valid));
+        pos = bit_count;
+        return n + 1;
     }
 
-    uint32_t norm_freqs[2];
-    uint32_t cum_freqs[3] = { 0, freqs[0], freqs[0] + freqs[1] };
-    for (int i = 1; i <= 2; i++) {
-        cum_freqs[i] = ((uint64_t)prob_scale * cum_freqs[i]) / total_bits;
-    }
-    for (int i = 0; i < 2; i++) {
-        if (freqs[i] > 0 && cum_freqs[i + 1] == cum_freqs[i]) {
-            if (i == 0) { if (cum_freqs[2] > cum_freqs[1]) cum_freqs[2]--; }
-            else { if (cum_freqs[1] > cum_freqs[0]) cum_freqs[1]--; }
+private:
+    uint32_t states[LANE_COUNT];
+    std::vector<uint16_t> words;
+    const uint16_t* ptr;
+    const uint16_t* end;
+    uint32_t freq0;
+    uint64_t invert;
+    LaneKernel kernel;
+    uint64_t pos = 0;
+};
+
+template <bool PrefixPairs>
+static std::unique_ptr<PackedBitSource> open_with_engine(RansEngine engine, const std::vector<uint8_t>& compressed_data, size_t header_size, const uint32_t norm_freqs[2],
+                                                         uint64_t out_bits, uint64_t invert, uint64_t chunk_bits, std::vector<uint32_t> chunk_freq0) {
+    if (!PrefixPairs && engine == RansEngine::RansLanes) {
+        return std::make_unique<LaneBitSource>(compressed_data, header_size, norm_freqs, out_bits, invert);
+    }
+    if (engine == RansEngine::Rans64) {
+        return std::make_unique<RansBitSource<Rans64BinaryDecoder, PrefixPairs>>(compressed_data, header_size, norm_freqs, out_bits, invert, chunk_bits, std::move(chunk_freq0));
+    }
+    return std::make_unique<RansBitSource<RansByteBinaryDecoder, PrefixPairs>>(compressed_data, header_size, norm_freqs, out_bits, invert, chunk_bits, std::move(chunk_freq0));
+}
+
+// KO: 청크를 역순으로 받아 바로 부호화하는 rANS 수신자입니다. 빈도는 생성 시 주어진 심볼 수로 미리 정해지며,
+//     퇴화 스트림이면 인코더를 만들지 않고 스트림 헤더만 기록합니다.
+// EN: A rANS sink that codes the chunks right away as they arrive in reverse. The frequencies are settled up front from the symbol
+//     counts given at construction, and a degenerate stream creates no encoder and only writes its stream header.
+template <typename Encoder, bool PrefixPairs>
+class RansStreamSinkImpl : public RansStreamSink {
+public:
+    RansStreamSinkImpl(StreamHeaderVersion header_version, uint64_t input_bits, uint64_t total_symbols, const uint64_t freqs[2], uint64_t invert)
+        : header_version(header_version), input_bits(input_bits), total_symbols(total_symbols), invert(invert) {
+        const uint32_t prob_scale = 1u << Encoder::scale_bits;
+        if (freqs[0] == 0 || freqs[1] == 0) {
+            norm_freqs[0] = (freqs[0] == 0) ? 0 : prob_scale;
+            return;
+        }
+        normalize_binary_freqs(freqs, norm_freqs, prob_scale);
+        if constexpr (std::is_same_v<Encoder, LaneBinaryEncoder>) {
+            const size_t capacity = max_lane_encoded_size(freqs[0], freqs[1], norm_freqs[0], norm_freqs[1], Encoder::scale_bits, sizeof(uint32_t) * LANE_COUNT);
+            encoder.emplace(capacity, norm_freqs, total_symbols);
+        }
+        else {
+            const size_t capacity = rANS_Coder::max_encoded_size(freqs[0], freqs[1], norm_freqs[0], norm_freqs[1], Encoder::scale_bits);
+            encoder.emplace(capacity, norm_freqs);
         }
     }
-    norm_freqs[0] = cum_freqs[1] - cum_freqs[0];
-    norm_freqs[1] = cum_freqs[2] - cum_freqs[1];
 
-    size_t original_size_bytes = (bit_stream.size() + 7) / 8;
-    std::vector<uint8_t> compressed_buffer(original_size_bytes + (original_size_bytes / 5) + 16);
-    uint8_t* ptr = compressed_buffer.data() + compressed_buffer.size();
+    void put_reverse(const PackedBits& chunk) override {
+        received += chunk.size();
+        if (encoder) put_packed<PrefixPairs>(*encoder, chunk, invert);
+    }
 
-    RansState rans;
-    RansEncInit(&rans);
-    for (size_t i = bit_stream.size(); i > 0; --i) {
-        bool bit = bit_stream[i - 1];
-        if (!bit) { // bit == false (0)
-            RansEncPut(&rans, &ptr, 0, norm_freqs[0], scale_bits);
+    std::vector<uint8_t> finish(StreamDescriptor* descriptor) override {
+        if (descriptor != nullptr) *descriptor = {};
+        if (received != input_bits) {
+            throw std::invalid_argument("The stream sink received a different number of bits than it was created for.");
         }
-        else { // bit == true (1)
-            RansEncPut(&rans, &ptr, norm_freqs[0], norm_freqs[1], scale_bits);
+        if (input_bits == 0) return {};
+        const size_t header_size = stream_header_size(header_version);
+        std::vector<uint8_t> output;
+        if (encoder) encoder->finish(output, header_size);
+        else output.resize(header_size);
+        write_stream_header(output.data(), header_version, total_symbols, norm_freqs[0], descriptor);
+        return output;
+    }
+
+private:
+    StreamHeaderVersion header_version;
+    uint64_t input_bits;
+    uint64_t total_symbols;
+    uint64_t invert;
+    uint32_t norm_freqs[2] = { 0, 0 };
+    std::optional<Encoder> encoder;
+    uint64_t received = 0;
+};
+
+// KO: 레인 배치는 접두 비트 쌍을 쓰지 않으므로, 입력 비트 하나가 이진 심볼 하나입니다.
+// EN: The lane layout never uses prefix pairs, so every input bit is one binary symbol.
+template <bool PrefixPairs>
+static std::unique_ptr<RansStreamSink> create_sink_with_engine(RansEngine engine, StreamHeaderVersion header_version, uint64_t input_bits, uint64_t total_symbols,
+                                                               const uint64_t freqs[2], uint64_t invert) {
+    if constexpr (!PrefixPairs) {
+        if (engine == RansEngine::RansLanes) {
+            return std::make_unique<RansStreamSinkImpl<LaneBinaryEncoder, false>>(header_version, input_bits, total_symbols, freqs, invert);
         }
     }
-    RansEncFlush(&rans, &ptr);
+    if (engine == RansEngine::Rans64) {
+        return std::make_unique<RansStreamSinkImpl<Rans64BinaryEncoder, PrefixPairs>>(header_version, input_bits, total_symbols, freqs, invert);
+    }
+    return std::make_unique<RansStreamSinkImpl<RansByteBinaryEncoder, PrefixPairs>>(header_version, input_bits, total_symbols, freqs, invert);
+}
+
+// KO: 재구성 스트림의 자리표시자 수로부터 부호화할 이진 심볼의 빈도를 계산합니다.
+//     자리표시자(1)가 흔한 심볼이면 비트를 뒤집어, 드문 심볼이 항상 1이 되도록 합니다. prefix_pairs가 거짓이면(레인 배치) 심볼을 그대로 셉니다.
+// EN: Computes the frequencies of the binary symbols to code from the placeholder count of the reconstructed stream.
+//     If the placeholder (1) is the common symbol, the bits are inverted so that the rare symbol is always 1.
+//     Without prefix_pairs (the lane layout) the symbols are counted as they are.
+static void reconstructed_stream_freqs(uint64_t n_symbols, uint64_t n_placeholders, bool is_placeholder_common, bool prefix_pairs, uint64_t freqs[2]) {
+    const uint64_t n_rare = is_placeholder_common ? n_symbols - n_placeholders : n_placeholders;
+    const uint64_t n_common = n_symbols - n_rare;
+    freqs[0] = prefix_pairs ? n_common * 2 + n_rare * 1 : n_common;
+    freqs[1] = n_rare * 1;
+}
+
+
+// --- ENCODE_BITS ---
+// KO: PackedBits로 담긴 이진 스트림(value_bitmap, auxiliary_mask)을 압축합니다.
+//     빈도는 워드 단위 popcount로 계산합니다. 청크 빈도를 사용하지 않으면 스트림 전체를 수신자 하나에 넘깁니다.
+// EN: Compresses a binary stream held in PackedBits (value_bitmap, auxiliary_mask).
+//     The frequencies are computed with a word-at-a-time popcount. Without chunked frequencies the whole stream goes through a single sink.
+std::vector<uint8_t> rANS_Coder::encode_bits(const PackedBits& bit_stream, StreamDescriptor* descriptor) {
+    if (descriptor != nullptr) *descriptor = {};
+    if (bit_stream.empty()) {
+        return {};
+    }
+
+    const uint64_t total_bits = bit_stream.size();
+    const uint64_t ones = bit_stream.count_ones();
+    std::vector<uint32_t> chunk_freq0(chunk_count(total_bits, chunk_bits));
+    if (chunk_freq0.empty() || ones == 0 || ones == total_bits) {
+        const std::unique_ptr<RansStreamSink> sink = create_bits_sink(total_bits, ones);
+        sink->put_reverse(bit_stream);
+        return sink->finish(descriptor);
+    }
 
-    size_t compressed_size = (compressed_buffer.data() + compressed_buffer.size()) - ptr;
-    std::vector<uint8_t> final_output(8 + compressed_size);
-    memcpy(final_output.data(), &total_bits, 4);
-    memcpy(final_output.data() + 4, &norm_freqs[0], 4);
-    memcpy(final_output.data() + 8, ptr, compressed_size);
+    uint64_t freqs[2]; // [0] = frequency of 0, [1] = frequency of 1
+    freqs[1] = ones;
+    freqs[0] = total_bits - freqs[1];
+    const uint32_t scale_bits = engine_scale_bits(engine);
+    uint32_t norm_freqs[2];
+    normalize_binary_freqs(freqs, norm_freqs, 1u << scale_bits);
+
+    const size_t header_size = stream_header_size(header_version);
+    std::vector<uint8_t> final_output;
+    const size_t capacity = chunk_freqs(bit_stream, chunk_bits, false, false, scale_bits, chunk_freq0);
+    const std::vector<uint8_t> table = write_chunk_table(chunk_freq0, norm_freqs[0]);
+    encode_with_engine<false>(engine, bit_stream, 0, norm_freqs, capacity, header_size + table.size(), final_output, chunk_bits, &chunk_freq0);
+    memcpy(final_output.data() + header_size, table.data(), table.size());
+    write_stream_header(final_output.data(), header_version, total_bits, norm_freqs[0], descriptor);
 
     return final_output;
 }
@@ -195,46 +1032,42 @@ std::vector<uint8_t> rANS_Coder::encode_bits(const std::vector<bool>& bit_stream
 // --- DECODE_BITS ---
 // KO: `encode_bits`로 압축된 데이터를 원본 비트 스트림으로 복호화합니다.
 // EN: Decodes data compressed with `encode_bits` back to the original bit stream.
-std::vector<bool> rANS_Coder::decode_bits(const std::vector<uint8_t>& compressed_data) {
-    if (compressed_data.size() < 8) {
-        throw std::runtime_error("Invalid compressed data: header too small.");
+PackedBits rANS_Coder::decode_bits(const std::vector<uint8_t>& compressed_data, const StreamDescriptor* descriptor) {
+    return read_all_bits(*open_bits(compressed_data, descriptor));
+}
+
+std::unique_ptr<PackedBitSource> rANS_Coder::open_bits(const std::vector<uint8_t>& compressed_data, const StreamDescriptor* descriptor) {
+    // KO: 빈 스트림은 헤더 없이 0바이트로 기록됩니다. (Detached 형식의 퇴화 스트림도 페이로드가 0바이트입니다.)
+    // EN: An empty stream is stored as zero bytes, without a header. (So is a degenerate stream in the Detached format.)
+    if (compressed_data.empty() && header_version != StreamHeaderVersion::Detached) {
+        return std::make_unique<FilledBitSource>(0, 0);
     }
 
-    uint32_t total_bits;
+    uint64_t total_bits;
     uint32_t norm_freqs[2];
-    const uint32_t scale_bits = 14;
+    const uint32_t scale_bits = engine_scale_bits(engine);
     const uint32_t prob_scale = 1 << scale_bits;
 
-    memcpy(&total_bits, compressed_data.data(), 4);
-    memcpy(&norm_freqs[0], compressed_data.data() + 4, 4);
+    const size_t header_size = read_stream_header(compressed_data, header_version, descriptor, total_bits, norm_freqs[0]);
 
-    if (total_bits == 0) return {};
-    if (norm_freqs[0] == 0 || norm_freqs[0] == prob_scale) {
-        bool bit_to_repeat = (norm_freqs[0] == 0); // freq0이 0이면 반복할 비트는 true(1)
-        return std::vector<bool>(total_bits, bit_to_repeat);
+    if (total_bits == 0) return std::make_unique<FilledBitSource>(0, 0);
+    if (norm_freqs[0] == 0 || norm_freqs[0] >= prob_scale) {
+        uint32_t bit_to_repeat = (norm_freqs[0] == 0) ? 1 : 0; // freq0이 0이면 반복할 비트는 1
+        return std::make_unique<FilledBitSource>(total_bits, bit_to_repeat);
     }
     norm_freqs[1] = prob_scale - norm_freqs[0];
 
-    RansDecSymbol dsyms[2];
-    RansDecSymbolInit(&dsyms[0], 0, norm_freqs[0]);
-    RansDecSymbolInit(&dsyms[1], norm_freqs[0], norm_freqs[1]);
-    std::vector<uint8_t> cum2sym(prob_scale);
-    for (uint32_t i = 0; i < norm_freqs[0]; i++) cum2sym[i] = 0; // false
-    for (uint32_t i = norm_freqs[0]; i < prob_scale; i++) cum2sym[i] = 1; // true
-
-    uint8_t* ptr = const_cast<uint8_t*>(compressed_data.data()) + 8;
-    RansState rans;
-    RansDecInit(&rans, &ptr);
+    std::vector<uint32_t> chunk_freq0(chunk_count(total_bits, chunk_bits));
+    const size_t table_size = chunk_freq0.empty() ? 0 : read_chunk_table(compressed_data, header_size, norm_freqs[0], prob_scale, chunk_freq0);
+    return open_with_engine<false>(engine, compressed_data, header_size + table_size, norm_freqs, total_bits, 0, chunk_bits, std::move(chunk_freq0));
+}
 
-    std::vector<bool> decoded_output(total_bits);
-    for (size_t i = 0; i < total_bits; i++) {
-        uint32_t cf = RansDecGet(&rans, scale_bits);
-        uint8_t s = cum2sym[cf];
-        decoded_output[i] = (s != 0);
-        RansDecAdvanceSymbol(&rans, &ptr, &dsyms[s], scale_bits);
+std::unique_ptr<RansStreamSink> rANS_Coder::create_bits_sink(uint64_t bit_count, uint64_t ones) {
+    if (ones != 0 && ones != bit_count && chunk_count(bit_count, chunk_bits) != 0) {
+        throw std::invalid_argument("Chunked frequencies need the whole stream up front and cannot be used with a stream sink.");
     }
-
-    return decoded_output;
+    const uint64_t freqs[2] = { bit_count - ones, ones };
+    return create_sink_with_engine<false>(engine, header_version, bit_count, bit_count, freqs, 0);
 }
 
 
@@ -243,74 +1076,35 @@ std::vector<bool> rANS_Coder::decode_bits(const std::vector<uint8_t>& compressed
 //     더 압축이 잘되는 비트 패턴("00", "01")으로 변환한 뒤 rANS로 압축합니다.
 // EN: A special encoder for the 'reconstructed_stream'. It converts the symbols (markers/placeholders)
 //     of this stream into more compressible bit patterns ("00", "01") and then compresses them with rANS.
-std::vector<uint8_t> rANS_Coder::encode_reconstructed_stream(const std::vector<uint8_t>& recon_stream, bool is_placeholder_common) {
+std::vector<uint8_t> rANS_Coder::encode_reconstructed_stream(const PackedBits& recon_stream, bool is_placeholder_common, StreamDescriptor* descriptor) {
+    if (descriptor != nullptr) *descriptor = {};
     if (recon_stream.empty()) {
         return {};
     }
 
-    uint8_t common_symbol_val = is_placeholder_common ? 1 : 0;
-    size_t n_common = 0;
-    for (uint8_t s : recon_stream) {
-        if (s == common_symbol_val) n_common++;
-    }
-    size_t n_rare = recon_stream.size() - n_common;
-
-    const uint32_t total_bits = static_cast<uint32_t>(recon_stream.size() * 2);
-    if (total_bits == 0) return {};
-
-    uint32_t freqs[2];
-    freqs[0] = static_cast<uint32_t>(n_common * 2 + n_rare * 1);
-    freqs[1] = static_cast<uint32_t>(n_rare * 1);
-
-    const uint32_t scale_bits = 14;
-    const uint32_t prob_scale = 1 << scale_bits;
+    const uint64_t invert = is_placeholder_common ? ~0ull : 0ull;
+    const uint64_t n_placeholders = recon_stream.count_ones();
+    uint64_t freqs[2];
+    reconstructed_stream_freqs(recon_stream.size(), n_placeholders, is_placeholder_common, engine != RansEngine::RansLanes, freqs);
 
-    if (freqs[1] == 0) {
-        std::vector<uint8_t> output(8);
-        memcpy(output.data(), &total_bits, 4);
-        uint32_t freq0_val = prob_scale;
-        memcpy(output.data() + 4, &freq0_val, 4);
-        return output;
+    std::vector<uint32_t> chunk_freq0(chunk_count(recon_stream.size(), chunk_bits));
+    if (chunk_freq0.empty() || freqs[1] == 0) {
+        const std::unique_ptr<RansStreamSink> sink = create_reconstructed_stream_sink(recon_stream.size(), n_placeholders, is_placeholder_common);
+        sink->put_reverse(recon_stream);
+        return sink->finish(descriptor);
     }
 
+    const uint32_t scale_bits = engine_scale_bits(engine);
     uint32_t norm_freqs[2];
-    uint32_t cum_freqs[3] = { 0, freqs[0], freqs[0] + freqs[1] };
-    for (int i = 1; i <= 2; i++) {
-        cum_freqs[i] = ((uint64_t)prob_scale * cum_freqs[i]) / total_bits;
-    }
-    for (int i = 0; i < 2; i++) {
-        if (freqs[i] > 0 && cum_freqs[i + 1] == cum_freqs[i]) {
-            if (i == 0) { if (cum_freqs[2] > cum_freqs[1]) cum_freqs[2]--; }
-            else { if (cum_freqs[1] > cum_freqs[0]) cum_freqs[1]--; }
-        }
-    }
-    norm_freqs[0] = cum_freqs[1] - cum_freqs[0];
-    norm_freqs[1] = cum_freqs[2] - cum_freqs[1];
-
-    size_t approx_size = (total_bits / 8) + (total_bits / 40) + 16;
-    std::vector<uint8_t> compressed_buffer(approx_size);
-    uint8_t* ptr = compressed_buffer.data() + compressed_buffer.size();
-    RansState rans;
-    RansEncInit(&rans);
+    normalize_binary_freqs(freqs, norm_freqs, 1u << scale_bits);
 
-    for (size_t i = recon_stream.size(); i > 0; --i) {
-        uint8_t s = recon_stream[i - 1];
-        if (s == common_symbol_val) {
-            RansEncPut(&rans, &ptr, 0, norm_freqs[0], scale_bits);
-            RansEncPut(&rans, &ptr, 0, norm_freqs[0], scale_bits);
-        }
-        else {
-            RansEncPut(&rans, &ptr, norm_freqs[0], norm_freqs[1], scale_bits);
-            RansEncPut(&rans, &ptr, 0, norm_freqs[0], scale_bits);
-        }
-    }
-    RansEncFlush(&rans, &ptr);
-
-    size_t compressed_size = (compressed_buffer.data() + compressed_buffer.size()) - ptr;
-    std::vector<uint8_t> final_output(8 + compressed_size);
-    memcpy(final_output.data(), &total_bits, 4);
-    memcpy(final_output.data() + 4, &norm_freqs[0], 4);
-    memcpy(final_output.data() + 8, ptr, compressed_size);
+    const size_t header_size = stream_header_size(header_version);
+    std::vector<uint8_t> final_output;
+    const size_t capacity = chunk_freqs(recon_stream, chunk_bits, true, is_placeholder_common, scale_bits, chunk_freq0);
+    const std::vector<uint8_t> table = write_chunk_table(chunk_freq0, norm_freqs[0]);
+    encode_with_engine<true>(engine, recon_stream, invert, norm_freqs, capacity, header_size + table.size(), final_output, chunk_bits, &chunk_freq0);
+    memcpy(final_output.data() + header_size, table.data(), table.size());
+    write_stream_header(final_output.data(), header_version, recon_stream.size() * 2, norm_freqs[0], descriptor);
 
     return final_output;
 }
@@ -318,63 +1112,148 @@ std::vector<uint8_t> rANS_Coder::encode_reconstructed_stream(const std::vector<u
 // --- DECODE_RECONSTRUCTED_STREAM (오류 수정된 최종 버전) ---
 // KO: `encode_reconstructed_stream`으로 압축된 데이터를 복호화합니다.
 // EN: Decodes data compressed by `encode_reconstructed_stream`.
-std::vector<uint8_t> rANS_Coder::decode_reconstructed_stream(const std::vector<uint8_t>& compressed_data, bool is_placeholder_common) {
-    if (compressed_data.size() < 8) {
-        throw std::runtime_error("Invalid compressed data: header too small.");
+PackedBits rANS_Coder::decode_reconstructed_stream(const std::vector<uint8_t>& compressed_data, bool is_placeholder_common, const StreamDescriptor* descriptor) {
+    return read_all_bits(*open_reconstructed_stream(compressed_data, is_placeholder_common, descriptor));
+}
+
+std::unique_ptr<PackedBitSource> rANS_Coder::open_reconstructed_stream(const std::vector<uint8_t>& compressed_data, bool is_placeholder_common, const StreamDescriptor* descriptor) {
+    if (compressed_data.empty() && header_version != StreamHeaderVersion::Detached) {
+        return std::make_unique<FilledBitSource>(0, 0);
     }
 
-    uint32_t total_bits;
+    uint64_t total_bits;
     uint32_t norm_freqs[2];
-    const uint32_t scale_bits = 14;
+    const uint32_t scale_bits = engine_scale_bits(engine);
     const uint32_t prob_scale = 1 << scale_bits;
 
-    memcpy(&total_bits, compressed_data.data(), 4);
-    memcpy(&norm_freqs[0], compressed_data.data() + 4, 4);
+    const size_t header_size = read_stream_header(compressed_data, header_version, descriptor, total_bits, norm_freqs[0]);
 
-    if (total_bits == 0) return {};
+    if (total_bits == 0) return std::make_unique<FilledBitSource>(0, 0);
+    uint32_t common_symbol = is_placeholder_common ? 1 : 0;
+    const uint64_t invert = is_placeholder_common ? ~0ull : 0ull;
 
-    if (norm_freqs[0] >= prob_scale) {
-        uint8_t common_symbol = is_placeholder_common ? 1 : 0;
-        if (total_bits % 2 != 0) {
-            throw std::runtime_error("Total bits should be even for common-only stream.");
+    // KO: 레인 배치의 스트림 헤더는 심볼 수 그대로를 셉니다.
+    // EN: The stream header of the lane layout counts the symbols themselves.
+    if (engine == RansEngine::RansLanes) {
+        if (norm_freqs[0] == 0 || norm_freqs[0] >= prob_scale) {
+            return std::make_unique<FilledBitSource>(total_bits, (norm_freqs[0] == 0) ? 1 - common_symbol : common_symbol);
         }
-        return std::vector<uint8_t>(total_bits / 2, common_symbol);
+        norm_freqs[1] = prob_scale - norm_freqs[0];
+        return open_with_engine<false>(engine, compressed_data, header_size, norm_freqs, total_bits, invert, 0, {});
+    }
+
+    if (total_bits % 2 != 0) {
+        throw std::runtime_error("Total bits of the reconstructed stream should be even.");
+    }
+    if (norm_freqs[0] >= prob_scale) {
+        return std::make_unique<FilledBitSource>(total_bits / 2, common_symbol);
     }
     norm_freqs[1] = prob_scale - norm_freqs[0];
 
-    RansDecSymbol dsyms[2];
-    RansDecSymbolInit(&dsyms[0], 0, norm_freqs[0]);
-    RansDecSymbolInit(&dsyms[1], norm_freqs[0], norm_freqs[1]);
-    std::vector<uint8_t> cum2sym(prob_scale);
-    for (uint32_t i = 0; i < norm_freqs[0]; i++) cum2sym[i] = 0;
-    for (uint32_t i = norm_freqs[0]; i < prob_scale; i++) cum2sym[i] = 1;
+    std::vector<uint32_t> chunk_freq0(chunk_count(total_bits / 2, chunk_bits));
+    const size_t table_size = chunk_freq0.empty() ? 0 : read_chunk_table(compressed_data, header_size, norm_freqs[0], prob_scale, chunk_freq0);
+    return open_with_engine<true>(engine, compressed_data, header_size + table_size, norm_freqs, total_bits / 2, invert, chunk_bits, std::move(chunk_freq0));
+}
+
+std::unique_ptr<RansStreamSink> rANS_Coder::create_reconstructed_stream_sink(uint64_t symbol_count, uint64_t n_placeholders, bool is_placeholder_common) {
+    uint64_t freqs[2];
+    reconstructed_stream_freqs(symbol_count, n_placeholders, is_placeholder_common, engine != RansEngine::RansLanes, freqs);
+    if (freqs[1] != 0 && chunk_count(symbol_count, chunk_bits) != 0) {
+        throw std::invalid_argument("Chunked frequencies need the whole stream up front and cannot be used with a stream sink.");
+    }
+    if (engine == RansEngine::RansLanes) {
+        return create_sink_with_engine<false>(engine, header_version, symbol_count, symbol_count, freqs, is_placeholder_common ? ~0ull : 0ull);
+    }
+    return create_sink_with_engine<true>(engine, header_version, symbol_count, symbol_count * 2, freqs, is_placeholder_common ? ~0ull : 0ull);
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++ Fixed-Model Stream Handlers (encode_bits_with_model / decode_bits_with_model)
+// +++ 고정 모델 스트림 처리용 함수 (encode_bits_with_model / decode_bits_with_model)
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-    uint8_t* ptr = const_cast<uint8_t*>(compressed_data.data()) + 8;
-    RansState rans;
-    RansDecInit(&rans, &ptr);
+// KO: 0.24 고정소수점 확률을 엔진의 정밀도로 변환하고, 두 심볼 모두 1 이상의 빈도를 갖도록 제한합니다.
+// EN: Converts a 0.24 fixed-point probability to the precision of the engine and keeps both frequencies at 1 or above.
+static void model_norm_freqs(uint32_t prob0_q24, uint32_t scale_bits, uint32_t norm_freqs[2]) {
+    const uint32_t prob_scale = 1u << scale_bits;
+    uint32_t freq0 = (scale_bits >= 24) ? (prob0_q24 << (scale_bits - 24)) : (prob0_q24 >> (24 - scale_bits));
+    if (freq0 < 1) freq0 = 1;
+    if (freq0 > prob_scale - 1) freq0 = prob_scale - 1;
+    norm_freqs[0] = freq0;
+    norm_freqs[1] = prob_scale - freq0;
+}
 
-    std::vector<uint8_t> decoded_output;
-    decoded_output.reserve(total_bits / 2);
+template <typename Encoder>
+static std::vector<uint8_t> encode_streams_with_model(const std::vector<const PackedBits*>& streams, const std::vector<uint32_t>& prob0_q24) {
+    std::vector<uint32_t> norm_freqs(streams.size() * 2);
+    size_t capacity = 0;
+    uint64_t total_bits = 0;
+    for (size_t i = 0; i < streams.size(); ++i) {
+        model_norm_freqs(prob0_q24[i], Encoder::scale_bits, &norm_freqs[i * 2]);
+        const uint64_t ones = streams[i]->count_ones();
+        capacity += rANS_Coder::max_encoded_size(streams[i]->size() - ones, ones, norm_freqs[i * 2], norm_freqs[i * 2 + 1], Encoder::scale_bits);
+        total_bits += streams[i]->size();
+    }
+    if (total_bits == 0) return {};
 
-    uint8_t common_symbol = is_placeholder_common ? 1 : 0;
-    uint8_t rare_symbol = is_placeholder_common ? 0 : 1;
+    // KO: rANS는 역순으로 부호화하므로, 마지막 스트림부터 부호화해야 복호화 시 첫 스트림부터 나옵니다.
+    // EN: rANS encodes in reverse, so the streams are encoded last to first in order to decode first to last.
+    Encoder encoder(capacity, &norm_freqs[0]);
+    for (size_t i = streams.size(); i-- > 0;) {
+        encoder.set_freqs(&norm_freqs[i * 2]);
+        put_packed<false>(encoder, *streams[i], 0);
+    }
+    std::vector<uint8_t> output;
+    encoder.finish(output, 0);
+    return output;
+}
 
-    for (uint32_t i = 0; i < total_bits; i += 2) {
-        uint32_t cf_prefix = RansDecGet(&rans, scale_bits);
-        uint8_t bit_prefix = cum2sym[cf_prefix];
-        RansDecAdvanceSymbol(&rans, &ptr, &dsyms[bit_prefix], scale_bits);
+template <typename Decoder>
+static std::vector<PackedBits> decode_streams_with_model(const std::vector<uint8_t>& compressed_data, const std::vector<uint64_t>& bit_counts, const std::vector<uint32_t>& prob0_q24) {
+    std::vector<PackedBits> outputs(bit_counts.size());
+    uint64_t total_bits = 0;
+    for (uint64_t count : bit_counts) total_bits += count;
+    if (total_bits == 0) return outputs;
 
-        uint32_t cf_payload = RansDecGet(&rans, scale_bits);
-        uint8_t bit_payload = cum2sym[cf_payload];
-        RansDecAdvanceSymbol(&rans, &ptr, &dsyms[bit_payload], scale_bits);
+    std::vector<uint32_t> norm_freqs(bit_counts.size() * 2);
+    for (size_t i = 0; i < bit_counts.size(); ++i) {
+        model_norm_freqs(prob0_q24[i], Decoder::scale_bits, &norm_freqs[i * 2]);
+    }
+    Decoder decoder(compressed_data, 0, &norm_freqs[0]);
+    for (size_t i = 0; i < bit_counts.size(); ++i) {
+        decoder.set_freqs(&norm_freqs[i * 2]);
+        get_packed<false>(decoder, bit_counts[i], 0, outputs[i]);
+    }
+    return outputs;
+}
 
-        if (bit_payload == 1) {
-            decoded_output.push_back(rare_symbol);
-        }
-        else {
-            decoded_output.push_back(common_symbol);
-        }
+// --- ENCODE_BITS_WITH_MODEL ---
+// KO: 여러 이진 스트림을 학습된 모델의 고정 확률로, 하나의 rANS 상태에 이어서 부호화합니다.
+//     스트림 헤더가 없고 플러시도 한 번뿐이므로 작은 블록의 고정 비용이 크게 줄어듭니다.
+// EN: Codes several binary streams back to back into a single rANS state, using the fixed probabilities of a trained model.
+//     There are no stream headers and only a single flush, which greatly reduces the fixed cost of small blocks.
+std::vector<uint8_t> rANS_Coder::encode_bits_with_model(const std::vector<const PackedBits*>& streams, const std::vector<uint32_t>& prob0_q24) {
+    if (streams.size() != prob0_q24.size()) {
+        throw std::invalid_argument("Every stream needs a model probability.");
+    }
+    if (engine == RansEngine::RansLanes) {
+        throw std::invalid_argument("The lane-interleaved engine does not support trained models.");
     }
+    if (engine == RansEngine::Rans64) return encode_streams_with_model<Rans64BinaryEncoder>(streams, prob0_q24);
+    return encode_streams_with_model<RansByteBinaryEncoder>(streams, prob0_q24);
+}
 
-    return decoded_output;
-}
\ No newline at end of file
+// --- DECODE_BITS_WITH_MODEL ---
+// KO: `encode_bits_with_model`로 압축된 데이터를 복호화합니다. 스트림 헤더가 없으므로 각 스트림의 비트 수는 호출자가 알려 주어야 합니다.
+// EN: Decodes data compressed with `encode_bits_with_model`. There are no stream headers, so the caller supplies the bit count of every stream.
+std::vector<PackedBits> rANS_Coder::decode_bits_with_model(const std::vector<uint8_t>& compressed_data, const std::vector<uint64_t>& bit_counts, const std::vector<uint32_t>& prob0_q24) {
+    if (bit_counts.size() != prob0_q24.size()) {
+        throw std::invalid_argument("Every stream needs a model probability.");
+    }
+    if (engine == RansEngine::RansLanes) {
+        throw std::invalid_argument("The lane-interleaved engine does not support trained models.");
+    }
+    if (engine == RansEngine::Rans64) return decode_streams_with_model<Rans64BinaryDecoder>(compressed_data, bit_counts, prob0_q24);
+    return decode_streams_with_model<RansByteBinaryDecoder>(compressed_data, bit_counts, prob0_q24);
+}
@@ -4,6 +4,67 @@
 // EN: Prevents the header file from being included multiple times.
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "../PackedBits/PackedBits.h"
+
+// KO: 각 압축 스트림 앞에 붙는 스트림 헤더의 형식입니다.
+//     - V1: [uint32 심볼 수][uint32 norm_freqs[0]] (8바이트, 기존 형식, 심볼 수가 2^32 미만으로 제한됨)
+//     - V2: [uint64 심볼 수][uint32 norm_freqs[0]] (12바이트, 512MiB를 넘는 대형 블록용)
+//     - Detached: 스트림 헤더를 기록하지 않고 StreamDescriptor로 주고받습니다. (블록 헤더에 합쳐 기록하는 압축 블록 형식용)
+// EN: The format of the stream header placed in front of every compressed stream.
+//     - V1: [uint32 symbol count][uint32 norm_freqs[0]] (8 bytes, legacy format, limited to fewer than 2^32 symbols)
+//     - V2: [uint64 symbol count][uint32 norm_freqs[0]] (12 bytes, for large blocks beyond 512MiB)
+//     - Detached: No stream header is written; it is exchanged through a StreamDescriptor instead.
+//                 (For the compact block format, which merges it into the block header)
+enum class StreamHeaderVersion : uint8_t {
+    Detached = 0,
+    V1 = 1,
+    V2 = 2
+};
+
+// KO: 스트림 헤더의 내용입니다. Detached 형식에서는 인코딩 시 채워지고 디코딩 시 호출자가 제공합니다.
+//     norm_freq0이 0 또는 prob_scale이면 모든 심볼이 같은 퇴화 스트림이며 페이로드가 없습니다.
+// EN: The contents of a stream header. With the Detached format it is filled in when encoding and supplied by the caller when decoding.
+//     A norm_freq0 of 0 or prob_scale marks a degenerate stream whose symbols are all the same, and which has no payload.
+struct StreamDescriptor {
+    uint64_t symbol_count = 0;
+    uint32_t norm_freq0 = 0;
+};
+
+// KO: 이진 심볼을 부호화하는 rANS 엔진의 종류입니다. 모든 엔진은 인코딩 시 미리 계산된
+//     인코더 심볼(역수 곱셈)을 사용하므로 심볼마다 나눗셈이 발생하지 않습니다.
+//     - RansByte:  32비트 상태, 바이트 단위 출력, 14비트 확률 정밀도 (기존 형식)
+//     - Rans64:    64비트 상태, 32비트 워드 단위 출력, 24비트 확률 정밀도
+//     - RansLanes: 32비트 상태 32개를 엇갈려 쓰는 레인 배치, 16비트 워드 단위 출력, 12비트 확률 정밀도.
+//                  심볼 i는 레인 i % 32의 상태로 부호화되므로, 복호화 시 32개 심볼을 SIMD로 한꺼번에 풉니다.
+//                  (AVX-512 / AVX2를 실행 시 감지하며, 같은 배치의 스칼라 복호기가 항상 있습니다.)
+//                  재구성 스트림도 접두 비트 쌍 없이 심볼당 이진 심볼 하나로 부호화하며, 청크 빈도와 학습된 모델은 지원하지 않습니다.
+// EN: The kind of rANS engine that codes the binary symbols. Every engine uses precomputed
+//     encoder symbols (reciprocal multiplies) when encoding, so no symbol pays for a division.
+//     - RansByte:  32-bit state, byte-wise output, 14-bit probability precision (legacy format)
+//     - Rans64:    64-bit state, 32-bit word-wise output, 24-bit probability precision
+//     - RansLanes: A lane layout interleaving 32 32-bit states, 16-bit word-wise output, 12-bit probability precision.
+//                  Symbol i is coded by the state of lane i % 32, so decoding unpacks 32 symbols at once with SIMD.
+//                  (AVX-512 / AVX2 are detected at run time, and a scalar decoder of the same layout is always there.)
+//                  The reconstructed stream is coded as one binary symbol per symbol too, without prefix pairs, and neither
+//                  chunked frequencies nor trained models are supported.
+enum class RansEngine : uint8_t {
+    RansByte = 0,
+    Rans64 = 1,
+    RansLanes = 2
+};
+
+// KO: 청크를 역순으로 받아 바로 rANS로 부호화하는 수신자입니다. 모든 청크를 넘긴 뒤 finish로 압축 데이터를 받습니다.
+//     결과는 같은 스트림을 'encode_bits' / 'encode_reconstructed_stream'으로 압축한 것과 같습니다.
+// EN: A sink that codes the chunks with rANS right away as they arrive in reverse. After every chunk has been handed over,
+//     finish returns the compressed data. The result is the same as compressing the stream with 'encode_bits' / 'encode_reconstructed_stream'.
+class RansStreamSink : public PackedBitSink {
+public:
+    // KO: @param descriptor - 값이 주어지면 스트림 헤더의 내용이 기록됩니다.
+    // EN: @param descriptor - If given, receives the contents of the stream header.
+    virtual std::vector<uint8_t> finish(StreamDescriptor* descriptor = nullptr) = 0;
+};
 
 // KO: rANS(range Asymmetric Numeral Systems) 인코딩 및 디코딩 기능을 제공하는 클래스입니다.
 //     다양한 유형의 데이터 스트림(바이트, 비트, 특수 스트림)을 처리하기 위한 인터페이스를 포함합니다.
@@ -11,24 +72,33 @@
 //     It includes interfaces for handling various types of data streams (byte, bit, specialized streams).
 class rANS_Coder {
 public:
-    // --- Byte/Bit Stream Processing Functions ---
-    // --- 바이트/비트 스트림 처리 함수 ---
-
-    // KO: 0 또는 1의 값을 갖는 바이트(uint8_t) 스트림을 압축합니다.
-    // EN: Compresses a stream of bytes (uint8_t) containing values of 0 or 1.
-    std::vector<uint8_t> encode(const std::vector<uint8_t>& symbol_stream);
+    // KO: 인코딩 시 기록하고 디코딩 시 해석할 스트림 헤더 형식과 rANS 엔진을 지정합니다.
+    // @param chunk_bits - 0이 아니면 입력 스트림을 이 비트 수(64의 배수)마다 청크로 나누어, 청크마다 빈도를 다시 계산합니다.
+    //                     (반정적 모델, 분포가 변하는 블록용) 청크 빈도 표는 스트림 헤더 바로 뒤에 기록되며,
+    //                     한 청크에 다 들어가는 스트림은 기존 형식 그대로입니다. 디코딩 시에도 같은 값을 주어야 합니다.
+    // EN: Specifies the stream header format and the rANS engine to use when encoding and to expect when decoding.
+    // @param chunk_bits - If non-zero, the input stream is split into chunks of this many bits (a multiple of 64), and the
+    //                     frequencies are recomputed for every chunk. (A semi-static model, for blocks whose distribution drifts)
+    //                     The chunk frequency table is written right after the stream header, and a stream that fits in one
+    //                     chunk keeps the existing format. The same value must be given when decoding.
+    explicit rANS_Coder(StreamHeaderVersion header_version = StreamHeaderVersion::V2, RansEngine engine = RansEngine::Rans64, uint64_t chunk_bits = 0);
 
-    // KO: 'encode' 함수로 압축된 데이터를 원본 바이트 스트림으로 복호화합니다.
-    // EN: Decodes data compressed by the 'encode' function back into the original byte stream.
-    std::vector<uint8_t> decode(const std::vector<uint8_t>& compressed_data);
+    // --- Bit Stream Processing Functions ---
+    // --- 비트 스트림 처리 함수 ---
 
-    // KO: bool 값의 벡터(true/false)로 표현된 비트 스트림을 압축합니다.
-    // EN: Compresses a bit stream represented as a vector of bools (true/false).
-    std::vector<uint8_t> encode_bits(const std::vector<bool>& bit_stream);
+    // KO: uint64_t 워드에 촘촘하게 담긴 비트 스트림(PackedBits)을 압축합니다.
+    //     모든 인코딩 함수는 하나의 이진 부호화 코어를 공유합니다.
+    // @param descriptor - 값이 주어지면 스트림 헤더의 내용이 기록됩니다. (Detached 형식에서 필요)
+    // EN: Compresses a bit stream packed densely into uint64_t words (PackedBits).
+    //     All encoding functions share a single binary coding core.
+    // @param descriptor - If given, receives the contents of the stream header. (Needed with the Detached format)
+    std::vector<uint8_t> encode_bits(const PackedBits& bit_stream, StreamDescriptor* descriptor = nullptr);
 
     // KO: 'encode_bits' 함수로 압축된 데이터를 원본 비트 스트림으로 복호화합니다.
+    // @param descriptor - Detached 형식에서 스트림 헤더 대신 사용할 내용.
     // EN: Decodes data compressed by the 'encode_bits' function back into the original bit stream.
-    std::vector<bool> decode_bits(const std::vector<uint8_t>& compressed_data);
+    // @param descriptor - The contents used instead of a stream header with the Detached format.
+    PackedBits decode_bits(const std::vector<uint8_t>& compressed_data, const StreamDescriptor* descriptor = nullptr);
 
     // --- Special Stream Processing for Reconstructed Stream ---
     // --- 재구성 스트림(Reconstructed Stream)을 위한 특수 처리 함수 ---
@@ -38,19 +108,78 @@ public:
     //     이 함수는 더 흔한 심볼을 "00"으로, 드문 심볼을 "01"과 같은 비트 패턴으로 변환하여 rANS로 압축 효율을 높입니다.
     // @param recon_stream - 인코딩할 재구성 스트림.
     // @param is_placeholder_common - '데이터 자리표시자'가 스트림에서 더 흔한 심볼인지 여부를 나타내는 플래그.
+    // @param descriptor - 값이 주어지면 스트림 헤더의 내용이 기록됩니다.
     // EN: A specialized encoding function for the 'reconstructed_stream'.
     //     This stream consists of two types of symbols: 'data placeholders' and 'markers'.
     //     This function improves compression efficiency by converting the more common symbol to a bit pattern like "00" 
     //     and the rarer symbol to "01" before rANS encoding.
     // @param recon_stream - The reconstructed stream to be encoded.
     // @param is_placeholder_common - A flag indicating whether the 'data placeholder' is the more common symbol in the stream.
-    std::vector<uint8_t> encode_reconstructed_stream(const std::vector<uint8_t>& recon_stream, bool is_placeholder_common);
+    // @param descriptor - If given, receives the contents of the stream header.
+    std::vector<uint8_t> encode_reconstructed_stream(const PackedBits& recon_stream, bool is_placeholder_common, StreamDescriptor* descriptor = nullptr);
 
     // KO: 'encode_reconstructed_stream'으로 압축된 데이터를 원본 재구성 스트림으로 복호화합니다.
     // @param compressed_data - 복호화할 압축된 데이터.
     // @param is_placeholder_common - 인코딩 시 '데이터 자리표시자'가 흔한 심볼로 처리되었는지 여부를 알려주는 플래그.
+    // @param descriptor - Detached 형식에서 스트림 헤더 대신 사용할 내용.
     // EN: Decodes data compressed with 'encode_reconstructed_stream' back to the original reconstructed stream.
     // @param compressed_data - The compressed data to be decoded.
     // @param is_placeholder_common - A flag indicating if the 'data placeholder' was treated as the common symbol during encoding.
-    std::vector<uint8_t> decode_reconstructed_stream(const std::vector<uint8_t>& compressed_data, bool is_placeholder_common);
+    // @param descriptor - The contents used instead of a stream header with the Detached format.
+    PackedBits decode_reconstructed_stream(const std::vector<uint8_t>& compressed_data, bool is_placeholder_common, const StreamDescriptor* descriptor = nullptr);
+
+    // --- Streaming Functions (Fused Pipelines) ---
+    // --- 스트리밍 함수 (융합 파이프라인) ---
+
+    // KO: 'decode_bits' / 'decode_reconstructed_stream'과 같은 스트림을 한꺼번에 만들지 않고, 요청받을 때마다 복호화하는 공급원을 엽니다.
+    //     공급원은 compressed_data를 참조하므로, 다 읽을 때까지 compressed_data가 살아 있어야 합니다.
+    // EN: Opens a source that decodes the same stream as 'decode_bits' / 'decode_reconstructed_stream' on request instead of materializing it.
+    //     The source refers to compressed_data, which must outlive it.
+    std::unique_ptr<PackedBitSource> open_bits(const std::vector<uint8_t>& compressed_data, const StreamDescriptor* descriptor = nullptr);
+    std::unique_ptr<PackedBitSource> open_reconstructed_stream(const std::vector<uint8_t>& compressed_data, bool is_placeholder_common, const StreamDescriptor* descriptor = nullptr);
+
+    // KO: 스트림을 다 만들기 전에 심볼 수만으로 빈도를 정하고, 청크를 역순으로 받아 부호화하는 수신자를 만듭니다.
+    //     청크 빈도는 스트림 전체가 먼저 있어야 하므로, 청크 크기보다 긴 비퇴화 스트림에는 사용할 수 없습니다.
+    // @param ones / n_placeholders - 스트림 전체의 1의 개수 / 자리표시자 수.
+    // EN: Creates a sink whose frequencies are settled from the symbol counts alone, before the stream exists, and which codes the
+    //     chunks as they arrive in reverse. Chunked frequencies need the whole stream first, so a non-degenerate stream longer than a chunk cannot use it.
+    // @param ones / n_placeholders - The number of ones / placeholders in the whole stream.
+    std::unique_ptr<RansStreamSink> create_bits_sink(uint64_t bit_count, uint64_t ones);
+    std::unique_ptr<RansStreamSink> create_reconstructed_stream_sink(uint64_t symbol_count, uint64_t n_placeholders, bool is_placeholder_common);
+
+    // --- Fixed-Model Stream Processing (Trained Models) ---
+    // --- 고정 모델 스트림 처리 함수 (학습된 모델) ---
+
+    // KO: 여러 이진 스트림을 학습된 모델의 고정 확률(0.24 고정소수점, 0의 확률)로 하나의 rANS 상태에 이어서 압축합니다.
+    //     스트림 헤더를 기록하지 않으며, 모든 스트림이 비어 있으면 빈 벡터를 반환합니다.
+    // @param streams - 압축할 스트림들. 복호화 시 이 순서대로 복원됩니다.
+    // @param prob0_q24 - 각 스트림에서 0이 나타날 확률.
+    // EN: Compresses several binary streams back to back into a single rANS state, using the fixed probabilities
+    //     of a trained model (probability of a 0, in 0.24 fixed point). No stream headers are written, and an empty
+    //     vector is returned when every stream is empty.
+    // @param streams - The streams to compress. They are restored in this order when decoding.
+    // @param prob0_q24 - The probability of a 0 in each stream.
+    std::vector<uint8_t> encode_bits_with_model(const std::vector<const PackedBits*>& streams, const std::vector<uint32_t>& prob0_q24);
+
+    // KO: 'encode_bits_with_model'로 압축된 데이터를 복호화합니다.
+    // @param bit_counts - 각 스트림의 비트 수. (스트림 헤더가 없으므로 호출자가 알려 주어야 합니다.)
+    // EN: Decodes data compressed with 'encode_bits_with_model'.
+    // @param bit_counts - The bit count of every stream. (There are no stream headers, so the caller must supply them.)
+    std::vector<PackedBits> decode_bits_with_model(const std::vector<uint8_t>& compressed_data, const std::vector<uint64_t>& bit_counts, const std::vector<uint32_t>& prob0_q24);
+
+    // KO: 두 이진 심볼의 개수와 정규화된 빈도로부터 rANS 출력(플러시 포함) 크기의 증명 가능한 최악 상한을 계산합니다.
+    //     출력 버퍼를 이 크기로 한 번만 할당하면 재할당이나 버퍼 초과가 발생하지 않습니다.
+    // EN: Computes a provable worst-case upper bound of the rANS output size (including the flush)
+    //     from the counts and normalized frequencies of the two binary symbols.
+    //     Allocating the output buffer once with this size rules out both reallocation and overruns.
+    static size_t max_encoded_size(uint64_t count0, uint64_t count1, uint32_t norm_freq0, uint32_t norm_freq1, uint32_t scale_bits);
+
+    // KO: 엔진의 확률 정밀도(scale_bits)를 반환합니다. 스트림의 norm_freqs[0]은 [0, 1 << scale_bits] 범위에 있습니다.
+    // EN: Returns the probability precision (scale_bits) of an engine. The norm_freqs[0] of a stream lies in [0, 1 << scale_bits].
+    static uint32_t engine_scale_bits(RansEngine engine);
+
+private:
+    StreamHeaderVersion header_version;
+    RansEngine engine;
+    uint64_t chunk_bits;
 };
\ No newline at end of file
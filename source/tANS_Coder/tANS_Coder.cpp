@@ -0,0 +1,313 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 tANS_Coder 클래스의 멤버 함수들을 구현합니다.
+//     빈도 정규화, 상태 테이블 구성(FSE 방식의 심볼 분산), 그리고 역방향 비트스트림을 사용하는 부호화/복호화로 이루어집니다.
+// EN: This file implements the member functions of the tANS_Coder class.
+//     It consists of frequency normalization, state table construction (FSE-style symbol spreading),
+//     and encoding/decoding over a backward-read bitstream.
+#include "tANS_Coder.h"
+#include "../Varint/Varint.h"
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <bit>
+#include <algorithm>
+
+constexpr uint32_t TABLE_SIZE = 1u << tANS_Coder::TABLE_LOG;
+
+// KO: PackedBits의 비트를 MSB부터 8개씩 묶어 바이트로 만듭니다. 각 워드의 바이트는 빅 엔디언 순서입니다.
+// EN: Groups the bits of a PackedBits stream 8 at a time, MSB first, into bytes. The bytes of every word are in big-endian order.
+static std::vector<uint8_t> packed_bytes(const PackedBits& bits) {
+    std::vector<uint8_t> bytes(static_cast<size_t>((bits.size() + 7) / 8));
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(bits.words[i >> 3] >> (56 - 8 * (i & 7)));
+    }
+    return bytes;
+}
+
+static void byte_histogram(const std::vector<uint8_t>& bytes, uint64_t hist[256]) {
+    for (int s = 0; s < 256; ++s) hist[s] = 0;
+    for (uint8_t b : bytes) hist[b]++;
+}
+
+// KO: 바이트 빈도를 합이 TABLE_SIZE가 되도록 정규화합니다. 등장한 심볼은 1 이상의 빈도를 받습니다.
+//     반올림한 뒤 합이 맞을 때까지, 비용(비트) 증가가 가장 작은 심볼의 빈도를 하나씩 줄이거나 늘립니다.
+// EN: Normalizes the byte frequencies so that they sum to TABLE_SIZE. A symbol that occurs receives at least 1.
+//     After rounding, the frequency whose change costs the fewest bits is decremented or incremented one at a time until the sum is right.
+static void normalize_freqs(const uint64_t hist[256], uint32_t norm[256]) {
+    uint64_t total = 0;
+    for (int s = 0; s < 256; ++s) total += hist[s];
+    int64_t sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        if (hist[s] == 0) { norm[s] = 0; continue; }
+        const double scaled = static_cast<double>(hist[s]) * TABLE_SIZE / static_cast<double>(total);
+        norm[s] = static_cast<uint32_t>(std::max(1.0, std::floor(scaled + 0.5)));
+        sum += norm[s];
+    }
+    while (sum != TABLE_SIZE) {
+        const bool shrink = sum > TABLE_SIZE;
+        int best = -1;
+        double best_cost = 0.0;
+        for (int s = 0; s < 256; ++s) {
+            if (norm[s] == 0 || (shrink && norm[s] == 1)) continue;
+            const double cost = shrink ? hist[s] * std::log2(static_cast<double>(norm[s]) / (norm[s] - 1))
+                                       : -(hist[s] * std::log2(static_cast<double>(norm[s] + 1) / norm[s]));
+            if (best < 0 || cost < best_cost) {
+                best = s;
+                best_cost = cost;
+            }
+        }
+        if (shrink) { norm[best]--; sum--; }
+        else { norm[best]++; sum++; }
+    }
+}
+
+// KO: 심볼을 상태 테이블에 분산합니다. (FSE 방식: 테이블 크기와 서로소인 보폭으로 순회)
+// EN: Spreads the symbols over the state table. (FSE-style: a walk with a step coprime to the table size)
+static void spread_symbols(const uint32_t norm[256], uint8_t table[TABLE_SIZE]) {
+    const uint32_t step = (TABLE_SIZE >> 1) + (TABLE_SIZE >> 3) + 3;
+    uint32_t pos = 0;
+    for (int s = 0; s < 256; ++s) {
+        for (uint32_t i = 0; i < norm[s]; ++i) {
+            table[pos] = static_cast<uint8_t>(s);
+            pos = (pos + step) & (TABLE_SIZE - 1);
+        }
+    }
+}
+
+// KO: 복호화 테이블 항목입니다. 상태 하나가 심볼(스트림 비트 8개), 읽을 비트 수, 다음 상태의 기준값을 한 번에 알려 줍니다.
+// EN: A decoding table entry. One state tells the symbol (8 stream bits), the number of bits to read and the base of the next state at once.
+struct DecodeEntry {
+    uint16_t next_base;
+    uint8_t symbol;
+    uint8_t n_bits;
+};
+
+// --- Bit I/O ---
+// --- 비트 입출력 ---
+
+// KO: LSB부터 채우는 순방향 비트 기록기입니다.
+// EN: A forward bit writer that fills LSB first.
+class ForwardBitWriter {
+public:
+    explicit ForwardBitWriter(std::vector<uint8_t>& output) : out(output) {}
+
+    inline void put(uint32_t value, unsigned count) {
+        acc |= static_cast<uint64_t>(value) << fill;
+        fill += count;
+        while (fill >= 8) {
+            out.push_back(static_cast<uint8_t>(acc));
+            acc >>= 8;
+            fill -= 8;
+        }
+    }
+
+    void finish() {
+        if (fill > 0) out.push_back(static_cast<uint8_t>(acc));
+        acc = 0;
+        fill = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t acc = 0;
+    unsigned fill = 0;
+};
+
+// KO: 끝에서부터 거꾸로 읽는 역방향 비트 판독기입니다. 버퍼는 4바이트 여유분을 가져야 합니다.
+// EN: A backward bit reader that reads from the end towards the start. The buffer must have 4 bytes of slack.
+class BackwardBitReader {
+public:
+    BackwardBitReader(const uint8_t* data, uint64_t bit_position) : data(data), pos(bit_position) {}
+
+    inline uint32_t get(unsigned count) {
+        if (count > pos) {
+            throw std::runtime_error("Invalid compressed data: tANS bitstream overrun.");
+        }
+        pos -= count;
+        uint32_t window;
+        memcpy(&window, data + (pos >> 3), 4);
+        return (window >> (pos & 7)) & ((1u << count) - 1);
+    }
+
+    uint64_t remaining() const { return pos; }
+
+private:
+    const uint8_t* data;
+    uint64_t pos;
+};
+
+// --- Public Functions ---
+// --- 공개 함수 ---
+
+std::vector<uint8_t> tANS_Coder::encode_bits(const PackedBits& bit_stream) {
+    if (bit_stream.empty()) return {};
+    const std::vector<uint8_t> symbols = packed_bytes(bit_stream);
+    uint64_t hist[256];
+    byte_histogram(symbols, hist);
+    uint32_t norm[256];
+    normalize_freqs(hist, norm);
+
+    // KO: 부호화 테이블: 심볼 s의 x번째 값(x는 [norm, 2*norm))이 가리키는 상태는 분산 테이블에서 s가 x - norm번째로 나타나는 위치입니다.
+    // EN: The encoding table: value x of symbol s (x in [norm, 2*norm)) maps to the state where s appears for the (x - norm)-th time in the spread table.
+    uint8_t spread[TABLE_SIZE];
+    spread_symbols(norm, spread);
+    uint32_t cumulative[256];
+    uint32_t running = 0;
+    for (int s = 0; s < 256; ++s) {
+        cumulative[s] = running;
+        running += norm[s];
+    }
+    std::vector<uint16_t> encode_table(TABLE_SIZE);
+    uint32_t occurrence[256] = { 0 };
+    for (uint32_t u = 0; u < TABLE_SIZE; ++u) {
+        const uint8_t s = spread[u];
+        encode_table[cumulative[s] + occurrence[s]++] = static_cast<uint16_t>(TABLE_SIZE + u);
+    }
+    // KO: 심볼마다 최대 출력 비트 수와, 그보다 한 비트 적게 내보내는 상태의 경계입니다.
+    // EN: The maximum number of output bits of every symbol, and the state bound below which one bit fewer is emitted.
+    uint32_t max_bits[256], threshold[256];
+    for (int s = 0; s < 256; ++s) {
+        if (norm[s] == 0) continue;
+        max_bits[s] = TABLE_LOG - static_cast<uint32_t>(std::bit_width(norm[s]) - 1);
+        threshold[s] = norm[s] << max_bits[s];
+    }
+
+    std::vector<uint8_t> output;
+    output.reserve(1 + 256 * 2 + symbols.size() + 8);
+    int last_symbol = 255;
+    while (norm[last_symbol] == 0) --last_symbol;
+    output.push_back(static_cast<uint8_t>(last_symbol));
+    for (int s = 0; s <= last_symbol; ++s) write_varint(output, norm[s]);
+
+    // KO: 심볼을 역순으로 부호화하여, 복호기가 비트스트림을 거꾸로 읽으면서 정순으로 심볼을 얻도록 합니다.
+    // EN: The symbols are encoded in reverse, so the decoder gets them in order while reading the bitstream backwards.
+    ForwardBitWriter writer(output);
+    uint32_t state = TABLE_SIZE;
+    for (size_t i = symbols.size(); i-- > 0;) {
+        const uint8_t s = symbols[i];
+        const uint32_t n_bits = (state >= threshold[s]) ? max_bits[s] : max_bits[s] - 1;
+        writer.put(state & ((1u << n_bits) - 1), n_bits);
+        state = encode_table[cumulative[s] + (state >> n_bits) - norm[s]];
+    }
+    writer.put(state - TABLE_SIZE, TABLE_LOG);
+    writer.put(1, 1);
+    writer.finish();
+    return output;
+}
+
+// KO: 압축 데이터에서 워드를 요청받을 때마다 복호화하는 tANS 공급원입니다. 생성 시 빈도 표를 읽어 복호화 테이블을 만들고,
+//     워드 하나마다 조회 8번으로 스트림 비트 64개를 만듭니다. 마지막 워드를 만든 뒤 최종 상태와 남은 비트를 검증합니다.
+// EN: A tANS source that decodes words from the compressed data as they are requested. The frequency table is read and the decoding
+//     table built at construction, and every word takes 8 lookups for its 64 stream bits. The final state and the leftover bits are
+//     validated after the last word.
+class TableBitSource : public PackedBitSource {
+public:
+    TableBitSource(const std::vector<uint8_t>& compressed_data, uint64_t bit_count)
+        : PackedBitSource(bit_count), decode_table(TABLE_SIZE), reader(nullptr, 0) {
+        if (bit_count == 0) return;
+        const uint8_t* ptr = compressed_data.data();
+        const uint8_t* end = ptr + compressed_data.size();
+        if (ptr == end) {
+            throw std::runtime_error("Invalid compressed data: missing tANS frequency table.");
+        }
+
+        // KO: 정규화된 빈도 표를 읽고 합을 검증합니다.
+        // EN: Reads the normalized frequency table and validates its sum.
+        uint32_t norm[256] = { 0 };
+        const int last_symbol = *ptr++;
+        uint64_t sum = 0;
+        for (int s = 0; s <= last_symbol; ++s) {
+            uint64_t freq;
+            if (!read_varint(ptr, end, freq) || freq > TABLE_SIZE) {
+                throw std::runtime_error("Invalid compressed data: corrupted tANS frequency table.");
+            }
+            norm[s] = static_cast<uint32_t>(freq);
+            sum += freq;
+        }
+        if (sum != TABLE_SIZE) {
+            throw std::runtime_error("Invalid compressed data: corrupted tANS frequency table.");
+        }
+
+        // KO: 복호화 테이블: 상태 u의 심볼 s가 x번째 값이면, 다음 상태는 (x << n_bits) + (읽은 비트) - TABLE_SIZE 입니다.
+        // EN: The decoding table: if the symbol s of state u has value x, the next state is (x << n_bits) + (bits read) - TABLE_SIZE.
+        uint8_t spread[TABLE_SIZE];
+        spread_symbols(norm, spread);
+        uint32_t next_value[256];
+        for (int s = 0; s < 256; ++s) next_value[s] = norm[s];
+        for (uint32_t u = 0; u < TABLE_SIZE; ++u) {
+            const uint8_t s = spread[u];
+            const uint32_t x = next_value[s]++;
+            const uint32_t n_bits = tANS_Coder::TABLE_LOG - static_cast<uint32_t>(std::bit_width(x) - 1);
+            decode_table[u] = { static_cast<uint16_t>((x << n_bits) - TABLE_SIZE), s, static_cast<uint8_t>(n_bits) };
+        }
+
+        // KO: 비트스트림의 마지막 바이트에서 종료 비트를 찾고, 그 앞의 최종 상태부터 읽습니다.
+        // EN: Finds the terminating bit in the last byte of the bitstream, and starts reading from the final state before it.
+        const size_t stream_size = static_cast<size_t>(end - ptr);
+        if (stream_size == 0 || ptr[stream_size - 1] == 0) {
+            throw std::runtime_error("Invalid compressed data: missing tANS state.");
+        }
+        stream.assign(ptr, end);
+        stream.resize(stream_size + 4, 0);
+        const uint64_t marker = static_cast<uint64_t>(stream_size - 1) * 8 + (std::bit_width(stream[stream_size - 1]) - 1);
+        reader = BackwardBitReader(stream.data(), marker);
+        state = reader.get(tANS_Coder::TABLE_LOG);
+    }
+
+    // KO: 조회 한 번마다 스트림 비트 8개(한 바이트)가 나오며, 이를 빅 엔디언 순서로 워드에 채웁니다.
+    //     마지막 바이트의 남는 비트는 인코딩 시 0이었으므로, 손상된 데이터가 아니면 이미 0입니다.
+    // EN: Every lookup yields 8 stream bits (one byte), which are filled into the words in big-endian order.
+    //     The spare bits of the last byte were zero when encoding, so they are already zero unless the data is corrupted.
+    size_t read_words(uint64_t* out, size_t max_words) override {
+        size_t n = 0;
+        for (; n < max_words && pos < bit_count; ++n, pos += 64) {
+            const uint64_t remaining = bit_count - pos;
+            const unsigned n_symbols = (remaining < 64) ? static_cast<unsigned>((remaining + 7) / 8) : 8;
+            uint64_t word = 0;
+            for (unsigned i = 0; i < n_symbols; ++i) {
+                const DecodeEntry& e = decode_table[state];
+                word |= static_cast<uint64_t>(e.symbol) << (56 - 8 * i);
+                state = e.next_base + reader.get(e.n_bits);
+            }
+            out[n] = (remaining < 64) ? (word & (~0ull << (64 - remaining))) : word;
+        }
+        if (n > 0 && pos >= bit_count && (state != 0 || reader.remaining() != 0)) {
+            throw std::runtime_error("Invalid compressed data: tANS bitstream mismatch.");
+        }
+        return n;
+    }
+
+private:
+    std::vector<DecodeEntry> decode_table;
+    std::vector<uint8_t> stream;
+    BackwardBitReader reader;
+    uint32_t state = 0;
+    uint64_t pos = 0;
+};
+
+PackedBits tANS_Coder::decode_bits(const std::vector<uint8_t>& compressed_data, uint64_t bit_count) {
+    return read_all_bits(*open_bits(compressed_data, bit_count));
+}
+
+std::unique_ptr<PackedBitSource> tANS_Coder::open_bits(const std::vector<uint8_t>& compressed_data, uint64_t bit_count) {
+    return std::make_unique<TableBitSource>(compressed_data, bit_count);
+}
+
+uint64_t tANS_Coder::estimate_encoded_size(const PackedBits& bit_stream) {
+    if (bit_stream.empty()) return 0;
+    const std::vector<uint8_t> symbols = packed_bytes(bit_stream);
+    uint64_t hist[256];
+    byte_histogram(symbols, hist);
+    uint32_t norm[256];
+    normalize_freqs(hist, norm);
+
+    double bits = TABLE_LOG + 1;
+    size_t table_size = 1;
+    int last_symbol = 255;
+    while (norm[last_symbol] == 0) --last_symbol;
+    for (int s = 0; s <= last_symbol; ++s) {
+        table_size += varint_size(norm[s]);
+        if (hist[s] > 0) bits += static_cast<double>(hist[s]) * (TABLE_LOG - std::log2(static_cast<double>(norm[s])));
+    }
+    return table_size + static_cast<uint64_t>(std::ceil(bits / 8.0));
+}
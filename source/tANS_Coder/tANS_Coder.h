@@ -0,0 +1,48 @@
+﻿#pragma once
+// Author: SnowPing00
+// KO: 헤더 파일이 중복으로 포함되는 것을 방지합니다.
+// EN: Prevents the header file from being included multiple times.
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "../PackedBits/PackedBits.h"
+
+// KO: 테이블 기반 ANS(tANS, FSE 방식) 부호화 및 복호화 기능을 제공하는 클래스입니다.
+//     이진 스트림의 비트를 8비트씩 묶어 256개 심볼의 알파벳으로 부호화하므로, 복호화 시 테이블 조회 한 번으로 스트림 비트 8개가 나옵니다.
+//     (rANS_Coder는 상태 갱신 한 번에 이진 심볼 하나를 복호화합니다.)
+//     압축 데이터: [uint8 마지막 심볼][심볼 0부터 마지막 심볼까지 varint 정규화 빈도][비트스트림]
+//     비트스트림은 심볼을 역순으로 부호화하며 LSB부터 채워지고, 끝에 최종 상태(TABLE_LOG비트)와 종료 비트 1이 붙습니다.
+// EN: A class that provides table-based ANS (tANS, FSE-style) encoding and decoding.
+//     The bits of a binary stream are grouped 8 at a time and coded over a 256-symbol alphabet, so every table lookup
+//     while decoding yields 8 stream bits. (The rANS_Coder decodes one binary symbol per state update.)
+//     Compressed data: [uint8 last symbol][varint normalized frequency for symbols 0 to the last symbol][bitstream]
+//     The bitstream codes the symbols in reverse and is filled LSB first; it ends with the final state (TABLE_LOG bits) and a terminating 1 bit.
+class tANS_Coder {
+public:
+    // KO: 상태 테이블의 크기(log2)입니다. 정규화된 빈도의 합은 1 << TABLE_LOG 입니다.
+    // EN: The size (log2) of the state table. The normalized frequencies sum to 1 << TABLE_LOG.
+    static constexpr unsigned TABLE_LOG = 11;
+
+    // KO: PackedBits 스트림을 바이트 심볼로 묶어 압축합니다. 마지막 바이트의 남는 비트는 0으로 채워집니다.
+    //     빈 스트림은 빈 벡터가 됩니다.
+    // EN: Compresses a PackedBits stream grouped into byte symbols. The spare bits of the last byte are filled with zeros.
+    //     An empty stream becomes an empty vector.
+    std::vector<uint8_t> encode_bits(const PackedBits& bit_stream);
+
+    // KO: 'encode_bits'로 압축된 데이터를 복호화합니다.
+    // @param bit_count - 원본 스트림의 비트 수. (압축 데이터에 기록되지 않으므로 호출자가 알려 주어야 합니다.)
+    // EN: Decodes data compressed with 'encode_bits'.
+    // @param bit_count - The bit count of the original stream. (It is not recorded in the compressed data, so the caller must supply it.)
+    PackedBits decode_bits(const std::vector<uint8_t>& compressed_data, uint64_t bit_count);
+
+    // KO: 'decode_bits'와 같은 스트림을 한꺼번에 만들지 않고, 요청받을 때마다 복호화하는 공급원을 엽니다. (융합 파이프라인용)
+    // EN: Opens a source that decodes the same stream as 'decode_bits' on request instead of materializing it. (For fused pipelines)
+    std::unique_ptr<PackedBitSource> open_bits(const std::vector<uint8_t>& compressed_data, uint64_t bit_count);
+
+    // KO: 스트림을 부호화하지 않고, 'encode_bits'가 만들 출력의 크기(바이트)를 바이트 히스토그램으로부터 추정합니다.
+    //     정규화된 빈도에 대한 교차 엔트로피와 빈도 표의 크기를 더한 값입니다.
+    // EN: Estimates the size (in bytes) of the output 'encode_bits' would produce from the byte histogram, without encoding the stream.
+    //     It is the cross entropy under the normalized frequencies plus the size of the frequency table.
+    static uint64_t estimate_encoded_size(const PackedBits& bit_stream);
+};
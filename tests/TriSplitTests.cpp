@@ -0,0 +1,972 @@
+﻿// Author: SnowPing00
+// KO: 이 파일은 TriSplit 블록 형식과 컨테이너의 왕복(round-trip) 및 손상 입력 테스트입니다.
+//     각 테스트는 압축한 데이터가 원본으로 정확히 복원되는지, 그리고 잘리거나 비트가 바뀐 입력이
+//     충돌 없이 오류로 끝나는지 확인합니다. 실패한 검사가 있으면 0이 아닌 값으로 종료합니다.
+// EN: This file holds the round-trip and corrupt-input tests of the TriSplit block formats and container.
+//     Every test checks that compressed data restores the original exactly, and that truncated or bit-flipped input
+//     ends in an error without crashing. The program exits with a non-zero status if any check fails.
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <cstdint>
+
+#include "../source/BlockCodec/BlockCodec.h"
+#include "../source/PackedBits/PackedBits.h"
+#include "../source/SeparationEngine/SeparationEngine.h"
+#include "../source/Transform/Transform.h"
+#include "../source/Container/Container.h"
+#include "../source/ArchiveReader/ArchiveReader.h"
+#include "../source/PerfCounters/PerfCounters.h"
+#include "../source/BufferPool/BufferPool.h"
+#include "../source/WorkPool/WorkPool.h"
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// --- 검사 도구 ---
+// --- Check Helpers ---
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 실패 메시지는 테스트 중에 std::cerr를 버리더라도 보이도록, 처음의 표준 오류 버퍼에 씁니다.
+// EN: Failure messages go to the original standard error buffer, so they stay visible while std::cerr is discarded.
+static std::ostream failure_log(std::cerr.rdbuf());
+static int failed_checks = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            ++failed_checks; \
+            failure_log << "FAILED: " << __FILE__ << ":" << __LINE__ << ": " #condition << std::endl; \
+        } \
+    } while (0)
+
+// KO: 코덱은 진행 상황을 std::cout과 std::cerr에 출력하므로, 테스트하는 동안 둘을 버립니다.
+// EN: The codec prints its progress to std::cout and std::cerr, so both are discarded while a test runs.
+class QuietStreams {
+public:
+    QuietStreams() : saved_out(std::cout.rdbuf(sink.rdbuf())), saved_err(std::cerr.rdbuf(sink.rdbuf())) {}
+    ~QuietStreams() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+
+private:
+    std::ostringstream sink;
+    std::streambuf* saved_out;
+    std::streambuf* saved_err;
+};
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// --- 테스트 데이터 ---
+// --- Test Data ---
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+static std::vector<uint8_t> random_bytes(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (uint8_t& byte : data) byte = static_cast<uint8_t>(rng());
+    return data;
+}
+
+// KO: 몇몇 바이트 값에 치우친 데이터로, 분리한 스트림이 잘 압축됩니다.
+// EN: Data skewed toward a few byte values, whose separated streams compress well.
+static std::vector<uint8_t> skewed_bytes(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::geometric_distribution<int> distribution(0.3);
+    std::vector<uint8_t> data(size);
+    for (uint8_t& byte : data) byte = static_cast<uint8_t>(std::min(distribution(rng), 255));
+    return data;
+}
+
+static std::vector<uint8_t> text_bytes(size_t size) {
+    static const std::string words[] = { "the ", "block ", "stream ", "split ", "of ", "rANS ", "and ", "bitmap\n", "data, " };
+    std::vector<uint8_t> data;
+    data.reserve(size);
+    for (size_t i = 0; data.size() < size; ++i) {
+        const std::string& word = words[(i * 7 + i / 5) % (sizeof(words) / sizeof(words[0]))];
+        data.insert(data.end(), word.begin(), word.end());
+    }
+    data.resize(size);
+    return data;
+}
+
+// KO: 천천히 변하는 16비트 측정값처럼, 지연 필터와 전치가 도움이 되는 데이터입니다.
+// EN: Data like slowly changing 16-bit readings, which the lag filters and transpositions help.
+static std::vector<uint8_t> telemetry_bytes(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        const uint16_t value = static_cast<uint16_t>(1000 + 200 * std::sin(static_cast<double>(i) / 300.0));
+        data[i] = static_cast<uint8_t>(value);
+        data[i + 1] = static_cast<uint8_t>(value >> 8);
+    }
+    return data;
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// --- 공용 검사 ---
+// --- Shared Checks ---
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 블록을 복호화하며, 예외를 던지면 빈 결과로 취급합니다.
+// EN: Decodes a block, treating a thrown exception as an empty result.
+static bool try_decompress(const std::vector<uint8_t>& block, const TrainedModel* model, const std::vector<uint8_t>* previous,
+                           std::vector<uint8_t>& output) {
+    try {
+        output = decompress_block(block, model, previous);
+        return true;
+    }
+    catch (const std::exception&) {
+        output.clear();
+        return false;
+    }
+}
+
+static bool round_trips(const std::vector<uint8_t>& data, const CompressionOptions& options, const TrainedModel* model = nullptr) {
+    const std::vector<uint8_t> block = compress_block(data, model, options);
+    std::vector<uint8_t> output;
+    uint64_t original_size = 0;
+    return try_decompress(block, model, nullptr, output) && output == data &&
+           read_block_original_size(block, original_size) && original_size == data.size();
+}
+
+// KO: 블록의 모든 접두사와 여러 비트 뒤집기를 복호화합니다. 잘린 블록은 원본 크기로 복원되면 안 되며,
+//     어떤 입력도 충돌하거나 메모리 밖을 읽어서는 안 됩니다 (AddressSanitizer로 빌드하면 함께 확인됩니다).
+// EN: Decodes every prefix of the block and many bit flips of it. A truncated block must not restore the original size,
+//     and no input may crash or read out of bounds (checked as well when built with AddressSanitizer).
+static void check_corruption(const std::vector<uint8_t>& block, size_t original_size,
+                             const TrainedModel* model = nullptr, const std::vector<uint8_t>* previous = nullptr) {
+    std::vector<uint8_t> output;
+    const size_t step = std::max<size_t>(1, block.size() / 512);
+    for (size_t length = 0; length < block.size(); length += step) {
+        const std::vector<uint8_t> truncated(block.begin(), block.begin() + length);
+        try_decompress(truncated, model, previous, output);
+        CHECK(output.size() != original_size || original_size == 0);
+    }
+
+    std::mt19937 rng(static_cast<uint32_t>(block.size()));
+    for (int trial = 0; trial < 200 && !block.empty(); ++trial) {
+        std::vector<uint8_t> flipped = block;
+        for (int flip = 0; flip < 1 + trial % 3; ++flip) {
+            const size_t bit = rng() % (flipped.size() * 8);
+            flipped[bit / 8] ^= static_cast<uint8_t>(1 << (bit % 8));
+        }
+        try_decompress(flipped, model, previous, output);
+    }
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// --- 블록 형식 테스트 ---
+// --- Block Format Tests ---
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 기본 선택 사항의 블록은 빈 블록부터 큰 블록까지 왕복해야 하며, 잘리거나 손상된 블록은 충돌 없이 실패해야 합니다.
+//     비트 뒤집기는 첫 바이트의 플래그도 바꾸므로, 고정 크기 헤더를 갖는 기존 블록의 경로도 함께 시험합니다.
+// EN: Blocks with the default options must round-trip from empty blocks to large ones, and truncated or damaged blocks
+//     must fail without crashing. Bit flips change the flags of the first byte too, so the path of legacy blocks with
+//     their fixed-size header is exercised as well.
+static void test_default_blocks() {
+    QuietStreams quiet;
+    const CompressionOptions options;
+    const std::vector<std::vector<uint8_t>> inputs = {
+        {}, { 42 }, std::vector<uint8_t>(100000, 0), text_bytes(300000), skewed_bytes(200000, 1), random_bytes(50000, 2),
+    };
+    for (const std::vector<uint8_t>& data : inputs) CHECK(round_trips(data, options));
+
+    const std::vector<uint8_t> text = text_bytes(60000);
+    const std::vector<uint8_t> skew = skewed_bytes(60000, 22);
+    check_corruption(compress_block(text, nullptr, options), text.size());
+    check_corruption(compress_block(skew, nullptr, options), skew.size());
+}
+
+// KO: tANS를 끄면 모든 스트림이 rANS로 부호화됩니다. 64 KiB(BlockCodec.cpp의 SMALL_BLOCK_SIZE)보다 작은 블록은
+//     바이트 단위 rANS를, 큰 블록은 64비트 rANS를 쓰므로 경계 양쪽의 크기를 시험합니다.
+// EN: With tANS off every stream is coded with rANS. Blocks smaller than 64 KiB (SMALL_BLOCK_SIZE in BlockCodec.cpp) use the
+//     byte-wise rANS and larger ones the 64-bit rANS, so sizes on both sides of the boundary are tested.
+static void test_rans_blocks() {
+    QuietStreams quiet;
+    constexpr size_t small_block_size = 64 * 1024;
+    CompressionOptions options;
+    options.allow_table_ans = false;
+    for (size_t size : { small_block_size - 1, small_block_size, small_block_size + 1, 4 * small_block_size + 3 }) {
+        CHECK(round_trips(skewed_bytes(size, static_cast<uint32_t>(size)), options));
+        CHECK(round_trips(text_bytes(size), options));
+    }
+
+    const std::vector<uint8_t> small = skewed_bytes(30000, 28);
+    const std::vector<uint8_t> large = skewed_bytes(100000, 29);
+    check_corruption(compress_block(small, nullptr, options), small.size());
+    check_corruption(compress_block(large, nullptr, options), large.size());
+}
+
+// KO: PackedBits는 워드 경계를 넘는 비트 묶음을 쓰고 읽어도 순서대로 같은 비트를 돌려주어야 합니다.
+// EN: PackedBits must give back the same bits in order when bit groups that straddle word boundaries are written and read.
+static void test_packed_bits() {
+    std::mt19937 rng(30);
+    std::vector<std::pair<uint64_t, unsigned>> groups;
+    PackedBits bits;
+    PackedBitWriter writer(bits, 100);
+    uint64_t total = 0;
+    for (int i = 0; i < 5000; ++i) {
+        const unsigned count = rng() % 58;
+        const uint64_t value = count == 0 ? 0 : (static_cast<uint64_t>(rng()) << 32 | rng()) >> (64 - count);
+        if (count == 1) writer.put(static_cast<uint32_t>(value));
+        else writer.put_bits(value, count);
+        groups.emplace_back(value, count);
+        total += count;
+    }
+    writer.finish();
+    CHECK(bits.size() == total && bits.words.size() == PackedBits::words_for(total));
+
+    PackedBitReader reader(bits);
+    bool same = true;
+    for (const auto& [value, count] : groups) same = same && reader.get_bits(count) == value;
+    CHECK(same && reader.position() == total);
+
+    const PackedBits ones = PackedBits::filled(131, 1);
+    CHECK(ones.count_ones() == 131 && ones.get(130) == 1 && PackedBits::filled(131, 0).count_ones() == 0);
+}
+
+static void test_trained_model() {
+    QuietStreams quiet;
+    ModelTrainer trainer;
+    for (uint32_t seed = 10; seed < 20; ++seed) trainer.add_sample(skewed_bytes(4096, seed));
+    const TrainedModel model = trainer.build();
+    CHECK(model.model_id != 0);
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "TriSplitTests.model";
+    CHECK(model.save(path));
+    TrainedModel loaded;
+    CHECK(loaded.load(path) && loaded.model_id == model.model_id);
+    std::filesystem::remove(path);
+
+    const std::vector<uint8_t> data = skewed_bytes(512, 21);
+    const CompressionOptions options;
+    CHECK(round_trips(data, options, &loaded));
+
+    // KO: 학습된 모델 블록은 모델 없이, 또는 다른 모델로는 복호화되지 않아야 합니다.
+    // EN: A trained-model block must not decode without its model or with another model.
+    const std::vector<uint8_t> block = compress_block(data, &model, options);
+    std::vector<uint8_t> output;
+    try_decompress(block, nullptr, nullptr, output);
+    CHECK(output.empty());
+    ModelTrainer other_trainer;
+    other_trainer.add_sample(text_bytes(4096));
+    const TrainedModel other = other_trainer.build();
+    try_decompress(block, &other, nullptr, output);
+    CHECK(output.empty());
+
+    check_corruption(block, data.size(), &model);
+}
+
+// KO: 작은 블록도 압축 블록 형식으로 왕복해야 하며, 퇴화 스트림만 있는 블록의 헤더는 수 바이트여야 합니다.
+//     저장 블록으로 바뀌지 않도록 store_incompressible을 끕니다.
+// EN: Small blocks must round-trip in the compact block format too, and a block with only degenerate streams must have a header
+//     of a few bytes. store_incompressible is turned off so that no block becomes a stored block.
+static void test_compact_blocks() {
+    QuietStreams quiet;
+    CompressionOptions options;
+    options.store_incompressible = false;
+    for (size_t size = 0; size <= 64; ++size) {
+        const std::vector<uint8_t> data = skewed_bytes(size, static_cast<uint32_t>(40 + size));
+        const std::vector<uint8_t> block = compress_block(data, nullptr, options);
+        CHECK(!block.empty() && (block[0] & (BLOCK_FLAG_COMPACT | BLOCK_FLAG_TRAINED_MODEL)) == BLOCK_FLAG_COMPACT);
+        CHECK(round_trips(data, options));
+    }
+    CHECK(compress_block(std::vector<uint8_t>(1000, 0), nullptr, options).size() <= 16);
+
+    const std::vector<uint8_t> data = skewed_bytes(2000, 31);
+    check_corruption(compress_block(data, nullptr, options), data.size());
+}
+
+static void test_symbol_widths() {
+    QuietStreams quiet;
+    const std::vector<uint8_t> text = text_bytes(400000);
+    const std::vector<uint8_t> skew = skewed_bytes(400000, 3);
+    const std::vector<uint8_t> small = skewed_bytes(60000, 32);
+    for (unsigned width : { 1u, 2u, 4u }) {
+        CompressionOptions options;
+        options.symbol_width = width;
+        CHECK(round_trips(text, options));
+        CHECK(round_trips(skew, options));
+        CHECK(round_trips(random_bytes(1000, width), options));
+        if (width != 2) check_corruption(compress_block(small, nullptr, options), small.size());
+    }
+}
+
+// KO: 모든 짝짓기로 분리한 스트림은 원본으로 재조립되어야 하며, 자동 짝짓기는 자주 나오는 두 심볼을 한 쌍으로 묶어야 합니다.
+// EN: Streams separated with every pairing must reassemble into the original, and the automatic pairing must pair up the two frequent symbols.
+static void test_symbol_pairing() {
+    QuietStreams quiet;
+    const uint64_t pair_00_01[4] = { 1000, 1000, 10, 10 };
+    const uint64_t pair_00_10[4] = { 1000, 10, 1000, 10 };
+    const uint64_t canonical[4] = { 10, 1000, 1000, 10 };
+    CHECK(SeparationEngine::best_pairing(pair_00_01) == SymbolPairing::Pair00_01);
+    CHECK(SeparationEngine::best_pairing(pair_00_10) == SymbolPairing::Pair00_10);
+    CHECK(SeparationEngine::best_pairing(canonical) == SymbolPairing::Canonical);
+
+    // KO: 주로 '00'과 '01'로 이루어진 데이터입니다.
+    // EN: Data made mostly of '00' and '01'.
+    std::mt19937 rng(33);
+    std::vector<uint8_t> data(200000);
+    for (uint8_t& byte : data) {
+        for (int i = 0; i < 4; ++i) byte = static_cast<uint8_t>(byte << 2 | (rng() % 16 == 0 ? 2 + rng() % 2 : rng() % 2));
+    }
+    SeparationEngine engine;
+    for (SymbolPairing pairing : { SymbolPairing::Canonical, SymbolPairing::Pair00_01, SymbolPairing::Pair00_10, SymbolPairing::Auto }) {
+        const SeparatedStreams streams = engine.separate(data, std::nullopt, 2, pairing);
+        CHECK(pairing != SymbolPairing::Auto || streams.pairing == SymbolPairing::Pair00_01);
+        CHECK(engine.reconstruct(streams.value_bitmap, streams.auxiliary_mask, streams.reconstructed_stream,
+                                 streams.aux_mask_1_represents_11, data.size(), 2, streams.pairing) == data);
+    }
+
+    CompressionOptions options;
+    options.optimize_pairing = true;
+    CHECK(round_trips(data, options));
+    CHECK(round_trips(text_bytes(300000), options));
+    check_corruption(compress_block(std::vector<uint8_t>(data.begin(), data.begin() + 60000), nullptr, options), 60000);
+}
+
+// KO: 모든 스트림을 rANS로 부호화하면 추정 크기는 실제 블록 크기와 거의 같아야 합니다. 심볼 폭을 찾을 때도 마찬가지입니다.
+// EN: With every stream coded with rANS, the predicted size must be close to the actual block size. The same holds when the symbol width is searched.
+static void test_estimate() {
+    QuietStreams quiet;
+    const std::vector<std::vector<uint8_t>> inputs = { text_bytes(300000), skewed_bytes(300000, 34), random_bytes(50000, 35) };
+    for (bool search_symbol_width : { false, true }) {
+        CompressionOptions options;
+        options.allow_table_ans = false;
+        options.store_incompressible = false;
+        options.search_symbol_width = search_symbol_width;
+        for (const std::vector<uint8_t>& data : inputs) {
+            const BlockEstimate estimate = estimate_block(data, nullptr, options);
+            const uint64_t actual = compress_block(data, nullptr, options).size();
+            CHECK(estimate.original_size == data.size());
+            CHECK(estimate.predicted_size <= actual + actual / 100 + 16 && actual <= estimate.predicted_size + actual / 100 + 16);
+        }
+    }
+}
+
+// KO: 모든 변환 조합은 레코드 크기의 배수가 아닌 길이에서도 가역이어야 하며, 측정값 데이터의 블록을 줄여야 합니다.
+// EN: Every combination of transforms must be reversible, also for lengths that are not a multiple of the record size,
+//     and must shrink blocks of telemetry data.
+static void test_transforms() {
+    QuietStreams quiet;
+    const std::vector<uint8_t> sample = skewed_bytes(1003, 36);
+    for (ByteFilter filter : { ByteFilter::None, ByteFilter::Delta, ByteFilter::Xor }) {
+        for (Transposition transposition : { Transposition::None, Transposition::Bytes, Transposition::BitPlanes }) {
+            for (uint32_t distance : { 1u, 2u, 3u, 4u, 7u, 2000u }) {
+                const TransformSpec spec = { filter, distance, transposition, distance };
+                CHECK(is_valid_transform(spec));
+                CHECK(inverse_transform(forward_transform(sample, spec), spec) == sample);
+            }
+        }
+    }
+    CHECK(!is_valid_transform({ ByteFilter::Delta, 0, Transposition::None, 1 }));
+    CHECK(!is_valid_transform({ ByteFilter::None, 1, Transposition::Bytes, MAX_TRANSFORM_DISTANCE + 1 }));
+
+    const std::vector<uint8_t> telemetry = telemetry_bytes(200000);
+    const std::vector<uint8_t> text = text_bytes(200000);
+    CompressionOptions options;
+    const size_t plain_size = compress_block(telemetry, nullptr, options).size();
+    options.transform = { ByteFilter::Delta, 2, Transposition::BitPlanes, 2 };
+    CHECK(compress_block(telemetry, nullptr, options).size() < plain_size);
+    CHECK(round_trips(telemetry, options) && round_trips(text, options));
+    options.transform = { ByteFilter::Xor, 1, Transposition::Bytes, 4 };
+    CHECK(round_trips(telemetry, options) && round_trips(text, options));
+
+    const std::vector<uint8_t> data(telemetry.begin(), telemetry.begin() + 60000);
+    check_corruption(compress_block(data, nullptr, options), data.size());
+}
+
+// KO: tANS를 허용한 블록은 layout 바이트에 표시하고 왕복해야 하며, 허용하지 않으면 tANS 스트림이 없어야 합니다.
+// EN: A block allowed to use tANS must mark it in the layout byte and round-trip, and without it no stream may use tANS.
+static void test_table_ans() {
+    QuietStreams quiet;
+    const std::vector<uint8_t> skew = skewed_bytes(200000, 37);
+    const auto uses_table_ans = [](const std::vector<uint8_t>& block) {
+        return block.size() > 1 && (block[0] & BLOCK_FLAG_LAYOUT) && (block[1] & LAYOUT_FLAG_TABLE_ANS);
+    };
+    CompressionOptions options;
+    options.allow_table_ans = true;
+    CHECK(uses_table_ans(compress_block(skew, nullptr, options)));
+    CHECK(round_trips(skew, options) && round_trips(text_bytes(200000), options));
+    options.allow_table_ans = false;
+    CHECK(!uses_table_ans(compress_block(skew, nullptr, options)));
+
+    options.allow_table_ans = true;
+    const std::vector<uint8_t> data = skewed_bytes(60000, 38);
+    const std::vector<uint8_t> block = compress_block(data, nullptr, options);
+    CHECK(uses_table_ans(block));
+    check_corruption(block, data.size());
+}
+
+// KO: 통계가 도중에 바뀌는 블록에서는 청크 빈도가 블록을 줄여야 하며, 청크보다 짧은 꼬리도 왕복해야 합니다.
+// EN: On a block whose statistics change midway, chunked frequencies must shrink the block, and tails shorter than a chunk must round-trip too.
+static void test_chunked_frequencies() {
+    QuietStreams quiet;
+    std::vector<uint8_t> data = std::vector<uint8_t>(150000, 0x0F);
+    const std::vector<uint8_t> skew = skewed_bytes(150003, 39);
+    data.insert(data.end(), skew.begin(), skew.end());
+
+    CompressionOptions options;
+    options.allow_table_ans = false;
+    const size_t static_size = compress_block(data, nullptr, options).size();
+    for (uint64_t chunk_kib : { 1u, 4u, 64u }) {
+        options.freq_chunk_kib = chunk_kib;
+        const std::vector<uint8_t> block = compress_block(data, nullptr, options);
+        CHECK(!block.empty() && (block[0] & BLOCK_FLAG_CHUNKED_FREQS));
+        CHECK(block.size() < static_size);
+        CHECK(round_trips(data, options));
+    }
+
+    options.freq_chunk_kib = 1;
+    const std::vector<uint8_t> small = skewed_bytes(60000, 22);
+    check_corruption(compress_block(small, nullptr, options), small.size());
+}
+
+// KO: 융합 경로는 청크 단위로 분리하고 공급원에서 스트림을 받아 재조립하므로, 청크 경계 양쪽의 크기와 모든 심볼 폭을 시험합니다.
+//     스트림 길이가 원본 크기와 맞지 않으면 재조립은 빈 결과를 반환해야 합니다.
+// EN: The fused paths separate chunk by chunk and reassemble from stream sources, so sizes on both sides of a chunk boundary
+//     and every symbol width are tested. Reassembly must return an empty result when the stream lengths do not match the original size.
+static void test_fused_pipelines() {
+    QuietStreams quiet;
+    constexpr size_t chunk = SeparationEngine::SEPARATION_CHUNK_BYTES;
+    CompressionOptions options;
+    options.allow_table_ans = false;
+    for (size_t size : { chunk - 1, chunk, chunk + 1, 5 * chunk + 77 }) {
+        for (unsigned width : { 1u, 2u, 4u }) {
+            options.symbol_width = width;
+            CHECK(round_trips(skewed_bytes(size, static_cast<uint32_t>(size + width)), options));
+        }
+    }
+
+    SeparationEngine engine;
+    const std::vector<uint8_t> data = skewed_bytes(3 * chunk + 5, 40);
+    for (unsigned width : { 1u, 2u, 4u }) {
+        const SeparatedStreams streams = engine.separate(data, std::nullopt, width);
+        StoredBitSource value_bitmap(streams.value_bitmap), auxiliary_mask(streams.auxiliary_mask), reconstructed(streams.reconstructed_stream);
+        CHECK(engine.reconstruct(value_bitmap, auxiliary_mask, reconstructed, streams.aux_mask_1_represents_11, data.size(), width) == data);
+
+        StoredBitSource short_bitmap(streams.value_bitmap), short_mask(streams.auxiliary_mask), short_reconstructed(streams.reconstructed_stream);
+        CHECK(engine.reconstruct(short_bitmap, short_mask, short_reconstructed, streams.aux_mask_1_represents_11, data.size() + 1, width).empty());
+    }
+}
+
+// KO: 큰 블록의 병렬 분리는 스레드 수와 관계없이 같은 스트림과 같은 블록을 만들어야 합니다.
+// EN: The parallel separation of a large block must produce the same streams and the same block whatever the thread count.
+static void test_parallel_separation() {
+    QuietStreams quiet;
+    const std::vector<uint8_t> data = skewed_bytes((3 << 20) + 13, 41);
+    SeparationEngine engine;
+    for (unsigned width : { 1u, 2u, 4u }) {
+        const SeparatedStreams serial = engine.separate(data, std::nullopt, width, SymbolPairing::Canonical, 1);
+        const SeparatedStreams parallel = engine.separate(data, std::nullopt, width, SymbolPairing::Canonical, 4);
+        CHECK(serial.value_bitmap.bit_count == parallel.value_bitmap.bit_count && serial.value_bitmap.words == parallel.value_bitmap.words);
+        CHECK(serial.auxiliary_mask.bit_count == parallel.auxiliary_mask.bit_count && serial.auxiliary_mask.words == parallel.auxiliary_mask.words);
+        CHECK(serial.reconstructed_stream.bit_count == parallel.reconstructed_stream.bit_count &&
+              serial.reconstructed_stream.words == parallel.reconstructed_stream.words);
+    }
+
+    CompressionOptions options;
+    options.threads = 1;
+    const std::vector<uint8_t> serial_block = compress_block(data, nullptr, options);
+    options.threads = 4;
+    CHECK(compress_block(data, nullptr, options) == serial_block);
+    CHECK(round_trips(data, options));
+}
+
+// KO: 다단계 블록은 모든 깊이에서 왕복해야 하며, 중첩 블록이 손상되어도 충돌 없이 실패해야 합니다.
+//     균일 심볼과 혼합 심볼이 번갈아 나오는 데이터는 reconstructed_stream이 반복 무늬가 되어 0차 rANS로는 줄지 않으므로,
+//     다시 분리하면 크게 줄어듭니다.
+// EN: Multi-level blocks must round-trip at every depth, and a damaged nested block must fail without crashing.
+//     In data alternating uniform and mixed symbols the reconstructed_stream becomes a repeating pattern that order-0 rANS
+//     cannot shrink, so separating it again shrinks it a lot.
+static void test_stream_tree() {
+    QuietStreams quiet;
+    std::mt19937 rng(42);
+    std::vector<uint8_t> data(300000);
+    for (uint8_t& byte : data) {
+        static const uint8_t uniform[2] = { 0b00, 0b11 }, mixed[2] = { 0b01, 0b10 };
+        byte = static_cast<uint8_t>(uniform[rng() % 2] << 6 | mixed[rng() % 2] << 4 | uniform[rng() % 2] << 2 | mixed[rng() % 2]);
+    }
+    CompressionOptions options;
+    options.allow_table_ans = false;
+    const size_t single_level_size = compress_block(data, nullptr, options).size();
+    for (unsigned depth = 1; depth <= MAX_STREAM_TREE_DEPTH; ++depth) {
+        options.stream_tree_depth = depth;
+        const std::vector<uint8_t> block = compress_block(data, nullptr, options);
+        CHECK(!block.empty() && !(block[0] & BLOCK_FLAG_SINGLE_LEVEL) && block.size() < single_level_size);
+        CHECK(round_trips(data, options) && round_trips(text_bytes(300000), options));
+    }
+
+    const std::vector<uint8_t> small(data.begin(), data.begin() + 60000);
+    const std::vector<uint8_t> block = compress_block(small, nullptr, options);
+    CHECK(!block.empty() && !(block[0] & BLOCK_FLAG_SINGLE_LEVEL));
+    check_corruption(block, small.size());
+}
+
+// KO: 긴 반복이 있는 블록은 일치 사전 처리로 크게 줄어야 하며, 반복이 없는 블록도 왕복해야 합니다.
+// EN: A block with long repeats must shrink a lot with the match prepass, and blocks without repeats must round-trip as well.
+static void test_match_prepass() {
+    QuietStreams quiet;
+    const std::vector<uint8_t> record = random_bytes(5000, 43);
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 40; ++i) {
+        data.insert(data.end(), record.begin(), record.end());
+        data.push_back(static_cast<uint8_t>(i));
+    }
+    CompressionOptions options;
+    const size_t plain_size = compress_block(data, nullptr, options).size();
+    options.match_prepass = true;
+    const std::vector<uint8_t> block = compress_block(data, nullptr, options);
+    CHECK(block.size() * 4 < plain_size);
+    CHECK(round_trips(data, options));
+    CHECK(round_trips(text_bytes(300000), options) && round_trips(random_bytes(30000, 44), options));
+
+    const std::vector<uint8_t> small(data.begin(), data.begin() + 30000);
+    check_corruption(compress_block(small, nullptr, options), small.size());
+}
+
+// KO: 모든 압축 수준의 블록은 왕복해야 하며, 손상된 블록은 충돌 없이 실패해야 합니다.
+// EN: Blocks of every compression level must round-trip, and damaged blocks must fail without crashing.
+static void test_levels() {
+    QuietStreams quiet;
+    const std::vector<std::vector<uint8_t>> inputs = {
+        {}, { 42 }, std::vector<uint8_t>(100000, 0), text_bytes(300000), skewed_bytes(200000, 1), random_bytes(50000, 2), telemetry_bytes(100000),
+    };
+    for (unsigned level = MIN_COMPRESSION_LEVEL; level <= MAX_COMPRESSION_LEVEL; ++level) {
+        const CompressionOptions options = compression_level_options(level);
+        for (const std::vector<uint8_t>& data : inputs) CHECK(round_trips(data, options));
+    }
+
+    const std::vector<uint8_t> text = text_bytes(60000);
+    const std::vector<uint8_t> skew = skewed_bytes(60000, 22);
+    for (unsigned level = MIN_COMPRESSION_LEVEL; level <= MAX_COMPRESSION_LEVEL; level += 2) {
+        const CompressionOptions options = compression_level_options(level);
+        check_corruption(compress_block(text, nullptr, options), text.size());
+        check_corruption(compress_block(skew, nullptr, options), skew.size());
+    }
+}
+
+// KO: 압축되지 않는 블록은 원본에 1바이트만 더한 저장 블록이 되어야 합니다.
+// EN: An incompressible block must become a stored block, only one byte larger than the original.
+static void test_stored_blocks() {
+    QuietStreams quiet;
+    const std::vector<uint8_t> data = random_bytes(20000, 6);
+    const std::vector<uint8_t> block = compress_block(data, nullptr, compression_level_options(DEFAULT_COMPRESSION_LEVEL));
+    CHECK(!block.empty() && block[0] == BLOCK_STORED);
+    CHECK(block.size() == data.size() + 1);
+    CHECK(round_trips(data, compression_level_options(DEFAULT_COMPRESSION_LEVEL)));
+
+    // KO: 수준 1은 추정만으로 압축되지 않는 블록을 건너뛰며, 저장 블록을 끄면 압축한 블록을 그대로 씁니다.
+    // EN: Level 1 skips blocks the estimate deems incompressible, and with stored blocks off the compressed block is written as is.
+    CHECK(compress_block(data, nullptr, compression_level_options(MIN_COMPRESSION_LEVEL)) == block);
+    CompressionOptions options;
+    options.store_incompressible = false;
+    const std::vector<uint8_t> compressed = compress_block(data, nullptr, options);
+    CHECK(!compressed.empty() && compressed[0] != BLOCK_STORED && compressed.size() > block.size());
+
+    // KO: 저장 블록 뒤에 예약된 플래그 값은 거부되어야 합니다.
+    // EN: Reserved flag values after a stored block must be rejected.
+    std::vector<uint8_t> invalid = block;
+    invalid[0] = BLOCK_STORED | (1 << 2);
+    std::vector<uint8_t> output;
+    try_decompress(invalid, nullptr, nullptr, output);
+    CHECK(output.empty());
+}
+
+static void test_reference_blocks() {
+    QuietStreams quiet;
+    uint64_t offset = 0, size = 0;
+    const std::vector<uint8_t> block = make_reference_block(123456789, 8 << 20);
+    CHECK(read_reference_block(block, offset, size) && offset == 123456789 && size == (8u << 20));
+    uint64_t original_size = 0;
+    CHECK(read_block_original_size(block, original_size) && original_size == (8u << 20));
+
+    // KO: 참조 블록은 컨테이너가 풀어야 하므로 혼자서는 복호화되지 않습니다.
+    // EN: A reference block must be resolved by the container, so it does not decode on its own.
+    std::vector<uint8_t> output;
+    try_decompress(block, nullptr, nullptr, output);
+    CHECK(output.empty());
+
+    for (size_t length = 0; length < block.size(); ++length) {
+        const std::vector<uint8_t> truncated(block.begin(), block.begin() + length);
+        CHECK(!read_reference_block(truncated, offset, size));
+    }
+}
+
+static void test_linked_blocks() {
+    QuietStreams quiet;
+    const CompressionOptions options = compression_level_options(DEFAULT_COMPRESSION_LEVEL);
+    const std::vector<uint8_t> previous = skewed_bytes(4096, 7);
+    const std::vector<uint8_t> data = skewed_bytes(4096, 8);
+    const std::vector<uint8_t> block = compress_linked_block(data, previous, nullptr, options);
+    CHECK(is_linked_block(block));
+
+    std::vector<uint8_t> output;
+    CHECK(try_decompress(block, nullptr, &previous, output) && output == data);
+
+    // KO: 앞 블록이 없거나 다르면 복호화는 실패해야 합니다.
+    // EN: Decoding must fail without the previous block or with a different one.
+    try_decompress(block, nullptr, nullptr, output);
+    CHECK(output.empty());
+    const std::vector<uint8_t> other = skewed_bytes(4096, 9);
+    try_decompress(block, nullptr, &other, output);
+    CHECK(output.empty() || output != data);
+
+    check_corruption(block, data.size(), nullptr, &previous);
+}
+
+// KO: 레인 배치는 긴 rANS 스트림에만 쓰이므로, 레인으로 부호화되도록 큰 블록을 씁니다.
+// EN: The lane layout is only used for long rANS streams, so blocks large enough to be coded in lanes are used.
+static void test_lanes() {
+    QuietStreams quiet;
+    CompressionOptions options;
+    options.allow_table_ans = false;
+    options.lane_interleaved = true;
+    for (const std::vector<uint8_t>& data : { skewed_bytes(2000000, 4), text_bytes(1000000), std::vector<uint8_t>(1000000, 0x55) }) {
+        CHECK(round_trips(data, options));
+    }
+
+    // KO: 레인 수(32)의 배수가 아닌 길이에서도 꼬리가 맞게 복호화되어야 합니다.
+    // EN: The tail must decode correctly for lengths that are not a multiple of the lane count (32).
+    for (size_t size : { 65537u, 100003u, 262151u }) {
+        CHECK(round_trips(skewed_bytes(size, static_cast<uint32_t>(size)), options));
+    }
+
+    const std::vector<uint8_t> data = skewed_bytes(300000, 5);
+    check_corruption(compress_block(data, nullptr, options), data.size());
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// --- 컨테이너 테스트 ---
+// --- Container Tests ---
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 블록 목록을 프로그램과 같은 방식으로 아카이브에 씁니다. 앞에 나온 블록과 같은 블록은 참조로 쓰며, block_stats이면 블록 통계를 기록합니다.
+//     link_interval이 0이 아니면 link_interval번째마다의 블록을 제외한 블록을 앞 블록에 연결합니다.
+// EN: Writes a list of blocks to an archive the way the program does. A block identical to an earlier one is written as a reference,
+//     and block statistics are stored if block_stats is set. If link_interval is non-zero, every block except each link_interval-th
+//     one is linked to the previous block.
+static std::string write_archive(const std::vector<std::vector<uint8_t>>& blocks, ContainerIndex& index, bool block_stats = true,
+                                 uint64_t link_interval = 0) {
+    std::ostringstream out(std::ios::binary);
+    out.write(reinterpret_cast<const char*>(CONTAINER_MAGIC), sizeof(CONTAINER_MAGIC));
+    index = {};
+    index.has_stats = block_stats;
+    const CompressionOptions options = compression_level_options(DEFAULT_COMPRESSION_LEVEL);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const std::vector<uint8_t>& data = blocks[i];
+        std::vector<uint8_t> block;
+        for (size_t j = 0; j < i && block.empty(); ++j) {
+            if (blocks[j] == data) block = make_reference_block(index.blocks[j].original_offset, data.size());
+        }
+        if (block.empty()) {
+            const bool linked = link_interval > 0 && i % link_interval != 0;
+            block = linked ? compress_linked_block(data, blocks[i - 1], nullptr, options) : compress_block(data, nullptr, options);
+        }
+        write_container_block(out, block, data.size(), compute_block_stats(data.data(), data.size()), index);
+    }
+    write_container_index(out, index);
+    return out.str();
+}
+
+static std::vector<uint8_t> concatenate(const std::vector<std::vector<uint8_t>>& blocks) {
+    std::vector<uint8_t> data;
+    for (const std::vector<uint8_t>& block : blocks) data.insert(data.end(), block.begin(), block.end());
+    return data;
+}
+
+static void test_container_index() {
+    QuietStreams quiet;
+    std::vector<std::vector<uint8_t>> blocks = { text_bytes(5000), random_bytes(3000, 23), {}, skewed_bytes(7000, 24), text_bytes(5000) };
+    ContainerIndex written;
+    const std::string archive = write_archive(blocks, written);
+
+    std::istringstream in(archive, std::ios::binary);
+    ContainerIndex index;
+    CHECK(read_container_index(in, index));
+    CHECK(index.blocks.size() == blocks.size() && index.has_stats);
+    CHECK(index.original_size() == concatenate(blocks).size());
+    std::vector<uint8_t> output;
+    for (size_t i = 0; i < index.blocks.size() && i < blocks.size(); ++i) {
+        CHECK(index.blocks[i].offset == written.blocks[i].offset && index.blocks[i].original_size == blocks[i].size());
+        std::vector<uint8_t> block;
+        CHECK(read_container_block(in, index.blocks[i], block));
+        uint64_t offset = 0, size = 0;
+        if (i == 4) CHECK(read_reference_block(block, offset, size) && offset == index.blocks[0].original_offset && size == blocks[0].size());
+        else CHECK(try_decompress(block, nullptr, nullptr, output) && output == blocks[i]);
+    }
+    CHECK(index.blocks[1].stats.min_byte == 0 && index.blocks[1].stats.max_byte == 255);
+    CHECK(blocks_with_byte_range(index, 200, 255) == std::vector<size_t>({ 1 }));
+
+    // KO: 색인에 기록하지 않는 심볼 11의 수도 원본에서 센 값과 같아야 합니다.
+    // EN: The count of symbol 11, which the index does not store, must equal the count taken from the original as well.
+    for (size_t i = 0; i < index.blocks.size() && i < blocks.size(); ++i) {
+        const BlockStats expected = compute_block_stats(blocks[i].data(), blocks[i].size());
+        CHECK(std::equal(expected.symbol_counts, expected.symbol_counts + 4, index.blocks[i].stats.symbol_counts));
+    }
+
+    // KO: 통계를 요청하지 않은 아카이브의 색인에는 통계가 없으며, 질의는 아무 블록도 고르지 않습니다.
+    // EN: The index of an archive written without statistics has none, and queries select no block.
+    ContainerIndex plain_written, plain;
+    const std::string plain_archive = write_archive(blocks, plain_written, false);
+    std::istringstream plain_in(plain_archive, std::ios::binary);
+    CHECK(read_container_index(plain_in, plain) && !plain.has_stats && plain.blocks.size() == blocks.size());
+    CHECK(plain_archive.size() < archive.size() && blocks_with_symbol(plain, 0).empty());
+
+    // KO: 추가 모드처럼 blocks_end부터 새 블록과 색인을 다시 쓰면, 앞 블록은 그대로이고 새 블록이 뒤에 이어져야 합니다.
+    // EN: Rewriting new blocks and the index from blocks_end, as the append mode does, must keep the earlier blocks and continue after them.
+    ContainerIndex appended = index;
+    std::ostringstream out(std::ios::binary);
+    out.write(archive.data(), static_cast<std::streamsize>(appended.blocks_end));
+    const std::vector<uint8_t> extra = skewed_bytes(4000, 45);
+    write_container_block(out, compress_block(extra), extra.size(), compute_block_stats(extra.data(), extra.size()), appended);
+    write_container_index(out, appended);
+    std::istringstream appended_in(out.str(), std::ios::binary);
+    ContainerIndex reread;
+    CHECK(read_container_index(appended_in, reread) && reread.blocks.size() == blocks.size() + 1);
+    CHECK(reread.original_size() == index.original_size() + extra.size());
+    std::vector<uint8_t> last;
+    CHECK(!reread.blocks.empty() && read_container_block(appended_in, reread.blocks.back(), last));
+    CHECK(try_decompress(last, nullptr, nullptr, output) && output == extra);
+
+    // KO: 잘리거나 손상된 색인은 읽히지 않거나, 읽히더라도 파일 밖을 가리키는 블록을 가져서는 안 됩니다.
+    //     색인이 잘려 나간 아카이브는 색인 없는 컨테이너로 읽힐 수 있으며, 그때는 통계가 없고 온전한 프레임만 담깁니다.
+    // EN: A truncated or damaged index must not be read, or if it is, must not hold blocks that point outside the file.
+    //     An archive whose index was cut off may read as a container without an index, which has no statistics and only whole frames.
+    for (size_t length = 0; length < archive.size(); length += 7) {
+        const std::string prefix = archive.substr(0, length);
+        std::istringstream truncated(prefix, std::ios::binary);
+        ContainerIndex damaged;
+        if (!read_container_index(truncated, damaged)) continue;
+        CHECK(!damaged.has_stats && damaged.blocks_end == prefix.size() && damaged.blocks.size() <= blocks.size());
+    }
+    std::mt19937 rng(25);
+    for (int trial = 0; trial < 500; ++trial) {
+        std::string flipped = archive;
+        const size_t position = written.blocks_end + rng() % (archive.size() - written.blocks_end);
+        flipped[position] = static_cast<char>(flipped[position] ^ (1 << (rng() % 8)));
+        std::istringstream damaged_in(flipped, std::ios::binary);
+        ContainerIndex damaged;
+        if (!read_container_index(damaged_in, damaged)) continue;
+        for (const ContainerBlock& block : damaged.blocks) {
+            CHECK(block.offset + block.compressed_size <= flipped.size());
+        }
+    }
+}
+
+// KO: 여러 파일을 한 아카이브에 담으면 멤버 표가 각 파일의 블록 범위와 원본 범위를 기록해야 합니다. 빈 파일은 블록이 없는 멤버입니다.
+// EN: When several files go into one archive, the member table must record the block range and original range of every file.
+//     An empty file is a member without blocks.
+static void test_container_members() {
+    QuietStreams quiet;
+    const std::vector<std::vector<std::vector<uint8_t>>> files = {
+        { text_bytes(4000), text_bytes(1000) }, {}, { skewed_bytes(3000, 47) },
+    };
+    std::ostringstream out(std::ios::binary);
+    out.write(reinterpret_cast<const char*>(CONTAINER_MAGIC), sizeof(CONTAINER_MAGIC));
+    ContainerIndex written;
+    for (size_t f = 0; f < files.size(); ++f) {
+        for (const std::vector<uint8_t>& data : files[f]) {
+            write_container_block(out, compress_block(data), data.size(), BlockStats(), written);
+        }
+        add_container_member(written, "dir/file" + std::to_string(f));
+    }
+    write_container_index(out, written);
+
+    std::istringstream in(out.str(), std::ios::binary);
+    ContainerIndex index;
+    CHECK(read_container_index(in, index) && index.members.size() == files.size());
+    size_t first_block = 0;
+    uint64_t original_offset = 0;
+    for (size_t f = 0; f < files.size() && f < index.members.size(); ++f) {
+        const ContainerMember& member = index.members[f];
+        const uint64_t size = concatenate(files[f]).size();
+        CHECK(member.name == "dir/file" + std::to_string(f) && member.first_block == first_block && member.block_count == files[f].size());
+        CHECK(member.original_offset == original_offset && member.original_size == size);
+        first_block += files[f].size();
+        original_offset += size;
+    }
+}
+
+// KO: 아카이브 파일을 임시 경로에 쓰고 ArchiveReader로 엽니다.
+// EN: Writes the archive to a temporary path and opens it with an ArchiveReader.
+static bool open_archive(ArchiveReader& reader, const std::string& archive, const std::filesystem::path& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(archive.data(), static_cast<std::streamsize>(archive.size()));
+    out.close();
+    return reader.open(path);
+}
+
+static void test_archive_reader() {
+    QuietStreams quiet;
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "TriSplitTests.tsp";
+
+    // KO: 참조 블록과 연결 블록이 섞인 아카이브의 모든 범위가 원본과 같아야 합니다. 캐시가 블록 하나보다 작아도 마찬가지입니다.
+    // EN: Every range of an archive mixing reference and linked blocks must equal the original, even with a cache smaller than one block.
+    std::vector<std::vector<uint8_t>> blocks;
+    for (uint32_t i = 0; i < 24; ++i) blocks.push_back(i % 5 == 4 ? blocks[i - 3] : skewed_bytes(3000 + 17 * i, 30 + i));
+    const std::vector<uint8_t> original = concatenate(blocks);
+    ContainerIndex index;
+    const std::string archive = write_archive(blocks, index, true, 6);
+    for (size_t cache_bytes : { size_t(1) << 20, size_t(1000) }) {
+        ArchiveReader reader(cache_bytes);
+        CHECK(open_archive(reader, archive, path) && reader.size() == original.size());
+        std::vector<uint8_t> output(original.size());
+        CHECK(reader.read(0, output.data(), output.size()) == original.size() && output == original);
+        std::mt19937 rng(26);
+        for (int trial = 0; trial < 100; ++trial) {
+            const uint64_t offset = rng() % original.size();
+            const size_t size = std::min<size_t>(rng() % 10000, original.size() - offset);
+            std::vector<uint8_t> range(size);
+            CHECK(reader.read(offset, range.data(), size) == size && std::equal(range.begin(), range.end(), original.begin() + offset));
+        }
+        CHECK(reader.read(original.size(), output.data(), 1) == 0);
+    }
+
+    // KO: 긴 연결 사슬의 마지막 블록을 임의 접근해도 스택이 넘치지 않아야 합니다.
+    // EN: Random access to the last block of a long linked chain must not overflow the stack.
+    blocks.clear();
+    for (uint32_t i = 0; i < 20000; ++i) blocks.push_back(skewed_bytes(64, 100 + i));
+    {
+        ArchiveReader reader(1 << 20);
+        CHECK(open_archive(reader, write_archive(blocks, index, false, 20000), path));
+        const ArchiveReader::Block last = reader.block(blocks.size() - 1);
+        CHECK(last && *last == blocks.back());
+    }
+
+    // KO: 손상된 블록은 읽기를 짧게 끝내야 하며 충돌해서는 안 됩니다.
+    // EN: A damaged block must end the read short and must not crash.
+    blocks = { text_bytes(20000), text_bytes(20000), skewed_bytes(20000, 27) };
+    std::string damaged = write_archive(blocks, index);
+    damaged[index.blocks[1].offset + index.blocks[1].compressed_size / 2] ^= 0x40;
+    damaged[index.blocks[1].offset] ^= 0x01;
+    {
+        ArchiveReader reader(1 << 20);
+        CHECK(open_archive(reader, damaged, path));
+        std::vector<uint8_t> output(60000);
+        const size_t read = reader.read(0, output.data(), output.size());
+        CHECK(read == blocks[0].size() && std::equal(blocks[0].begin(), blocks[0].end(), output.begin()));
+    }
+    std::filesystem::remove(path);
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// --- 작업 풀 테스트 ---
+// --- Work Pool Tests ---
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 바깥에서 넣은 작업과 작업자가 넣은 작업이 모두 한 번씩 실행되어야 하며, 작업자 번호는 풀 크기보다 작아야 합니다.
+// EN: Tasks submitted from outside and from workers must all run exactly once, and worker numbers must be below the pool size.
+static void test_work_pool() {
+    WorkStealingPool pool(4);
+    CHECK(pool.size() == 4);
+    std::vector<std::atomic<int>> runs(2000);
+    std::atomic<bool> valid_workers = true;
+    for (int round = 0; round < 2; ++round) {
+        for (size_t i = 0; i < runs.size() / 2; ++i) {
+            pool.submit([&, i](unsigned worker) {
+                if (worker >= 4) valid_workers = false;
+                ++runs[i];
+                pool.submit([&, i](unsigned nested_worker) {
+                    if (nested_worker >= 4) valid_workers = false;
+                    ++runs[runs.size() / 2 + i];
+                });
+            });
+        }
+        pool.wait();
+        CHECK(std::all_of(runs.begin(), runs.end(), [&](const std::atomic<int>& count) { return count == round + 1; }));
+    }
+    CHECK(valid_workers);
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// --- 버퍼 풀 테스트 ---
+// --- Buffer Pool Tests ---
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 큰 영역은 POOL_REGION_ALIGN으로 정렬되어야 하며, 해제한 영역은 같은 스레드의 같은 크기 요청에 다시 쓰여야 합니다.
+// EN: Large regions must be aligned to POOL_REGION_ALIGN, and a released region must be reused for a request of the same size on the same thread.
+static void test_buffer_pool() {
+    const size_t bytes = 3 * POOL_MIN_BYTES + 5;
+    uint8_t* region = static_cast<uint8_t*>(pool_allocate(bytes));
+    CHECK(region != nullptr && reinterpret_cast<uintptr_t>(region) % POOL_REGION_ALIGN == 0);
+    std::fill(region, region + bytes, uint8_t(0xA5));
+    CHECK(region[bytes - 1] == 0xA5);
+    pool_release(region, bytes);
+    void* reused = pool_allocate(bytes);
+    CHECK(reused == region);
+    pool_release(reused, bytes);
+
+    // KO: 작은 요청과 큰 요청이 섞인 벡터도 보통의 벡터처럼 동작해야 합니다.
+    // EN: Vectors growing from small to large requests must behave like ordinary vectors.
+    std::vector<uint64_t, PoolAllocator<uint64_t>> words;
+    for (uint64_t i = 0; i < POOL_MIN_BYTES; ++i) words.push_back(i * 3);
+    bool same = true;
+    for (uint64_t i = 0; i < words.size(); ++i) same = same && words[i] == i * 3;
+    CHECK(same && words.size() == POOL_MIN_BYTES);
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// --- 성능 측정 테스트 ---
+// --- Profiling Tests ---
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// KO: 측정을 켜면 카운터를 열 수 없는 호스트에서도 단계마다 한 줄이 보고되어야 합니다. 측정은 켠 뒤 끌 수 없으므로 마지막에 시험합니다.
+// EN: With the measurement on, every stage must get a report line even on hosts where the counters cannot be opened.
+//     The measurement cannot be turned off once on, so this is tested last.
+static void test_perf_profile() {
+    QuietStreams quiet;
+    enable_perf_profiling();
+    CHECK(perf_profiling_enabled());
+    const std::vector<uint8_t> data = skewed_bytes(100000, 46);
+    CompressionOptions options;
+    options.allow_table_ans = false;
+    CHECK(round_trips(data, options));
+
+    std::ostringstream report;
+    report_perf_profile(report);
+    CHECK(report.str().find("separate+encode (fused)") != std::string::npos);
+    CHECK(report.str().find("reconstruct") != std::string::npos);
+}
+
+int main() {
+    test_default_blocks();
+    test_rans_blocks();
+    test_packed_bits();
+    test_trained_model();
+    test_compact_blocks();
+    test_symbol_widths();
+    test_symbol_pairing();
+    test_estimate();
+    test_transforms();
+    test_table_ans();
+    test_chunked_frequencies();
+    test_fused_pipelines();
+    test_parallel_separation();
+    test_stream_tree();
+    test_match_prepass();
+    test_levels();
+    test_stored_blocks();
+    test_reference_blocks();
+    test_linked_blocks();
+    test_lanes();
+    test_container_index();
+    test_container_members();
+    test_archive_reader();
+    test_work_pool();
+    test_buffer_pool();
+    test_perf_profile();
+
+    if (failed_checks != 0) {
+        std::cerr << failed_checks << " check(s) failed." << std::endl;
+        return 1;
+    }
+    std::cout << "All tests passed." << std::endl;
+    return 0;
+}